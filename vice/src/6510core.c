@@ -392,6 +392,35 @@ do {                                                                   \
             profile_rtx(reg_sp + 1); \
     } while (0)
 
+#elif defined(SAMPLEPROF)
+/* the drive CPUs only track calls for the sampling profiler */
+#define CHECK_PROFILE_INTERRUPT(dest_addr, handler)                     \
+    do {                                                                \
+        if (SAMPLEPROF->active) {                                       \
+            sampleprof_interrupt(SAMPLEPROF, dest_addr, reg_sp + 1);    \
+        }                                                               \
+    } while (0)
+
+#define CHECK_PROFILE_JSR(dest_addr)                              \
+    do {                                                          \
+        if (SAMPLEPROF->active) {                                 \
+            sampleprof_call(SAMPLEPROF, dest_addr, reg_sp);       \
+        }                                                         \
+    } while (0)
+
+#define CHECK_PROFILE_RTS()                             \
+    do {                                                \
+        if (SAMPLEPROF->active) {                       \
+            sampleprof_return(SAMPLEPROF, reg_sp);      \
+        }                                               \
+    } while (0)
+
+#define CHECK_PROFILE_RTI()                             \
+    do {                                                \
+        if (SAMPLEPROF->active) {                       \
+            sampleprof_return(SAMPLEPROF, reg_sp + 1);  \
+        }                                               \
+    } while (0)
 #else
 #define CHECK_PROFILE_INTERRUPT(dest_addr, handler)
 #define CHECK_PROFILE_JSR(dest_addr)
@@ -99,6 +99,35 @@
 #define REWIND_FETCH_OPCODE(clock, amount) clock -= amount
 #endif
 
+/* Call tracking for the sampling profiler, used after the jump to the
+   called code and before the return address is pulled. */
+#ifdef SAMPLEPROF
+#define CHECK_SAMPLEPROF_INTERRUPT()                                  \
+    do {                                                              \
+        if (SAMPLEPROF->active) {                                     \
+            sampleprof_interrupt(SAMPLEPROF, reg_pc, reg_sp + 1);     \
+        }                                                             \
+    } while (0)
+
+#define CHECK_SAMPLEPROF_JSR()                              \
+    do {                                                    \
+        if (SAMPLEPROF->active) {                           \
+            sampleprof_call(SAMPLEPROF, reg_pc, reg_sp);    \
+        }                                                   \
+    } while (0)
+
+#define CHECK_SAMPLEPROF_RETURN(sp)                     \
+    do {                                                \
+        if (SAMPLEPROF->active) {                       \
+            sampleprof_return(SAMPLEPROF, (sp));        \
+        }                                               \
+    } while (0)
+#else
+#define CHECK_SAMPLEPROF_INTERRUPT()
+#define CHECK_SAMPLEPROF_JSR()
+#define CHECK_SAMPLEPROF_RETURN(sp)
+#endif
+
 /* ------------------------------------------------------------------------- */
 /* Hook for additional delay.  */
 
@@ -321,6 +350,7 @@
                 LOCAL_SET_DECIMAL(0);                                                                         \
                 LOCAL_SET_INTERRUPT(1);                                                                       \
                 JUMP(LOAD_ADDR(0xfffa));                                                                      \
+                CHECK_SAMPLEPROF_INTERRUPT();                                                                 \
                 SET_LAST_OPCODE(0);                                                                           \
                 CLK_ADD(CLK, 2);                                                                              \
             }                                                                                                 \
@@ -346,6 +376,7 @@
                 LOCAL_SET_DECIMAL(0);                                                                         \
                 LOCAL_SET_INTERRUPT(1);                                                                       \
                 JUMP(LOAD_ADDR(0xfffe));                                                                      \
+                CHECK_SAMPLEPROF_INTERRUPT();                                                                 \
                 SET_LAST_OPCODE(0);                                                                           \
                 CLK_ADD(CLK, 2);                                                                              \
             }                                                                                                 \
@@ -725,6 +756,7 @@
         LOCAL_SET_DECIMAL(0);    \
         LOCAL_SET_INTERRUPT(1);  \
         JUMP(LOAD_ADDR(0xfffe)); \
+        CHECK_SAMPLEPROF_INTERRUPT(); \
         CLK_ADD(CLK, CYCLES_2);  \
     } while (0)
 
@@ -927,6 +959,7 @@
         tmp_addr = (p1 | (LOAD(reg_pc) << 8)); \
         CLK_ADD(CLK, CYCLES_1);                \
         JUMP(tmp_addr);                        \
+        CHECK_SAMPLEPROF_JSR();                \
     } while (0)
 
 #define LDA(value, clk_inc, pc_inc) \
@@ -1177,6 +1210,7 @@
     do {                             \
         uint16_t tmp;                    \
                                      \
+        CHECK_SAMPLEPROF_RETURN(reg_sp + 1); \
         LOAD(reg_sp | 0x100);        \
         CLK_ADD(CLK, CYCLES_4);      \
         tmp = (uint16_t)PULL();          \
@@ -1190,6 +1224,7 @@
     do {                           \
         uint16_t tmp;                  \
                                    \
+        CHECK_SAMPLEPROF_RETURN(reg_sp); \
         LOAD(reg_sp | 0x100);      \
         CLK_ADD(CLK, CYCLES_3);    \
         tmp = PULL();              \
@@ -1646,6 +1681,7 @@
         history_clk = CLK;
 #endif
 #endif
+
         SET_LAST_ADDR(reg_pc);
         FETCH_OPCODE(opcode);
 
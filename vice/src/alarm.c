@@ -85,6 +85,8 @@ void alarm_context_time_warp(alarm_context_t *context, CLOCK warp_amount,
         return;
     }
 
+    alarm_trace_time_warp(context, warp_amount, warp_direction);
+
     for (i = 0; i < context->num_pending_alarms; i++) {
         if (warp_direction > 0) {
             context->pending_alarms[i].clk += warp_amount;
@@ -176,6 +178,8 @@ void alarm_unset(alarm_t *alarm)
     }
     context = alarm->context;
 
+    alarm_trace_unset(alarm);
+
     if (context->num_pending_alarms > 1) {
         int last;
 
@@ -210,3 +214,72 @@ void alarm_log_too_many_alarms(void)
 {
     log_error(LOG_DEFAULT, "alarm_set(): Too many alarms set!");
 }
+
+/* ------------------------------------------------------------------------ */
+
+#ifdef ALARM_TRACE
+
+/* One line per operation, contexts and alarms are identified by address:
+
+   S <context> <alarm> <clk>       alarm_set()
+   U <context> <alarm>             alarm_unset() of a pending alarm
+   D <context> <clk>               alarm_context_dispatch()
+   W <context> <amount> <dir>      alarm_context_time_warp()  */
+
+static FILE *alarm_trace_file = NULL;
+static int alarm_trace_disabled = 0;
+
+/* Returns NULL when the trace file cannot be written, tracing is then off
+   for the rest of the session.  */
+static FILE *alarm_trace_open(void)
+{
+    if (alarm_trace_file == NULL && !alarm_trace_disabled) {
+        alarm_trace_file = fopen("alarmtrace.txt", "w");
+        if (alarm_trace_file == NULL) {
+            log_error(LOG_DEFAULT, "Cannot open `alarmtrace.txt', alarm tracing disabled.");
+            alarm_trace_disabled = 1;
+        }
+    }
+    return alarm_trace_file;
+}
+
+void alarm_trace_set(alarm_t *alarm, CLOCK cpu_clk)
+{
+    FILE *f = alarm_trace_open();
+
+    if (f != NULL) {
+        fprintf(f, "S %p %p %"PRIu64"\n",
+                (void *)alarm->context, (void *)alarm, cpu_clk);
+    }
+}
+
+void alarm_trace_unset(alarm_t *alarm)
+{
+    FILE *f = alarm_trace_open();
+
+    if (f != NULL) {
+        fprintf(f, "U %p %p\n", (void *)alarm->context, (void *)alarm);
+    }
+}
+
+void alarm_trace_dispatch(alarm_context_t *context, CLOCK cpu_clk)
+{
+    FILE *f = alarm_trace_open();
+
+    if (f != NULL) {
+        fprintf(f, "D %p %"PRIu64"\n", (void *)context, cpu_clk);
+    }
+}
+
+void alarm_trace_time_warp(alarm_context_t *context, CLOCK warp_amount,
+                           int warp_direction)
+{
+    FILE *f = alarm_trace_open();
+
+    if (f != NULL) {
+        fprintf(f, "W %p %"PRIu64" %d\n",
+                (void *)context, warp_amount, warp_direction);
+    }
+}
+
+#endif
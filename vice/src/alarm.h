@@ -32,6 +32,11 @@
 
 #define ALARM_CONTEXT_MAX_PENDING_ALARMS 0x100
 
+/* Define to write every alarm_set(), alarm_unset(), dispatch and time warp to
+   `alarmtrace.txt' in the current directory.  src/tests/alarmbench replays
+   such a trace.  */
+/* #define ALARM_TRACE */
+
 typedef void (*alarm_callback_t)(CLOCK offset, void *data);
 
 /* An alarm.  */
@@ -98,6 +103,18 @@ void alarm_destroy(alarm_t *alarm);
 void alarm_unset(alarm_t *alarm);
 void alarm_log_too_many_alarms(void);
 
+#ifdef ALARM_TRACE
+void alarm_trace_set(alarm_t *alarm, CLOCK cpu_clk);
+void alarm_trace_unset(alarm_t *alarm);
+void alarm_trace_dispatch(alarm_context_t *context, CLOCK cpu_clk);
+void alarm_trace_time_warp(alarm_context_t *context, CLOCK warp_amount, int warp_direction);
+#else
+#define alarm_trace_set(alarm, cpu_clk)
+#define alarm_trace_unset(alarm)
+#define alarm_trace_dispatch(context, cpu_clk)
+#define alarm_trace_time_warp(context, warp_amount, warp_direction)
+#endif
+
 /* ------------------------------------------------------------------------- */
 
 /* Inline functions.  */
@@ -135,6 +152,8 @@ inline static void alarm_context_dispatch(alarm_context_t *context,
     int idx;
     alarm_t *alarm;
 
+    alarm_trace_dispatch(context, cpu_clk);
+
     offset = cpu_clk - context->next_pending_alarm_clk;
 
     idx = context->next_pending_alarm_idx;
@@ -148,6 +167,8 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
     alarm_context_t *context;
     int idx;
 
+    alarm_trace_set(alarm, cpu_clk);
+
     context = alarm->context;
     idx = alarm->pending_idx;
 
@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "rewind.h"
 #include "uiactions.h"
 #include "uiapi.h"
 #include "uisnapshot.h"
@@ -138,6 +139,15 @@ static void history_milestone_reset_action(ui_action_map_t *self)
 {
     event_record_reset_milestone();
 }
+
+/** \brief  Rewind one second action
+ *
+ * \param[in]   self    action map
+ */
+static void history_rewind_action(ui_action_map_t *self)
+{
+    rewind_seek_seconds(1);
+}
 /* }}} */
 
 
@@ -184,6 +194,9 @@ static const ui_action_map_t snapshot_actions[] = {
     {   .action  = ACTION_HISTORY_MILESTONE_RESET,
         .handler = history_milestone_reset_action
     },
+    {   .action  = ACTION_HISTORY_REWIND,
+        .handler = history_rewind_action
+    },
     UI_ACTION_MAP_TERMINATOR
 };
 
@@ -115,6 +115,9 @@ static void vice_directx_destroy_context(video_canvas_t *canvas)
 {
     context_t *context;
 
+    /* a frame still being rendered would be queued on this context */
+    video_canvas_render_wait(canvas);
+
     CANVAS_LOCK();
 
     context = canvas->renderer_context;
@@ -263,6 +266,19 @@ static void vice_directx_update_context(video_canvas_t *canvas, unsigned int wid
     CANVAS_UNLOCK();
 }
 
+/** \brief The pixels of a backbuffer are rendered, queue it for display */
+static void vice_directx_frame_rendered(video_canvas_t *canvas, void *param)
+{
+    context_t *context;
+    backbuffer_t *backbuffer = param;
+
+    CANVAS_LOCK();
+    context = canvas->renderer_context;
+    render_queue_enqueue_for_display(context->render_queue, backbuffer);
+    render_thread_push_job(context->render_thread, render_thread_render);
+    CANVAS_UNLOCK();
+}
+
 /** \brief It's time to draw a complete emulated frame */
 static void vice_directx_refresh_rect(video_canvas_t *canvas,
                                      unsigned int xs, unsigned int ys,
@@ -298,12 +314,10 @@ static void vice_directx_refresh_rect(video_canvas_t *canvas,
 
     CANVAS_UNLOCK();
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
-
-    CANVAS_LOCK();
-    render_queue_enqueue_for_display(context->render_queue, backbuffer);
-    render_thread_push_job(context->render_thread, render_thread_render);
-    CANVAS_UNLOCK();
+    /* With VideoRenderThread the frame is queued for display from the
+       render worker thread once it is complete */
+    video_canvas_render_async(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4,
+                              vice_directx_frame_rendered, backbuffer);
 }
 
 static void vice_directx_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *canvas)
@@ -149,6 +149,9 @@ static void vice_opengl_destroy_context(video_canvas_t *canvas)
 {
     context_t *context;
 
+    /* a frame still being rendered would be queued on this context */
+    video_canvas_render_wait(canvas);
+
     CANVAS_LOCK();
 
     context = canvas->renderer_context;
@@ -330,6 +333,24 @@ static void vice_opengl_update_context(video_canvas_t *canvas, unsigned int widt
     CANVAS_UNLOCK();
 }
 
+/** \brief The pixels of a backbuffer are rendered, queue it for display */
+static void vice_opengl_frame_rendered(video_canvas_t *canvas, void *param)
+{
+    context_t *context;
+    backbuffer_t *backbuffer = param;
+
+    CANVAS_LOCK();
+    context = canvas->renderer_context;
+    if (context->render_thread) {
+        render_queue_enqueue_for_display(context->render_queue, backbuffer);
+        render_thread_push_job(context->render_thread, render_thread_render);
+    } else {
+        /* Thread no longer running, probably shutting down */
+        render_queue_return_to_pool(context->render_queue, backbuffer);
+    }
+    CANVAS_UNLOCK();
+}
+
 /** \brief It's time to draw a complete emulated frame */
 static void vice_opengl_refresh_rect(video_canvas_t *canvas,
                                      unsigned int xs, unsigned int ys,
@@ -365,17 +386,10 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
 
     CANVAS_UNLOCK();
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
-
-    CANVAS_LOCK();
-    if (context->render_thread) {
-        render_queue_enqueue_for_display(context->render_queue, backbuffer);
-        render_thread_push_job(context->render_thread, render_thread_render);
-    } else {
-        /* Thread no longer running, probably shutting down */
-        render_queue_return_to_pool(context->render_queue, backbuffer);
-    }
-    CANVAS_UNLOCK();
+    /* With VideoRenderThread the frame is queued for display from the
+       render worker thread once it is complete */
+    video_canvas_render_async(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4,
+                              vice_opengl_frame_rendered, backbuffer);
 }
 
 
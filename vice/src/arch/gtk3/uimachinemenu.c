@@ -597,6 +597,10 @@ static ui_menu_item_t snapshot_menu[] = {
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_HISTORY_MILESTONE_RESET
     },
+    {   .label    = "Rewind one second",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_HISTORY_REWIND
+    },
     UI_MENU_SEPARATOR,
 
     {   .label    = "Save/Record media...",
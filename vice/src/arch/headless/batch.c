@@ -0,0 +1,430 @@
+/** \file   batch.c
+ * \brief   Headless batch mode
+ *
+ * Runs a list of jobs from a single, fully initialised emulator process.
+ *
+ * Resources, ROMs and the machine are set up once by the normal startup code.
+ * Right before the emulation would start, the process forks a copy of itself
+ * for each job, keeping up to `-batchworkers` copies running at the same time.
+ * Every copy parses its own job command line (for example an image to
+ * autostart plus `-limitcycles` and `-debugcart`) on top of the inherited
+ * state and then runs the machine until it exits.  The parent collects the
+ * exit status of each job and prints one result line per job on stdout:
+ *
+ *  batch: job <n> exit <code> <milliseconds>ms <job command line>
+ *
+ * or `signal <number>` instead of `exit <code>` if the job crashed.
+ *
+ * The job file contains one job per line, empty lines and lines starting
+ * with '#' are ignored. Arguments are separated by whitespace and can be
+ * enclosed in double quotes.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef UNIX_COMPILE
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "archdep.h"
+#include "archdep_tick.h"
+#include "cmdline.h"
+#include "initcmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "util.h"
+
+#include "batch.h"
+
+
+/** \brief  Maximum number of arguments on a single job line
+ */
+#define BATCH_MAX_ARGS  64
+
+
+/** \brief  A single batch job
+ */
+typedef struct batch_job_s {
+    char *line;         /**< job command line as found in the job file */
+#ifdef UNIX_COMPILE
+    pid_t pid;          /**< process running the job, 0 if not started */
+#endif
+    tick_t start;       /**< tick at which the job was started */
+} batch_job_t;
+
+
+/** \brief  Name of the job file (`-batch`)
+ */
+static char *batch_file = NULL;
+
+/** \brief  Number of jobs to run in parallel (`-batchworkers`)
+ *
+ * 0 means one job per online CPU core.
+ */
+static int batch_workers = 0;
+
+
+static int set_batch_file(const char *param, void *extra_param)
+{
+    util_string_set(&batch_file, param);
+    return 0;
+}
+
+static int set_batch_workers(const char *param, void *extra_param)
+{
+    int num = atoi(param);
+
+    if (num < 0) {
+        return -1;
+    }
+    batch_workers = num;
+    return 0;
+}
+
+
+/** \brief  Command line options for the batch mode
+ */
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-batch", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_batch_file, NULL, NULL, NULL,
+      "<Name>", "Run the jobs listed in <Name> (one command line per line) in copies of the initialized machine" },
+    { "-batchworkers", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_batch_workers, NULL, NULL, NULL,
+      "<Number>", "Number of batch jobs to run in parallel (0: one per CPU core)" },
+    CMDLINE_LIST_END
+};
+
+
+/** \brief  Register the batch mode command line options
+ *
+ * \return  0 on success, -1 on failure
+ */
+int batch_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+
+/** \brief  Check if a job file was given on the command line
+ *
+ * \return  true if the batch mode was requested
+ */
+bool batch_is_enabled(void)
+{
+    return batch_file != NULL && *batch_file != '\0';
+}
+
+
+/** \brief  Free memory used by the batch mode
+ */
+void batch_shutdown(void)
+{
+    lib_free(batch_file);
+    batch_file = NULL;
+}
+
+
+#ifdef UNIX_COMPILE
+
+/** \brief  Split a job line into an argument vector
+ *
+ * Modifies \a line in place. argv[0] is set to the program name so the result
+ * can be passed to the command line parser directly.
+ *
+ * \param[in,out]   line    job line
+ * \param[out]      argv    argument vector, BATCH_MAX_ARGS + 1 entries
+ *
+ * \return  number of arguments including argv[0], or -1 on error
+ */
+static int batch_split_line(char *line, char **argv)
+{
+    int argc = 0;
+    char *p = line;
+
+    argv[argc++] = (char *)archdep_program_name();
+
+    while (*p != '\0') {
+        char *out;
+
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (argc >= BATCH_MAX_ARGS) {
+            return -1;
+        }
+        argv[argc++] = out = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            if (*p == '"') {
+                p++;
+                while (*p != '\0' && *p != '"') {
+                    *out++ = *p++;
+                }
+                if (*p == '\0') {
+                    return -1;
+                }
+                p++;
+            } else {
+                *out++ = *p++;
+            }
+        }
+        if (*p != '\0') {
+            p++;
+        }
+        *out = '\0';
+    }
+    argv[argc] = NULL;
+
+    return argc;
+}
+
+
+/** \brief  Read the job file
+ *
+ * \param[out]  jobs    list of jobs, free with lib_free()
+ *
+ * \return  number of jobs, or -1 on error
+ */
+static int batch_read_jobs(batch_job_t **jobs)
+{
+    FILE *fd;
+    char buffer[4096];
+    int num = 0;
+    int size = 64;
+
+    fd = fopen(batch_file, "r");
+    if (fd == NULL) {
+        log_error(LOG_DEFAULT, "Batch: cannot open job file `%s'.", batch_file);
+        return -1;
+    }
+
+    *jobs = lib_malloc(sizeof(batch_job_t) * (size_t)size);
+
+    while (fgets(buffer, sizeof(buffer), fd) != NULL) {
+        char *line = (char *)util_skip_whitespace(buffer);
+
+        if (*line == '\0' || *line == '#') {
+            continue;
+        }
+        /* strip trailing whitespace, including the newline */
+        ((char *)util_skip_whitespace_trailing(line))[1] = '\0';
+
+        if (num == size) {
+            size *= 2;
+            *jobs = lib_realloc(*jobs, sizeof(batch_job_t) * (size_t)size);
+        }
+        (*jobs)[num].line = lib_strdup(line);
+        (*jobs)[num].pid = 0;
+        (*jobs)[num].start = 0;
+        num++;
+    }
+
+    fclose(fd);
+
+    return num;
+}
+
+
+/** \brief  Set up the forked job process
+ *
+ * Parses the job command line on top of the already initialized machine, so
+ * the autostart image and exit conditions get applied on the first reset.
+ * VSID loads the PSID file of the job right away.
+ *
+ * \param[in]   job     job to run
+ *
+ * \return  0 on success, -1 on failure
+ */
+static int batch_start_job(batch_job_t *job)
+{
+    char *argv[BATCH_MAX_ARGS + 1];
+    char *line = lib_strdup(job->line);
+    int argc;
+    int result = -1;
+
+    argc = batch_split_line(line, argv);
+    if (argc < 0) {
+        log_error(LOG_DEFAULT, "Batch: invalid job line `%s'.", job->line);
+    } else {
+        result = initcmdline_check_args(argc, argv);
+        if (result == 0) {
+            result = initcmdline_check_psid();
+        }
+    }
+
+    lib_free(line);
+    return result;
+}
+
+
+/** \brief  Print the result of a finished job
+ *
+ * \param[in]   jobs        list of jobs
+ * \param[in]   num_jobs    number of jobs
+ * \param[in]   pid         process id of the finished job
+ * \param[in]   status      status as returned by wait()
+ *
+ * \return  true if the job exited with exit code 0
+ */
+static bool batch_job_done(batch_job_t *jobs, int num_jobs, pid_t pid, int status)
+{
+    int i;
+
+    for (i = 0; i < num_jobs; i++) {
+        if (jobs[i].pid == pid) {
+            uint32_t msec = TICK_TO_MILLI(tick_now_delta(jobs[i].start));
+
+            if (WIFEXITED(status)) {
+                fprintf(stdout, "batch: job %d exit %d %ums %s\n",
+                        i, WEXITSTATUS(status), msec, jobs[i].line);
+            } else {
+                fprintf(stdout, "batch: job %d signal %d %ums %s\n",
+                        i, WIFSIGNALED(status) ? WTERMSIG(status) : 0, msec,
+                        jobs[i].line);
+            }
+            fflush(stdout);
+            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+    }
+    return true;
+}
+
+
+/** \brief  Run all jobs of the job file
+ *
+ * Called after the machine has been initialized and before the emulation is
+ * started. In the parent process this function does not return, it exits
+ * VICE after all jobs are done, with exit code 0 if every job succeeded.
+ *
+ * \return  0 in a job process which should now run the emulation, or -1 if
+ *          a job process could not be set up
+ */
+int batch_run(void)
+{
+    batch_job_t *jobs = NULL;
+    int num_read;
+    int num_jobs;
+    int next = 0;
+    int running = 0;
+    int workers = batch_workers;
+    bool success = true;
+    int i;
+
+    num_jobs = num_read = batch_read_jobs(&jobs);
+    if (num_jobs < 0) {
+        archdep_vice_exit(EXIT_FAILURE);
+    }
+
+    if (workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+        workers = cores > 0 ? (int)cores : 1;
+    }
+
+    log_message(LOG_DEFAULT, "Batch: running %d jobs from `%s' on %d workers.",
+                num_jobs, batch_file, workers);
+
+    while (next < num_jobs || running > 0) {
+        int status;
+        pid_t pid;
+
+        while (running < workers && next < num_jobs) {
+            /* don't let buffered output end up in every child */
+            fflush(stdout);
+            fflush(stderr);
+
+            jobs[next].start = tick_now();
+            pid = fork();
+            if (pid == 0) {
+                /* job process: run the emulation */
+                int result = batch_start_job(&jobs[next]);
+
+                for (i = 0; i < num_read; i++) {
+                    if (i != next) {
+                        lib_free(jobs[i].line);
+                    }
+                }
+                return result;
+            }
+            if (pid < 0) {
+                log_error(LOG_DEFAULT, "Batch: fork() failed: %s.", strerror(errno));
+                success = false;
+                num_jobs = next;
+                break;
+            }
+            jobs[next].pid = pid;
+            running++;
+            next++;
+        }
+
+        if (running == 0) {
+            break;
+        }
+
+        pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error(LOG_DEFAULT, "Batch: wait() failed: %s.", strerror(errno));
+            success = false;
+            break;
+        }
+        if (!batch_job_done(jobs, num_jobs, pid, status)) {
+            success = false;
+        }
+        running--;
+    }
+
+    for (i = 0; i < num_read; i++) {
+        lib_free(jobs[i].line);
+    }
+    lib_free(jobs);
+
+    archdep_vice_exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    return -1;  /* not reached */
+}
+
+#else /* UNIX_COMPILE */
+
+int batch_run(void)
+{
+    log_error(LOG_DEFAULT, "Batch: batch mode is not supported on this platform.");
+    archdep_vice_exit(EXIT_FAILURE);
+    return -1;
+}
+
+#endif /* UNIX_COMPILE */
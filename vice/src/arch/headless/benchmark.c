@@ -0,0 +1,611 @@
+/** \file   benchmark.c
+ * \brief   Headless benchmark mode
+ *
+ * Times parts of the emulator inside the real machine, with the ROMs,
+ * expansions and disk images given on the command line, and prints the
+ * results on stdout:
+ *
+ *  benchmark: <name>: <result>
+ *
+ * The machine first runs for `-benchmarkdelay` seconds of emulated time (in
+ * warp mode), to get past the boot or into an autostarted program. Then
+ * the benchmark selected with `-benchmark` runs from a CPU trap, so the
+ * machine is between two instructions, and VICE exits with code 0, or 1 if
+ * the benchmark failed.  Combined with `-batch`, one process can benchmark
+ * several setups of the same machine.
+ *
+ * Benchmarks that time the emulation itself run the machine for a number
+ * of cycles in warp mode between their steps, see benchmark_emulate().
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "archdep_exit.h"
+#include "archdep_remove.h"
+#include "archdep_tick.h"
+#include "archdep_tmpnam.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mon_breakpoint.h"
+#include "montypes.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "util.h"
+#include "vsync.h"
+
+#include "benchmark.h"
+
+
+/** \brief  A benchmark that can be selected with `-benchmark`
+ */
+typedef struct benchmark_s {
+    const char *name;       /**< name on the command line */
+    int runs;               /**< default number of runs (`-benchmarkruns`) */
+    void (*start)(void);    /**< called from a CPU trap after the delay */
+} benchmark_t;
+
+
+/** \brief  Name of the selected benchmark (`-benchmark`)
+ */
+static char *benchmark_name = NULL;
+
+/** \brief  Number of runs, 0 for the default of the benchmark
+ */
+static int benchmark_runs = 0;
+
+/** \brief  Emulated seconds before the benchmark starts
+ */
+static int benchmark_delay = 3;
+
+/** \brief  The selected benchmark
+ */
+static const benchmark_t *benchmark = NULL;
+
+/** \brief  Alarm used to stop the emulation after a number of cycles
+ */
+static alarm_t *benchmark_alarm = NULL;
+
+/** \brief  Function to call once the cycles of benchmark_emulate() are done
+ */
+static void (*benchmark_next)(double seconds) = NULL;
+
+/** \brief  Host time at which benchmark_emulate() started
+ */
+static tick_t benchmark_emulate_start;
+
+
+/* ------------------------------------------------------------------------- */
+/* helpers for the benchmarks */
+
+/** \brief  Seconds since \a start
+ */
+static double benchmark_seconds(tick_t start)
+{
+    return (double)tick_now_delta(start) / TICK_PER_SECOND;
+}
+
+/** \brief  Print a result line
+ */
+static void benchmark_result(const char *format, ...)
+{
+    va_list ap;
+
+    fprintf(stdout, "benchmark: %s: ", benchmark->name);
+    va_start(ap, format);
+    vfprintf(stdout, format, ap);
+    va_end(ap);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+/** \brief  End the benchmark and exit VICE
+ *
+ * \param[in]   ok  the benchmark completed and its checks passed
+ */
+static void benchmark_exit(bool ok)
+{
+    if (!ok) {
+        benchmark_result("failed");
+    }
+    archdep_vice_exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void benchmark_trap(uint16_t addr, void *data)
+{
+    void (*next)(double seconds) = benchmark_next;
+
+    benchmark_next = NULL;
+    next(benchmark_seconds(benchmark_emulate_start));
+}
+
+static void benchmark_alarm_handler(CLOCK offset, void *data)
+{
+    alarm_unset(benchmark_alarm);
+    interrupt_maincpu_trigger_trap(benchmark_trap, NULL);
+}
+
+/** \brief  Run the machine for a number of cycles in warp mode
+ *
+ * Returns right away, \a next is called from a CPU trap once the machine
+ * has run at least \a cycles cycles, with the host time that took.
+ *
+ * \param[in]   cycles  main CPU cycles to run
+ * \param[in]   next    function to call afterwards
+ */
+static void benchmark_emulate(CLOCK cycles, void (*next)(double seconds))
+{
+    benchmark_next = next;
+    benchmark_emulate_start = tick_now();
+    alarm_set(benchmark_alarm, maincpu_clk + cycles);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* snapshot: save and restore latency, memory and file backend */
+
+static void benchmark_snapshot(void)
+{
+    snapshot_memory_t *mem = snapshot_memory_new();
+    char *filename = archdep_tmpnam();
+    double mem_save = 0.0, mem_load = 0.0, file_save = 0.0, file_load = 0.0;
+    size_t size = 0;
+    tick_t start;
+    int i;
+    bool ok = true;
+
+    for (i = 0; i < benchmark_runs && ok; i++) {
+        start = tick_now();
+        ok = machine_write_snapshot_memory(mem, 0, 0, 0) == 0;
+        mem_save += benchmark_seconds(start);
+
+        start = tick_now();
+        ok = ok && machine_read_snapshot_memory(mem, 0) == 0;
+        mem_load += benchmark_seconds(start);
+
+        start = tick_now();
+        ok = ok && machine_write_snapshot(filename, 0, 0, 0) == 0;
+        file_save += benchmark_seconds(start);
+
+        start = tick_now();
+        ok = ok && machine_read_snapshot(filename, 0) == 0;
+        file_load += benchmark_seconds(start);
+    }
+
+    if (ok) {
+        snapshot_memory_get_data(mem, &size);
+        benchmark_result("%d runs, %lu bytes", benchmark_runs, (unsigned long)size);
+        benchmark_result("memory save %.0fus, memory load %.0fus",
+                         mem_save * 1e6 / benchmark_runs, mem_load * 1e6 / benchmark_runs);
+        benchmark_result("file save %.0fus, file load %.0fus",
+                         file_save * 1e6 / benchmark_runs, file_load * 1e6 / benchmark_runs);
+    }
+
+    archdep_remove(filename);
+    lib_free(filename);
+    snapshot_memory_destroy(mem);
+    benchmark_exit(ok);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* rewind: cost of the keyframes and latency of rewinding one second */
+
+/** \brief  Emulated seconds to time with and without rewinding
+ */
+#define BENCHMARK_REWIND_SECONDS    5
+
+/** \brief  Emulated seconds between two seeks, to grow the history again
+ */
+#define BENCHMARK_REWIND_GAP        2
+
+/** \brief  Cycles between two checks for the end of the replay
+ */
+#define BENCHMARK_REWIND_POLL       1000
+
+static int rewind_size = 0;
+static double rewind_plain = 0.0;
+static double rewind_restore = 0.0;
+static double rewind_total = 0.0;
+static double rewind_max = 0.0;
+static tick_t rewind_start;
+static int rewind_run = 0;
+
+static void benchmark_rewind_seek(double seconds);
+
+static void benchmark_rewind_poll(double seconds)
+{
+    double latency;
+
+    if (rewind_replay_active()) {
+        benchmark_emulate(BENCHMARK_REWIND_POLL, benchmark_rewind_poll);
+        return;
+    }
+
+    latency = benchmark_seconds(rewind_start);
+    rewind_total += latency;
+    if (latency > rewind_max) {
+        rewind_max = latency;
+    }
+
+    if (++rewind_run < benchmark_runs) {
+        benchmark_emulate((CLOCK)BENCHMARK_REWIND_GAP * machine_get_cycles_per_second(),
+                          benchmark_rewind_seek);
+        return;
+    }
+
+    benchmark_result("seek back 1s, %d runs: restore %.2fms, with replay %.2fms, max %.2fms",
+                     benchmark_runs, rewind_restore * 1e3 / benchmark_runs,
+                     rewind_total * 1e3 / benchmark_runs, rewind_max * 1e3);
+    benchmark_exit(true);
+}
+
+/* runs right after the seek, the clock went back with the restored keyframe */
+static void benchmark_rewind_restored(uint16_t addr, void *data)
+{
+    rewind_restore += benchmark_seconds(rewind_start);
+    benchmark_emulate(BENCHMARK_REWIND_POLL, benchmark_rewind_poll);
+}
+
+static void benchmark_rewind_seek(double seconds)
+{
+    rewind_start = tick_now();
+    if (rewind_seek_seconds(1) < 0) {
+        benchmark_exit(false);
+        return;
+    }
+    interrupt_maincpu_trigger_trap(benchmark_rewind_restored, NULL);
+}
+
+static void benchmark_rewind_history(double seconds)
+{
+    int size = 0, interval = 0;
+
+    resources_get_int("RewindBufferSize", &size);
+    resources_get_int("RewindInterval", &interval);
+    benchmark_result("keyframe every %d frames, %dMiB: emulation %.1f%% slower, %u frames of history",
+                     interval, size, (seconds / rewind_plain - 1.0) * 100.0,
+                     rewind_get_history_frames());
+    benchmark_rewind_seek(0.0);
+}
+
+static void benchmark_rewind_plain(double seconds)
+{
+    rewind_plain = seconds;
+    resources_set_int("RewindBufferSize", rewind_size > 0 ? rewind_size : 64);
+    benchmark_emulate((CLOCK)BENCHMARK_REWIND_SECONDS * machine_get_cycles_per_second(),
+                      benchmark_rewind_history);
+}
+
+static void benchmark_rewind(void)
+{
+    /* the history is built from here on, with the -rewindsize and
+       -rewindinterval given (64MiB if none) */
+    resources_get_int("RewindBufferSize", &rewind_size);
+    resources_set_int("RewindBufferSize", 0);
+    benchmark_emulate((CLOCK)BENCHMARK_REWIND_SECONDS * machine_get_cycles_per_second(),
+                      benchmark_rewind_plain);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* checkpoints: emulation speed with 0, 10 and 1000 monitor checkpoints */
+
+/** \brief  Emulated seconds to time for each number of checkpoints
+ */
+#define BENCHMARK_CHECKPOINTS_SECONDS   10
+
+static const int checkpoint_counts[] = { 0, 10, 1000 };
+
+#define NUM_CHECKPOINT_COUNTS (int)(sizeof(checkpoint_counts) / sizeof(checkpoint_counts[0]))
+
+static int checkpoint_step = 0;
+static int checkpoint_run = 0;
+static int checkpoint_num = 0;
+static double checkpoint_best = 0.0;
+static double checkpoint_none = 0.0;
+
+/* Add checkpoints up to `count', a third each of exec, load and store, spread
+   over the whole address space of the computer.  They are disabled, so when
+   one is hit the list is searched as usual but the machine does not stop.  */
+static void benchmark_checkpoints_add(int count)
+{
+    static const MEMORY_OP ops[] = { e_exec, e_load, e_store };
+    unsigned int addr;
+    int num;
+
+    for (; checkpoint_num < count; checkpoint_num++) {
+        addr = ((unsigned int)checkpoint_num * 0x10000 / 1000 + 0x1b) & 0xffff;
+        num = mon_breakpoint_add_checkpoint(new_addr(e_comp_space, addr),
+                                            new_addr(e_invalid_space, 0),
+                                            true, ops[checkpoint_num % 3], false, false);
+        mon_breakpoint_switch_checkpoint(e_OFF, num);
+    }
+}
+
+static void benchmark_checkpoints_step(double seconds)
+{
+    int count;
+
+    if (checkpoint_run > 0 && (checkpoint_run == 1 || seconds < checkpoint_best)) {
+        checkpoint_best = seconds;
+    }
+
+    if (checkpoint_run == benchmark_runs) {
+        count = checkpoint_counts[checkpoint_step];
+        if (count == 0) {
+            checkpoint_none = checkpoint_best;
+        }
+        benchmark_result("%4d checkpoints: %.0fms, %+.1f%%", count,
+                         checkpoint_best * 1e3,
+                         (checkpoint_best / checkpoint_none - 1.0) * 100.0);
+        checkpoint_run = 0;
+        if (++checkpoint_step == NUM_CHECKPOINT_COUNTS) {
+            mon_breakpoint_delete_checkpoint(-1);
+            benchmark_exit(true);
+            return;
+        }
+    }
+
+    benchmark_checkpoints_add(checkpoint_counts[checkpoint_step]);
+    checkpoint_run++;
+    benchmark_emulate((CLOCK)BENCHMARK_CHECKPOINTS_SECONDS * machine_get_cycles_per_second(),
+                      benchmark_checkpoints_step);
+}
+
+static void benchmark_checkpoints(void)
+{
+    benchmark_checkpoints_step(0.0);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* conditions: compiled checkpoint conditions against the tree walker */
+
+/** \brief  Emulated seconds to time for each condition and evaluator
+ */
+#define BENCHMARK_CONDITIONS_SECONDS    5
+
+/* all of them are false, so the trace checkpoint never prints */
+static const char * const conditions[] = {
+    "A == $20 && X > 3 && SP == $100",
+    "A == $100 || X == $100 || Y == $100",
+    "((X + Y * 2) & 7) == $100",
+    "@cpu:($a0 + X) == $100"
+};
+
+#define NUM_CONDITIONS (int)(sizeof(conditions) / sizeof(conditions[0]))
+
+/* 0: no checkpoint, then for each condition compiled and tree walker */
+static int condition_step = 0;
+static int condition_run = 0;
+static double condition_best = 0.0;
+static double condition_none = 0.0;
+static double condition_compiled = 0.0;
+
+/* Trace every instruction of the computer if the condition holds.  */
+static bool benchmark_conditions_add(const char *condition)
+{
+    mon_checkpoint_t *cp;
+    char *line;
+
+    line = lib_msprintf("trace exec $0000 $ffff if %s", condition);
+    parse_and_execute_line(line);
+    lib_free(line);
+
+    cp = mon_breakpoint_find_checkpoint(1);
+    return cp != NULL && cp->condition != NULL && cp->compiled_condition != NULL;
+}
+
+static void benchmark_conditions_step(double seconds)
+{
+    const char *condition;
+
+    if (condition_run > 0 && (condition_run == 1 || seconds < condition_best)) {
+        condition_best = seconds;
+    }
+
+    if (condition_run == benchmark_runs) {
+        if (condition_step == 0) {
+            condition_none = condition_best;
+            benchmark_result("no checkpoint: %.0fms", condition_none * 1e3);
+        } else if (condition_step % 2 == 1) {
+            condition_compiled = condition_best;
+        } else {
+            condition = conditions[(condition_step - 1) / 2];
+            benchmark_result("%s: compiled %+.1f%%, tree %+.1f%%", condition,
+                             (condition_compiled / condition_none - 1.0) * 100.0,
+                             (condition_best / condition_none - 1.0) * 100.0);
+            mon_breakpoint_delete_checkpoint(-1);
+        }
+
+        condition_run = 0;
+        if (++condition_step == 1 + 2 * NUM_CONDITIONS) {
+            mon_breakpoint_use_compiled_conditions(true);
+            benchmark_exit(true);
+            return;
+        }
+
+        if (condition_step % 2 == 1) {
+            condition = conditions[(condition_step - 1) / 2];
+            if (!benchmark_conditions_add(condition)) {
+                benchmark_result("cannot compile `%s'", condition);
+                benchmark_exit(false);
+                return;
+            }
+        }
+        mon_breakpoint_use_compiled_conditions(condition_step % 2 == 1);
+    }
+
+    condition_run++;
+    benchmark_emulate((CLOCK)BENCHMARK_CONDITIONS_SECONDS * machine_get_cycles_per_second(),
+                      benchmark_conditions_step);
+}
+
+static void benchmark_conditions(void)
+{
+    /* the new checkpoint is then always #1 */
+    mon_breakpoint_delete_checkpoint(-1);
+    benchmark_conditions_step(0.0);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  List of benchmarks
+ */
+static const benchmark_t benchmarks[] = {
+    { "snapshot", 500, benchmark_snapshot },
+    { "rewind", 20, benchmark_rewind },
+    { "checkpoints", 3, benchmark_checkpoints },
+    { "conditions", 3, benchmark_conditions },
+    { NULL, 0, NULL }
+};
+
+
+static int set_benchmark_name(const char *param, void *extra_param)
+{
+    util_string_set(&benchmark_name, param);
+    return 0;
+}
+
+static int set_benchmark_runs(const char *param, void *extra_param)
+{
+    int num = atoi(param);
+
+    if (num < 0) {
+        return -1;
+    }
+    benchmark_runs = num;
+    return 0;
+}
+
+static int set_benchmark_delay(const char *param, void *extra_param)
+{
+    int num = atoi(param);
+
+    if (num < 0) {
+        return -1;
+    }
+    benchmark_delay = num;
+    return 0;
+}
+
+
+/** \brief  Command line options for the benchmark mode
+ */
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-benchmark", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_benchmark_name, NULL, NULL, NULL,
+      "<Name>", "Run the benchmark <Name> (snapshot, rewind, checkpoints, conditions) and exit" },
+    { "-benchmarkruns", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_benchmark_runs, NULL, NULL, NULL,
+      "<Number>", "Number of benchmark runs (0: default of the benchmark)" },
+    { "-benchmarkdelay", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_benchmark_delay, NULL, NULL, NULL,
+      "<Seconds>", "Emulated seconds to run before the benchmark starts" },
+    CMDLINE_LIST_END
+};
+
+
+/** \brief  Register the benchmark mode command line options
+ *
+ * \return  0 on success, -1 on failure
+ */
+int benchmark_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+
+/** \brief  Check if a benchmark was given on the command line
+ *
+ * \return  true if the benchmark mode was requested
+ */
+bool benchmark_is_enabled(void)
+{
+    return benchmark_name != NULL && *benchmark_name != '\0';
+}
+
+
+static void benchmark_delay_done(double seconds)
+{
+    benchmark->start();
+}
+
+
+/** \brief  Prepare the benchmark
+ *
+ * Called after the machine has been initialized and before the emulation
+ * is started. The benchmark itself runs later, from the emulation.
+ *
+ * \return  0 on success, -1 if there is no such benchmark
+ */
+int benchmark_run(void)
+{
+    int i;
+
+    for (i = 0; benchmarks[i].name != NULL; i++) {
+        if (strcmp(benchmarks[i].name, benchmark_name) == 0) {
+            benchmark = &benchmarks[i];
+            break;
+        }
+    }
+    if (benchmark == NULL) {
+        log_error(LOG_DEFAULT, "Benchmark: unknown benchmark `%s'.", benchmark_name);
+        return -1;
+    }
+    if (benchmark_runs == 0) {
+        benchmark_runs = benchmark->runs;
+    }
+
+    benchmark_alarm = alarm_new(maincpu_alarm_context, "Benchmark",
+                                benchmark_alarm_handler, NULL);
+    vsync_set_warp_mode(1);
+    benchmark_emulate((CLOCK)benchmark_delay * machine_get_cycles_per_second(),
+                      benchmark_delay_done);
+    return 0;
+}
+
+
+/** \brief  Free memory used by the benchmark mode
+ */
+void benchmark_shutdown(void)
+{
+    lib_free(benchmark_name);
+    benchmark_name = NULL;
+}
@@ -67,6 +67,8 @@
 /* for the fullscreen_capability() stub */
 #include "fullscreen.h"
 
+#include "batch.h"
+#include "benchmark.h"
 #include "ui.h"
 
 
@@ -103,6 +105,12 @@ int ui_cmdline_options_init(void)
 {
     /* printf("%s\n", __func__); */
 
+    if (batch_cmdline_options_init() < 0) {
+        return -1;
+    }
+    if (benchmark_cmdline_options_init() < 0) {
+        return -1;
+    }
     return cmdline_register_options(cmdline_options_common);
 }
 
@@ -216,6 +224,9 @@ int ui_resources_init(void)
 void ui_resources_shutdown(void)
 {
     /* printf("%s\n", __func__); */
+
+    batch_shutdown();
+    benchmark_shutdown();
 }
 
 /** \brief Clean up memory used by the UI system itself
@@ -32,6 +32,7 @@
 
 #include "menu_common.h"
 #include "menu_snapshot.h"
+#include "rewind.h"
 #include "snapshot.h"
 #include "uiactions.h"
 #include "uimenu.h"
@@ -181,6 +182,15 @@ static void history_milestone_reset_action(ui_action_map_t *self)
     event_record_reset_milestone();
 }
 
+/** \brief  Rewind one second action
+ *
+ * \param[in]   self    action map
+ */
+static void history_rewind_action(ui_action_map_t *self)
+{
+    rewind_seek_seconds(1);
+}
+
 
 /** \brief  List of mappings for snapshot and history actions */
 static const ui_action_map_t snapshot_actions[] = {
@@ -222,6 +232,9 @@ static const ui_action_map_t snapshot_actions[] = {
     {   .action  = ACTION_HISTORY_MILESTONE_RESET,
         .handler = history_milestone_reset_action
     },
+    {   .action  = ACTION_HISTORY_REWIND,
+        .handler = history_rewind_action
+    },
     UI_ACTION_MAP_TERMINATOR
 };
 
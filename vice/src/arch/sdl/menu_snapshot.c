@@ -322,6 +322,11 @@ ui_menu_entry_t snapshot_menu[] = {
         .type      = MENU_ENTRY_OTHER,
         .activated = MENU_EXIT_UI_STRING
     },
+    {   .action    = ACTION_HISTORY_REWIND,
+        .string    = "Rewind one second",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
     SDL_MENU_ITEM_SEPARATOR,
 
     SDL_MENU_ITEM_TITLE("Record start mode"),
@@ -796,70 +796,13 @@ video_canvas_t *video_canvas_create(video_canvas_t *canvas, unsigned int *width,
     return canvas;
 }
 
-void video_canvas_refresh(struct video_canvas_s *canvas,
-                          unsigned int xs, unsigned int ys,
-                          unsigned int xi, unsigned int yi,
-                          unsigned int w, unsigned int h)
+/* Upload the rendered frame in canvas->screen and show it */
+static void sdl2_present_frame(video_canvas_t *canvas)
 {
     SDL_Texture *texture_swap;
-    uint8_t *backup;
     SDL_RendererFlip flip = 0;
     double angle = 0;
 
-    /* If the canvas isn't initialized, skip this */
-    if ((canvas == NULL) || (canvas->screen == NULL)) {
-        return;
-    }
-
-    if (sdl_canvas_is_visible(canvas) == 0) {
-        return;
-    }
-
-    if (sdl_vsid_state & SDL_VSID_ACTIVE) {
-        sdl_vsid_draw();
-    }
-
-    if (sdl_vkbd_state & SDL_VKBD_ACTIVE) {
-        sdl_vkbd_draw();
-    }
-
-    if (uistatusbar_state & (UISTATUSBAR_ACTIVE|UISTATUSBAR_ACTIVE_VDC)) {
-        uistatusbar_draw();
-    }
-
-    xi *= canvas->videoconfig->scalex;
-    w *= canvas->videoconfig->scalex;
-
-    yi *= canvas->videoconfig->scaley;
-    h *= canvas->videoconfig->scaley;
-
-    w = MIN(w, canvas->width);
-    h = MIN(h, canvas->height);
-
-    /* FIXME attempt to draw outside canvas */
-    if ((xi + w > canvas->width) || (yi + h > canvas->height)) {
-        return;
-    }
-
-    if (machine_class == VICE_MACHINE_VSID) {
-        canvas->draw_buffer_vsid->draw_buffer_width = canvas->draw_buffer->draw_buffer_width;
-        canvas->draw_buffer_vsid->draw_buffer_height = canvas->draw_buffer->draw_buffer_height;
-        canvas->draw_buffer_vsid->draw_buffer_pitch = canvas->draw_buffer->draw_buffer_pitch;
-        canvas->draw_buffer_vsid->canvas_physical_width = canvas->draw_buffer->canvas_physical_width;
-        canvas->draw_buffer_vsid->canvas_physical_height = canvas->draw_buffer->canvas_physical_height;
-        canvas->draw_buffer_vsid->canvas_width = canvas->draw_buffer->canvas_width;
-        canvas->draw_buffer_vsid->canvas_height = canvas->draw_buffer->canvas_height;
-        canvas->draw_buffer_vsid->visible_width = canvas->draw_buffer->visible_width;
-        canvas->draw_buffer_vsid->visible_height = canvas->draw_buffer->visible_height;
-
-        backup = canvas->draw_buffer->draw_buffer;
-        canvas->draw_buffer->draw_buffer = canvas->draw_buffer_vsid->draw_buffer;
-        video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
-        canvas->draw_buffer->draw_buffer = backup;
-    } else {
-        video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
-    }
-
     if (recreate_textures) {
         recreate_all_textures();
         recreate_textures = 0;
@@ -951,6 +894,82 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
     ui_autohide_mouse_cursor();
 }
 
+void video_canvas_refresh(struct video_canvas_s *canvas,
+                          unsigned int xs, unsigned int ys,
+                          unsigned int xi, unsigned int yi,
+                          unsigned int w, unsigned int h)
+{
+    uint8_t *backup;
+
+    /* If the canvas isn't initialized, skip this */
+    if ((canvas == NULL) || (canvas->screen == NULL)) {
+        return;
+    }
+
+    if (sdl_canvas_is_visible(canvas) == 0) {
+        return;
+    }
+
+    if (sdl_vsid_state & SDL_VSID_ACTIVE) {
+        sdl_vsid_draw();
+    }
+
+    if (sdl_vkbd_state & SDL_VKBD_ACTIVE) {
+        sdl_vkbd_draw();
+    }
+
+    if (uistatusbar_state & (UISTATUSBAR_ACTIVE|UISTATUSBAR_ACTIVE_VDC)) {
+        uistatusbar_draw();
+    }
+
+    xi *= canvas->videoconfig->scalex;
+    w *= canvas->videoconfig->scalex;
+
+    yi *= canvas->videoconfig->scaley;
+    h *= canvas->videoconfig->scaley;
+
+    w = MIN(w, canvas->width);
+    h = MIN(h, canvas->height);
+
+    /* FIXME attempt to draw outside canvas */
+    if ((xi + w > canvas->width) || (yi + h > canvas->height)) {
+        return;
+    }
+
+    if (machine_class == VICE_MACHINE_VSID) {
+        canvas->draw_buffer_vsid->draw_buffer_width = canvas->draw_buffer->draw_buffer_width;
+        canvas->draw_buffer_vsid->draw_buffer_height = canvas->draw_buffer->draw_buffer_height;
+        canvas->draw_buffer_vsid->draw_buffer_pitch = canvas->draw_buffer->draw_buffer_pitch;
+        canvas->draw_buffer_vsid->canvas_physical_width = canvas->draw_buffer->canvas_physical_width;
+        canvas->draw_buffer_vsid->canvas_physical_height = canvas->draw_buffer->canvas_physical_height;
+        canvas->draw_buffer_vsid->canvas_width = canvas->draw_buffer->canvas_width;
+        canvas->draw_buffer_vsid->canvas_height = canvas->draw_buffer->canvas_height;
+        canvas->draw_buffer_vsid->visible_width = canvas->draw_buffer->visible_width;
+        canvas->draw_buffer_vsid->visible_height = canvas->draw_buffer->visible_height;
+
+        backup = canvas->draw_buffer->draw_buffer;
+        canvas->draw_buffer->draw_buffer = canvas->draw_buffer_vsid->draw_buffer;
+        video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
+        canvas->draw_buffer->draw_buffer = backup;
+    } else if (video_render_thread && !sdl_menu_state) {
+        /* Show the frame queued by the previous refresh and let the render
+           thread work on this one while the next frame is emulated */
+        video_canvas_render_wait(canvas);
+        if (canvas->render_pending) {
+            sdl2_present_frame(canvas);
+        }
+        video_canvas_render_async(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch,
+                                  NULL, NULL);
+        canvas->render_pending = 1;
+        return;
+    } else {
+        video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
+    }
+    canvas->render_pending = 0;
+
+    sdl2_present_frame(canvas);
+}
+
 int video_canvas_set_palette(struct video_canvas_s *canvas, struct palette_s *palette)
 {
     unsigned int i, col = 0;
@@ -1106,6 +1125,8 @@ void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas)
             return;
         }
         if (canvas->screen) {
+            video_canvas_render_wait(canvas);
+            canvas->render_pending = 0;
             SDL_FreeSurface(canvas->screen);
         }
         canvas->screen = new_screen;
@@ -1250,6 +1271,7 @@ void video_canvas_destroy(struct video_canvas_s *canvas)
             sdl_canvaslist[i]->container = NULL;
 #endif
 
+            video_canvas_render_wait(sdl_canvaslist[i]);
             SDL_FreeSurface(sdl_canvaslist[i]->screen);
             sdl_canvaslist[i]->screen = NULL;
         }
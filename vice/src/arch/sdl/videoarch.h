@@ -107,6 +107,10 @@ struct video_canvas_s {
 
     /** \brief The SDL2 objects that this canvas can output to. */
     video_container_t* container;
+
+    /** \brief Nonzero if the render thread got a frame for screen that is
+     *         not shown yet, see VideoRenderThread. */
+    int render_pending;
 #endif
 
     struct video_render_config_s *videoconfig;
@@ -36,6 +36,7 @@
 #include "log.h"
 #include "maincpu.h"
 #include "monitor.h"
+#include "sampleprof.h"
 #include "types.h"
 #include "z80.h"
 #include "z80mem.h"
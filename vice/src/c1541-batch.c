@@ -0,0 +1,900 @@
+/** \file   c1541-batch.c
+ * \brief   c1541 batch mode
+ *
+ * Runs a small command script on every image of a collection, using a pool
+ * of threads that each have their own virtual drive, and prints one JSON
+ * object per image on stdout:
+ *
+ *  {"job":0,"image":"a.d64","ok":true,"ms":3,"results":[...]}
+ *
+ * The images are either listed in a manifest file (one path per line) or
+ * given as a pattern like `games/\*.d64', where `*' and `?' are allowed in
+ * the file name part. The script contains one command per line, empty lines
+ * and lines starting with '#' are ignored:
+ *
+ *  info                show the image format
+ *  list [<pattern>]    list the directory, <pattern> as for `list'
+ *  extract [<dir>]     extract all files to <dir>/<image name>/
+ *
+ * The images are opened read-only and loaded into memory as a whole.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef UNIX_COMPILE
+#include <unistd.h>
+#endif
+
+#include "archdep.h"
+#include "cbmdos.h"
+#include "charset.h"
+#include "diskcontents-block.h"
+#include "diskimage.h"
+#include "fsimage-cache.h"
+#include "imagecontents.h"
+#include "lib.h"
+#include "log.h"
+#include "p64.h"
+#include "util.h"
+#include "vdrive-bam.h"
+#include "vdrive-dir.h"
+#include "vdrive.h"
+
+#include "c1541-batch.h"
+
+
+/** \brief  Maximum number of arguments of a script command
+ */
+#define BATCH_MAX_ARGS  4
+
+/** \brief  Unit number used for the virtual drives
+ */
+#define BATCH_UNIT      8
+
+
+/** \brief  Script command
+ */
+typedef struct batch_command_s {
+    int argc;                       /**< number of arguments, including name */
+    char *argv[BATCH_MAX_ARGS];     /**< name and arguments */
+} batch_command_t;
+
+/** \brief  Growing output buffer for the JSON line of a job
+ */
+typedef struct batch_output_s {
+    char *data;     /**< text, always terminated */
+    size_t len;     /**< length of the text */
+    size_t size;    /**< size of the allocated buffer */
+} batch_output_t;
+
+/** \brief  State shared by the worker threads
+ */
+typedef struct batch_s {
+    char **images;                  /**< paths of the images */
+    int num_images;                 /**< number of images */
+    batch_command_t *commands;      /**< script */
+    int num_commands;               /**< number of script commands */
+    int next;                       /**< next image to process */
+    int failed;                     /**< number of failed images */
+} batch_t;
+
+typedef int (*batch_command_func_t)(vdrive_t *vdrive, const char *image,
+                                    const batch_command_t *cmd,
+                                    batch_output_t *out);
+
+
+#ifdef HAVE_PTHREAD_H
+/** \brief  Protects the job counter and stdout */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+/** \brief  Serializes opening and closing images and creating directories,
+ *          zfile keeps a global list of the open files */
+static pthread_mutex_t batch_file_lock = PTHREAD_MUTEX_INITIALIZER;
+#define BATCH_LOCK(m)   pthread_mutex_lock(&(m))
+#define BATCH_UNLOCK(m) pthread_mutex_unlock(&(m))
+#else
+#define BATCH_LOCK(m)
+#define BATCH_UNLOCK(m)
+#endif
+
+
+/* ------------------------------------------------------------------------- */
+/* output */
+
+static void batch_printf(batch_output_t *out, const char *format, ...) VICE_ATTR_PRINTF2;
+
+static void batch_printf(batch_output_t *out, const char *format, ...)
+{
+    va_list ap;
+    int len;
+
+    while (1) {
+        va_start(ap, format);
+        len = vsnprintf(out->data + out->len, out->size - out->len, format, ap);
+        va_end(ap);
+        if (len < 0) {
+            return;
+        }
+        if (out->len + (size_t)len < out->size) {
+            out->len += (size_t)len;
+            return;
+        }
+        out->size = (out->size + (size_t)len) * 2;
+        out->data = lib_realloc(out->data, out->size);
+    }
+}
+
+/** \brief  Get the length of the UTF-8 sequence at \a p
+ *
+ * \return  number of bytes, 0 if \a p does not start a valid sequence
+ *          (overlong forms and surrogates included)
+ */
+static int batch_utf8_length(const unsigned char *p)
+{
+    unsigned int code;
+    int len, i;
+
+    if (p[0] < 0x80) {
+        return 1;
+    } else if (p[0] >= 0xc2 && p[0] <= 0xdf) {
+        len = 2;
+        code = p[0] & 0x1f;
+    } else if (p[0] >= 0xe0 && p[0] <= 0xef) {
+        len = 3;
+        code = p[0] & 0x0f;
+    } else if (p[0] >= 0xf0 && p[0] <= 0xf4) {
+        len = 4;
+        code = p[0] & 0x07;
+    } else {
+        return 0;
+    }
+
+    for (i = 1; i < len; i++) {
+        if ((p[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+        code = (code << 6) | (p[i] & 0x3f);
+    }
+    if ((len == 3 && (code < 0x800 || (code >= 0xd800 && code <= 0xdfff)))
+        || (len == 4 && (code < 0x10000 || code > 0x10ffff))) {
+        return 0;
+    }
+    return len;
+}
+
+/** \brief  Add \a str as a JSON string, quoted and escaped
+ *
+ * Valid UTF-8, like host file names, is passed through. Other bytes above
+ * 0x7f, like PETSCII graphics left over by the conversion to ASCII, are
+ * taken as Latin-1 and escaped.
+ */
+static void batch_print_string(batch_output_t *out, const char *str)
+{
+    const unsigned char *p;
+    int len;
+
+    batch_printf(out, "\"");
+    for (p = (const unsigned char *)str; *p != '\0'; p += len) {
+        len = batch_utf8_length(p);
+        if (*p == '"' || *p == '\\') {
+            batch_printf(out, "\\%c", *p);
+        } else if (*p < 0x20 || *p == 0x7f || len == 0) {
+            batch_printf(out, "\\u%04x", *p);
+            len = 1;
+        } else {
+            batch_printf(out, "%.*s", len, (const char *)p);
+        }
+    }
+    batch_printf(out, "\"");
+}
+
+/** \brief  Add a PETSCII string of at most \a len bytes as a JSON string
+ *
+ * Stops at the first shifted space (0xa0) or 0.
+ */
+static void batch_print_petscii(batch_output_t *out, const uint8_t *str, size_t len)
+{
+    char *ascii = lib_malloc(len + 1);
+    size_t i;
+
+    for (i = 0; i < len && str[i] != 0xa0 && str[i] != 0; i++) {
+        ascii[i] = (char)str[i];
+    }
+    ascii[i] = '\0';
+    charset_petconvstring((uint8_t *)ascii, CONVERT_TO_ASCII);
+    batch_print_string(out, ascii);
+    lib_free(ascii);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* images */
+
+/** \brief  Attach \a name read-only to a new virtual drive
+ *
+ * \return  virtual drive or NULL on error
+ */
+static vdrive_t *batch_open_image(const char *name)
+{
+    disk_image_t *image;
+    vdrive_t *vdrive;
+
+    image = disk_image_create();
+    image->device = DISK_IMAGE_DEVICE_FS;
+    disk_image_media_create(image);
+
+    image->gcr = NULL;
+    image->p64 = lib_calloc(1, sizeof(TP64Image));
+    P64ImageCreate((PP64Image)image->p64);
+    image->read_only = 1;
+
+    disk_image_name_set(image, name);
+
+    BATCH_LOCK(batch_file_lock);
+    if (disk_image_open(image) < 0) {
+        BATCH_UNLOCK(batch_file_lock);
+        P64ImageDestroy((PP64Image)image->p64);
+        lib_free(image->p64);
+        disk_image_media_destroy(image);
+        disk_image_destroy(image);
+        return NULL;
+    }
+    BATCH_UNLOCK(batch_file_lock);
+
+    vdrive = lib_calloc(1, sizeof(vdrive_t));
+    vdrive_device_setup(vdrive, BATCH_UNIT);
+    vdrive_attach_image(image, BATCH_UNIT, 0, vdrive);
+    return vdrive;
+}
+
+static void batch_close_image(vdrive_t *vdrive)
+{
+    disk_image_t *image = vdrive->image;
+
+    if (image != NULL) {
+        vdrive_detach_image(image, BATCH_UNIT, 0, vdrive);
+        P64ImageDestroy((PP64Image)image->p64);
+        lib_free(image->p64);
+        BATCH_LOCK(batch_file_lock);
+        disk_image_close(image);
+        BATCH_UNLOCK(batch_file_lock);
+        disk_image_media_destroy(image);
+        disk_image_destroy(image);
+        vdrive->image = NULL;
+    }
+    vdrive_device_shutdown(vdrive);
+    lib_free(vdrive);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* commands */
+
+static int batch_info_cmd(vdrive_t *vdrive, const char *image,
+                          const batch_command_t *cmd, batch_output_t *out)
+{
+    const char *format = c1541_image_format_name(vdrive->image_format);
+
+    batch_printf(out, ",\"format\":");
+    batch_print_string(out, format != NULL ? format : "unknown");
+    batch_printf(out, ",\"tracks\":%u", vdrive->num_tracks);
+    return 0;
+}
+
+static int batch_list_cmd(vdrive_t *vdrive, const char *image,
+                          const batch_command_t *cmd, batch_output_t *out)
+{
+    image_contents_t *listing;
+    image_contents_file_list_t *element;
+    const char *pattern = cmd->argc > 1 ? cmd->argv[1] : NULL;
+    int first = 1;
+
+    listing = diskcontents_block_read(vdrive, 0);
+    if (listing == NULL) {
+        return -1;
+    }
+
+    batch_printf(out, ",\"name\":");
+    batch_print_petscii(out, listing->name, IMAGE_CONTENTS_NAME_LEN);
+    batch_printf(out, ",\"id\":");
+    batch_print_petscii(out, listing->id, IMAGE_CONTENTS_ID_LEN);
+    if (listing->blocks_free >= 0) {
+        batch_printf(out, ",\"blocks_free\":%d", listing->blocks_free);
+    }
+    batch_printf(out, ",\"files\":[");
+
+    for (element = listing->file_list; element != NULL; element = element->next) {
+        if (pattern != NULL) {
+            char *name = image_contents_filename_to_string(element, IMAGE_CONTENTS_STRING_ASCII);
+            char *type = image_contents_filetype_to_string(element, IMAGE_CONTENTS_STRING_ASCII);
+            int match = c1541_list_file_matches_pattern(name, type, pattern);
+
+            lib_free(name);
+            lib_free(type);
+            if (!match) {
+                continue;
+            }
+        }
+        /* type is "%c%s%c": splat, file type, lock */
+        batch_printf(out, "%s{\"name\":", first ? "" : ",");
+        batch_print_petscii(out, element->name, IMAGE_CONTENTS_FILE_NAME_LEN);
+        batch_printf(out, ",\"type\":\"%.3s\",\"blocks\":%u,\"closed\":%s,\"locked\":%s}",
+                     (const char *)element->type + 1, element->size,
+                     element->type[0] == '*' ? "false" : "true",
+                     element->type[4] == '<' ? "true" : "false");
+        first = 0;
+    }
+    batch_printf(out, "]");
+
+    image_contents_destroy(listing);
+    return 0;
+}
+
+/** \brief  Write the file starting at \a track, \a sector to \a path
+ *
+ * \return  number of bytes written, -1 on error
+ */
+static long batch_extract_file(vdrive_t *vdrive, unsigned int track,
+                               unsigned int sector, const char *path)
+{
+    uint8_t buffer[256];
+    unsigned int max_blocks;
+    long total = 0;
+    FILE *fd;
+
+    fd = fopen(path, MODE_WRITE);
+    if (fd == NULL) {
+        return -1;
+    }
+
+    /* guard against circular chains */
+    max_blocks = (unsigned int)(disk_image_size(vdrive->image) / 256) + 1;
+
+    while (track != 0) {
+        size_t len;
+
+        if (max_blocks-- == 0
+            || vdrive_read_sector(vdrive, buffer, track, sector) != 0) {
+            total = -1;
+            break;
+        }
+        if (buffer[0] == 0) {
+            /* last block, buffer[1] is the index of the last byte */
+            len = buffer[1] >= 2 ? (size_t)buffer[1] - 1 : 0;
+        } else {
+            len = 254;
+        }
+        if (len > 0 && fwrite(buffer + 2, len, 1, fd) < 1) {
+            total = -1;
+            break;
+        }
+        total += (long)len;
+        track = buffer[0];
+        sector = buffer[1];
+    }
+
+    fclose(fd);
+    return total;
+}
+
+static int batch_extract_cmd(vdrive_t *vdrive, const char *image,
+                             const batch_command_t *cmd, batch_output_t *out)
+{
+    uint8_t buffer[256];
+    char *image_name;
+    char *dest;
+    char *ext;
+    unsigned int track, sector;
+    unsigned int max_blocks;
+    int first = 1;
+    int result = 0;
+    int i;
+
+    if (vdrive_bam_read_bam(vdrive) != 0) {
+        return -1;
+    }
+
+    /* <dir>/<image name without extension>/ */
+    util_fname_split(image, NULL, &image_name);
+    ext = strrchr(image_name, '.');
+    if (ext != NULL && ext != image_name) {
+        *ext = '\0';
+    }
+    archdep_sanitize_filename(image_name);
+    dest = util_join_paths(cmd->argc > 1 ? cmd->argv[1] : ".", image_name, NULL);
+    lib_free(image_name);
+
+    BATCH_LOCK(batch_file_lock);
+    if (archdep_access(dest, ARCHDEP_ACCESS_F_OK) != 0) {
+        result = archdep_mkdir_recursive(dest, 0755);
+    }
+    BATCH_UNLOCK(batch_file_lock);
+    if (result < 0) {
+        lib_free(dest);
+        return -1;
+    }
+
+    batch_printf(out, ",\"directory\":");
+    batch_print_string(out, dest);
+    batch_printf(out, ",\"files\":[");
+
+    track = vdrive->Dir_Track;
+    sector = vdrive->Dir_Sector;
+    max_blocks = (unsigned int)(disk_image_size(vdrive->image) / 256) + 1;
+
+    while (track != 0 && result == 0) {
+        if (max_blocks-- == 0
+            || vdrive_read_sector(vdrive, buffer, track, sector) != 0) {
+            result = -1;
+            break;
+        }
+
+        for (i = 0; i < 256; i += SLOT_SIZE) {
+            uint8_t file_type = buffer[i + SLOT_TYPE_OFFSET];
+            char name[IMAGE_CONTENTS_FILE_NAME_LEN + 1];
+            char *path;
+            long bytes;
+            int len;
+
+            if (!(file_type & CBMDOS_FT_CLOSED)
+                || ((file_type & 7) != CBMDOS_FT_SEQ
+                    && (file_type & 7) != CBMDOS_FT_PRG
+                    && (file_type & 7) != CBMDOS_FT_USR)) {
+                continue;
+            }
+
+            for (len = 0; len < IMAGE_CONTENTS_FILE_NAME_LEN; len++) {
+                uint8_t c = buffer[i + SLOT_NAME_OFFSET + len];
+                if (c == 0xa0) {
+                    break;
+                }
+                name[len] = (char)c;
+            }
+            name[len] = '\0';
+            charset_petconvstring((uint8_t *)name, CONVERT_TO_ASCII);
+            archdep_sanitize_filename(name);
+
+            path = util_join_paths(dest, name, NULL);
+            bytes = batch_extract_file(vdrive,
+                                       buffer[i + SLOT_FIRST_TRACK],
+                                       buffer[i + SLOT_FIRST_SECTOR], path);
+            lib_free(path);
+
+            batch_printf(out, "%s{\"name\":", first ? "" : ",");
+            batch_print_petscii(out, buffer + i + SLOT_NAME_OFFSET,
+                                IMAGE_CONTENTS_FILE_NAME_LEN);
+            batch_printf(out, ",\"type\":\"%s\"",
+                         cbmdos_filetype_get(file_type & 7));
+            if (bytes >= 0) {
+                batch_printf(out, ",\"bytes\":%ld}", bytes);
+            } else {
+                batch_printf(out, ",\"error\":\"cannot extract\"}");
+                result = -1;
+            }
+            first = 0;
+        }
+
+        track = buffer[0];
+        sector = buffer[1];
+    }
+    batch_printf(out, "]");
+
+    lib_free(dest);
+    return result;
+}
+
+/** \brief  Script commands */
+static const struct {
+    const char *name;           /**< command name */
+    int max_args;               /**< maximum number of arguments */
+    batch_command_func_t func;  /**< handler */
+} batch_commands[] = {
+    { "info", 0, batch_info_cmd },
+    { "list", 1, batch_list_cmd },
+    { "extract", 1, batch_extract_cmd },
+    { NULL, 0, NULL }
+};
+
+static int batch_find_command(const char *name)
+{
+    int i;
+
+    for (i = 0; batch_commands[i].name != NULL; i++) {
+        if (strcmp(batch_commands[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* jobs */
+
+/** \brief  Run the script on image \a index and print its JSON line */
+static void batch_run_job(batch_t *batch, int index)
+{
+    batch_output_t out;
+    const char *image = batch->images[index];
+    vdrive_t *vdrive;
+    tick_t start = tick_now();
+    int ok = 1;
+    int i;
+
+    out.size = 1024;
+    out.len = 0;
+    out.data = lib_malloc(out.size);
+    out.data[0] = '\0';
+
+    batch_printf(&out, "\"results\":[");
+    vdrive = batch_open_image(image);
+    if (vdrive == NULL) {
+        ok = 0;
+        batch_printf(&out, "],\"error\":\"cannot open image\"");
+    } else {
+        for (i = 0; i < batch->num_commands; i++) {
+            const batch_command_t *cmd = &batch->commands[i];
+            int result;
+
+            batch_printf(&out, "%s{\"command\":", i > 0 ? "," : "");
+            batch_print_string(&out, cmd->argv[0]);
+            result = batch_commands[batch_find_command(cmd->argv[0])].func(vdrive, image, cmd, &out);
+            batch_printf(&out, ",\"ok\":%s}", result < 0 ? "false" : "true");
+            if (result < 0) {
+                ok = 0;
+            }
+        }
+        batch_printf(&out, "]");
+        batch_close_image(vdrive);
+    }
+
+    BATCH_LOCK(batch_lock);
+    fprintf(stdout, "{\"job\":%d,\"image\":", index);
+    {
+        batch_output_t name = { NULL, 0, 0 };
+
+        name.size = strlen(image) + 16;
+        name.data = lib_malloc(name.size);
+        batch_print_string(&name, image);
+        fputs(name.data, stdout);
+        lib_free(name.data);
+    }
+    fprintf(stdout, ",\"ok\":%s,\"ms\":%lu,%s}\n", ok ? "true" : "false",
+            (unsigned long)TICK_TO_MILLI(tick_now_delta(start)), out.data);
+    fflush(stdout);
+    if (!ok) {
+        batch->failed++;
+    }
+    BATCH_UNLOCK(batch_lock);
+
+    lib_free(out.data);
+}
+
+/** \brief  Get the next image to process, -1 if done */
+static int batch_next_job(batch_t *batch)
+{
+    int index = -1;
+
+    BATCH_LOCK(batch_lock);
+    if (batch->next < batch->num_images) {
+        index = batch->next++;
+    }
+    BATCH_UNLOCK(batch_lock);
+    return index;
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *batch_worker(void *param)
+{
+    batch_t *batch = param;
+    int index;
+
+    while ((index = batch_next_job(batch)) >= 0) {
+        batch_run_job(batch, index);
+    }
+    return NULL;
+}
+#endif
+
+
+/* ------------------------------------------------------------------------- */
+/* input */
+
+/** \brief  Read the non-empty, non-comment lines of \a path
+ *
+ * \return  number of lines, -1 on error
+ */
+static int batch_read_lines(const char *path, char ***lines)
+{
+    FILE *fd;
+    char buffer[4096];
+    int num = 0;
+    int size = 64;
+
+    fd = fopen(path, MODE_READ_TEXT);
+    if (fd == NULL) {
+        return -1;
+    }
+
+    *lines = lib_malloc(sizeof(char *) * (size_t)size);
+    while (fgets(buffer, sizeof(buffer), fd) != NULL) {
+        char *line = (char *)util_skip_whitespace(buffer);
+
+        if (*line == '\0' || *line == '#') {
+            continue;
+        }
+        /* strip trailing whitespace, including the newline */
+        ((char *)util_skip_whitespace_trailing(line))[1] = '\0';
+
+        if (num == size) {
+            size *= 2;
+            *lines = lib_realloc(*lines, sizeof(char *) * (size_t)size);
+        }
+        (*lines)[num++] = lib_strdup(line);
+    }
+    fclose(fd);
+    return num;
+}
+
+/** \brief  Match \a name against \a pattern with `*' and `?', ignoring case */
+static int batch_match(const char *pattern, const char *name)
+{
+    while (*pattern != '\0') {
+        if (*pattern == '*') {
+            pattern++;
+            do {
+                if (batch_match(pattern, name)) {
+                    return 1;
+                }
+            } while (*name++ != '\0');
+            return 0;
+        }
+        if (*name == '\0'
+            || (*pattern != '?'
+                && tolower((unsigned char)*pattern) != tolower((unsigned char)*name))) {
+            return 0;
+        }
+        pattern++;
+        name++;
+    }
+    return *name == '\0';
+}
+
+/** \brief  Get the images matching \a pattern
+ *
+ * \return  number of images, -1 on error
+ */
+static int batch_glob(const char *pattern, char ***images)
+{
+    archdep_dir_t *dir;
+    char *dirname;
+    char *filepattern;
+    const char *entry;
+    int num = 0;
+    int size = 64;
+    int i;
+
+    util_fname_split(pattern, &dirname, &filepattern);
+    dir = archdep_opendir(dirname != NULL && *dirname != '\0' ? dirname : ".",
+                          ARCHDEP_OPENDIR_NO_HIDDEN_FILES);
+    if (dir == NULL) {
+        lib_free(dirname);
+        lib_free(filepattern);
+        return -1;
+    }
+
+    *images = lib_malloc(sizeof(char *) * (size_t)size);
+    for (i = 0; (entry = archdep_readdir_get_file(dir, i)) != NULL; i++) {
+        if (!batch_match(filepattern, entry)) {
+            continue;
+        }
+        if (num == size) {
+            size *= 2;
+            *images = lib_realloc(*images, sizeof(char *) * (size_t)size);
+        }
+        if (dirname != NULL && *dirname != '\0') {
+            (*images)[num++] = util_join_paths(dirname, entry, NULL);
+        } else {
+            (*images)[num++] = lib_strdup(entry);
+        }
+    }
+
+    archdep_closedir(dir);
+    lib_free(dirname);
+    lib_free(filepattern);
+    return num;
+}
+
+/** \brief  Split a script line into a command
+ *
+ * Arguments are separated by whitespace and can be enclosed in double
+ * quotes. Modifies \a line in place.
+ *
+ * \return  0 on success, -1 on error
+ */
+static int batch_parse_command(char *line, batch_command_t *cmd)
+{
+    char *p = line;
+    int index;
+
+    cmd->argc = 0;
+    while (*p != '\0') {
+        char *out;
+
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (cmd->argc >= BATCH_MAX_ARGS) {
+            return -1;
+        }
+        cmd->argv[cmd->argc++] = out = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            if (*p == '"') {
+                p++;
+                while (*p != '\0' && *p != '"') {
+                    *out++ = *p++;
+                }
+                if (*p == '\0') {
+                    return -1;
+                }
+                p++;
+            } else {
+                *out++ = *p++;
+            }
+        }
+        if (*p != '\0') {
+            p++;
+        }
+        *out = '\0';
+    }
+
+    if (cmd->argc == 0) {
+        return -1;
+    }
+    index = batch_find_command(cmd->argv[0]);
+    if (index < 0 || cmd->argc - 1 > batch_commands[index].max_args) {
+        return -1;
+    }
+    return 0;
+}
+
+static void batch_free_lines(char **lines, int num)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        lib_free(lines[i]);
+    }
+    lib_free(lines);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Run the batch mode
+ *
+ * \param[in]   images  manifest file or pattern
+ * \param[in]   script  command script
+ * \param[in]   threads number of threads, 0 for one per CPU core
+ *
+ * \return  FD_OK if every image was processed without errors
+ */
+int c1541_batch_run(const char *images, const char *script, int threads)
+{
+    batch_t batch;
+    char **script_lines = NULL;
+    int num_lines;
+    int i;
+
+    memset(&batch, 0, sizeof(batch));
+
+    num_lines = batch_read_lines(script, &script_lines);
+    if (num_lines < 0) {
+        fprintf(stderr, "cannot read script `%s'\n", script);
+        return FD_NOTRD;
+    }
+    batch.commands = lib_calloc((size_t)num_lines + 1, sizeof(batch_command_t));
+    for (i = 0; i < num_lines; i++) {
+        if (batch_parse_command(script_lines[i], &batch.commands[i]) < 0) {
+            fprintf(stderr, "invalid script line `%s'\n", script_lines[i]);
+            lib_free(batch.commands);
+            batch_free_lines(script_lines, num_lines);
+            return FD_BADVAL;
+        }
+    }
+    batch.num_commands = num_lines;
+
+    if (strpbrk(images, "*?") != NULL) {
+        batch.num_images = batch_glob(images, &batch.images);
+    } else {
+        batch.num_images = batch_read_lines(images, &batch.images);
+    }
+    if (batch.num_images < 0) {
+        fprintf(stderr, "cannot read image list `%s'\n", images);
+        lib_free(batch.commands);
+        batch_free_lines(script_lines, num_lines);
+        return FD_NOTRD;
+    }
+
+    if (threads <= 0) {
+#ifdef UNIX_COMPILE
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = cores > 0 ? (int)cores : 1;
+#else
+        threads = 1;
+#endif
+    }
+    if (threads > batch.num_images) {
+        threads = batch.num_images > 0 ? batch.num_images : 1;
+    }
+
+    /* every image is read once and then only looked at */
+    fsimage_cache_set_backend(FSIMAGE_BACKEND_MEMORY);
+
+#ifdef HAVE_PTHREAD_H
+    if (threads > 1) {
+        pthread_t *workers = lib_malloc(sizeof(pthread_t) * (size_t)threads);
+        int started = 0;
+
+        for (i = 0; i < threads; i++) {
+            if (pthread_create(&workers[i], NULL, batch_worker, &batch) != 0) {
+                break;
+            }
+            started++;
+        }
+        /* if no thread could be started, do it all here */
+        batch_worker(&batch);
+        for (i = 0; i < started; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        lib_free(workers);
+    } else
+#endif
+    {
+        while ((i = batch_next_job(&batch)) >= 0) {
+            batch_run_job(&batch, i);
+        }
+    }
+
+    fsimage_cache_set_backend(FSIMAGE_BACKEND_STDIO);
+
+    batch_free_lines(batch.images, batch.num_images);
+    lib_free(batch.commands);
+    batch_free_lines(script_lines, num_lines);
+
+    return batch.failed > 0 ? FD_BADIMAGE : FD_OK;
+}
@@ -0,0 +1,36 @@
+/** \file   c1541-batch.h
+ * \brief   c1541 batch mode
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_C1541_BATCH_H
+#define VICE_C1541_BATCH_H
+
+int c1541_batch_run(const char *images, const char *script, int threads);
+
+/* implemented in c1541.c */
+int c1541_list_file_matches_pattern(const char *name, const char *type,
+                                    const char *pattern);
+const char *c1541_image_format_name(unsigned int type);
+
+#endif
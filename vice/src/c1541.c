@@ -76,6 +76,7 @@
 #endif
 
 #include "archdep.h"
+#include "c1541-batch.h"
 #include "cbmdos.h"
 #include "cbmimage.h"
 #include "charset.h"
@@ -187,6 +188,7 @@ static int translate_fsimage_error(int err);
 /* command handlers */
 static int attach_cmd(int nargs, char **args);
 static int bam_cmd(int nargs, char **args);
+static int batch_cmd(int nargs, char **args);
 static int bcopy_cmd(int nargs, char **args);
 static int bfill_cmd(int nargs, char **args);
 static int block_cmd(int nargs, char **args);
@@ -296,6 +298,15 @@ const command_t command_list[] = {
       "<track-max>",
       0, 3,
       bam_cmd },
+    { "batch",
+      "batch <images> <script> [<threads>]",
+      "Run the commands in <script> on every image listed in the file "
+      "<images>, or\nmatching the pattern <images> (eg `*.d64'), using "
+      "<threads> threads (default\nis one per CPU core). Supported commands "
+      "are `info', `list [<pattern>]' and\n`extract [<dir>]'. Prints one JSON "
+      "object per image.",
+      2, 3,
+      batch_cmd },
     { "bcopy",
       "bcopy <src-track> <src-sector> <dst-track> <dst-sector> [<src-unit> "
       "[<dst-unit>]]",
@@ -1505,6 +1516,36 @@ static int bam_cmd(int nargs, char **args)
 }
 
 
+/** \brief  Run a script on many images
+ *
+ * Syntax: `batch <images> <script> [<threads>]`
+ *
+ * Logging is silenced while the batch runs, so only the JSON lines end up
+ * on stdout. The log level in effect before is restored afterwards.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int batch_cmd(int nargs, char **args)
+{
+    int threads = 0;
+    int old_limit;
+    int result;
+
+    if (nargs > 3 && (arg_to_int(args[3], &threads) < 0 || threads < 0)) {
+        return FD_BADVAL;
+    }
+
+    old_limit = log_get_limit();
+    log_set_limit(LOG_LIMIT_SILENT);
+    result = c1541_batch_run(args[1], args[2], threads);
+    log_set_limit(old_limit);
+    return result;
+}
+
+
 /** \brief  Copy block to another block
  *
  * Copies a single block (sector) to another block, optionally between different
@@ -3478,6 +3519,28 @@ static int list_file_matches_pattern(const char *name,
 }
 
 
+/** \brief  Match a directory entry against a `list' pattern
+ *
+ * Exported for the batch mode, see list_file_matches_pattern().
+ */
+int c1541_list_file_matches_pattern(const char *name,
+                                    const char *type,
+                                    const char *pattern)
+{
+    return list_file_matches_pattern(name, type, pattern);
+}
+
+
+/** \brief  Get image type name from type number
+ *
+ * Exported for the batch mode, see image_format_name().
+ */
+const char *c1541_image_format_name(unsigned int type)
+{
+    return image_format_name(type);
+}
+
+
 
 /** \brief  Show directory listing of a drive
  *
@@ -207,8 +207,26 @@ void mem_toggle_watchpoints(int flag, void *context)
     see testprogs/CPU/cpuport for details and tests
 */
 
+/* RAM behind the page of `addr' for REU block transfers, NULL if DMA to
+   that page is anything else than a plain RAM access. $00/$01 go through
+   the DMA versions of the zero page functions, $ff00 triggers REU DMA. */
+static uint8_t *mem_reu_dma_ram(uint16_t addr, int write)
+{
+    unsigned int page = addr >> 8;
+
+    if (page == 0x00 || page == 0xff) {
+        return NULL;
+    }
+    if (write) {
+        return (_mem_write_tab_ptr[page] == ram_store) ? mem_ram : NULL;
+    }
+    return (_mem_read_tab_ptr[page] == ram_read) ? mem_ram : NULL;
+}
+
 void c64_mem_init(void)
 {
+    /* Initialize REU block transfer interface */
+    reu_dma_fast_register(vicii_next_pending_alarm_clk, mem_reu_dma_ram);
 }
 
 void mem_pla_config_changed(void)
@@ -47,6 +47,7 @@
 #include "mem.h"
 #include "monitor.h"
 #include "resources.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "types.h"
 #include "z80regs.h"
@@ -256,6 +256,16 @@ static struct reu_ba_s reu_ba = {
     NULL, NULL, NULL, 0, 0, 0, 0
 };
 
+/*! \brief interface for copying blocks directly from/to RAM, used for x64 */
+struct reu_dma_fast_s {
+    reu_dma_next_alarm_callback_t *next_alarm; /*!< function that returns the clock of the next pending VICII alarm */
+    reu_dma_ram_callback_t *ram;               /*!< function that returns the RAM behind a page, or NULL if it is not plain RAM */
+};
+
+static struct reu_dma_fast_s reu_dma_fast = {
+    NULL, NULL
+};
+
 static int reu_write_image = 0;
 
 static int floating_bus_value = 0xff;
@@ -598,6 +608,14 @@ void reu_ba_register(reu_ba_check_callback_t *ba_check,
     reu_ba.enabled = 1;
 }
 
+/*! \brief register the block transfer interface */
+void reu_dma_fast_register(reu_dma_next_alarm_callback_t *next_alarm,
+                           reu_dma_ram_callback_t *ram)
+{
+    reu_dma_fast.next_alarm = next_alarm;
+    reu_dma_fast.ram = ram;
+}
+
 /*! \brief reset the REU */
 void reu_reset(void)
 {
@@ -1153,6 +1171,158 @@ inline static uint8_t read_from_reu(unsigned int reu_addr)
 
 /* ------------------------------------------------------------------------- */
 
+#define REU_DMA_HOST_READ  1 /*!< the block transfer reads from the host */
+#define REU_DMA_HOST_WRITE 2 /*!< the block transfer writes to the host */
+
+/*! \brief get the host RAM behind a page for a block transfer
+
+  \param addr
+    An address in the page
+
+  \param access
+    REU_DMA_HOST_READ and/or REU_DMA_HOST_WRITE
+
+  \return
+    The host RAM (indexed by the full host address) if all requested accesses
+    to that page are plain RAM accesses, else NULL
+*/
+static uint8_t *reu_dma_fast_host_ram(uint16_t addr, int access)
+{
+    uint8_t *ram = NULL;
+
+    if (access & REU_DMA_HOST_READ) {
+        ram = reu_dma_fast.ram(addr, 0);
+        if (ram == NULL) {
+            return NULL;
+        }
+    }
+    if (access & REU_DMA_HOST_WRITE) {
+        uint8_t *write_ram = reu_dma_fast.ram(addr, 1);
+        if (write_ram == NULL || (ram != NULL && ram != write_ram)) {
+            return NULL;
+        }
+        ram = write_ram;
+    }
+    return ram;
+}
+
+/*! \brief determine how many bytes can be transferred as one block
+
+  The per-byte loops advance the clock by one or two cycles per byte and
+  serve the VICII alarms after every cycle. As long as no alarm becomes due,
+  these calls do nothing, and bytes that go from plain RAM to DRAM (or back)
+  have no side effects. Such a run can be copied in one go, with the clock
+  advanced by the same number of cycles.
+
+  \param host_addr
+    The host (computer) address of the next byte
+
+  \param reu_addr
+    The REU address of the next byte
+
+  \param host_step
+    The increment to use for the host address; must be either 0 or 1
+
+  \param reu_step
+    The increment to use for the REU address; must be either 0 or 1
+
+  \param len
+    The remaining transfer length
+
+  \param cycles_per_byte
+    The number of cycles the per-byte loop uses for one byte
+
+  \param access
+    REU_DMA_HOST_READ and/or REU_DMA_HOST_WRITE
+
+  \param host_ram
+    Returns the host RAM for the block
+
+  \return
+    The number of bytes that can be transferred as one block, 0 if the next
+    byte must go through the per-byte loop
+*/
+static int reu_dma_fast_len(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step,
+                            int len, int cycles_per_byte, int access, uint8_t **host_ram)
+{
+    CLOCK next_alarm;
+    unsigned int dram_addr;
+    unsigned int page, last_page;
+    int n = len;
+
+    /* x64sc checks BA every cycle, stay exact there */
+    if (reu_ba.enabled || reu_dma_fast.next_alarm == NULL) {
+        return 0;
+    }
+
+    /* no VICII alarm may become due before the last cycle of the block */
+    next_alarm = reu_dma_fast.next_alarm();
+    if (next_alarm <= maincpu_clk + cycles_per_byte) {
+        return 0;
+    }
+    if ((next_alarm - maincpu_clk - 1) / cycles_per_byte < (CLOCK)n) {
+        n = (int)((next_alarm - maincpu_clk - 1) / cycles_per_byte);
+    }
+
+    /* the REU addresses must be backed by DRAM and must not wrap around */
+    if ((reu_addr & 0x0007ffff) >= rec_options.wrap_around) {
+        return 0;
+    }
+    dram_addr = reu_addr & (rec_options.dram_wrap_around - 1);
+    if (dram_addr >= rec_options.not_backedup_addresses) {
+        return 0;
+    }
+    if (reu_step) {
+        if (rec_options.wrap_around - (reu_addr & 0x0007ffff) < (unsigned int)n) {
+            n = (int)(rec_options.wrap_around - (reu_addr & 0x0007ffff));
+        }
+        if (rec_options.not_backedup_addresses - dram_addr < (unsigned int)n) {
+            n = (int)(rec_options.not_backedup_addresses - dram_addr);
+        }
+    }
+
+    /* the host addresses must be plain RAM and must not wrap around */
+    *host_ram = reu_dma_fast_host_ram(host_addr, access);
+    if (*host_ram == NULL) {
+        return 0;
+    }
+    if (host_step) {
+        if (0x10000 - host_addr < n) {
+            n = 0x10000 - host_addr;
+        }
+        last_page = (host_addr + n - 1) >> 8;
+        for (page = (host_addr >> 8) + 1; page <= last_page; page++) {
+            if (reu_dma_fast_host_ram((uint16_t)(page << 8), access) != *host_ram) {
+                n = (int)((page << 8) - host_addr);
+                break;
+            }
+        }
+    }
+
+    return n;
+}
+
+/*! \brief advance the REU address after a block transfer
+
+  \param reu_addr
+    The REU address of the first byte of the block
+
+  \param reu_step
+    The increment to use for the REU address; must be either 0 or 1
+
+  \param n
+    The number of bytes in the block
+
+  \return
+    The REU address of the next byte, as the per-byte loop would have it
+*/
+inline static unsigned int reu_dma_fast_advance_reu(unsigned int reu_addr, int reu_step, int n)
+{
+    return increment_reu_with_wrap_around(reu_addr + (unsigned int)((n - 1) * reu_step), reu_step);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /*! \brief update the REU registers after a DMA operation
 
   \param host_addr
@@ -1242,7 +1412,10 @@ static void reu_dma_update_regs(uint16_t host_addr, unsigned int reu_addr, int l
 */
 static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
-    uint8_t value;
+    uint8_t value = 0;
+    uint8_t *host_ram;
+    uint8_t *dram;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s<= main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1251,6 +1424,25 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 1, REU_DMA_HOST_READ, &host_ram);
+        if (n > 0) {
+            dram = &reu_ram[reu_addr & (rec_options.dram_wrap_around - 1)];
+            if (host_step && reu_step) {
+                memcpy(dram, &host_ram[host_addr], n);
+            } else if (reu_step) {
+                memset(dram, host_ram[host_addr], n);
+            } else {
+                /* only the last byte stays in the fixed REU location */
+                *dram = host_ram[host_addr + (n - 1) * host_step];
+            }
+            value = host_ram[host_addr + (n - 1) * host_step];
+            maincpu_clk += n;
+            host_addr = (host_addr + n * host_step) & 0xffff;
+            reu_addr = reu_dma_fast_advance_reu(reu_addr, reu_step, n);
+            len -= n;
+            continue;
+        }
+
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value = mem_dma_read(host_addr);
@@ -1288,6 +1480,9 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
 static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    uint8_t *host_ram;
+    uint8_t *dram;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1296,6 +1491,25 @@ static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 1, REU_DMA_HOST_WRITE, &host_ram);
+        if (n > 0) {
+            dram = &reu_ram[reu_addr & (rec_options.dram_wrap_around - 1)];
+            if (host_step && reu_step) {
+                memcpy(&host_ram[host_addr], dram, n);
+            } else if (host_step) {
+                memset(&host_ram[host_addr], *dram, n);
+            } else {
+                /* only the last byte stays in the fixed host location */
+                host_ram[host_addr] = dram[(n - 1) * reu_step];
+            }
+            floating_bus_value = dram[(n - 1) * reu_step];
+            maincpu_clk += n;
+            host_addr = (host_addr + n * host_step) & 0xffff;
+            reu_addr = reu_dma_fast_advance_reu(reu_addr, reu_step, n);
+            len -= n;
+            continue;
+        }
+
         DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring byte: %x from ext $%05X to main $%04X.", reu_ram[reu_addr % reu_size], reu_addr, host_addr));
         nonsc_reu_clk_inc_pre();
         /* after a transfer from REU to host, the last (pre)fetched value from valid
@@ -1342,6 +1556,9 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
 {
     uint8_t value_from_reu;
     uint8_t value_from_c64;
+    uint8_t *host_ram;
+    uint8_t *dram;
+    int i, n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "swap ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1350,6 +1567,22 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 2,
+                             REU_DMA_HOST_READ | REU_DMA_HOST_WRITE, &host_ram);
+        if (n > 0) {
+            dram = &reu_ram[reu_addr & (rec_options.dram_wrap_around - 1)];
+            for (i = 0; i < n; i++) {
+                value_from_reu = dram[i * reu_step];
+                dram[i * reu_step] = host_ram[host_addr + i * host_step];
+                host_ram[host_addr + i * host_step] = value_from_reu;
+            }
+            maincpu_clk += 2 * n;
+            host_addr = (host_addr + n * host_step) & 0xffff;
+            reu_addr = reu_dma_fast_advance_reu(reu_addr, reu_step, n);
+            len -= n;
+            continue;
+        }
+
         value_from_reu = read_from_reu(reu_addr);
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
@@ -1397,6 +1630,10 @@ static void reu_dma_compare(uint16_t host_addr, unsigned int reu_addr, int host_
 
     uint8_t new_status_or_mask = 0;
 
+    uint8_t *host_ram;
+    uint8_t *dram;
+    int i, n;
+
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "compare ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1410,6 +1647,25 @@ static void reu_dma_compare(uint16_t host_addr, unsigned int reu_addr, int host_
     /* rec.status &= ~ (REU_REG_R_STATUS_VERIFY_ERROR | REU_REG_R_STATUS_END_OF_BLOCK); */
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 1, REU_DMA_HOST_READ, &host_ram);
+        if (n > 0) {
+            /* skip the bytes that compare equal, a mismatch goes through
+               the per-byte loop below */
+            dram = &reu_ram[reu_addr & (rec_options.dram_wrap_around - 1)];
+            for (i = 0; i < n; i++) {
+                if (dram[i * reu_step] != host_ram[host_addr + i * host_step]) {
+                    break;
+                }
+            }
+            if (i > 0) {
+                maincpu_clk += i;
+                host_addr = (host_addr + i * host_step) & 0xffff;
+                reu_addr = reu_dma_fast_advance_reu(reu_addr, reu_step, i);
+                len -= i;
+                continue;
+            }
+        }
+
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value_from_reu = read_from_reu(reu_addr);
@@ -0,0 +1,203 @@
+/** \file   vsid-render.c
+ * \brief   Offline rendering of PSID tunes to sound files
+ *
+ * With `-render <file>` VSID plays the selected tune in warp mode and writes
+ * every sample to a WAV file (or FLAC if the name ends in ".flac"), then
+ * exits. The duration is given with `-rendertime`, or taken from the HVSC
+ * song length database when that is 0.
+ *
+ * Many tunes can be rendered in parallel with the batch mode of the headless
+ * UI, one job line per tune.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "hvsc.h"
+#include "lib.h"
+#include "log.h"
+#include "psid.h"
+#include "resources.h"
+#include "sound.h"
+#include "util.h"
+#include "vsync.h"
+
+#include "vsid-render.h"
+
+
+/** \brief  Duration used when the tune is not in the song length database
+ */
+#define VSID_RENDER_DEFAULT_MSEC    (3 * 60 * 1000)
+
+
+/* PSID file loaded from commandline, see vsid.c */
+extern char *psid_autostart_image;
+
+/** \brief  Name of the output file (`-render`)
+ */
+static char *render_file = NULL;
+
+/** \brief  Duration in seconds (`-rendertime`), 0 to use the song length DB
+ */
+static int render_seconds = 0;
+
+/** \brief  Duration in milliseconds, determined on the first frame
+ */
+static long render_msec = -1;
+
+
+static int set_render_file(const char *param, void *extra_param)
+{
+    const char *ext;
+
+    ext = strrchr(param, '.');
+    if (resources_set_string("SoundDeviceName",
+                             ext != NULL && util_strcasecmp(ext, ".flac") == 0
+                             ? "flac" : "wav") < 0
+        || resources_set_string("SoundDeviceArg", param) < 0
+        || resources_set_int("Sound", 1) < 0) {
+        log_error(LOG_DEFAULT, "Render: cannot set up the sound output to `%s'.", param);
+        return -1;
+    }
+
+    /* only now, a failed -render must neither warp nor exit */
+    util_string_set(&render_file, param);
+    sound_set_offline_render(1);
+    return 0;
+}
+
+static int set_render_seconds(const char *param, void *extra_param)
+{
+    int num = atoi(param);
+
+    if (num < 0) {
+        return -1;
+    }
+    render_seconds = num;
+    return 0;
+}
+
+
+/** \brief  Command line options for offline rendering
+ */
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-render", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_render_file, NULL, NULL, NULL,
+      "<Name>", "Render the tune to sound file <Name> (.wav or .flac) as fast as possible and exit" },
+    { "-rendertime", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_render_seconds, NULL, NULL, NULL,
+      "<seconds>", "Duration of the rendered tune (0: use the HVSC song length database)" },
+    CMDLINE_LIST_END
+};
+
+
+/** \brief  Register the offline rendering command line options
+ *
+ * \return  0 on success, -1 on failure
+ */
+int vsid_render_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+
+/** \brief  Free memory used by the offline rendering
+ */
+void vsid_render_shutdown(void)
+{
+    lib_free(render_file);
+    render_file = NULL;
+}
+
+
+/** \brief  Determine the duration of the rendered tune
+ *
+ * \return  duration in milliseconds
+ */
+static long vsid_render_duration(void)
+{
+    long *lengths = NULL;
+    long msec = VSID_RENDER_DEFAULT_MSEC;
+    int tune = 0;
+    int songs;
+
+    if (render_seconds > 0) {
+        return render_seconds * 1000L;
+    }
+
+    resources_get_int("PSIDTune", &tune);
+    if (tune == 0) {
+        psid_tunes(&tune);
+    }
+
+    songs = -1;
+    if (psid_autostart_image != NULL) {
+        songs = hvsc_sldb_get_lengths(psid_autostart_image, &lengths);
+    }
+    if (songs >= tune && tune > 0) {
+        msec = lengths[tune - 1];
+    } else {
+        log_warning(LOG_DEFAULT,
+                    "Render: no song length for tune %d, rendering %ld seconds.",
+                    tune, msec / 1000);
+    }
+    if (lengths != NULL) {
+        lib_free(lengths);
+    }
+    return msec;
+}
+
+
+/** \brief  Check if the rendered tune is complete
+ *
+ * Called at the end of every frame, exits VICE once the requested duration
+ * has been written.
+ *
+ * \param[in]   frames          number of frames played
+ * \param[in]   rfsh_per_sec    frames per second
+ */
+void vsid_render_frame(unsigned int frames, double rfsh_per_sec)
+{
+    if (render_file == NULL) {
+        return;
+    }
+
+    if (render_msec < 0) {
+        render_msec = vsid_render_duration();
+        log_message(LOG_DEFAULT, "Render: writing %ld.%03ld seconds to `%s'.",
+                    render_msec / 1000, render_msec % 1000, render_file);
+        /* no need to stay in sync with the host, see sound_set_offline_render() */
+        vsync_set_warp_mode(1);
+    }
+
+    if ((double)frames * 1000.0 / rfsh_per_sec >= (double)render_msec) {
+        archdep_vice_exit(EXIT_SUCCESS);
+    }
+}
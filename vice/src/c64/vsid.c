@@ -69,6 +69,7 @@
 #include "vsid-cmdline-options.h"
 #include "vsidui.h"
 #include "vsid-debugcart.h"
+#include "vsid-render.h"
 #include "vsync.h"
 
 
@@ -167,6 +168,10 @@ int machine_cmdline_options_init(void)
         init_cmdline_options_fail("debug cart");
         return -1;
     }
+    if (vsid_render_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("render");
+        return -1;
+    }
     return 0;
 }
 
@@ -300,6 +305,7 @@ void machine_specific_shutdown(void)
     sid_cmdline_options_shutdown();
 
     psid_shutdown();
+    vsid_render_shutdown();
 }
 
 void machine_handle_pending_alarms(CLOCK num_write_cycles)
@@ -313,6 +319,7 @@ void machine_handle_pending_alarms(CLOCK num_write_cycles)
 static void machine_vsync_hook(void)
 {
     int i;
+    unsigned int frames;
     unsigned int playtime;
     static unsigned int time = 0;
 
@@ -330,18 +337,20 @@ static void machine_vsync_hook(void)
         }
     }
 
+    frames = psid_increment_frames();
 #if 0
-    playtime = (psid_increment_frames() * machine_timing.cycles_per_rfsh)
+    playtime = (frames * machine_timing.cycles_per_rfsh)
         / machine_timing.cycles_per_sec;
 #else
     /* Count deciseconds */
-    playtime = (double)psid_increment_frames()
-        / machine_timing.rfsh_per_sec * 10.0;
+    playtime = (double)frames / machine_timing.rfsh_per_sec * 10.0;
 #endif
     if (playtime != time) {
         time = playtime;
         vsid_ui_display_time(playtime);
     }
+
+    vsid_render_frame(frames, machine_timing.rfsh_per_sec);
 }
 
 void machine_set_restore_key(int v)
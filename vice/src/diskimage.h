@@ -99,6 +99,9 @@ struct disk_image_s {
     unsigned int max_half_tracks;
     struct gcr_s *gcr;
     struct TP64Image *p64;
+    unsigned int generation; /* bumped on every write, so cached views of
+                                the contents (vdrive directory index) can
+                                tell they are stale */
 };
 typedef struct disk_image_s disk_image_t;
 
@@ -40,6 +40,7 @@
 
 #include "diskconstants.h"
 #include "diskimage.h"
+#include "fsimage-cache.h"
 #include "fsimage-check.h"
 #include "fsimage-create.h"
 #include "fsimage-dxx.h"
@@ -604,6 +605,8 @@ int disk_image_open(disk_image_t *image)
 
     DBG(("disk_image_open"));
 
+    image->generation = 0;
+
     switch (image->device) {
         case DISK_IMAGE_DEVICE_FS:
             rc = fsimage_open(image);
@@ -679,6 +682,8 @@ int disk_image_write_sector(disk_image_t *image, const uint8_t *buf, const disk_
         return -1;
     }
 
+    image->generation++;
+
     switch (image->device) {
         case DISK_IMAGE_DEVICE_FS:
             rc = fsimage_write_sector(image, buf, dadr);
@@ -710,6 +715,8 @@ int disk_image_write_half_track(disk_image_t *image, unsigned int half_track,
         return -1;
     }
 
+    image->generation++;
+
     switch (image->type) {
         case DISK_IMAGE_TYPE_P64:
             return fsimage_p64_write_half_track(image, half_track, raw);
@@ -754,7 +761,7 @@ void disk_image_init(void)
 
 int disk_image_resources_init(void)
 {
-    return 0;
+    return fsimage_cache_resources_init();
 }
 
 void disk_image_resources_shutdown(void)
@@ -763,7 +770,7 @@ void disk_image_resources_shutdown(void)
 
 int disk_image_cmdline_options_init(void)
 {
-    return 0;
+    return fsimage_cache_cmdline_options_init();
 }
 
 /*-----------------------------------------------------------------------*/
@@ -0,0 +1,459 @@
+/*
+ * fsimage-cache.c - Memory mapped and in-memory access to disk images.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The sector based images (D64 .. DHD) and G64 are read and written with
+   util_fpread()/util_fpwrite(), which is an fseek() plus an fread() or
+   fwrite() for every sector or half track. This adds two other ways to get
+   at the image data:
+
+   - mmap: the image file is mapped into memory, writes go straight into the
+     mapping and are synced to the file with msync().
+   - memory: the whole image is read into memory once, written blocks are
+     marked dirty and written back in runs.
+
+   In both cases the data is written back when the image is detached and,
+   if DiskImageSyncInterval is not 0, about that many seconds after the
+   first write that is not written back yet. The emulators check that every
+   frame from drive_vsync_hook(), tools without a frame loop check it when
+   they flush after a write. Accesses that do not fit the cached image (growing the file) turn
+   the cache off for the image and continue with stdio.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define FSIMAGE_CACHE_HAVE_MMAP
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "diskimage.h"
+#include "fsimage-cache.h"
+#include "fsimage.h"
+#include "lib.h"
+#include "log.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+
+/* granularity of the dirty tracking in memory mode */
+#define FSIMAGE_CACHE_BLOCK_SIZE    256
+
+typedef struct fsimage_cache_s {
+    fsimage_t *fsimage;
+    struct fsimage_cache_s *next;
+
+    int backend;
+    int read_only;
+    uint8_t *data;
+    size_t size;
+
+    /* memory: one flag per block */
+    uint8_t *dirty_map;
+    /* something was written since the last sync, first at `dirty_since' */
+    int dirty;
+    tick_t dirty_since;
+
+    /* statistics, logged when the image is closed */
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long syncs;
+} fsimage_cache_t;
+
+static log_t fsimage_cache_log = LOG_DEFAULT;
+
+/* all open caches, for the periodic write back; c1541 batch mode opens
+   images on several threads */
+static fsimage_cache_t *cache_list = NULL;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t cache_list_lock = PTHREAD_MUTEX_INITIALIZER;
+#define CACHE_LIST_LOCK()   pthread_mutex_lock(&cache_list_lock)
+#define CACHE_LIST_UNLOCK() pthread_mutex_unlock(&cache_list_lock)
+#else
+#define CACHE_LIST_LOCK()
+#define CACHE_LIST_UNLOCK()
+#endif
+
+/* resources */
+static int backend_setting = FSIMAGE_BACKEND_STDIO;
+static int sync_interval = 5;
+
+static int set_backend(int val, void *param)
+{
+    switch (val) {
+        case FSIMAGE_BACKEND_STDIO:
+        case FSIMAGE_BACKEND_MMAP:
+        case FSIMAGE_BACKEND_MEMORY:
+            break;
+        default:
+            return -1;
+    }
+    /* only used for images attached from now on */
+    backend_setting = val;
+    return 0;
+}
+
+static int set_sync_interval(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+    sync_interval = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "DiskImageBackend", FSIMAGE_BACKEND_STDIO, RES_EVENT_NO, NULL,
+      &backend_setting, set_backend, NULL },
+    { "DiskImageSyncInterval", 5, RES_EVENT_NO, NULL,
+      &sync_interval, set_sync_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int fsimage_cache_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-diskimagebackend", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "DiskImageBackend", NULL,
+      "<mode>", "Set how disk images are accessed (0: stdio, 1: memory mapped, 2: loaded into memory)" },
+    { "-diskimagesync", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "DiskImageSyncInterval", NULL,
+      "<seconds>", "Write back changed disk image data this many seconds after a write (0: on detach only)" },
+    CMDLINE_LIST_END
+};
+
+int fsimage_cache_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void fsimage_cache_set_backend(int backend)
+{
+    set_backend(backend, NULL);
+}
+
+void fsimage_cache_init(void)
+{
+    fsimage_cache_log = log_open("Filesystem Image Cache");
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cache_sync(fsimage_t *fsimage)
+{
+    fsimage_cache_t *cache = fsimage->cache;
+    size_t blocks, first, last, start, end;
+    int result = 0;
+
+    if (!cache->dirty) {
+        return 0;
+    }
+
+    if (cache->backend == FSIMAGE_BACKEND_MEMORY) {
+        blocks = (cache->size + FSIMAGE_CACHE_BLOCK_SIZE - 1) / FSIMAGE_CACHE_BLOCK_SIZE;
+        for (first = 0; first < blocks; first = last) {
+            if (!cache->dirty_map[first]) {
+                last = first + 1;
+                continue;
+            }
+            /* write runs of dirty blocks at once */
+            for (last = first; last < blocks && cache->dirty_map[last]; last++) {
+                cache->dirty_map[last] = 0;
+            }
+            start = first * FSIMAGE_CACHE_BLOCK_SIZE;
+            end = last * FSIMAGE_CACHE_BLOCK_SIZE;
+            if (end > cache->size) {
+                end = cache->size;
+            }
+            if (util_fpwrite(fsimage->fd, cache->data + start, end - start, (long)start) < 0) {
+                log_error(fsimage_cache_log, "Error writing back `%s'.", fsimage->name);
+                result = -1;
+            }
+        }
+        fflush(fsimage->fd);
+    }
+#ifdef FSIMAGE_CACHE_HAVE_MMAP
+    else if (cache->backend == FSIMAGE_BACKEND_MMAP) {
+        if (msync(cache->data, cache->size, MS_SYNC) < 0) {
+            log_error(fsimage_cache_log, "Error syncing `%s'.", fsimage->name);
+            result = -1;
+        }
+    }
+#endif
+
+    cache->dirty = 0;
+    cache->syncs++;
+    return result;
+}
+
+static void cache_sync_if_due(fsimage_t *fsimage)
+{
+    fsimage_cache_t *cache = fsimage->cache;
+
+    if (sync_interval > 0 && cache->dirty
+        && tick_now_delta(cache->dirty_since) >= tick_per_second() * (tick_t)sync_interval) {
+        cache_sync(fsimage);
+    }
+}
+
+static int cache_release(fsimage_t *fsimage)
+{
+    fsimage_cache_t *cache = fsimage->cache;
+    fsimage_cache_t **p;
+    int result;
+
+    if (cache == NULL) {
+        return 0;
+    }
+
+    CACHE_LIST_LOCK();
+    for (p = &cache_list; *p != NULL; p = &(*p)->next) {
+        if (*p == cache) {
+            *p = cache->next;
+            break;
+        }
+    }
+    CACHE_LIST_UNLOCK();
+
+    result = cache_sync(fsimage);
+
+    log_verbose(fsimage_cache_log, "`%s': %lu reads, %lu writes, %lu write backs.",
+                fsimage->name, cache->reads, cache->writes, cache->syncs);
+
+#ifdef FSIMAGE_CACHE_HAVE_MMAP
+    if (cache->backend == FSIMAGE_BACKEND_MMAP) {
+        munmap(cache->data, cache->size);
+    } else
+#endif
+    {
+        lib_free(cache->data);
+        lib_free(cache->dirty_map);
+    }
+    lib_free(cache);
+    fsimage->cache = NULL;
+    return result;
+}
+
+#ifdef FSIMAGE_CACHE_HAVE_MMAP
+static int cache_map(fsimage_t *fsimage, fsimage_cache_t *cache)
+{
+    void *data;
+
+    /* the mapping must see everything written through stdio so far */
+    fflush(fsimage->fd);
+    data = mmap(NULL, cache->size, PROT_READ | (cache->read_only ? 0 : PROT_WRITE),
+                MAP_SHARED, fileno(fsimage->fd), 0);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    cache->data = data;
+    return 0;
+}
+#endif
+
+static int cache_load(fsimage_t *fsimage, fsimage_cache_t *cache)
+{
+    size_t blocks = (cache->size + FSIMAGE_CACHE_BLOCK_SIZE - 1) / FSIMAGE_CACHE_BLOCK_SIZE;
+
+    cache->data = lib_malloc(cache->size);
+    if (util_fpread(fsimage->fd, cache->data, cache->size, 0) < 0) {
+        lib_free(cache->data);
+        cache->data = NULL;
+        return -1;
+    }
+    cache->dirty_map = lib_calloc(1, blocks);
+    return 0;
+}
+
+void fsimage_cache_open(disk_image_t *image)
+{
+    fsimage_t *fsimage = image->media.fsimage;
+    fsimage_cache_t *cache;
+    off_t size;
+    int result = -1;
+
+    if (fsimage->cache != NULL || backend_setting == FSIMAGE_BACKEND_STDIO) {
+        return;
+    }
+
+    switch (image->type) {
+        case DISK_IMAGE_TYPE_D64:
+        case DISK_IMAGE_TYPE_D67:
+        case DISK_IMAGE_TYPE_D71:
+        case DISK_IMAGE_TYPE_D81:
+        case DISK_IMAGE_TYPE_D80:
+        case DISK_IMAGE_TYPE_D82:
+#ifdef HAVE_X64_IMAGE
+        case DISK_IMAGE_TYPE_X64:
+#endif
+        case DISK_IMAGE_TYPE_D1M:
+        case DISK_IMAGE_TYPE_D2M:
+        case DISK_IMAGE_TYPE_D4M:
+        case DISK_IMAGE_TYPE_DHD:
+        case DISK_IMAGE_TYPE_D90:
+        case DISK_IMAGE_TYPE_G64:
+        case DISK_IMAGE_TYPE_G71:
+            break;
+        default:
+            return;
+    }
+
+    size = archdep_file_size(fsimage->fd);
+    if (size <= 0) {
+        return;
+    }
+
+    cache = lib_calloc(1, sizeof(fsimage_cache_t));
+    cache->fsimage = fsimage;
+    cache->backend = backend_setting;
+    cache->read_only = image->read_only;
+    cache->size = (size_t)size;
+
+#ifdef FSIMAGE_CACHE_HAVE_MMAP
+    if (cache->backend == FSIMAGE_BACKEND_MMAP) {
+        result = cache_map(fsimage, cache);
+    }
+#else
+    if (cache->backend == FSIMAGE_BACKEND_MMAP) {
+        /* closest thing we have */
+        cache->backend = FSIMAGE_BACKEND_MEMORY;
+    }
+#endif
+    if (cache->backend == FSIMAGE_BACKEND_MEMORY) {
+        result = cache_load(fsimage, cache);
+    }
+
+    if (result < 0) {
+        log_warning(fsimage_cache_log, "Cannot cache `%s', using stdio.", fsimage->name);
+        lib_free(cache);
+        return;
+    }
+
+    fsimage->cache = cache;
+
+    CACHE_LIST_LOCK();
+    cache->next = cache_list;
+    cache_list = cache;
+    CACHE_LIST_UNLOCK();
+}
+
+int fsimage_cache_close(disk_image_t *image)
+{
+    return cache_release(image->media.fsimage);
+}
+
+int fsimage_cache_sync(fsimage_t *fsimage)
+{
+    if (fsimage->cache == NULL) {
+        return 0;
+    }
+    return cache_sync(fsimage);
+}
+
+void fsimage_cache_vsync_hook(void)
+{
+    fsimage_cache_t *cache;
+
+    if (sync_interval == 0 || cache_list == NULL) {
+        return;
+    }
+
+    CACHE_LIST_LOCK();
+    for (cache = cache_list; cache != NULL; cache = cache->next) {
+        cache_sync_if_due(cache->fsimage);
+    }
+    CACHE_LIST_UNLOCK();
+}
+
+/* ------------------------------------------------------------------------- */
+
+int fsimage_read(fsimage_t *fsimage, void *buf, size_t num, long offset)
+{
+    fsimage_cache_t *cache = fsimage->cache;
+
+    if (cache == NULL) {
+        return util_fpread(fsimage->fd, buf, num, offset);
+    }
+
+    cache->reads++;
+    if (offset < 0 || (size_t)offset + num > cache->size) {
+        return -1;
+    }
+    memcpy(buf, cache->data + offset, num);
+    return 0;
+}
+
+int fsimage_write(fsimage_t *fsimage, const void *buf, size_t num, long offset)
+{
+    fsimage_cache_t *cache = fsimage->cache;
+    size_t block;
+
+    if (cache == NULL || cache->read_only) {
+        return util_fpwrite(fsimage->fd, buf, num, offset);
+    }
+
+    if (offset < 0 || (size_t)offset + num > cache->size) {
+        /* the image grows, continue without the cache */
+        cache_release(fsimage);
+        return util_fpwrite(fsimage->fd, buf, num, offset);
+    }
+
+    cache->writes++;
+    memcpy(cache->data + offset, buf, num);
+    if (cache->backend == FSIMAGE_BACKEND_MEMORY) {
+        for (block = (size_t)offset / FSIMAGE_CACHE_BLOCK_SIZE;
+             block * FSIMAGE_CACHE_BLOCK_SIZE < (size_t)offset + num; block++) {
+            cache->dirty_map[block] = 1;
+        }
+    }
+    if (!cache->dirty) {
+        cache->dirty = 1;
+        cache->dirty_since = tick_now();
+    }
+    return 0;
+}
+
+void fsimage_flush(fsimage_t *fsimage)
+{
+    fsimage_cache_t *cache = fsimage->cache;
+
+    if (cache == NULL) {
+        fflush(fsimage->fd);
+        return;
+    }
+
+    cache_sync_if_due(fsimage);
+}
@@ -0,0 +1,64 @@
+/*
+ * fsimage-cache.h - Memory mapped and in-memory access to disk images.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FSIMAGE_CACHE_H
+#define VICE_FSIMAGE_CACHE_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+struct disk_image_s;
+struct fsimage_s;
+
+/* values of the DiskImageBackend resource */
+#define FSIMAGE_BACKEND_STDIO   0   /* fseek/fread/fwrite for every access */
+#define FSIMAGE_BACKEND_MMAP    1   /* image file mapped into memory */
+#define FSIMAGE_BACKEND_MEMORY  2   /* whole image loaded, dirty blocks written back */
+
+int fsimage_cache_resources_init(void);
+int fsimage_cache_cmdline_options_init(void);
+void fsimage_cache_init(void);
+
+/* Sets the backend without going through the resources, for tools */
+void fsimage_cache_set_backend(int backend);
+
+/* Called once the image was probed, sets up the configured backend for the
+   sector based image types. Falls back to stdio if that is not possible. */
+void fsimage_cache_open(struct disk_image_s *image);
+/* Writes back everything and returns to stdio access */
+int fsimage_cache_close(struct disk_image_s *image);
+/* Writes back everything that changed */
+int fsimage_cache_sync(struct fsimage_s *fsimage);
+/* Called every frame, writes back the images changed more than the sync
+   interval ago */
+void fsimage_cache_vsync_hook(void);
+
+/* Replacements for util_fpread()/util_fpwrite() on the image file */
+int fsimage_read(struct fsimage_s *fsimage, void *buf, size_t num, long offset);
+int fsimage_write(struct fsimage_s *fsimage, const void *buf, size_t num, long offset);
+/* Makes writes visible to other readers: fflush() for stdio, write back if
+   the sync interval has passed otherwise, for tools that have no frames */
+void fsimage_flush(struct fsimage_s *fsimage);
+
+#endif
@@ -33,6 +33,7 @@
 #include "diskimage.h"
 #include "drive.h"
 #include "cbmdos.h"
+#include "fsimage-cache.h"
 #include "fsimage-dxx.h"
 #include "fsimage.h"
 #include "gcr.h"
@@ -108,7 +109,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buffer, max_sector * 256, offset) < 0) {
+    if (fsimage_write(fsimage, buffer, max_sector * 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u to disk image.",
                   track);
         lib_free(buffer);
@@ -126,10 +127,10 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
 #endif
             fsimage->error_info.dirty = 0;
             if (error_info_created) {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map,
+                res = fsimage_write(fsimage, fsimage->error_info.map,
                                    fsimage->error_info.len, fsimage->error_info.len * 256);
             } else {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map + sectors,
+                res = fsimage_write(fsimage, fsimage->error_info.map + sectors,
                                    max_sector, offset);
             }
             if (res < 0) {
@@ -142,7 +143,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    fsimage_flush(fsimage);
     return 0;
 }
 
@@ -175,7 +176,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 
     bam_id[0] = bam_id[1] = 0xa0;
     if (sectors >= 0) {
-        util_fpread(fsimage->fd, buffer, 256, sectors << 8);
+        fsimage_read(fsimage, buffer, 256, sectors << 8);
     } else {
         return -1;
     }
@@ -243,7 +244,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 
                 buffer[BAM_ID_1571] = buffer[BAM_ID_1571 + 1] = 0xa0;
                 if (sectors >= 0) {
-                    util_fpread(fsimage->fd, buffer, 256, sectors << 8);
+                    fsimage_read(fsimage, buffer, 256, sectors << 8);
                 }
                 header.id1 = buffer[BAM_ID_1571]; /* second side, update id and track */
                 header.id2 = buffer[BAM_ID_1571 + 1];
@@ -270,7 +271,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 #endif
                 if (sectors >= 0) {
                     rf = CBMDOS_FDC_ERR_DRIVE;
-                    if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
+                    if (fsimage_read(fsimage, buffer, 256, offset) >= 0) {
                         if (fsimage->error_info.map != NULL) {
                             rf = fsimage->error_info.map[sectors];
                         }
@@ -373,7 +374,7 @@ int fsimage_dxx_read_sector(const disk_image_t *image, uint8_t *buf, const disk_
 
     if (harderror == 0) {
         if (image->gcr == NULL) {
-            if (util_fpread(fsimage->fd, buf, 256, offset) < 0) {
+            if (fsimage_read(fsimage, buf, 256, offset) < 0) {
                 log_error(fsimage_dxx_log,
                         "Error reading T:%u S:%u from disk image.",
                         dadr->track, dadr->sector);
@@ -450,7 +451,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buf, 256, offset) < 0) {
+    if (fsimage_write(fsimage, buf, 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u S:%u to disk image.",
                   dadr->track, dadr->sector);
         return -1;
@@ -469,7 +470,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         }
 #endif
         fsimage->error_info.map[sectors] = CBMDOS_FDC_ERR_OK;
-        if (util_fpwrite(fsimage->fd, &fsimage->error_info.map[sectors], 1, offset) < 0) {
+        if (fsimage_write(fsimage, &fsimage->error_info.map[sectors], 1, offset) < 0) {
             log_error(fsimage_dxx_log,
                     "Error writing T:%u S:%u error info to disk image.",
                     dadr->track, dadr->sector);
@@ -477,7 +478,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    fsimage_flush(fsimage);
     return 0;
 }
 
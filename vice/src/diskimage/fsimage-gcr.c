@@ -31,6 +31,7 @@
 
 #include "diskconstants.h"
 #include "diskimage.h"
+#include "fsimage-cache.h"
 #include "fsimage-gcr.h"
 #include "fsimage.h"
 #include "gcr.h"
@@ -85,7 +86,7 @@ static long fsimage_gcr_seek_half_track(fsimage_t *fsimage, unsigned int half_tr
         log_error(fsimage_gcr_log, "Attempt to read without disk image.");
         return -1;
     }
-    if (util_fpread(fsimage->fd, buf, 12, 0) < 0) {
+    if (fsimage_read(fsimage, buf, 12, 0) < 0) {
         log_error(fsimage_gcr_log, "Could not read GCR disk image.");
         return -1;
     }
@@ -112,7 +113,7 @@ static long fsimage_gcr_seek_half_track(fsimage_t *fsimage, unsigned int half_tr
     }
 #endif
 
-    if (util_fpread(fsimage->fd, buf, 4, 12 + (half_track - 2) * 4) < 0) {
+    if (fsimage_read(fsimage, buf, 4, 12 + (half_track - 2) * 4) < 0) {
         log_error(fsimage_gcr_log, "Could not read GCR disk image.");
         return -1;
     }
@@ -144,7 +145,7 @@ int fsimage_gcr_read_half_track(const disk_image_t *image, unsigned int half_tra
     }
 
     if (offset != 0) {
-        if (util_fpread(fsimage->fd, buf, 2, offset) < 0) {
+        if (fsimage_read(fsimage, buf, 2, offset) < 0) {
             log_error(fsimage_gcr_log, "Could not read GCR disk image.");
             return -1;
         }
@@ -161,7 +162,7 @@ int fsimage_gcr_read_half_track(const disk_image_t *image, unsigned int half_tra
         raw->data = lib_calloc(1, track_len);
         raw->size = track_len;
 
-        if (fread(raw->data, track_len, 1, fsimage->fd) < 1) {
+        if (fsimage_read(fsimage, raw->data, track_len, offset + 2) < 0) {
             log_error(fsimage_gcr_log, "Could not read GCR disk image.");
             return -1;
         }
@@ -213,6 +214,8 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     if (offset == 0) {
+        /* the image grows, which the cache does not handle */
+        fsimage_cache_close(image);
         offset = fseek(fsimage->fd, 0, SEEK_END);
         if (offset == 0) {
             offset = ftell(fsimage->fd);
@@ -227,14 +230,14 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
     if (raw->data != NULL) {
         util_word_to_le_buf(buf, (uint16_t)raw->size);
 
-        if (util_fpwrite(fsimage->fd, buf, 2, offset) < 0) {
+        if (fsimage_write(fsimage, buf, 2, offset) < 0) {
             log_error(fsimage_gcr_log, "Could not write GCR disk image.");
             return -1;
         }
 
         /* Clear gap between the end of the actual track and the start of
            the next track.  */
-        if (fwrite(raw->data, raw->size, 1, fsimage->fd) < 1) {
+        if (fsimage_write(fsimage, raw->data, raw->size, offset + 2) < 0) {
             log_error(fsimage_gcr_log, "Could not write GCR disk image.");
             return -1;
         }
@@ -242,9 +245,9 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
 
         if (gap > 0) {
             uint8_t *padding = lib_calloc(1, gap);
-            res = fwrite(padding, gap, 1, fsimage->fd);
+            res = fsimage_write(fsimage, padding, gap, offset + 2 + raw->size);
             lib_free(padding);
-            if (res < 1) {
+            if (res < 0) {
                 log_error(fsimage_gcr_log, "Could not write GCR disk image.");
                 return -1;
             }
@@ -257,13 +260,13 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
              *        -- compyx 2020-07-24
              */
             util_dword_to_le_buf(buf, (uint32_t)offset);
-            if (util_fpwrite(fsimage->fd, buf, 4, 12 + (half_track - 2) * 4) < 0) {
+            if (fsimage_write(fsimage, buf, 4, 12 + (half_track - 2) * 4) < 0) {
                 log_error(fsimage_gcr_log, "Could not write GCR disk image.");
                 return -1;
             }
 
             util_dword_to_le_buf(buf, disk_image_speed_map(image->type, half_track / 2));
-            if (util_fpwrite(fsimage->fd, buf, 4, 12 + (half_track - 2 + num_half_tracks) * 4) < 0) {
+            if (fsimage_write(fsimage, buf, 4, 12 + (half_track - 2 + num_half_tracks) * 4) < 0) {
                 log_error(fsimage_gcr_log, "Could not write GCR disk image.");
                 return -1;
             }
@@ -271,7 +274,7 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    fsimage_flush(fsimage);
 
     return 0;
 }
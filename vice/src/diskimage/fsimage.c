@@ -32,6 +32,7 @@
 #include "archdep.h"
 #include "diskconstants.h"
 #include "diskimage.h"
+#include "fsimage-cache.h"
 #include "fsimage-dxx.h"
 #include "fsimage-gcr.h"
 #include "fsimage-p64.h"
@@ -162,6 +163,7 @@ int fsimage_open(disk_image_t *image)
     }
 
     if (fsimage_probe(image) == 0) {
+        fsimage_cache_open(image);
         return 0;
     }
 
@@ -181,6 +183,9 @@ int fsimage_close(disk_image_t *image)
         return -1;
     }
 
+    /* write back what is still cached */
+    fsimage_cache_close(image);
+
     /* flush the image when closed; added by Roberto Muscedere on 20210125 */
     if (image->type == DISK_IMAGE_TYPE_P64) {
         fsimage_write_p64_image(image);
@@ -292,6 +297,7 @@ int fsimage_write_sector(disk_image_t *image, const uint8_t *buf,
 void fsimage_init(void)
 {
     fsimage_log = log_open("Filesystem Image");
+    fsimage_cache_init();
     fsimage_dxx_init();
     fsimage_gcr_init();
     fsimage_p64_init();
@@ -37,6 +37,8 @@ struct disk_addr_s;
 typedef struct fsimage_s {
     FILE *fd;
     char *name;
+    /* mmap or in-memory copy of the image, NULL for stdio access */
+    struct fsimage_cache_s *cache;
     struct {
         uint8_t *map;
         int dirty;
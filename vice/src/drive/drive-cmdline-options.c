@@ -55,6 +55,18 @@ static const cmdline_option_t cmdline_options[] =
     { "-drivesoundvolume", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "DriveSoundEmulationVolume", NULL,
       "<Volume>", "Set volume for disk drive sound emulation (0-4000)" },
+    { "-drivethreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveThreads", (void *)1,
+      NULL, "Run 1541 drive units on worker threads" },
+    { "+drivethreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveThreads", (void *)0,
+      NULL, "Run all drive units on the emulation thread" },
+    { "-drivefastrotation", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveFastRotation", (void *)1,
+      NULL, "Skip over long idle periods of the disk rotation (G64/P64 images)" },
+    { "+drivefastrotation", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveFastRotation", (void *)0,
+      NULL, "Simulate the disk rotation bit by bit at all times" },
     CMDLINE_LIST_END
 };
 
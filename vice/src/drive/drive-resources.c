@@ -62,6 +62,26 @@ int drive_sound_emulation;
 /* volume of the drive sound */
 int drive_sound_emulation_volume;
 
+/* Run the drive units on worker threads when possible?  */
+int drive_threads_enabled;
+
+static int set_drive_threads(int val, void *param)
+{
+    drive_threads_enabled = val ? 1 : 0;
+
+    return 0;
+}
+
+/* Skip over long idle periods of the disk rotation?  */
+int drive_fast_rotation;
+
+static int set_drive_fast_rotation(int val, void *param)
+{
+    drive_fast_rotation = val ? 1 : 0;
+
+    return 0;
+}
+
 static int set_drive_true_emulation(int val, void *param)
 {
     unsigned int dnr;
@@ -384,6 +404,10 @@ static const resource_int_t resources_int[] = {
       &drive_sound_emulation, set_drive_sound_emulation, NULL },
     { "DriveSoundEmulationVolume", 1000, RES_EVENT_NO, (resource_value_t)1000,
       &drive_sound_emulation_volume, set_drive_sound_emulation_volume, NULL },
+    { "DriveThreads", 0, RES_EVENT_SAME, (resource_value_t)0,
+      &drive_threads_enabled, set_drive_threads, NULL },
+    { "DriveFastRotation", 0, RES_EVENT_SAME, (resource_value_t)0,
+      &drive_fast_rotation, set_drive_fast_rotation, NULL },
     RESOURCE_INT_LIST_END
 };
 
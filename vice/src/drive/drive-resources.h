@@ -29,6 +29,8 @@
 
 extern int drive_sound_emulation;
 extern int drive_sound_emulation_volume;
+extern int drive_threads_enabled;
+extern int drive_fast_rotation;
 
 int drive_resources_init(void);
 void drive_resources_shutdown(void);
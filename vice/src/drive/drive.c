@@ -46,11 +46,20 @@
 #include <math.h>
 #include <assert.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#endif
+
 #include "attach.h"
 #include "archdep.h"
 #include "diskconstants.h"
 #include "diskimage.h"
+#include "diskimage/fsimage-cache.h"
 #include "drive-check.h"
+#include "drive-resources.h"
 #include "drive.h"
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
@@ -59,6 +68,7 @@
 #include "driverom.h"
 #include "drivetypes.h"
 #include "gcr.h"
+#include "interrupt.h"
 #include "iecbus.h"
 #include "iecdrive.h"
 #include "lib.h"
@@ -995,10 +1005,268 @@ void drive_cpu_execute_one(diskunit_context_t *drv, CLOCK clk_value)
     }
 }
 
+/* Minimum number of cycles the units must be behind before they are run on
+   worker threads.  Short catch-ups happen on every host access to the bus and
+   are cheaper to run in order than to hand out to the threads.  */
+#define DRIVE_THREADS_MIN_CYCLES    2000
+
+/* Number of checks a unit spins for the others to catch up before it goes to
+   sleep.  The units are usually only a few cycles apart.  */
+#define DRIVE_THREADS_SPIN          1000
+
+#if defined(_OPENMP) && defined(HAVE_PTHREAD_H)
+
+/* The units running on worker threads.  Each publishes how far it has got, in
+   main CPU cycles, whenever it accesses the IEC bus, and ~0 once it is done.  */
+static diskunit_context_t *drive_threads_unit[NUM_DISK_UNITS];
+static CLOCK drive_threads_pos[NUM_DISK_UNITS];
+static CLOCK drive_threads_start_clk[NUM_DISK_UNITS];
+static CLOCK drive_threads_start_drive_clk[NUM_DISK_UNITS];
+static int drive_threads_num;
+
+/* Units which gave up spinning wait on the condition, every change of
+   drive_threads_pos[] is made under the lock.  */
+static pthread_mutex_t drive_threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drive_threads_cond = PTHREAD_COND_INITIALIZER;
+static int drive_threads_sleeping = 0;
+
+/* Check whether a unit can be run on a worker thread.  Only the plain 1541
+   family qualifies: the other drives reach into host chips (fast serial,
+   parallel cables) or share state between units.  Units being debugged in
+   the monitor, with drive sound enabled, jammed, or with a reset or trap
+   pending (which log and update the UI) always run on the main thread.  */
+static int drive_cpu_can_run_threaded(diskunit_context_t *unit)
+{
+    switch (unit->type) {
+        case DRIVE_TYPE_1540:
+        case DRIVE_TYPE_1541:
+        case DRIVE_TYPE_1541II:
+            break;
+        default:
+            return 0;
+    }
+
+    return unit->parallel_cable == DRIVE_PC_NONE
+           && iecbus_drive_port() != NULL
+           && !drive_sound_emulation
+           && !unit->cpu->is_jammed
+           && !(unit->cpu->int_status->global_pending_int
+                & (IK_RESET | IK_TRAP | IK_MONITOR | IK_DMA))
+           && monitor_mask[monitor_diskspace_mem(unit->mynumber)] == MI_NONE;
+}
+
+/* Position of a threaded unit in main CPU cycles.  */
+static CLOCK drive_threads_unit_pos(int i)
+{
+    diskunit_context_t *unit = drive_threads_unit[i];
+    CLOCK cycles = *(unit->clk_ptr) - drive_threads_start_drive_clk[i];
+
+    return drive_threads_start_clk[i] + (cycles << 16) / unit->cpud->sync_factor;
+}
+
+/* Publish the position of unit `i' and wake up the units waiting for it.  */
+static void drive_threads_publish(int i, CLOCK pos)
+{
+    pthread_mutex_lock(&drive_threads_lock);
+#pragma omp atomic write
+    drive_threads_pos[i] = pos;
+    if (drive_threads_sleeping > 0) {
+        pthread_cond_broadcast(&drive_threads_cond);
+    }
+    pthread_mutex_unlock(&drive_threads_lock);
+}
+
+/* Check whether another unit may still access the bus before unit `self'
+   at `pos'.  */
+static int drive_threads_must_wait(int self, CLOCK pos)
+{
+    int i;
+
+    for (i = 0; i < drive_threads_num; i++) {
+        CLOCK other;
+
+        if (i == self) {
+            continue;
+        }
+#pragma omp atomic read
+        other = drive_threads_pos[i];
+        if (other < pos || (other == pos && i < self)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Called by a unit before it reads or writes the IEC bus.  Units on worker
+   threads wait until all other threaded units have got at least as far (ties
+   go to the lower unit number).  This way the bus accesses happen one at a
+   time and in cycle order, as if the units were run in lockstep.  */
+void drive_cpu_sync_bus(diskunit_context_t *unit)
+{
+    int self = unit->cpu->threaded - 1;
+    CLOCK pos;
+    int spin;
+
+    if (self < 0) {
+        return;
+    }
+
+    pos = drive_threads_unit_pos(self);
+
+    /* the lock makes our last bus access visible before moving on */
+    drive_threads_publish(self, pos);
+
+    for (spin = 0; drive_threads_must_wait(self, pos); spin++) {
+        if (spin >= DRIVE_THREADS_SPIN) {
+            pthread_mutex_lock(&drive_threads_lock);
+            drive_threads_sleeping++;
+            while (drive_threads_must_wait(self, pos)) {
+                pthread_cond_wait(&drive_threads_cond, &drive_threads_lock);
+            }
+            drive_threads_sleeping--;
+            pthread_mutex_unlock(&drive_threads_lock);
+            break;
+        }
+    }
+#pragma omp flush
+}
+
+static void drive_cpu_execute_thread(int i, CLOCK clk_value, int vsync)
+{
+    diskunit_context_t *unit = drive_threads_unit[i];
+
+    drive_cpu_execute_one(unit, clk_value);
+    if (vsync && unit->idling_method == DRIVE_IDLE_NO_IDLE) {
+        rotation_rotate_disk(unit->drives[0]);
+    }
+
+    drive_threads_publish(i, ~(CLOCK)0);
+}
+
+/* Run several units up to `clk_value', one worker thread per unit.
+
+   The units only see each other through the shared IEC lines, and
+   drive_cpu_sync_bus() orders their bus accesses by cycle.  This is more
+   exact than the serial order, where a unit sees the final line state of
+   the units run before it, so the result can differ from a run without
+   threads.  It is repeatable though: the order only depends on the units'
+   clocks and numbers, never on the thread timing.  */
+static void drive_cpu_execute_threaded(diskunit_context_t **units, int num,
+                                       CLOCK clk_value, int vsync)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        diskunit_context_t *unit = units[i];
+
+        /* this may log, do it before the threads start */
+        drivecpu_wake_up(unit);
+
+        drive_threads_unit[i] = unit;
+        drive_threads_pos[i] = unit->cpu->last_clk;
+        drive_threads_start_clk[i] = unit->cpu->last_clk;
+        drive_threads_start_drive_clk[i] = *(unit->clk_ptr);
+        unit->cpu->threaded = i + 1;
+        /* the CPU history is shared, each unit keeps its own meanwhile */
+        monitor_cpuhistory_begin_deferred(monitor_diskspace_mem(unit->mynumber));
+    }
+    drive_threads_num = num;
+
+#pragma omp parallel num_threads(num)
+    {
+        if (omp_get_num_threads() == num) {
+            drive_cpu_execute_thread(omp_get_thread_num(), clk_value, vsync);
+        } else {
+#pragma omp master
+            {
+                /* fewer threads than units, waiting for each other would
+                   never end, run them in order instead */
+                for (i = 0; i < num; i++) {
+                    units[i]->cpu->threaded = 0;
+                }
+                for (i = 0; i < num; i++) {
+                    drive_cpu_execute_thread(i, clk_value, vsync);
+                }
+            }
+        }
+    }
+
+    drive_threads_num = 0;
+    for (i = 0; i < num; i++) {
+        units[i]->cpu->threaded = 0;
+        /* in unit order, as if the units had run one after the other */
+        monitor_cpuhistory_end_deferred(monitor_diskspace_mem(units[i]->mynumber));
+        /* JAMs hit on the worker threads are reported here */
+        drivecpu_handle_pending_jam(units[i]);
+    }
+}
+
+/* Collect the units which need to catch up a worthwhile number of cycles
+   and can run on a worker thread.  Returns the number of units found, if
+   less than two the units should simply be run in order.  */
+static int drive_cpu_collect_threaded(diskunit_context_t **units, CLOCK clk_value,
+                                      int vsync)
+{
+    unsigned int dnr;
+    int num = 0;
+
+    if (!drive_threads_enabled) {
+        return 0;
+    }
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (!unit->enable) {
+            continue;
+        }
+        if (!drive_cpu_can_run_threaded(unit)) {
+            return 0;
+        }
+        if (vsync && unit->idling_method == DRIVE_IDLE_SKIP_CYCLES) {
+            continue;
+        }
+        if (clk_value > unit->cpu->last_clk
+            && clk_value - unit->cpu->last_clk >= DRIVE_THREADS_MIN_CYCLES) {
+            units[num++] = unit;
+        }
+    }
+
+    return num;
+}
+
+#else
+
+void drive_cpu_sync_bus(diskunit_context_t *unit)
+{
+}
+
+static void drive_cpu_execute_threaded(diskunit_context_t **units, int num,
+                                       CLOCK clk_value, int vsync)
+{
+}
+
+/* without OpenMP and POSIX threads the units are always run in order */
+static int drive_cpu_collect_threaded(diskunit_context_t **units, CLOCK clk_value,
+                                      int vsync)
+{
+    return 0;
+}
+
+#endif
+
 void drive_cpu_execute_all(CLOCK clk_value)
 {
     unsigned int dnr;
+    diskunit_context_t *units[NUM_DISK_UNITS];
+    int num;
 
+    num = drive_cpu_collect_threaded(units, clk_value, 0);
+    if (num > 1) {
+        drive_cpu_execute_threaded(units, num, clk_value, 0);
+    }
+
+    /* units already run on a worker thread have nothing left to do here */
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
 
@@ -1022,12 +1290,29 @@ void drive_cpu_set_overflow(diskunit_context_t *drv)
 void drive_vsync_hook(void)
 {
     unsigned int dnr;
+    diskunit_context_t *units[NUM_DISK_UNITS];
+    int num;
 
     drive_update_ui_status();
 
+    num = drive_cpu_collect_threaded(units, maincpu_clk, 1);
+    if (num > 1) {
+        drive_cpu_execute_threaded(units, num, maincpu_clk, 1);
+    } else {
+        num = 0;
+    }
+
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
         drive_t *drive = unit->drives[0];
+        int i;
+
+        /* skip units already handled by the worker threads */
+        for (i = 0; i < num && units[i] != unit; i++) {
+        }
+        if (i < num) {
+            continue;
+        }
 
         if (unit->enable) {
             if (unit->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
@@ -1044,6 +1329,9 @@ void drive_vsync_hook(void)
             /* printf("drive_vsync_hook drv %d @clk:%d\n", dnr, maincpu_clk); */
         }
     }
+
+    /* the drives are done for this frame, write back cached images */
+    fsimage_cache_vsync_hook();
 }
 
 /* ------------------------------------------------------------------------- */
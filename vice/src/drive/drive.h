@@ -395,6 +395,7 @@ void drive_reset(void);
 void drive_shutdown(void);
 void drive_cpu_execute_one(struct diskunit_context_s *drv, CLOCK clk_value);
 void drive_cpu_execute_all(CLOCK clk_value);
+void drive_cpu_sync_bus(struct diskunit_context_s *unit);
 void drive_cpu_set_overflow(struct diskunit_context_s *drv);
 void drive_vsync_hook(void);
 int drive_get_disk_drive_type(int dnr);
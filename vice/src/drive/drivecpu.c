@@ -51,6 +51,7 @@
 #include "monitor.h"
 #include "mos6510.h"
 #include "rotation.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "types.h"
 #include "uiapi.h"
@@ -71,6 +72,7 @@ void drivecpu_setup_context(struct diskunit_context_s *drv, int i)
 {
     monitor_interface_t *mi;
     drivecpu_context_t *cpu;
+    char *name;
 
     if (i) {
         drv->cpu = lib_calloc(1, sizeof(drivecpu_context_t));
@@ -123,6 +125,12 @@ void drivecpu_setup_context(struct diskunit_context_s *drv, int i)
 
     if (i) {
         drv->cpu->alarm_context = alarm_context_new(drv->cpu->identification_string);
+        name = lib_msprintf("drive%u", drv->mynumber + 8);
+        drv->cpu->sampleprof = sampleprof_cpu_new(name, drv->cpu->alarm_context,
+                                                  drv->cpu->int_status,
+                                                  drv->clk_ptr,
+                                                  &drv->clock_frequency, NULL);
+        lib_free(name);
     }
 }
 
@@ -228,6 +236,9 @@ void drivecpu_shutdown(diskunit_context_t *drv)
 
     cpu = drv->cpu;
 
+    sampleprof_cpu_destroy(cpu->sampleprof);
+    cpu->sampleprof = NULL;
+
     if (cpu->alarm_context != NULL) {
         alarm_context_destroy(cpu->alarm_context);
     }
@@ -408,6 +419,8 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 
 #define ALARM_CONTEXT (cpu->alarm_context)
 
+#define SAMPLEPROF (cpu->sampleprof)
+
 #define JAM() drivecpu_jam(drv)
 
 #define ROM_TRAP_ALLOWED() 1
@@ -467,6 +480,14 @@ static void drivecpu_jam(diskunit_context_t *drv)
 
     cpu = drv->cpu;
 
+    /* the JAM dialog and actions must not run on a worker thread, keep the
+       CPU jammed until drivecpu_handle_pending_jam() is called */
+    if (cpu->threaded) {
+        cpu->jam_pending = 1;
+        CLK++;
+        return;
+    }
+
     switch (drv->type) {
         case DRIVE_TYPE_1540:
             dname = "  1540";
@@ -538,6 +559,15 @@ static void drivecpu_jam(diskunit_context_t *drv)
     }
 }
 
+/* Report a JAM hit while the unit ran on a worker thread.  */
+void drivecpu_handle_pending_jam(diskunit_context_t *drv)
+{
+    if (drv->cpu->jam_pending) {
+        drv->cpu->jam_pending = 0;
+        drivecpu_jam(drv);
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 
 #define SNAP_MAJOR 1
@@ -48,6 +48,7 @@ void drivecpu_init(struct diskunit_context_s *drv, int type);
 void drivecpu_reset(struct diskunit_context_s *drv);
 void drivecpu_sleep(struct diskunit_context_s *drv);
 void drivecpu_wake_up(struct diskunit_context_s *drv);
+void drivecpu_handle_pending_jam(struct diskunit_context_s *drv);
 void drivecpu_shutdown(struct diskunit_context_s *drv);
 void drivecpu_reset_clk(struct diskunit_context_s *drv);
 void drivecpu_trigger_reset(unsigned int dnr);
@@ -45,6 +45,7 @@
 #include "monitor.h"
 #include "r65c02.h"
 #include "rotation.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "types.h"
 #include "uiapi.h"
@@ -60,6 +61,7 @@ void drivecpu65c02_setup_context(struct diskunit_context_s *drv, int i)
 {
     monitor_interface_t *mi;
     drivecpu_context_t *cpu;
+    char *name;
 
     if (i) {
         drv->cpu = lib_calloc(1, sizeof(drivecpu_context_t));
@@ -112,6 +114,12 @@ void drivecpu65c02_setup_context(struct diskunit_context_s *drv, int i)
 
     if (i) {
         drv->cpu->alarm_context = alarm_context_new(drv->cpu->identification_string);
+        name = lib_msprintf("drive%u", drv->mynumber + 8);
+        drv->cpu->sampleprof = sampleprof_cpu_new(name, drv->cpu->alarm_context,
+                                                  drv->cpu->int_status,
+                                                  drv->clk_ptr,
+                                                  &drv->clock_frequency, NULL);
+        lib_free(name);
     }
 }
 
@@ -202,6 +210,9 @@ void drivecpu65c02_shutdown(diskunit_context_t *drv)
 
     cpu = drv->cpu;
 
+    sampleprof_cpu_destroy(cpu->sampleprof);
+    cpu->sampleprof = NULL;
+
     if (cpu->alarm_context != NULL) {
         alarm_context_destroy(cpu->alarm_context);
     }
@@ -386,6 +397,8 @@ void drivecpu65c02_execute(diskunit_context_t *drv, CLOCK clk_value)
 
 #define ALARM_CONTEXT (cpu->alarm_context)
 
+#define SAMPLEPROF (cpu->sampleprof)
+
 #define ROM_TRAP_ALLOWED() 1
 
 #define ROM_TRAP_HANDLER() drive_trap_handler(drv)
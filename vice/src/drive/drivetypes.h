@@ -73,6 +73,8 @@ typedef struct drivecpu_context_s {
 
     struct monitor_interface_s *monitor_interface;
 
+    struct sampleprof_cpu_s *sampleprof;
+
     /* Value of clk for the last time mydrive_cpu_execute() was called.  */
     CLOCK last_clk;
 
@@ -96,6 +98,12 @@ typedef struct drivecpu_context_s {
     /* jam flag */
     int is_jammed;
 
+    /* set to the worker slot + 1 while the unit runs on a worker thread */
+    int threaded;
+
+    /* JAM hit on a worker thread, reported once the threads have joined */
+    int jam_pending;
+
     /* Public copy of the registers.  */
     mos6510_regs_t cpu_regs;
     R65C02_regs_t cpu_R65C02_regs;
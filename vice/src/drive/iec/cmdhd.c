@@ -49,6 +49,7 @@
 #include "types.h"
 #include "cmdhd.h"
 #include "util.h"
+#include "diskimage/fsimage-cache.h"
 #include "diskimage/fsimage.h"
 #include "rtc/rtc-72421.h"
 #include "resources.h"
@@ -285,6 +286,11 @@ static void cmdhd_scsiwrite(struct scsi_context_s *scsi)
 
     /* update track info on status bar */
     dc->current_half_track = (scsi->address * 200) / (hd->imagesize + 1);
+
+    /* the SCSI code writes to the file directly, let vdrive know */
+    if (hd->image) {
+        hd->image->generation++;
+    }
 }
 
 /* We don't actually format the disk, we just remove the 16 byte CMD signature */
@@ -1365,7 +1371,8 @@ int cmdhd_attach_image(disk_image_t *image, unsigned int unit)
         return -1;
     }
 
-    /* copy file FD to the scsi module */
+    /* copy file FD to the scsi module, which does its own stdio on it */
+    fsimage_cache_close(image);
     hd->scsi->file[0] = image->media.fsimage->fd;
 
     /* find the base lba */
@@ -219,6 +219,8 @@ static void store_prb(via_context_t *via_context, uint8_t byte, uint8_t p_oldpb,
     if (byte != p_oldpb) {
         DEBUG_IEC_DRV_WRITE(byte);
 
+        drive_cpu_sync_bus(via1p->diskunit);
+
         if (iecbus != NULL) {
             uint8_t *drive_data, *drive_bus;
             unsigned int unit;
@@ -332,6 +334,8 @@ static uint8_t read_prb(via_context_t *via_context)
     /* 0 for drive0, 0x20 for drive 1 */
     orval = (via1p->number << 5);
 
+    drive_cpu_sync_bus(via1p->diskunit);
+
     if (iecbus != NULL) {
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iecbus->drv_port) ^ 0x85) | orval;
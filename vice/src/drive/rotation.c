@@ -31,6 +31,7 @@
 #include "vice.h"
 
 #include "drive.h"
+#include "drive-resources.h"
 #include "drivetypes.h"
 #include "lib.h"
 #include "rotation.h"
@@ -44,6 +45,10 @@
 
 #define ROTATION_TABLE_SIZE 0x1000
 
+/* With DriveFastRotation, the last part of a catch-up that is simulated
+   bit by bit (in reference cycles, >100 bitcells in every speed zone) */
+#define ROTATION_FAST_TAIL_CYCLES 8192
+
 
 struct rotation_s {
     uint32_t accum;
@@ -332,6 +337,42 @@ static void rotation_do_wobble(drive_t *dptr)
 #endif
 }
 
+/*******************************************************************************
+ * Fast path for long catch-ups in read mode (DriveFastRotation)
+ *
+ * When the drive CPU did not look at the disk for a long time (for example
+ * because it slept in its idle loop with the motor still running), nothing
+ * that happened under the head before the last few bytes can be seen anymore.
+ * Only the end of the interval is simulated cycle exact then; the head is
+ * moved over the rest of it in one step.  The read shifter and the flux
+ * filter resynchronize within the simulated tail.
+ ******************************************************************************/
+
+/* Return the number of reference cycles that can be skipped */
+static CLOCK rotation_fast_skip_cycles(drive_t *dptr, CLOCK ref_cycles)
+{
+    rotation_t *rptr = &rotation[dptr->diskunit->mynumber];
+
+    if (!drive_fast_rotation
+        || dptr->read_write_mode == 0
+        || rptr->so_delay != 0
+        || ref_cycles <= ROTATION_FAST_TAIL_CYCLES * 2) {
+        return 0;
+    }
+    return ref_cycles - ROTATION_FAST_TAIL_CYCLES;
+}
+
+/* Update the decoder state after skipping `skip' reference cycles */
+static void rotation_fast_skip_decoder(rotation_t *rptr, CLOCK skip)
+{
+    /* no pending flux reversal, filter settled */
+    rptr->filter_counter = 40;
+    rptr->filter_last_state = rptr->filter_state;
+
+    /* keeps the BYTE READY phase relative to the cpu clock */
+    rptr->cycle_index += (uint32_t)skip;
+}
+
 /*******************************************************************************
  * 1541 circuit simulation for GCR-based images (.g64),
  * see 1541 circuit description in this file for details
@@ -377,6 +418,22 @@ static void rotation_1541_gcr(drive_t *dptr, CLOCK ref_cycles)
     cyc_sum_frv = cyc_sum_frv ? cyc_sum_frv : 1;
 
     if (dptr->read_write_mode) {
+        CLOCK skip = rotation_fast_skip_cycles(dptr, ref_cycles);
+
+        if (skip > 0) {
+            /* move the head over all bitcells passed while skipping */
+            uint64_t sum = rptr->accum + (uint64_t)cyc_sum_frv * skip;
+            uint32_t track_bits = dptr->GCR_current_track_size << 3;
+
+            if (dptr->GCR_image_loaded && track_bits > 0) {
+                dptr->GCR_head_offset = (unsigned int)((dptr->GCR_head_offset + sum / count_new_bitcell) % track_bits);
+            }
+            rptr->accum = (uint32_t)(sum % count_new_bitcell);
+
+            rotation_fast_skip_decoder(rptr, skip);
+            ref_cycles -= skip;
+        }
+
         /* emulate the number of reference clocks requested */
         while (ref_cycles > 0) {
             /* calculate how much cycles can we do in one single pass */
@@ -637,11 +694,20 @@ static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
     rotation_t *rptr;
     PP64PulseStream P64PulseStream;
     CLOCK DeltaPositionToNextPulse, ToDo;
+    CLOCK skip;
 
     rptr = &rotation[dptr->diskunit->mynumber];
 
     P64PulseStream = &dptr->p64->PulseStreams[dptr->side][dptr->current_half_track];
 
+    skip = rotation_fast_skip_cycles(dptr, ref_cycles);
+    if (skip > 0) {
+        /* the pulse index is looked up again below */
+        rptr->PulseHeadPosition = (uint32_t)((rptr->PulseHeadPosition + skip) % P64PulseSamplesPerRotation);
+        rotation_fast_skip_decoder(rptr, skip);
+        ref_cycles -= skip;
+    }
+
     /* Reset if out of head position bounds */
     if ((P64PulseStream->UsedLast >= 0) &&
         (P64PulseStream->Pulses[P64PulseStream->UsedLast].Position <= rptr->PulseHeadPosition)) {
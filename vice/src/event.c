@@ -51,6 +51,7 @@
 #include "maincpu.h"
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
 #include "snapshot.h"
 #include "tape.h"
 #include "tapeport.h"
@@ -381,6 +382,7 @@ void event_record(unsigned int type, void *data, unsigned int size)
     if (record_active == 1) {
         event_record_in_list(event_list, type, data, size);
     }
+    rewind_event_record(type, data, size);
 }
 
 
@@ -69,6 +69,7 @@
 #include "log.h"
 #include "machine.h"
 #include "palette.h"
+#include "recordqueue.h"
 #include "resources.h"
 #include "screenshot.h"
 #include "soundmovie.h"
@@ -227,8 +228,10 @@ static int file_init_done;
 static int current_video_port = SOCKETS_RANGE_FIRST;
 static int current_audio_port = SOCKETS_RANGE_FIRST + 1;
 
-/* input video stream */
-#define INPUT_VIDEO_BPP     3
+/* input video stream: 8 bit palette indices, followed by the palette as
+   256 native endian ARGB words (ffmpeg "pal8") */
+#define INPUT_VIDEO_PALETTE_SIZE    (256 * 4)
+#define INPUT_VIDEO_FRAME_SIZE      (video_width * video_height + INPUT_VIDEO_PALETTE_SIZE)
 
 static double time_base;
 static double fps;                  /* frames per second */
@@ -238,7 +241,10 @@ typedef struct {
     uint8_t *data;
     int linesize;
 } VIDEOFrame;
-static VIDEOFrame *video_st_frame;
+static VIDEOFrame *video_st_frame;   /* owned by the encoder thread once recording */
+
+/* frames and audio go through this to the encoder thread */
+static recordqueue_t *record_queue = NULL;
 
 /* input audio stream */
 #define AUDIO_BUFFER_SAMPLES        0x400
@@ -278,6 +284,7 @@ log_t ffmpeg_log = LOG_DEFAULT;
 
 static int ffmpegexedrv_init_file(void);
 static void ffmpegexedrv_shutdown(void);
+static int ffmpegexedrv_encode(recordqueue_item_t *item, void *param);
 
 /******************************************************************************/
 /* resources */
@@ -449,21 +456,30 @@ static void prepare_port_numbers(void)
     log_message(ffmpeg_log, "prepare_port_numbers %d:%d", current_video_port, current_audio_port);
 }
 
-static ssize_t write_video_frame(VIDEOFrame *pic)
+/* sends all of `len' bytes, the socket may take less in one go */
+static ssize_t send_all(vice_network_socket_t *socket, const uint8_t *data, ssize_t len)
 {
-    ssize_t len = INPUT_VIDEO_BPP * video_height * video_width;
     ssize_t res;
 
+    while (len > 0) {
+        res = vice_network_send(socket, data, len, 0 /* flags */);
+        if (res <= 0) {
+            return -1;
+        }
+        data += res;
+        len -= res;
+    }
+    return 0;
+}
+
+static ssize_t write_video_frame(VIDEOFrame *pic)
+{
     if ((video_has_codec > 0) && (video_codec != AV_CODEC_ID_NONE)) {
         if (ffmpeg_video_socket == 0) {
             log_error(ffmpeg_log, "FFMPEG: write_video_frame ffmpeg_video_socket is 0 (framecount:%"PRIu64")", framecounter);
             return -1;
         }
-        res = vice_network_send(ffmpeg_video_socket, pic->data, len, 0 /* flags */);
-        if (res < 0) {
-            return -1;
-        }
-        return len - res;
+        return send_all(ffmpeg_video_socket, pic->data, INPUT_VIDEO_FRAME_SIZE);
     }
     return 0;
 }
@@ -472,10 +488,13 @@ static int write_initial_video_frames(void)
 {
     int len;
     int frm;
-    /* clear frame */
-    len = INPUT_VIDEO_BPP * video_height * video_width;
+    /* clear frame, black palette */
+    len = INPUT_VIDEO_FRAME_SIZE;
     DBG(("video len:%d (%d)", len, len * DUMMY_FRAMES_VIDEO));
     memset(video_st_frame->data, 0, len);
+    for (frm = 0; frm < 256; frm++) {
+        ((uint32_t *)(video_st_frame->data + video_width * video_height))[frm] = 0xff000000;
+    }
     for (frm = 0; frm < DUMMY_FRAMES_VIDEO; frm++) {
         if (write_video_frame(video_st_frame) < 0) {
             return -1;
@@ -678,7 +697,7 @@ static int start_ffmpeg_executable(void)
     if ((video_has_codec > 0) && (video_codec != AV_CODEC_ID_NONE)) {
         sprintf(tempcommand,
                 "-f rawvideo "
-                "-pixel_format rgb24 "
+                "-pixel_format pal8 "
                 "-framerate %s "              /* exact fps */
                 "-r %s "              /* exact fps */
                 "-s %dx%d "                         /* size */
@@ -1014,7 +1033,15 @@ static int ffmpegexe_soundmovie_init(int speed, int channels, soundmovie_buffer_
     }
 #endif
 
-    return start_ffmpeg_executable();
+    if (start_ffmpeg_executable() < 0) {
+        return -1;
+    }
+
+    /* from here on the sockets are written by the encoder thread only */
+    recordqueue_close(record_queue);
+    record_queue = recordqueue_new("ffmpegexedrv", video_width, video_height,
+                                   ffmpegexedrv_encode, NULL);
+    return 0;
 }
 
 /* Soundmovie API soundmovie_funcs_t.encode */
@@ -1040,16 +1067,19 @@ static int ffmpegexe_soundmovie_encode(soundmovie_buffer_t *audio_in)
     }
 
     if ((audio_has_codec > 0) && (audio_codec != AV_CODEC_ID_NONE)) {
-        /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
+        if (record_queue == NULL) {
+            return -1;
+        }
+        /* the samples are sent by the encoder thread */
         if (audio_input_channels == 1) {
-            res = vice_network_send(ffmpeg_audio_socket, &audio_in->buffer[0], audio_in->used * 2, 0 /* flags */);
-            if (res != audio_in->used * 2) {
+            res = recordqueue_push_audio(record_queue, &audio_in->buffer[0], audio_in->used);
+            if (res < 0) {
                 return -1;
             }
             audio_input_counter += audio_in->used;
         } else if (audio_input_channels == 2) {
-            res = vice_network_send(ffmpeg_audio_socket, &audio_in->buffer[0], audio_in->used * 2, 0 /* flags */);
-            if (res != audio_in->used * 2) {
+            res = recordqueue_push_audio(record_queue, &audio_in->buffer[0], audio_in->used);
+            if (res < 0) {
                 return -1;
             }
             audio_input_counter += audio_in->used / 2;
@@ -1081,33 +1111,44 @@ static soundmovie_funcs_t ffmpegexedrv_soundmovie_funcs = {
    video stream encoding
  *****************************************************************************/
 
-static int video_fill_rgb_image(screenshot_t *screenshot, VIDEOFrame *pic)
+/* called on the encoder thread */
+static void video_fill_pal8_image(recordqueue_item_t *item, VIDEOFrame *pic)
 {
-    int x, y;
-    int dx, dy;
-    int colnum;
-    int bufferoffset;
-    int x_dim = screenshot->width;
-    int y_dim = screenshot->height;
-    int pix = 0;
-    /* center the screenshot in the video */
-    pic->linesize = video_width * INPUT_VIDEO_BPP;
-    dx = (video_width - x_dim) / 2;
-    dy = (video_height - y_dim) / 2;
-    bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
-        + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
-
-    for (y = 0; y < video_height; y++) {
-        for (x = 0; x < video_width; x++) {
-            colnum = screenshot->draw_buffer[bufferoffset + x];
-            pic->data[pix + INPUT_VIDEO_BPP * x] = screenshot->palette->entries[colnum].red;
-            pic->data[pix + INPUT_VIDEO_BPP * x + 1] = screenshot->palette->entries[colnum].green;
-            pic->data[pix + INPUT_VIDEO_BPP * x + 2] = screenshot->palette->entries[colnum].blue;
+    uint32_t *palette = (uint32_t *)(pic->data + video_width * video_height);
+    int i;
+
+    pic->linesize = video_width;
+    memcpy(pic->data, item->pixels, (size_t)(video_width * video_height));
+    for (i = 0; i < RECORDQUEUE_PALETTE_COLORS; i++) {
+        palette[i] = 0xff000000
+                     | ((uint32_t)item->palette[i * 3 + 0] << 16)
+                     | ((uint32_t)item->palette[i * 3 + 1] << 8)
+                     | (uint32_t)item->palette[i * 3 + 2];
+    }
+}
+
+/* Recordqueue encoder, called on the encoder thread for every queued frame
+   and audio buffer */
+static int ffmpegexedrv_encode(recordqueue_item_t *item, void *param)
+{
+    int i;
+
+    if (item->type == RECORDQUEUE_ITEM_AUDIO) {
+        /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
+        if (send_all(ffmpeg_audio_socket, (const uint8_t *)item->samples,
+                     (ssize_t)(item->num_samples * sizeof(int16_t))) < 0) {
+            log_error(ffmpeg_log, "ffmpegexedrv: Error writing to AUDIO socket");
+            return -1;
         }
-        bufferoffset += screenshot->draw_buffer_line_size;
-        pix += pic->linesize;
+        return 0;
     }
 
+    video_fill_pal8_image(item, video_st_frame);
+    for (i = 0; i < item->repeat; i++) {
+        if (write_video_frame(video_st_frame) < 0) {
+            return -1;
+        }
+    }
     return 0;
 }
 
@@ -1120,7 +1161,7 @@ static VIDEOFrame* video_alloc_picture(int bpp, int width, int height)
     if (!picture) {
         return NULL;
     }
-    picture->data = lib_malloc(bpp * width * height);
+    picture->data = lib_malloc(bpp * width * height + INPUT_VIDEO_PALETTE_SIZE);
     if (!picture->data) {
         lib_free(picture);
         log_debug(ffmpeg_log, "ffmpegexedrv: Could not allocate frame data");
@@ -1145,7 +1186,7 @@ static int ffmpegexedrv_open_video(void)
     video_is_open = 1;
 
     /* allocate the encoded raw picture */
-    video_st_frame = video_alloc_picture(INPUT_VIDEO_BPP, video_width, video_height);
+    video_st_frame = video_alloc_picture(1, video_width, video_height);
     if (!video_st_frame) {
         log_debug(ffmpeg_log, "ffmpegexedrv: could not allocate picture");
         return -1;
@@ -1174,7 +1215,7 @@ static void ffmpegexedrv_init_video(screenshot_t *screenshot)
     video_init_done = 1;
 
     /* resolution should be a multiple of 16 */
-    /* video_fill_rgb_image only implements cutting so */
+    /* the record queue only implements cutting so */
     /* adding black border was removed */
     video_width = screenshot->width & ~0xf;
     video_height = screenshot->height & ~0xf;
@@ -1292,6 +1333,12 @@ static int ffmpegexedrv_close(screenshot_t *screenshot)
 
     soundmovie_stop();
 
+    /* send what is still queued before the streams close */
+    if (recordqueue_close(record_queue) < 0) {
+        log_error(ffmpeg_log, "ffmpegexedrv: Error while writing to ffmpeg");
+    }
+    record_queue = NULL;
+
     ffmpegexedrv_close_video();
     ffmpegexedrv_close_audio();
 
@@ -1340,10 +1387,11 @@ static int ffmpegexedrv_record(screenshot_t *screenshot)
         return 0;
     }
 
-    /*DBGFRAMES(("ffmpegexedrv_record (%u)", framecounter));*/
-    video_fill_rgb_image(screenshot, video_st_frame);
-
-    if (write_video_frame(video_st_frame) < 0) {
+    if ((video_has_codec <= 0) || (video_codec == AV_CODEC_ID_NONE)) {
+        return 0;
+    }
+    if (record_queue == NULL) {
+        log_error(ffmpeg_log, "FFMPEG: ffmpegexedrv_record ffmpeg is not running yet (framecount:%"PRIu64")", framecounter);
         return -1;
     }
 
@@ -1353,11 +1401,11 @@ static int ffmpegexedrv_record(screenshot_t *screenshot)
         framecounter++;
         DBG(("video is late, inserting a frame (framecount:%lu, audiocount:%lu frametime:%f, audiotime:%f)",
             framecounter, audio_input_counter, frametime, audiotime));
-        if (write_video_frame(video_st_frame) < 0) {
-            return -1;
-        }
+        return recordqueue_push_video(record_queue, screenshot, 2);
     }
-    return 0;
+
+    /*DBGFRAMES(("ffmpegexedrv_record (%u)", framecounter));*/
+    return recordqueue_push_video(record_queue, screenshot, 1);
 }
 
 /* Driver API gfxoutputdrv_t.write */
@@ -40,6 +40,7 @@
 #include "iffdrv.h"
 #include "nativedrv.h"
 #include "pcxdrv.h"
+#include "recordqueue.h"
 #include "ppmdrv.h"
 #include "godotdrv.h"
 
@@ -200,6 +201,10 @@ int gfxoutput_resources_init(void)
 {
     gfxoutputdrv_list_t *current = gfxoutputdrv_list;
 
+    if (recordqueue_resources_init() < 0) {
+        return -1;
+    }
+
     while (current->next != NULL) {
         gfxoutputdrv_t *driver = current->drv;
         if (driver && (driver->resources_init != NULL)) {
@@ -218,6 +223,10 @@ int gfxoutput_cmdline_options_init(void)
 {
     gfxoutputdrv_list_t *current = gfxoutputdrv_list;
 
+    if (recordqueue_cmdline_options_init() < 0) {
+        return -1;
+    }
+
     while (current->next != NULL) {
         gfxoutputdrv_t *driver = current->drv;
         if (driver && (driver->cmdline_options_init != NULL)) {
@@ -0,0 +1,468 @@
+/*
+ * recordqueue.c - Frame queue and encoder thread for the video recorders.
+ *
+ * The recorders hand every frame and every audio buffer to a queue and
+ * return to the emulation right away. A worker thread takes the items from
+ * the queue in order and passes them to the encoder of the recorder, which
+ * does the color conversion, compression and output there.
+ *
+ * Video frames are queued as palette indices plus the palette, which is all
+ * the emulation side has to copy. When the encoder falls behind and the
+ * queue is full, the emulation waits for a free slot by default, so no
+ * frame is lost. With "RecordDropFrames" enabled the video frame is dropped
+ * instead and the next queued frame is repeated in its place, so the video
+ * keeps its length. Frames dropped after the last queued one are written as
+ * repeats of that frame when the queue is closed. Audio is never dropped.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "palette.h"
+#include "recordqueue.h"
+#include "resources.h"
+#include "screenshot.h"
+#include "types.h"
+
+#define RECORDQUEUE_SIZE_MIN    2
+#define RECORDQUEUE_SIZE_MAX    256
+
+struct recordqueue_s {
+    char *name;
+    int width;
+    int height;
+    recordqueue_encode_t *encode;
+    void *param;
+
+    /* ring of `size' items, `count' of them queued starting at `head' */
+    recordqueue_item_t *items;
+    int size;
+    int head;
+    int count;
+    int drop_frames;
+    int error;
+
+    /* video frames the next queued frame has to make up for */
+    int dropped_pending;
+    /* slot of the last queued video frame, -1 if none; audio items leave
+       the pixels and the palette of a slot alone */
+    int last_video;
+
+    /* statistics, logged when the queue is closed */
+    unsigned long frames;
+    unsigned long frames_dropped;
+    unsigned long waits;
+    tick_t wait_ticks;
+    tick_t encode_ticks;
+    int max_count;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;
+    pthread_cond_t item_cond;   /* item queued or quit */
+    pthread_cond_t free_cond;   /* item encoded */
+    pthread_t thread;
+    int thread_running;
+    int quit;
+#endif
+};
+
+static log_t recordqueue_log = LOG_DEFAULT;
+
+/* resources */
+static int record_queue_size = 8;
+static int record_drop_frames = 0;
+
+static int set_record_queue_size(int val, void *param)
+{
+    if (val < RECORDQUEUE_SIZE_MIN || val > RECORDQUEUE_SIZE_MAX) {
+        return -1;
+    }
+    record_queue_size = val;
+    return 0;
+}
+
+static int set_record_drop_frames(int val, void *param)
+{
+    record_drop_frames = val ? 1 : 0;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "RecordQueueSize", 8, RES_EVENT_NO, NULL,
+      &record_queue_size, set_record_queue_size, NULL },
+    { "RecordDropFrames", 0, RES_EVENT_NO, NULL,
+      &record_drop_frames, set_record_drop_frames, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int recordqueue_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-recordqueuesize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RecordQueueSize", NULL,
+      "<frames>", "Set the number of frames the video recorder queues for the encoder (2..256)" },
+    { "-recorddropframes", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "RecordDropFrames", (resource_value_t)1,
+      NULL, "Drop video frames when the encoder falls behind" },
+    { "+recorddropframes", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "RecordDropFrames", (resource_value_t)0,
+      NULL, "Make the emulation wait when the encoder falls behind" },
+    CMDLINE_LIST_END
+};
+
+int recordqueue_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int recordqueue_encode_item(recordqueue_t *queue, recordqueue_item_t *item)
+{
+    tick_t start = tick_now();
+    int result;
+
+    result = queue->encode(item, queue->param);
+    queue->encode_ticks += tick_now_delta(start);
+    return result;
+}
+
+#ifdef HAVE_PTHREAD_H
+
+static void *recordqueue_thread_main(void *data)
+{
+    recordqueue_t *queue = data;
+    recordqueue_item_t *item;
+    int result;
+
+    pthread_mutex_lock(&queue->lock);
+
+    for (;;) {
+        while (queue->count == 0 && !queue->quit) {
+            pthread_cond_wait(&queue->item_cond, &queue->lock);
+        }
+        if (queue->count == 0) {
+            break;
+        }
+        /* the item stays in the queue until it is encoded */
+        item = &queue->items[queue->head];
+        pthread_mutex_unlock(&queue->lock);
+
+        result = queue->error ? -1 : recordqueue_encode_item(queue, item);
+
+        pthread_mutex_lock(&queue->lock);
+        if (result < 0) {
+            queue->error = 1;
+        }
+        queue->head = (queue->head + 1) % queue->size;
+        queue->count--;
+        pthread_cond_signal(&queue->free_cond);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+#endif
+
+/* Returns a free item at the tail of the queue, or NULL if a video frame
+   should be dropped. Called with the lock held. */
+static recordqueue_item_t *recordqueue_get_free(recordqueue_t *queue, int drop)
+{
+#ifdef HAVE_PTHREAD_H
+    tick_t start;
+
+    if (queue->thread_running) {
+        if (queue->count == queue->size) {
+            if (drop) {
+                return NULL;
+            }
+            queue->waits++;
+            start = tick_now();
+            while (queue->count == queue->size) {
+                pthread_cond_wait(&queue->free_cond, &queue->lock);
+            }
+            queue->wait_ticks += tick_now_delta(start);
+        }
+        return &queue->items[(queue->head + queue->count) % queue->size];
+    }
+#endif
+    return &queue->items[0];
+}
+
+/* Queues the item returned by recordqueue_get_free(), or encodes it right
+   away without a thread. Called with the lock held. */
+static int recordqueue_commit(recordqueue_t *queue, recordqueue_item_t *item)
+{
+#ifdef HAVE_PTHREAD_H
+    if (queue->thread_running) {
+        queue->count++;
+        if (queue->count > queue->max_count) {
+            queue->max_count = queue->count;
+        }
+        pthread_cond_signal(&queue->item_cond);
+        return queue->error ? -1 : 0;
+    }
+#endif
+    if (recordqueue_encode_item(queue, item) < 0) {
+        queue->error = 1;
+    }
+    return queue->error ? -1 : 0;
+}
+
+static void recordqueue_lock(recordqueue_t *queue)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&queue->lock);
+#endif
+}
+
+static void recordqueue_unlock(recordqueue_t *queue)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&queue->lock);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+recordqueue_t *recordqueue_new(const char *name, int width, int height,
+                               recordqueue_encode_t *encode, void *param)
+{
+    recordqueue_t *queue;
+    int i;
+
+    if (recordqueue_log == LOG_DEFAULT) {
+        recordqueue_log = log_open("RecordQueue");
+    }
+
+    queue = lib_calloc(1, sizeof(recordqueue_t));
+    queue->name = lib_strdup(name);
+    queue->width = width;
+    queue->height = height;
+    queue->encode = encode;
+    queue->param = param;
+    queue->drop_frames = record_drop_frames;
+    queue->last_video = -1;
+    queue->size = 1;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->item_cond, NULL);
+    pthread_cond_init(&queue->free_cond, NULL);
+    if (pthread_create(&queue->thread, NULL, recordqueue_thread_main, queue) == 0) {
+        queue->thread_running = 1;
+        queue->size = record_queue_size;
+    } else {
+        log_error(recordqueue_log, "%s: cannot start the encoder thread, encoding on the emulation thread.", name);
+    }
+#endif
+
+    queue->items = lib_calloc((size_t)queue->size, sizeof(recordqueue_item_t));
+    for (i = 0; i < queue->size; i++) {
+        queue->items[i].pixels = lib_malloc((size_t)width * (size_t)height);
+    }
+
+    return queue;
+}
+
+int recordqueue_close(recordqueue_t *queue)
+{
+    recordqueue_item_t *item;
+    int result;
+    int i;
+    double per_second = (double)tick_per_second();
+
+    if (queue == NULL) {
+        return 0;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    if (queue->thread_running) {
+        /* the thread encodes the remaining items before it quits */
+        pthread_mutex_lock(&queue->lock);
+        queue->quit = 1;
+        pthread_cond_signal(&queue->item_cond);
+        pthread_mutex_unlock(&queue->lock);
+        pthread_join(queue->thread, NULL);
+    }
+    pthread_cond_destroy(&queue->free_cond);
+    pthread_cond_destroy(&queue->item_cond);
+    pthread_mutex_destroy(&queue->lock);
+#endif
+
+    /* the frames dropped since the last queued one would be missing at the
+       end of the video, repeat that frame for them */
+    if (queue->dropped_pending > 0 && queue->last_video >= 0 && !queue->error) {
+        item = &queue->items[queue->last_video];
+        item->type = RECORDQUEUE_ITEM_VIDEO;
+        item->repeat = queue->dropped_pending;
+        if (recordqueue_encode_item(queue, item) < 0) {
+            queue->error = 1;
+        }
+        queue->dropped_pending = 0;
+    }
+
+    log_message(recordqueue_log,
+                "%s: %lu frames, %lu dropped, emulation waited %lu times (%.1f ms), "
+                "encoder busy %.1f ms (%.1f frames/s), up to %d of %d items queued.",
+                queue->name, queue->frames, queue->frames_dropped, queue->waits,
+                (double)queue->wait_ticks * 1000.0 / per_second,
+                (double)queue->encode_ticks * 1000.0 / per_second,
+                queue->encode_ticks ? (double)queue->frames * per_second / (double)queue->encode_ticks : 0.0,
+                queue->max_count, queue->size);
+
+    result = queue->error ? -1 : 0;
+
+    for (i = 0; i < queue->size; i++) {
+        lib_free(queue->items[i].pixels);
+        lib_free(queue->items[i].samples);
+    }
+    lib_free(queue->items);
+    lib_free(queue->name);
+    lib_free(queue);
+
+    return result;
+}
+
+/* Copies the screenshot into the item, centered and cut to the video size */
+static void recordqueue_fill_video(recordqueue_t *queue, recordqueue_item_t *item,
+                                   screenshot_t *screenshot)
+{
+    int dx, dy;
+    int x0, y0, w;
+    int y;
+    unsigned int i, num_colors;
+    const uint8_t *src;
+    uint8_t *dst;
+
+    item->width = queue->width;
+    item->height = queue->height;
+
+    num_colors = screenshot->palette->num_entries;
+    if (num_colors > RECORDQUEUE_PALETTE_COLORS) {
+        num_colors = RECORDQUEUE_PALETTE_COLORS;
+    }
+    memset(item->palette, 0, sizeof(item->palette));
+    for (i = 0; i < num_colors; i++) {
+        item->palette[i * 3 + 0] = screenshot->palette->entries[i].red;
+        item->palette[i * 3 + 1] = screenshot->palette->entries[i].green;
+        item->palette[i * 3 + 2] = screenshot->palette->entries[i].blue;
+    }
+
+    /* a smaller video cuts the screen, a larger one gets a border */
+    dx = (queue->width - (int)screenshot->width) / 2;
+    dy = (queue->height - (int)screenshot->height) / 2;
+    x0 = dx < 0 ? 0 : dx;
+    y0 = dy < 0 ? 0 : dy;
+    w = dx < 0 ? queue->width : (int)screenshot->width;
+
+    if (dx > 0 || dy > 0) {
+        memset(item->pixels, 0, (size_t)queue->width * (size_t)queue->height);
+    }
+
+    src = screenshot->draw_buffer + screenshot->x_offset + (dx < 0 ? -dx : 0)
+          + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
+    dst = item->pixels + y0 * queue->width + x0;
+    for (y = y0; y < queue->height && y - y0 < (int)screenshot->height; y++) {
+        memcpy(dst, src, (size_t)w);
+        src += screenshot->draw_buffer_line_size;
+        dst += queue->width;
+    }
+}
+
+int recordqueue_push_video(recordqueue_t *queue, screenshot_t *screenshot, int repeat)
+{
+    recordqueue_item_t *item;
+    int result;
+
+    recordqueue_lock(queue);
+
+    queue->frames += repeat;
+
+    item = recordqueue_get_free(queue, queue->drop_frames);
+    if (item == NULL) {
+        /* the previous frame is repeated for the dropped one */
+        queue->frames_dropped += repeat;
+        queue->dropped_pending += repeat;
+        result = queue->error ? -1 : 0;
+        recordqueue_unlock(queue);
+        return result;
+    }
+
+    recordqueue_unlock(queue);
+
+    /* the slot belongs to us until it is committed */
+    item->type = RECORDQUEUE_ITEM_VIDEO;
+    item->repeat = repeat;
+    recordqueue_fill_video(queue, item, screenshot);
+
+    recordqueue_lock(queue);
+    /* a dropped frame shows up as a repeat of this one, which is close
+       enough and keeps the video in sync with the audio */
+    item->repeat += queue->dropped_pending;
+    queue->dropped_pending = 0;
+    queue->last_video = (int)(item - queue->items);
+    result = recordqueue_commit(queue, item);
+    recordqueue_unlock(queue);
+
+    return result;
+}
+
+int recordqueue_push_audio(recordqueue_t *queue, const int16_t *samples, size_t num_samples)
+{
+    recordqueue_item_t *item;
+    int result;
+
+    recordqueue_lock(queue);
+    item = recordqueue_get_free(queue, 0);
+    recordqueue_unlock(queue);
+
+    item->type = RECORDQUEUE_ITEM_AUDIO;
+    if (item->samples_size < num_samples) {
+        lib_free(item->samples);
+        item->samples = lib_malloc(num_samples * sizeof(int16_t));
+        item->samples_size = num_samples;
+    }
+    memcpy(item->samples, samples, num_samples * sizeof(int16_t));
+    item->num_samples = num_samples;
+
+    recordqueue_lock(queue);
+    result = recordqueue_commit(queue, item);
+    recordqueue_unlock(queue);
+
+    return result;
+}
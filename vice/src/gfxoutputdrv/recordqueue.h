@@ -0,0 +1,78 @@
+/*
+ * recordqueue.h - Frame queue and encoder thread for the video recorders.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_RECORDQUEUE_H
+#define VICE_RECORDQUEUE_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+struct screenshot_s;
+
+#define RECORDQUEUE_PALETTE_COLORS  256
+
+typedef enum {
+    RECORDQUEUE_ITEM_VIDEO,
+    RECORDQUEUE_ITEM_AUDIO
+} recordqueue_item_type_t;
+
+typedef struct recordqueue_item_s {
+    recordqueue_item_type_t type;
+
+    /* video: palette indices, `width' * `height' bytes */
+    uint8_t *pixels;
+    int width;
+    int height;
+    /* RGB triplets */
+    uint8_t palette[RECORDQUEUE_PALETTE_COLORS * 3];
+    /* number of times the frame goes into the stream */
+    int repeat;
+
+    /* audio: interleaved 16 bit samples */
+    int16_t *samples;
+    size_t num_samples;
+    size_t samples_size;
+} recordqueue_item_t;
+
+/* Called on the encoder thread for every queued item, in order. Returns
+   < 0 on error, which makes further pushes fail. */
+typedef int recordqueue_encode_t(recordqueue_item_t *item, void *param);
+
+typedef struct recordqueue_s recordqueue_t;
+
+int recordqueue_resources_init(void);
+int recordqueue_cmdline_options_init(void);
+
+/* `width' x `height' is the size of the video, the screenshots are centered
+   and cut to it. */
+recordqueue_t *recordqueue_new(const char *name, int width, int height,
+                               recordqueue_encode_t *encode, void *param);
+/* Encodes everything still queued, stops the thread and frees the queue.
+   Returns < 0 if the encoder failed. */
+int recordqueue_close(recordqueue_t *queue);
+
+int recordqueue_push_video(recordqueue_t *queue, struct screenshot_s *screenshot, int repeat);
+int recordqueue_push_audio(recordqueue_t *queue, const int16_t *samples, size_t num_samples);
+
+#endif
@@ -42,6 +42,7 @@
 #include "maincpu.h"
 #include "math.h"
 #include "palette.h"
+#include "recordqueue.h"
 #include "resources.h"
 #include "screenshot.h"
 #include "uiapi.h"
@@ -80,15 +81,13 @@
 
 /******************************************************************************/
 
-static int frameno = 0;
+static int frameno = 0;     /* frames written, counted on the encoder thread */
 
 static zmvb_init_flags_t iflg = ZMBV_INIT_FLAG_NONE;
 
 static int complevel = -1;  /* compression level, -1 means default */
 static int no_zlib = 0;
 
-static uint8_t cur_pal[PALETTE_SIZE];
-
 static int16_t cur_audio[MAX_AUDIO_BUFFER_SIZE];
 
 static zmbv_avi_t zavi;
@@ -101,7 +100,9 @@ static void *video_work_buffer = NULL;
 static int video_codec;
 static int audio_codec;
 
-static uint8_t *cur_screen = NULL;
+/* frames and audio go through this to the encoder thread, which does all
+   the encoding and writing to the avi */
+static recordqueue_t *record_queue = NULL;
 
 /* general */
 static int file_init_done = 1;
@@ -333,35 +334,10 @@ static int zmbv_soundmovie_encode(soundmovie_buffer_t *audio_in)
     LOGFRAMES(("zmbv_soundmovie_encode(size:%d used:%d channels:%d) clk:%ld frame:%d",
                audio_in->size, audio_in->used, audio_channels, clk_this_audio_frame, frameno));
 
-    /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
-    if (audio_channels == 1) {
-        int i, o;
-#if 1
-        /* convert mono -> stereo */
-        for (i = o = 0; i < audio_in->used; i++, o+=2) {
-            cur_audio[o] = audio_in->buffer[i];
-            cur_audio[o+1] = audio_in->buffer[i];
-        }
-        /* write avi chunks */
-        if (zmbv_avi_write_chunk_audio(zavi, &cur_audio[0], audio_in->used * 4) < 0) {
-            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
-            ret = -1;
-        }
-#else
-        /* FIXME: we should write the mono stream into the avi instead */
-#endif
-    } else if (audio_channels == 2) {
-        int i, o;
-        for (i = o = 0; i < audio_in->used; i+=2, o+=2) {
-            cur_audio[o] = audio_in->buffer[i];
-            cur_audio[o+1] = audio_in->buffer[i+1];
-        }
-        /* write avi chunks */
-        if (zmbv_avi_write_chunk_audio(zavi, &audio_in->buffer[0], audio_in->used * 2) < 0) {
-            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
-            ret = -1;
-        }
-    } else {
+    if ((audio_channels != 1) && (audio_channels != 2)) {
+        ret = -1;
+    } else if ((record_queue == NULL)
+               || (recordqueue_push_audio(record_queue, &audio_in->buffer[0], audio_in->used) < 0)) {
         ret = -1;
     }
 
@@ -387,60 +363,76 @@ static soundmovie_funcs_t zmbvdrv_soundmovie_funcs = {
 /*-----------------------*/
 /* video stream encoding */
 /*-----------------------*/
-static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
+/* Recordqueue encoder, called on the encoder thread for every queued frame
+   and audio buffer */
+static int zmbvdrv_encode(recordqueue_item_t *item, void *param)
 {
-    int x, y;
-    int dx, dy;
-    int bufferoffset;
-    int x_dim = screenshot->width;
-    int y_dim = screenshot->height;
-
-    if ((video_width == 0) || (video_height == 0)) {
+    int32_t written;
+    int flags;
+    int y, i;
+
+    if (item->type == RECORDQUEUE_ITEM_AUDIO) {
+        /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
+        if (audio_channels == 1) {
+            size_t n, o;
+            /* convert mono -> stereo */
+            for (n = o = 0; n < item->num_samples; n++, o += 2) {
+                cur_audio[o] = item->samples[n];
+                cur_audio[o + 1] = item->samples[n];
+            }
+            /* write avi chunks */
+            if (zmbv_avi_write_chunk_audio(zavi, &cur_audio[0], (int)(item->num_samples * 4)) < 0) {
+                LOG(("FATAL: can't write audio frame for screen #%d", frameno));
+                return -1;
+            }
+        } else {
+            /* write avi chunks */
+            if (zmbv_avi_write_chunk_audio(zavi, item->samples, (int)(item->num_samples * 2)) < 0) {
+                LOG(("FATAL: can't write audio frame for screen #%d", frameno));
+                return -1;
+            }
+        }
         return 0;
     }
 
-    /* center the screenshot in the video */
-    dx = (video_width - x_dim) / 2;
-    dy = (video_height - y_dim) / 2;
-    bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
-        + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
+    for (i = 0; i < item->repeat; i++) {
+        flags = ((frameno % KEYFRAME_INTERVAL == 0) ? ZMBV_PREP_FLAG_KEYFRAME : ZMBV_PREP_FLAG_NONE);
 
-    for (x = 0; x < PALETTE_NUM_COLORS; x++) {
-        cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 0] = screenshot->palette->entries[x].red;
-        cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 1] = screenshot->palette->entries[x].green;
-        cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 2] = screenshot->palette->entries[x].blue;
-    }
+        frameno++;
 
-    LOGFRAMES(("zmbvdrv_fill_rgb_image video_width/height: %dx%d", video_width, video_height));
-    for (y = 0; y < video_height; y++) {
-        for (x = 0; x < video_width; x++) {
-            cur_screen[(y * video_width) + x] = screenshot->draw_buffer[bufferoffset + x];
+        LOGFRAMES(("zmbvdrv_encode: frame %d", frameno));
+
+        /* encode video frame */
+        if (zmbv_encode_prepare_frame(zcodec, flags, fmt, item->palette, video_work_buffer, work_buffer_size) < 0) {
+            LOG(("FATAL: can't prepare frame for screen #%d", frameno));
+            return -1;
+        }
+        for (y = 0; y < video_height; ++y) {
+            if (zmbv_encode_line(zcodec, item->pixels + (y * video_width)) < 0) {
+                LOG(("FATAL: can't encode line #%d for screen #%d", y, frameno));
+                return -1;
+            }
+        }
+        written = zmvb_encode_finish_frame(zcodec);
+        if (written < 0) {
+            LOG(("FATAL: can't finish frame for screen #%d", frameno));
+            return -1;
+        }
+        /* write avi chunk */
+        if (zmbv_avi_write_chunk_video(zavi, video_work_buffer, written) < 0) {
+            LOG(("FATAL: can't write compressed frame for screen #%d", frameno));
+            return -1;
         }
-        bufferoffset += screenshot->draw_buffer_line_size;
     }
-    LOGFRAMES(("zmbvdrv_fill_rgb_image done"));
-
     return 0;
 }
 
-static uint8_t *zmbvdrv_alloc_picture(int width, int height)
-{
-    /* the pixel format is always 8bpp, with a 256 entries, 24bit, palette */
-    LOG(("zmbvdrv_alloc_picture width:%d height:%d", width, height));
-    return lib_malloc(width * height);
-}
-
 /* called by zmbvdrv_init_file() */
 static int zmbvdrv_open_video(int width, int height)
 {
     LOG(("zmbvdrv_open_video width:%d height:%d", width, height));
     /* MOVE? open the codec */
     video_is_open = 1;
-    /* FIXME: allocate the encoded raw picture */
-    cur_screen = zmbvdrv_alloc_picture(width, height);
-    if (cur_screen == NULL) {
-        return -1;
-    }
     return 0;
 }
 
@@ -449,10 +441,6 @@ static void zmbvdrv_close_video(void)
 {
     LOG(("zmbvdrv_close_video"));
     video_is_open = 0;
-    if (cur_screen != NULL) {
-        lib_free (cur_screen);
-        cur_screen = NULL;
-    }
 }
 /* called by zmbvdrv_save */
 static void zmbvdrv_init_video(screenshot_t *screenshot)
@@ -555,6 +543,10 @@ static int zmbvdrv_save(screenshot_t *screenshot, const char *filename)
 
     frameno = 0;
 
+    /* from here on the codec and the avi are used by the encoder thread */
+    record_queue = recordqueue_new("zmbvdrv", video_width, video_height,
+                                   zmbvdrv_encode, NULL);
+
     soundmovie_start(&zmbvdrv_soundmovie_funcs);
 
     return 0;
@@ -567,6 +559,12 @@ static int zmbvdrv_close(screenshot_t *screenshot)
 
     soundmovie_stop();
 
+    /* encode what is still queued */
+    if (recordqueue_close(record_queue) < 0) {
+        log_error(LOG_DEFAULT, "zmbvdrv: Error while writing the recording");
+    }
+    record_queue = NULL;
+
     zmbvdrv_close_video();
     zmbvdrv_close_audio();
 
@@ -590,9 +588,6 @@ static int zmbvdrv_close(screenshot_t *screenshot)
 /* triggered by screenshot_record, periodically called to output video data stream */
 static int zmbvdrv_record(screenshot_t *screenshot)
 {
-    int ret = -1;
-    int32_t written;
-    int flags;
     CLOCK clk_diff;
 
     if (audio_init_done && video_init_done && !file_init_done) {
@@ -617,38 +612,14 @@ static int zmbvdrv_record(screenshot_t *screenshot)
         }
     }
 
-    zmbvdrv_fill_rgb_image(screenshot);
-
-    flags = ((frameno % KEYFRAME_INTERVAL == 0) ? ZMBV_PREP_FLAG_KEYFRAME : ZMBV_PREP_FLAG_NONE);
-
-    frameno++;
+    if (record_queue == NULL) {
+        return -1;
+    }
 
-    LOGFRAMES(("zmbvdrv_record: frame %d (clk:%ld)", frameno, clk_this_video_frame));
+    LOGFRAMES(("zmbvdrv_record: frame %u (clk:%ld)", framecounter, clk_this_video_frame));
+    framecounter++;
 
-    /* encode video frame */
-    if (zmbv_encode_prepare_frame(zcodec, flags, fmt, cur_pal, video_work_buffer, work_buffer_size) < 0) {
-        LOG(("FATAL: can't prepare frame for screen #%d", frameno));
-        goto quit;
-    }
-    for (int y = 0; y < video_height; ++y) {
-        if (zmbv_encode_line(zcodec, cur_screen+(y*video_width)) < 0) {
-            LOG(("FATAL: can't encode line #%d for screen #%d", y, frameno));
-            goto quit;
-        }
-    }
-    written = zmvb_encode_finish_frame(zcodec);
-    if (written < 0) {
-        LOG(("FATAL: can't finish frame for screen #%d", frameno));
-        goto quit;
-    }
-    /* write avi chunk */
-    if (zmbv_avi_write_chunk_video(zavi, video_work_buffer, written) < 0) {
-        LOG(("FATAL: can't write compressed frame for screen #%d", frameno));
-        goto quit;
-    }
-    ret = 0;
-quit:
-    if (ret < 0) {
+    if (recordqueue_push_video(record_queue, screenshot, 1) < 0) {
         log_debug(LOG_DEFAULT, "Error while writing video frame");
         return -1;
     }
@@ -44,68 +44,13 @@
 #include "machine-drive.h"
 
 
-/* This code is used to check whether the directory is circular.  It should
-   be replaced by a more simple check that just stops if the number of
-   entries is bigger than expected, but this needs some support in `vdrive.c'
-   which we do not have yet.  */
-
-static struct block_list_t {
-    unsigned int track;
-    unsigned int sector;
-} *block_list = NULL;
-
-static unsigned int block_list_nelems;
-static unsigned int block_list_size;
-
-static void circular_check_init(void)
-{
-    block_list_nelems = 0;
-}
-
-static void circular_check_free(void)
-{
-    if (block_list) {
-        lib_free(block_list);
-        block_list = NULL;
-    }
-    block_list_size = 0;
-    block_list_nelems = 0;
-}
-
-static int circular_check(unsigned int track, unsigned int sector)
-{
-    unsigned int i;
-
-    for (i = 0; i < block_list_nelems; i++) {
-        if (block_list[i].track == track && block_list[i].sector == sector) {
-            return 1;
-        }
-    }
-
-    if (block_list_nelems == block_list_size) {
-        if (block_list_size == 0) {
-            block_list_size = 512;
-            block_list = lib_malloc(sizeof(*block_list) * block_list_size);
-        } else {
-            block_list_size *= 2;
-            block_list = lib_realloc(block_list,
-                                     sizeof(*block_list) * block_list_size);
-        }
-    }
-
-    block_list[block_list_nelems].track = track;
-    block_list[block_list_nelems++].sector = sector;
-
-    return 0;
-}
-
 image_contents_t *diskcontents_block_read(vdrive_t *vdrive, int part)
 {
     image_contents_t *contents;
-    uint8_t buffer[256];
     int retval;
     image_contents_file_list_t *lp;
-    unsigned int curr_track, curr_sector;
+    vdrive_dir_index_t *index;
+    unsigned int n;
 
     machine_drive_flush();
 
@@ -133,27 +78,20 @@ image_contents_t *diskcontents_block_read(vdrive_t *vdrive, int part)
 
     contents->partition = vdrive->selected_part;
 
-    curr_track = vdrive->Dir_Track;
-    curr_sector = vdrive->Dir_Sector;
-
     lp = NULL;
     contents->file_list = NULL;
 
-    circular_check_init();
+    /* the index stops at the end of the chain, a loop or a read error */
+    index = vdrive_dir_index_get(vdrive, vdrive->Dir_Track, vdrive->Dir_Sector);
+    if (index == NULL) {
+        return contents;
+    }
 
-    while (1) {
-        uint8_t *p;
+    for (n = 0; n < vdrive_dir_index_num_sectors(index); n++) {
+        const uint8_t *p;
         int j;
 
-        retval = vdrive_read_sector(vdrive, buffer, curr_track, curr_sector);
-
-        if (retval != 0
-            || circular_check(curr_track, curr_sector)) {
-            circular_check_free();
-            return contents;
-        }
-
-        for (p = buffer, j = 0; j < 8; j++, p += 32) {
+        for (p = vdrive_dir_index_sector(index, n), j = 0; j < 8; j++, p += 32) {
             if (p[SLOT_TYPE_OFFSET] != 0) {
                 image_contents_file_list_t *new_list;
                 int i;
@@ -188,15 +126,7 @@ image_contents_t *diskcontents_block_read(vdrive_t *vdrive, int part)
                 }
             }
         }
-
-        if (buffer[0] == 0) {
-            break;
-        }
-
-        curr_track = (int)buffer[0];
-        curr_sector = (int)buffer[1];
     }
 
-    circular_check_free();
     return contents;
 }
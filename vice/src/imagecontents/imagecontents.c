@@ -210,20 +210,23 @@ char *image_contents_to_string(image_contents_t * contents, char out_charset)
 }
 
 
+/* size of the buffer image_contents_get_filename() fills in */
+#define PRINT_NAME_SIZE (IMAGE_CONTENTS_FILE_NAME_LEN + 3)
+
 /** \brief  Convert filename in \a p to '\"<filename>\"'
  *
- * \param[in]   p   image contents file list
- *
- * \return  converted string, _not_ allocated on the heap, _not_ MT safe
+ * \param[in]   p           image contents file list
+ * \param[out]  print_name  buffer of PRINT_NAME_SIZE bytes for the result,
+ *                          usually on the stack of the caller
  */
-static char *image_contents_get_filename(image_contents_file_list_t * p)
+static void image_contents_get_filename(image_contents_file_list_t * p,
+                                        char *print_name)
 {
     int i;
-    /* WTF? */
-    static char print_name[IMAGE_CONTENTS_FILE_NAME_LEN + 3] = { 0 };
     char encountered_a0 = 0;
 
-    memset(print_name, 0x20, sizeof(print_name) - 1); /* redundant? better safe than sorry */
+    memset(print_name, 0x20, PRINT_NAME_SIZE - 1); /* redundant? better safe than sorry */
+    print_name[PRINT_NAME_SIZE - 1] = '\0';
     print_name[0] = '\"';
 
     for (i = 0; i < IMAGE_CONTENTS_FILE_NAME_LEN; i++) {
@@ -244,8 +247,6 @@ static char *image_contents_get_filename(image_contents_file_list_t * p)
     if (!encountered_a0) {
         print_name[i + 1] = '\"';
     }
-
-    return print_name;
 }
 
 
@@ -259,9 +260,9 @@ static char *image_contents_get_filename(image_contents_file_list_t * p)
 char *image_contents_filename_to_string(image_contents_file_list_t * p,
                                         char out_charset)
 {
-    char *print_name;
+    char print_name[PRINT_NAME_SIZE];
 
-    print_name = image_contents_get_filename(p);
+    image_contents_get_filename(p, print_name);
 
     if (out_charset == IMAGE_CONTENTS_STRING_PETSCII) {
         return lib_strdup(print_name);
@@ -301,10 +302,10 @@ char *image_contents_filetype_to_string(image_contents_file_list_t *p,
 char *image_contents_file_to_string(image_contents_file_list_t *p,
                                     char out_charset)
 {
-    char *print_name;
+    char print_name[PRINT_NAME_SIZE];
     uint8_t *str;
 
-    print_name = image_contents_get_filename(p);
+    image_contents_get_filename(p, print_name);
     str = (uint8_t *)lib_msprintf("%-4u %s%s", p->size, print_name, p->type);
 
     if (out_charset == IMAGE_CONTENTS_STRING_PETSCII) {
@@ -48,7 +48,9 @@
 #include "palette.h"
 #include "ram.h"
 #include "resources.h"
+#include "rewind.h"
 #include "romset.h"
+#include "sampleprof.h"
 #include "screenshot.h"
 #include "signals.h"
 #include "sysfile.h"
@@ -144,6 +146,16 @@ int init_resources(void)
         init_resource_fail("monitor");
         return -1;
     }
+    if (machine_class != VICE_MACHINE_VSID) {
+        if (rewind_resources_init() < 0) {
+            init_resource_fail("rewind");
+            return -1;
+        }
+    }
+    if (sampleprof_resources_init() < 0) {
+        init_resource_fail("sampling profiler");
+        return -1;
+    }
 #ifdef HAVE_NETWORK
     if (monitor_network_resources_init() < 0) {
         init_resource_fail("MONITOR_NETWORK");
@@ -197,6 +209,10 @@ int init_cmdline_options(void)
         init_cmdline_options_fail("monitor");
         return -1;
     }
+    if (sampleprof_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("sampling profiler");
+        return -1;
+    }
     if (machine_common_cmdline_options_init() < 0) {
         init_cmdline_options_fail("machine common");
         return -1;
@@ -227,6 +243,10 @@ int init_cmdline_options(void)
             init_cmdline_options_fail("RAM");
             return -1;
         }
+        if (rewind_cmdline_options_init() < 0) {
+            init_cmdline_options_fail("rewind");
+            return -1;
+        }
     }
 #ifdef HAVE_NETWORK
     if (monitor_network_cmdline_options_init() < 0) {
@@ -315,6 +335,7 @@ int init_main(void)
 
     if (machine_class != VICE_MACHINE_VSID) {
         vdrive_init();
+        rewind_init();
     }
 
     ui_init_finalize();
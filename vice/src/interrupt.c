@@ -320,7 +320,12 @@ extern log_t traps_log;
 void interrupt_maincpu_trigger_trap(void (*trap_func)(uint16_t, void *data),
                                     void *data)
 {
-    interrupt_cpu_status_t *cs = maincpu_int_status;
+    interrupt_trigger_trap(maincpu_int_status, trap_func, data);
+}
+
+void interrupt_trigger_trap(interrupt_cpu_status_t *cs,
+                            void (*trap_func)(uint16_t, void *data), void *data)
+{
     int this_trap_index;
     int trap_size_needed;
 
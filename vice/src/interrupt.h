@@ -303,6 +303,7 @@ unsigned int interrupt_cpu_status_int_new(interrupt_cpu_status_t *cs, const char
 void interrupt_ack_reset(interrupt_cpu_status_t *cs);
 void interrupt_set_reset_trap_func(interrupt_cpu_status_t *cs, void (*reset_trap_func)(void));
 void interrupt_maincpu_trigger_trap(void (*trap_func)(uint16_t, void *data), void *data);
+void interrupt_trigger_trap(interrupt_cpu_status_t *cs, void (*trap_func)(uint16_t, void *data), void *data);
 void interrupt_do_trap(interrupt_cpu_status_t *cs, uint16_t address);
 
 void interrupt_monitor_trap_on(interrupt_cpu_status_t *cs);
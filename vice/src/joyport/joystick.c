@@ -52,6 +52,7 @@
 #include "maincpu.h"
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
 #include "snapshot.h"
 #include "sysfile.h"
 #include "types.h"
@@ -315,7 +316,7 @@ uint8_t joystick_get_axis_value(unsigned int port, unsigned int pot)
 
 void joystick_set_value_absolute(unsigned int joyport, uint16_t value)
 {
-    if (event_playback_active()) {
+    if (event_playback_active() || rewind_replay_active()) {
         return;
     }
 
@@ -330,7 +331,7 @@ void joystick_set_value_absolute(unsigned int joyport, uint16_t value)
 /* set joystick bits */
 void joystick_set_value_or(unsigned int joyport, uint16_t value)
 {
-    if (event_playback_active()) {
+    if (event_playback_active() || rewind_replay_active()) {
         return;
     }
 
@@ -348,7 +349,7 @@ void joystick_set_value_or(unsigned int joyport, uint16_t value)
 /* release joystick bits */
 void joystick_set_value_and(unsigned int joyport, uint16_t value)
 {
-    if (event_playback_active()) {
+    if (event_playback_active() || rewind_replay_active()) {
         return;
     }
 
@@ -60,6 +60,7 @@
 #include "maincpu.h"
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
 #include "snapshot.h"
 #include "sysfile.h"
 #include "types.h"
@@ -764,7 +765,7 @@ void keyboard_key_pressed(signed long key, int mod)
     DBGKEY(("keyboard_key_pressed:   [PRESSED]      maincpu_clk: %12lu key:%3ld mod:0x%04x",
             maincpu_clk, key, (unsigned)mod));
 
-    if (event_playback_active()) {
+    if (event_playback_active() || rewind_replay_active()) {
         return;
     }
 
@@ -815,7 +816,7 @@ void keyboard_key_released(signed long key, int mod)
     DBGKEY(("keyboard_key_released:  [RELEASED]     maincpu_clk: %12lu key:%3ld mod:0x%04x idx:%d",
             maincpu_clk, key, (unsigned)mod, idx));
 
-    if (event_playback_active()) {
+    if (event_playback_active() || rewind_replay_active()) {
         return;
     }
 
@@ -870,7 +871,7 @@ static void keyboard_key_clear_internal(void)
 /* called by the ui */
 void keyboard_key_clear(void)
 {
-    if (event_playback_active()) {
+    if (event_playback_active() || rewind_replay_active()) {
         return;
     }
 
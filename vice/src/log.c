@@ -193,6 +193,15 @@ int log_set_limit(int n)
     UNLOCK_AND_RETURN_INT(0);
 }
 
+int log_get_limit(void)
+{
+    int n;
+
+    LOCK();
+    n = log_limit;
+    UNLOCK_AND_RETURN_INT(n);
+}
+
 /* called by code that is executed *before* the resources are registered */
 int log_set_limit_early(int n)
 {
@@ -62,8 +62,11 @@
 #include "printer.h"
 #include "profiler.h"
 #include "resources.h"
+#include "rewind.h"
 #include "romset.h"
+#include "sampleprof.h"
 #include "screenshot.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sysfile.h"
 #include "tape.h"
@@ -267,6 +270,8 @@ void machine_reset(void)
 
     event_reset_ack();
 
+    rewind_reset();
+
     /* Give the monitor a chance to break immediately */
     monitor_reset_hook();
 
@@ -282,10 +287,45 @@ void machine_reset(void)
     }
 }
 
+/** \brief  Write a snapshot of the machine into a memory buffer
+ *
+ * Same as machine_write_snapshot(), but without any file I/O, meant for
+ * taking many snapshots (rewind, fuzzing, comparing runs). The previous
+ * contents of \a mem are replaced.
+ *
+ * \return  0 on success, -1 on error
+ */
+int machine_write_snapshot_memory(snapshot_memory_t *mem, int save_roms, int save_disks, int event_mode)
+{
+    int err;
+
+    snapshot_memory_select(mem);
+    err = machine_write_snapshot("", save_roms, save_disks, event_mode);
+    snapshot_memory_select(NULL);
+    return err;
+}
+
+/** \brief  Restore the machine from a snapshot in a memory buffer
+ *
+ * \return  0 on success, -1 on error
+ */
+int machine_read_snapshot_memory(snapshot_memory_t *mem, int event_mode)
+{
+    int err;
+
+    snapshot_memory_select(mem);
+    err = machine_read_snapshot("", event_mode);
+    snapshot_memory_select(NULL);
+    return err;
+}
+
 void machine_maincpu_init(void)
 {
     maincpu_init();
     maincpu_monitor_interface = lib_calloc(1, sizeof(monitor_interface_t));
+    maincpu_sampleprof = sampleprof_cpu_new("maincpu", maincpu_alarm_context,
+                                            maincpu_int_status, &maincpu_clk,
+                                            NULL, profile_get_callstack);
 }
 
 void machine_early_init(void)
@@ -306,6 +346,8 @@ int machine_init(void)
 
 void machine_maincpu_shutdown(void)
 {
+    sampleprof_shutdown();
+
     if (maincpu_alarm_context != NULL) {
         alarm_context_destroy(maincpu_alarm_context);
     }
@@ -406,6 +448,9 @@ void machine_shutdown(void)
 
     resources_shutdown();
 
+    /* write the profile while the drive CPUs are still there */
+    sampleprof_stop();
+
     drive_shutdown();
 
     machine_maincpu_shutdown();
@@ -430,6 +475,8 @@ void machine_shutdown(void)
 
     event_shutdown();
 
+    rewind_shutdown();
+
     network_shutdown();
 
     autostart_resources_shutdown();
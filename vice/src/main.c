@@ -73,6 +73,11 @@
 #include "svnversion.h"
 #endif
 
+#ifdef USE_HEADLESSUI
+#include "batch.h"
+#include "benchmark.h"
+#endif
+
 #ifdef DEBUG_MAIN
 #define DBG(x)  log_printf x
 #else
@@ -442,6 +447,17 @@ int main_program(int argc, char **argv)
         return -1;
     }
 
+#ifdef USE_HEADLESSUI
+    /* `-batch': only returns in the forked job processes */
+    if (batch_is_enabled() && batch_run() < 0) {
+        return -1;
+    }
+    /* `-benchmark': runs from the emulation, exits VICE when done */
+    if (benchmark_is_enabled() && benchmark_run() < 0) {
+        return -1;
+    }
+#endif
+
 #ifdef USE_VICE_THREAD
 
     if (pthread_create(&vice_thread, NULL, vice_thread_main, NULL)) {
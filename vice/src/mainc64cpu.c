@@ -52,6 +52,7 @@
 #include "mos6510.h"
 #include "reu.h"
 #include "resources.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "traps.h"
 #include "types.h"
@@ -769,6 +770,8 @@ void maincpu_mainloop(void)
 
 #define ALARM_CONTEXT maincpu_alarm_context
 
+#define SAMPLEPROF maincpu_sampleprof
+
 #define CHECK_PENDING_ALARM() (clk >= next_alarm_clk(maincpu_int_status))
 
 #define CHECK_PENDING_INTERRUPT() check_pending_interrupt(maincpu_int_status)
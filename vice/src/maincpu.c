@@ -48,6 +48,7 @@
 #include "mos6510.h"
 #endif
 #include "h6809regs.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "resources.h"
 #include "cmdline.h"
@@ -596,6 +597,8 @@ void maincpu_mainloop(void)
 
 #define ALARM_CONTEXT maincpu_alarm_context
 
+#define SAMPLEPROF maincpu_sampleprof
+
 #define CHECK_PENDING_ALARM() (clk >= next_alarm_clk(maincpu_int_status))
 
 #define CHECK_PENDING_INTERRUPT() check_pending_interrupt(maincpu_int_status)
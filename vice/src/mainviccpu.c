@@ -41,6 +41,7 @@
 #include "mem.h"
 #include "monitor.h"
 #include "mos6510.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "resources.h"
 #include "cmdline.h"
@@ -596,6 +597,8 @@ void maincpu_mainloop(void)
 
 #define ALARM_CONTEXT maincpu_alarm_context
 
+#define SAMPLEPROF maincpu_sampleprof
+
 #define CHECK_PENDING_ALARM() (clk >= next_alarm_clk(maincpu_int_status))
 
 #define CHECK_PENDING_INTERRUPT() check_pending_interrupt(maincpu_int_status)
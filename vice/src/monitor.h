@@ -247,6 +247,8 @@ void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op, u
                               uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
                               uint8_t reg_sp, unsigned int reg_st, MEMSPACE origin);
 void monitor_cpuhistory_fix_p2(unsigned int p2);
+void monitor_cpuhistory_begin_deferred(MEMSPACE origin);
+void monitor_cpuhistory_end_deferred(MEMSPACE origin);
 void monitor_memmap_store(unsigned int addr, unsigned int type);
 
 /* memmap defines */
@@ -37,6 +37,7 @@
 #include "lib.h"
 #include "log.h"
 #include "mon_breakpoint.h"
+#include "mon_conditional.h"
 #include "mon_disassemble.h"
 #include "mon_util.h"
 #include "montypes.h"
@@ -60,6 +61,19 @@ static checkpoint_list_t *breakpoints[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_load[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_store[NUM_MEMSPACES];
 
+/* Bitmaps of the addresses covered by the lists above, indexed by the low 16
+   bits of the address. Most addresses have no checkpoint at all, those are
+   rejected with a single bit test instead of walking the list. A set bit
+   only means that the list must be searched. */
+#define CHECKPOINT_MAP_SIZE (0x10000 / 8)
+
+static uint8_t *breakpoints_map[NUM_MEMSPACES];
+static uint8_t *watchpoints_load_map[NUM_MEMSPACES];
+static uint8_t *watchpoints_store_map[NUM_MEMSPACES];
+
+/* Run the compiled conditions, false uses the tree walker for all of them */
+static bool use_compiled_conditions = true;
+
 
 void mon_breakpoint_init(void)
 {
@@ -148,8 +162,54 @@ mon_checkpoint_t *mon_breakpoint_find_checkpoint(int brknum)
     return NULL;
 }
 
+static void checkpoint_map_set_range(uint8_t *map, mon_checkpoint_t *cp)
+{
+    unsigned int start, count, loc, i;
+
+    start = addr_location(cp->start_addr);
+    count = 1;
+    if (mon_is_valid_addr(cp->end_addr)) {
+        count = addr_mask(addr_location(cp->end_addr) - start) + 1;
+    }
+
+    if (count >= 0x10000) {
+        memset(map, 0xff, CHECKPOINT_MAP_SIZE);
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        loc = (start + i) & 0xffff;
+        map[loc >> 3] |= (uint8_t)(1 << (loc & 7));
+    }
+}
+
+/* Rebuild the bitmap of a checkpoint list, an empty list has no bitmap.  */
+static void update_checkpoint_map(uint8_t **map, checkpoint_list_t *head)
+{
+    checkpoint_list_t *ptr;
+
+    if (head == NULL) {
+        lib_free(*map);
+        *map = NULL;
+        return;
+    }
+
+    if (*map == NULL) {
+        *map = lib_malloc(CHECKPOINT_MAP_SIZE);
+    }
+    memset(*map, 0, CHECKPOINT_MAP_SIZE);
+
+    for (ptr = head; ptr != NULL; ptr = ptr->next) {
+        checkpoint_map_set_range(*map, ptr->checkpt);
+    }
+}
+
 static void update_checkpoint_state(MEMSPACE mem)
 {
+    update_checkpoint_map(&breakpoints_map[mem], breakpoints[mem]);
+    update_checkpoint_map(&watchpoints_load_map[mem], watchpoints_load[mem]);
+    update_checkpoint_map(&watchpoints_store_map[mem], watchpoints_store[mem]);
+
     /* calls mem_toggle_watchpoints() */
     if (watchpoints_load[mem] != NULL ||
         watchpoints_store[mem] != NULL) {
@@ -206,6 +266,7 @@ static void remove_checkpoint(mon_checkpoint_t *cp)
     mem = addr_memspace(cp->start_addr);
 
     mon_delete_conditional(cp->condition);
+    mon_delete_compiled_conditional(cp->compiled_condition);
     lib_free(cp->command);
     cp->command = NULL;
 
@@ -369,7 +430,10 @@ void mon_breakpoint_set_checkpoint_condition(int cp_num,
         if (!cp) {
             mon_out("#%d not a valid checkpoint\n", cp_num);
         } else {
+            mon_delete_conditional(cp->condition);
+            mon_delete_compiled_conditional(cp->compiled_condition);
             cp->condition = cnode;
+            cp->compiled_condition = mon_compile_conditional(cnode);
 
             mon_out("Setting checkpoint %d condition to: ", cp_num);
             mon_print_conditional(cnode);
@@ -444,6 +508,50 @@ static void mon_breakpoint_event(mon_checkpoint_t *checkpt) {
 #endif
 }
 
+/** \brief Select how checkpoint conditions are evaluated
+ *
+ * The compiled conditions are used by default. Turning them off evaluates
+ * every condition by walking its tree, to compare the two.
+ *
+ * \param[in]  enable  use the compiled conditions
+ */
+void mon_breakpoint_use_compiled_conditions(bool enable)
+{
+    use_compiled_conditions = enable;
+}
+
+/** \brief Check whether there may be a checkpoint at an address
+ *
+ * Only tests the address bitmaps, so a true result still needs the checkpoint
+ * list to be searched, but false means there is no checkpoint for \a op at
+ * \a addr at all.
+ *
+ * \param[in]  mem     memspace
+ * \param[in]  addr    address
+ * \param[in]  op      e_exec, e_load or e_store
+ *
+ * \return false if there is no checkpoint for the address
+ */
+bool mon_breakpoint_has_checkpoint(MEMSPACE mem, unsigned int addr, MEMORY_OP op)
+{
+    const uint8_t *map;
+
+    switch (op) {
+        case e_load:
+            map = watchpoints_load_map[mem];
+            break;
+        case e_store:
+            map = watchpoints_store_map[mem];
+            break;
+        default: /* e_exec */
+            map = breakpoints_map[mem];
+            break;
+    }
+
+    addr &= 0xffff;
+    return map != NULL && (map[addr >> 3] & (1 << (addr & 7))) != 0;
+}
+
 bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned int lastpc, MEMORY_OP op)
 {
     checkpoint_list_t *ptr;
@@ -457,8 +565,13 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     const char *op_str;
     const char *action_str;
     supported_cpu_type_list_t *cpulist;
-    int monbank = mon_interfaces[mem]->current_bank;
+    int monbank;
+
+    if (!mon_breakpoint_has_checkpoint(mem, addr, op)) {
+        return FALSE;
+    }
 
+    monbank = mon_interfaces[mem]->current_bank;
     monitor_cpu = monitor_cpu_for_memspace[mem];
     instpc = new_addr(mem, (monitor_cpu->mon_register_get_val)(mem, e_PC));
     loadstorepc = new_addr(mem, lastpc);
@@ -518,7 +631,11 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
         ptr = ptr->next;
         if (cp && cp->enabled == e_ON) {
             /* If condition test fails, skip this checkpoint */
-            if (cp->condition) {
+            if (cp->compiled_condition && use_compiled_conditions) {
+                if (!mon_run_compiled_conditional(cp->compiled_condition)) {
+                    continue;
+                }
+            } else if (cp->condition) {
                 if (!mon_evaluate_conditional(cp->condition)) {
                     continue;
                 }
@@ -638,6 +755,7 @@ int breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
     new_cp->hit_count = 0;
     new_cp->ignore_count = 0;
     new_cp->condition = NULL;
+    new_cp->compiled_condition = NULL;
     new_cp->command = NULL;
     new_cp->check_load = memory_op & e_load;
     new_cp->check_store = memory_op & e_store;
@@ -720,6 +838,7 @@ void mon_breakpoint_unset(MON_ADDR address)
         /* there's a breakpoint, so remove it */
         remove_checkpoint_from_list( &all_checkpoints, ptr->checkpt );
         remove_checkpoint_from_list( &breakpoints[mem], ptr->checkpt );
+        update_checkpoint_state(mem);
     }
 }
 
@@ -42,6 +42,7 @@ struct mon_checkpoint_s {
     int hit_count;
     int ignore_count;
     cond_node_t *condition;
+    struct mon_cond_program_s *compiled_condition;
     char *command;
     bool stop;
     bool enabled;
@@ -60,6 +61,8 @@ void mon_breakpoint_print_checkpoints(void);
 void mon_breakpoint_delete_checkpoint(int brknum);
 void mon_breakpoint_set_checkpoint_condition(int brk_num, struct cond_node_s *cnode);
 void mon_breakpoint_set_checkpoint_command(int brk_num, char *cmd);
+void mon_breakpoint_use_compiled_conditions(bool enable);
+bool mon_breakpoint_has_checkpoint(MEMSPACE mem, unsigned int addr, MEMORY_OP op);
 bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr,
                                      unsigned int lastpc, MEMORY_OP op);
 int mon_breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
@@ -0,0 +1,315 @@
+/*
+ * mon_conditional.c - Compiled checkpoint conditions for the VICE built-in
+ *                     monitor.
+ *
+ * The parser builds a cond_node_t tree for a condition, which
+ * mon_evaluate_conditional() walks every time the checkpoint is examined.
+ * For checkpoints on hot code that tree walk adds up, so when a condition is
+ * set it is also compiled into a flat postfix program for a small stack
+ * machine: constants, registers and memory operands are decoded once into
+ * the instructions, and && / || skip their right operand like in C. The
+ * operands have no side effects, so the result is the same as the tree walk.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lib.h"
+#include "log.h"
+#include "mon_conditional.h"
+#include "monitor.h"
+#include "montypes.h"
+
+/* Instructions of the condition program. The binary operators use the
+   CONDITIONAL values, the others start after them. */
+enum {
+    COND_OP_CONST = e_BINARY_OR + 1,    /* push value */
+    COND_OP_REG,                        /* push register `regid' of `mem' */
+    COND_OP_RASTERLINE,                 /* push the raster line */
+    COND_OP_CYCLE,                      /* push the raster cycle */
+    COND_OP_PEEK,                       /* push byte at `value' in `bank' */
+    COND_OP_PEEK_INDIRECT,              /* replace address with byte */
+    COND_OP_AND,                        /* 0: leave 0, jump; else pop */
+    COND_OP_OR,                         /* !0: replace with 1, jump; else pop */
+    COND_OP_BOOL                        /* replace with 0 or 1 */
+};
+
+typedef struct mon_cond_insn_s {
+    int op;
+    int value;          /* constant, address or jump target */
+    int bank;
+    MEMSPACE mem;
+    int regid;
+} mon_cond_insn_t;
+
+struct mon_cond_program_s {
+    mon_cond_insn_t *code;
+    int length;
+    int size;
+    int *stack;
+    int depth;          /* current stack depth while compiling */
+    int max_depth;
+};
+
+
+static mon_cond_insn_t *emit(mon_cond_program_t *program, int op, int depth_change)
+{
+    mon_cond_insn_t *insn;
+
+    if (program->length == program->size) {
+        program->size = program->size ? program->size * 2 : 16;
+        program->code = lib_realloc(program->code, program->size * sizeof(mon_cond_insn_t));
+    }
+    insn = &program->code[program->length++];
+    memset(insn, 0, sizeof(mon_cond_insn_t));
+    insn->op = op;
+
+    program->depth += depth_change;
+    if (program->depth > program->max_depth) {
+        program->max_depth = program->depth;
+    }
+    return insn;
+}
+
+static int compile_node(mon_cond_program_t *program, cond_node_t *cnode)
+{
+    mon_cond_insn_t *insn;
+    int jump;
+
+    if (cnode->operation != e_INV) {
+        if (!(cnode->child1 && cnode->child2)) {
+            return -1;
+        }
+        if (compile_node(program, cnode->child1) < 0) {
+            return -1;
+        }
+
+        if (cnode->operation == e_LOGICAL_AND || cnode->operation == e_LOGICAL_OR) {
+            jump = program->length;
+            emit(program, cnode->operation == e_LOGICAL_AND ? COND_OP_AND : COND_OP_OR, -1);
+            if (compile_node(program, cnode->child2) < 0) {
+                return -1;
+            }
+            emit(program, COND_OP_BOOL, 0);
+            program->code[jump].value = program->length;
+            return 0;
+        }
+
+        if (cnode->operation < e_EQU || cnode->operation > e_BINARY_OR) {
+            return -1;
+        }
+        if (compile_node(program, cnode->child2) < 0) {
+            return -1;
+        }
+        emit(program, cnode->operation, -1);
+        return 0;
+    }
+
+    if (cnode->is_reg && reg_regid(cnode->reg_num) == e_Rasterline) {
+        emit(program, COND_OP_RASTERLINE, 1);
+    } else if (cnode->is_reg && reg_regid(cnode->reg_num) == e_Cycle) {
+        emit(program, COND_OP_CYCLE, 1);
+    } else if (cnode->is_reg) {
+        insn = emit(program, COND_OP_REG, 1);
+        insn->mem = reg_memspace(cnode->reg_num);
+        insn->regid = reg_regid(cnode->reg_num);
+    } else if (cnode->banknum >= 0) {
+        if (cnode->child1 != NULL) {
+            if (compile_node(program, cnode->child1) < 0) {
+                return -1;
+            }
+            insn = emit(program, COND_OP_PEEK_INDIRECT, 0);
+        } else {
+            insn = emit(program, COND_OP_PEEK, 1);
+            insn->value = (uint16_t)addr_location(cnode->value);
+        }
+        insn->mem = e_comp_space;
+        insn->bank = cnode->banknum;
+    } else {
+        insn = emit(program, COND_OP_CONST, 1);
+        insn->value = cnode->value;
+    }
+    return 0;
+}
+
+/** \brief Compile a condition
+ *
+ * \param[in]  cnode   condition tree, as built by the parser
+ *
+ * \return the program, or NULL if the tree cannot be compiled, in which case
+ *         mon_evaluate_conditional() has to be used
+ */
+mon_cond_program_t *mon_compile_conditional(cond_node_t *cnode)
+{
+    mon_cond_program_t *program;
+
+    program = lib_calloc(1, sizeof(mon_cond_program_t));
+
+    if (compile_node(program, cnode) < 0) {
+        mon_delete_compiled_conditional(program);
+        return NULL;
+    }
+    program->stack = lib_malloc(program->max_depth * sizeof(int));
+
+    return program;
+}
+
+static uint8_t peek(MEMSPACE mem, int bank, uint16_t addr)
+{
+    monitor_interface_t *iface = mon_interfaces[mem];
+    uint8_t byte1;
+    int old_sidefx;
+
+    if (iface->mem_bank_peek != NULL) {
+        return iface->mem_bank_peek(bank, addr, iface->context);
+    }
+
+    old_sidefx = sidefx;
+    sidefx = 0;
+    byte1 = mon_get_mem_val_ex(mem, bank, addr);
+    sidefx = old_sidefx;
+    return byte1;
+}
+
+/** \brief Evaluate a compiled condition
+ *
+ * \return the value of the condition, same as mon_evaluate_conditional()
+ */
+int mon_run_compiled_conditional(mon_cond_program_t *program)
+{
+    const mon_cond_insn_t *insn;
+    int *sp = program->stack;   /* next free slot */
+    int pc = 0;
+    unsigned int line, cycle;
+    int half_cycle;
+    int value;
+
+    while (pc < program->length) {
+        insn = &program->code[pc++];
+
+        switch (insn->op) {
+            case COND_OP_CONST:
+                *sp++ = insn->value;
+                break;
+            case COND_OP_REG:
+                *sp++ = (int)(monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)(insn->mem, insn->regid);
+                break;
+            case COND_OP_RASTERLINE:
+                mon_interfaces[e_comp_space]->get_line_cycle(&line, &cycle, &half_cycle);
+                *sp++ = (int)line;
+                break;
+            case COND_OP_CYCLE:
+                mon_interfaces[e_comp_space]->get_line_cycle(&line, &cycle, &half_cycle);
+                *sp++ = (int)cycle;
+                break;
+            case COND_OP_PEEK:
+                *sp++ = peek(insn->mem, insn->bank, (uint16_t)insn->value);
+                break;
+            case COND_OP_PEEK_INDIRECT:
+                sp[-1] = peek(insn->mem, insn->bank, (uint16_t)sp[-1]);
+                break;
+            case COND_OP_AND:
+                if (sp[-1] == 0) {
+                    pc = insn->value;
+                } else {
+                    sp--;
+                }
+                break;
+            case COND_OP_OR:
+                if (sp[-1] != 0) {
+                    sp[-1] = 1;
+                    pc = insn->value;
+                } else {
+                    sp--;
+                }
+                break;
+            case COND_OP_BOOL:
+                sp[-1] = (sp[-1] != 0);
+                break;
+            default:
+                /* binary operators */
+                value = *--sp;
+                switch (insn->op) {
+                    case e_EQU:
+                        sp[-1] = (sp[-1] == value);
+                        break;
+                    case e_NEQ:
+                        sp[-1] = (sp[-1] != value);
+                        break;
+                    case e_GT:
+                        sp[-1] = (sp[-1] > value);
+                        break;
+                    case e_LT:
+                        sp[-1] = (sp[-1] < value);
+                        break;
+                    case e_GTE:
+                        sp[-1] = (sp[-1] >= value);
+                        break;
+                    case e_LTE:
+                        sp[-1] = (sp[-1] <= value);
+                        break;
+                    case e_ADD:
+                        sp[-1] = sp[-1] + value;
+                        break;
+                    case e_SUB:
+                        sp[-1] = sp[-1] - value;
+                        break;
+                    case e_MUL:
+                        sp[-1] = sp[-1] * value;
+                        break;
+                    case e_DIV:
+                        if (value == 0) {
+                            log_error(LOG_DEFAULT, "Division by zero in conditional\n");
+                            sp[-1] = 0;
+                        } else {
+                            sp[-1] = sp[-1] / value;
+                        }
+                        break;
+                    case e_BINARY_AND:
+                        sp[-1] = sp[-1] & value;
+                        break;
+                    case e_BINARY_OR:
+                        sp[-1] = sp[-1] | value;
+                        break;
+                    default:
+                        log_error(LOG_DEFAULT, "Unexpected conditional operator: %d\n",
+                                  insn->op);
+                        return 0;
+                }
+                break;
+        }
+    }
+
+    return program->stack[0];
+}
+
+void mon_delete_compiled_conditional(mon_cond_program_t *program)
+{
+    if (program == NULL) {
+        return;
+    }
+    lib_free(program->code);
+    lib_free(program->stack);
+    lib_free(program);
+}
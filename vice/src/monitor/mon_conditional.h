@@ -0,0 +1,36 @@
+/*
+ * mon_conditional.h - Compiled checkpoint conditions for the VICE built-in
+ *                     monitor.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MON_CONDITIONAL_H
+#define VICE_MON_CONDITIONAL_H
+
+#include "montypes.h"
+
+typedef struct mon_cond_program_s mon_cond_program_t;
+
+mon_cond_program_t *mon_compile_conditional(cond_node_t *cnode);
+int mon_run_compiled_conditional(mon_cond_program_t *program);
+void mon_delete_compiled_conditional(mon_cond_program_t *program);
+
+#endif
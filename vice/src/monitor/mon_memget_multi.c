@@ -0,0 +1,68 @@
+/*
+ * mon_memget_multi.c - Size checks of binary monitor multi-range reads.
+ *
+ * Kept apart from monitor_binary.c so the test programs can check the
+ * limits without the rest of the monitor.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include "mon_memget_multi.h"
+#include "types.h"
+
+/** \brief  Get the size of the response body of a MON_CMD_MEM_GET_MULTI
+ *
+ * The size is summed in 64 bits, so 65535 ranges of 64 KiB cannot wrap it.
+ *
+ * \param[in]   ranges  \a count ranges of MON_MEMGET_MULTI_RANGE_SIZE bytes,
+ *                      as in the command body
+ * \param[in]   count   number of ranges
+ *
+ * \return  size of the response body, 0 if there are more than
+ *          MON_MEMGET_MULTI_MAX_RANGES ranges, a range ends before it
+ *          starts, or the response would be bigger than
+ *          MON_MEMGET_MULTI_MAX_SIZE
+ */
+uint32_t mon_memget_multi_response_size(const uint8_t *ranges, unsigned int count)
+{
+    uint64_t size = 2;
+    unsigned int i;
+
+    if (count > MON_MEMGET_MULTI_MAX_RANGES) {
+        return 0;
+    }
+
+    for (i = 0; i < count; i++, ranges += MON_MEMGET_MULTI_RANGE_SIZE) {
+        unsigned int startaddress = ranges[0] | (ranges[1] << 8);
+        unsigned int endaddress = ranges[2] | (ranges[3] << 8);
+
+        if (startaddress > endaddress) {
+            return 0;
+        }
+        size += 4 + (uint64_t)(endaddress + 1 - startaddress);
+    }
+
+    if (size > MON_MEMGET_MULTI_MAX_SIZE) {
+        return 0;
+    }
+    return (uint32_t)size;
+}
@@ -0,0 +1,40 @@
+/*
+ * mon_memget_multi.h - Size checks of binary monitor multi-range reads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MON_MEMGET_MULTI_H
+#define VICE_MON_MEMGET_MULTI_H
+
+#include "types.h"
+
+/* size of a range in the MON_CMD_MEM_GET_MULTI body */
+#define MON_MEMGET_MULTI_RANGE_SIZE     7
+
+/* most ranges in one request */
+#define MON_MEMGET_MULTI_MAX_RANGES     1024
+
+/* largest response body, in bytes */
+#define MON_MEMGET_MULTI_MAX_SIZE       (16 * 1024 * 1024)
+
+uint32_t mon_memget_multi_response_size(const uint8_t *ranges, unsigned int count);
+
+#endif
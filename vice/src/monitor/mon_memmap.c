@@ -41,6 +41,7 @@
 #include "mon_disassemble.h"
 #include "mon_memmap.h"
 #include "monitor.h"
+#include "monitor_binary.h"
 #include "montypes.h"
 #include "screenshot.h"
 #include "types.h"
@@ -131,6 +132,36 @@ int monitor_cpuhistory_allocate(int lines)
 }
 
 
+/* While drive units run on worker threads (see DriveThreads in drive.c),
+   each of them records its instructions in a buffer of its own instead of
+   the shared ring.  monitor_cpuhistory_end_deferred() moves them over on the
+   main thread once the workers are done, which also keeps the main thread
+   the only producer of the binary monitor trace ring.  */
+typedef struct cpuhistory_deferred_s {
+    cpuhistory_t *lines;
+    int num;
+    int size;
+    int active;
+} cpuhistory_deferred_t;
+
+static cpuhistory_deferred_t cpuhistory_deferred[NUM_MEMSPACES];
+
+static void cpuhistory_append(const cpuhistory_t *line)
+{
+    ++cpuhistory_i;
+    if (cpuhistory_i == cpuhistory_buffer_lines) {
+        cpuhistory_i = 0;
+    }
+    cpuhistory[cpuhistory_i] = *line;
+
+    if (monitor_binary_trace_flags) {
+        monitor_binary_trace_instruction(line->cycle, line->addr, line->op,
+                                         line->p1, line->p2, line->reg_a,
+                                         line->reg_x, line->reg_y, line->reg_sp,
+                                         line->reg_st, line->origin);
+    }
+}
+
 void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
                               unsigned int p1, unsigned int p2,
                               uint8_t reg_a,
@@ -140,30 +171,65 @@ void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
                               unsigned int reg_st,
                               MEMSPACE origin)
 {
+    cpuhistory_deferred_t *deferred = &cpuhistory_deferred[origin];
+    cpuhistory_t line;
+
     if (machine_is_jammed()) {
         return;
     }
 
-    ++cpuhistory_i;
-    if (cpuhistory_i == cpuhistory_buffer_lines) {
-        cpuhistory_i = 0;
+    line.cycle = cycle;
+    line.addr = addr;
+    line.op = op;
+    line.p1 = p1;
+    line.p2 = p2;
+    line.reg_a = reg_a;
+    line.reg_x = reg_x;
+    line.reg_y = reg_y;
+    line.reg_sp = reg_sp;
+    line.reg_st = reg_st;
+    line.origin = origin;
+
+    if (deferred->active) {
+        if (deferred->num == deferred->size) {
+            deferred->size = deferred->size ? deferred->size * 2 : 0x1000;
+            deferred->lines = lib_realloc(deferred->lines,
+                                          (size_t)deferred->size * sizeof(cpuhistory_t));
+        }
+        deferred->lines[deferred->num++] = line;
+        return;
     }
-    cpuhistory[cpuhistory_i].cycle = cycle;
-    cpuhistory[cpuhistory_i].addr = addr;
-    cpuhistory[cpuhistory_i].op = op;
-    cpuhistory[cpuhistory_i].p1 = p1;
-    cpuhistory[cpuhistory_i].p2 = p2;
-    cpuhistory[cpuhistory_i].reg_a = reg_a;
-    cpuhistory[cpuhistory_i].reg_x = reg_x;
-    cpuhistory[cpuhistory_i].reg_y = reg_y;
-    cpuhistory[cpuhistory_i].reg_sp = reg_sp;
-    cpuhistory[cpuhistory_i].reg_st = reg_st;
-    cpuhistory[cpuhistory_i].origin = origin;
+
+    cpuhistory_append(&line);
+}
+
+/* Start buffering the history of `origin', see cpuhistory_deferred_t */
+void monitor_cpuhistory_begin_deferred(MEMSPACE origin)
+{
+    cpuhistory_deferred[origin].num = 0;
+    cpuhistory_deferred[origin].active = 1;
+}
+
+/* Add the buffered history of `origin' to the ring and stop buffering */
+void monitor_cpuhistory_end_deferred(MEMSPACE origin)
+{
+    cpuhistory_deferred_t *deferred = &cpuhistory_deferred[origin];
+    int i;
+
+    deferred->active = 0;
+    for (i = 0; i < deferred->num; i++) {
+        cpuhistory_append(&deferred->lines[i]);
+    }
+    deferred->num = 0;
 }
 
 void monitor_cpuhistory_fix_p2(unsigned int p2)
 {
     cpuhistory[cpuhistory_i].p2 = p2;
+
+    if (monitor_binary_trace_flags) {
+        monitor_binary_trace_fix_p2(p2);
+    }
 }
 
 cpuhistory_t *mon_cpuhistory_seek(int count, MEMSPACE filter1, MEMSPACE filter2,
@@ -391,6 +457,10 @@ void monitor_memmap_store(unsigned int addr, unsigned int type)
         }
     }
     mon_memmap[addr & mon_memmap_mask] |= type;
+
+    if (monitor_binary_trace_flags) {
+        monitor_binary_trace_memory(addr, type);
+    }
 }
 
 void mon_memmap_save(const char *filename, int format)
@@ -459,11 +529,18 @@ void mon_memmap_init(void)
 
 void mon_memmap_shutdown(void)
 {
+    int i;
+
     lib_free(mon_memmap);
     mon_memmap = NULL;
     if (cpuhistory != NULL) {
         lib_free(cpuhistory);
     }
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        lib_free(cpuhistory_deferred[i].lines);
+        cpuhistory_deferred[i].lines = NULL;
+        cpuhistory_deferred[i].size = 0;
+    }
 }
 
 
@@ -504,4 +581,12 @@ void mon_memmap_shutdown(void)
 {
 }
 
+void monitor_cpuhistory_begin_deferred(MEMSPACE origin)
+{
+}
+
+void monitor_cpuhistory_end_deferred(MEMSPACE origin)
+{
+}
+
 #endif
@@ -498,8 +498,11 @@ char *uimon_in(const char *prompt)
         if (!monitor_is_binary()) {
             monitor_check_binary();
         } else {
+            /* NULL if the binary monitor has its own I/O thread */
             sockfd[sockfd_index] = monitor_binary_get_connected_socket();
-            sockfd_index++;
+            if (sockfd[sockfd_index] != NULL) {
+                sockfd_index++;
+            }
         }
 
         sockfd[sockfd_index] = NULL;
@@ -907,11 +907,31 @@ uint8_t mon_get_mem_val_nosfx(MEMSPACE mem, uint16_t mem_config, uint16_t mem_ad
     return mon_get_mem_val_ex_nosfx(mem, mon_interfaces[mem]->current_bank, mem_addr);
 }
 
+/* reads end + 1 bytes from start on, same as mon_get_mem_val_ex() for each */
 void mon_get_mem_block_ex(MEMSPACE mem, int bank, uint16_t start, uint16_t end, uint8_t *data)
 {
+    monitor_interface_t *iface = mon_interfaces[mem];
+    uint8_t (*read_func)(int bank, uint16_t addr, void *context);
     int i;
+
+    if (monitor_diskspace_dnr(mem) >= 0) {
+        if (!check_drive_emu_level_ok(monitor_diskspace_dnr(mem) + 8)) {
+            memset(data, 0, (size_t)end + 1);
+            return;
+        }
+    }
+
+    if ((sidefx == 0) && (iface->mem_bank_peek != NULL)) {
+        read_func = iface->mem_bank_peek;
+    } else {
+        if (sidefx == 0) {
+            log_error(LOG_DEFAULT, "mon_get_mem_block_ex: mem_bank_peek() not implemented for memspace %u.", mem);
+        }
+        read_func = iface->mem_bank_read;
+    }
+
     for (i = 0; i <= end; i++) {
-        data[i] = mon_get_mem_val_ex(mem, bank, (uint16_t)(start + i));
+        data[i] = read_func(bank, (uint16_t)(start + i), iface->context);
     }
 }
 
@@ -2804,6 +2824,10 @@ void monitor_watch_push_load_addr(uint16_t addr, MEMSPACE mem)
         return;
     }
 
+    if (!mon_breakpoint_has_checkpoint(mem, addr, e_load)) {
+        return;
+    }
+
     if (watch_load_count[mem] == MONITOR_MAX_CHECKPOINTS) {
         return;
     }
@@ -2819,6 +2843,10 @@ void monitor_watch_push_store_addr(uint16_t addr, MEMSPACE mem)
         return;
     }
 
+    if (!mon_breakpoint_has_checkpoint(mem, addr, e_store)) {
+        return;
+    }
+
     if (watch_store_count[mem] == MONITOR_MAX_CHECKPOINTS) {
         return;
     }
@@ -32,6 +32,11 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include "archdep_defs.h"
 #include "cmdline.h"
@@ -42,6 +47,7 @@
 #include "kbdbuf.h"
 #include "monitor.h"
 #include "monitor_binary.h"
+#include "monitor_network.h"
 #include "montypes.h"
 #include "resources.h"
 #include "uiapi.h"
@@ -52,6 +58,7 @@
 #include "machine-video.h"
 #include "palette.h"
 
+#include "mon_memget_multi.h"
 #include "mon_memmap.h"
 #include "mon_breakpoint.h"
 #include "mon_file.h"
@@ -79,11 +86,66 @@ static vice_network_socket_t * connected_socket = NULL;
 static char *monitor_binary_server_address = NULL;
 static int monitor_binary_enabled = 0;
 
+/* Large responses are built in this buffer behind room for the header, so
+   they can be sent with a single call and without another copy */
+static unsigned char *response_buffer = NULL;
+static size_t response_buffer_size = 0;
+
+#ifdef HAVE_PTHREAD_H
+/* With pthreads, the sockets are serviced by an I/O thread. It accepts the
+   connection, reads the commands and queues them for the emulation thread,
+   which only has to check a flag at its poll points. Queries that don't touch
+   the machine are answered by the I/O thread right away.
+
+   Each connection gets a new id. The emulation thread keeps what it set up
+   for a connection (trace, response buffer) together with the id, and drops
+   it once that connection is gone, even if the next one was accepted and
+   sent commands in the meantime. */
+
+/* A command waiting for the emulation thread */
+typedef struct binary_command_queue_entry_s {
+    unsigned char *buffer;
+    unsigned int connection;    /* id of the connection it came from */
+    struct binary_command_queue_entry_s *next;
+} binary_command_queue_entry_t;
+
+static pthread_t io_thread;
+static bool io_thread_running = false;
+
+/* protects the queue and the connection state below */
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when a command was queued or the connection was lost */
+static pthread_cond_t io_cond = PTHREAD_COND_INITIALIZER;
+/* held while sending, and while connected_socket is changed */
+static pthread_mutex_t send_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static binary_command_queue_entry_t *command_queue_head = NULL;
+static binary_command_queue_entry_t *command_queue_tail = NULL;
+static unsigned int commands_in_flight = 0;     /* queued or being processed */
+static bool io_thread_quit = false;
+static unsigned int io_connection = 0;          /* id of the last connection */
+static bool io_connection_open = false;
+
+/* wakes up the I/O thread, to quit */
+static vice_network_socket_t *io_wakeup = NULL;
+/* readable while commands are queued, the monitor waits on it together
+   with the text monitor connection */
+static vice_network_socket_t *command_wakeup = NULL;
+
+/* connection the emulation thread holds state for, 0 for none; only used
+   by the emulation thread */
+static unsigned int state_connection = 0;
+
+/* set when commands are queued, read without lock at the poll points */
+static volatile int commands_queued = 0;
+#endif
+
 enum t_binary_command {
     e_MON_CMD_INVALID = 0x00,
 
     e_MON_CMD_MEM_GET = 0x01,
     e_MON_CMD_MEM_SET = 0x02,
+    e_MON_CMD_MEM_GET_MULTI = 0x03,
 
     e_MON_CMD_CHECKPOINT_GET = 0x11,
     e_MON_CMD_CHECKPOINT_SET = 0x12,
@@ -112,6 +174,7 @@ enum t_binary_command {
     e_MON_CMD_DISPLAY_GET = 0x84,
     e_MON_CMD_VICE_INFO = 0x85,
     e_MON_CMD_CPUHISTORY_GET = 0x86,
+    e_MON_CMD_TRACE_SET = 0x87,
 
     e_MON_CMD_PALETTE_GET = 0x91,
 
@@ -130,6 +193,7 @@ enum t_binary_response {
     e_MON_RESPONSE_INVALID = 0x00,
     e_MON_RESPONSE_MEM_GET = 0x01,
     e_MON_RESPONSE_MEM_SET = 0x02,
+    e_MON_RESPONSE_MEM_GET_MULTI = 0x03,
 
     e_MON_RESPONSE_CHECKPOINT_INFO = 0x11,
 
@@ -161,6 +225,8 @@ enum t_binary_response {
     e_MON_RESPONSE_DISPLAY_GET = 0x84,
     e_MON_RESPONSE_VICE_INFO = 0x85,
     e_MON_RESPONSE_CPUHISTORY_GET = 0x86,
+    e_MON_RESPONSE_TRACE_SET = 0x87,
+    e_MON_RESPONSE_TRACE_DATA = 0x88,
 
     e_MON_RESPONSE_PALETTE_GET = 0x91,
 
@@ -207,7 +273,8 @@ struct binary_command_s {
 };
 typedef struct binary_command_s binary_command_t;
 
-int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
+/* send with send_lock held */
+static int transmit_unlocked(const unsigned char *buffer, size_t buffer_length)
 {
     int error = 0;
 
@@ -224,13 +291,53 @@ int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
     return error;
 }
 
-static void monitor_binary_quit(void)
+int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
+    int error;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&send_lock);
+#endif
+    error = transmit_unlocked(buffer, buffer_length);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&send_lock);
+#endif
+
+    return error;
+}
+
+static void monitor_binary_trace_stop(void);
+
+/* drop what belonged to the connection, on the emulation thread */
+static void monitor_binary_connection_cleanup(void)
+{
+    monitor_binary_trace_stop();
+
+    lib_free(response_buffer);
+    response_buffer = NULL;
+    response_buffer_size = 0;
+}
+
+static void monitor_binary_close_connection(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&send_lock);
+#endif
     vice_network_socket_close(connected_socket);
     connected_socket = NULL;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&send_lock);
+#endif
 }
 
-ssize_t monitor_binary_receive(unsigned char *buffer, size_t buffer_length)
+static void monitor_binary_quit(void)
+{
+    monitor_binary_close_connection();
+    monitor_binary_connection_cleanup();
+}
+
+/* receive buffer_length bytes, returns less if the connection failed */
+static ssize_t receive_all(unsigned char *buffer, size_t buffer_length)
 {
     ssize_t bytes_received = 0;
     ssize_t total_bytes_received = 0;
@@ -242,7 +349,6 @@ ssize_t monitor_binary_receive(unsigned char *buffer, size_t buffer_length)
             log_message(LOG_DEFAULT,
                         "monitor_binary_receive(): vice_network_receive() returned %"PRI_SSIZE_T", breaking connection",
                         bytes_received);
-            monitor_binary_quit();
             break;
         }
 
@@ -260,6 +366,17 @@ ssize_t monitor_binary_receive(unsigned char *buffer, size_t buffer_length)
     return total_bytes_received;
 }
 
+ssize_t monitor_binary_receive(unsigned char *buffer, size_t buffer_length)
+{
+    ssize_t total_bytes_received = receive_all(buffer, buffer_length);
+
+    if (total_bytes_received < (ssize_t)buffer_length) {
+        monitor_binary_quit();
+    }
+
+    return total_bytes_received;
+}
+
 static int monitor_binary_data_available(void)
 {
     int available = 0;
@@ -278,8 +395,55 @@ static int monitor_binary_data_available(void)
     return available;
 }
 
+#ifdef HAVE_PTHREAD_H
+/* drop the state of a connection closed by the I/O thread */
+static void monitor_binary_check_connection_lost(void)
+{
+    bool open;
+
+    if (state_connection == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&io_lock);
+    open = io_connection_open && io_connection == state_connection;
+    pthread_mutex_unlock(&io_lock);
+
+    if (!open) {
+        monitor_binary_connection_cleanup();
+        state_connection = 0;
+    }
+}
+
+/* called before running a command of `connection' */
+static void monitor_binary_set_state_connection(unsigned int connection)
+{
+    if (state_connection != connection) {
+        if (state_connection != 0) {
+            /* the previous connection is gone */
+            monitor_binary_connection_cleanup();
+        }
+        state_connection = connection;
+    }
+}
+#endif
+
 void monitor_check_binary(void)
 {
+#ifdef HAVE_PTHREAD_H
+    if (io_thread_running) {
+        monitor_binary_check_connection_lost();
+        monitor_binary_trace_flush();
+
+        if (commands_queued) {
+            monitor_startup_trap();
+        }
+        return;
+    }
+#endif
+
+    monitor_binary_trace_flush();
+
     if (monitor_binary_data_available()) {
         monitor_startup_trap();
     }
@@ -336,22 +500,55 @@ static uint16_t little_endian_to_uint16(unsigned char *input) {
     return (input[1] << 8) + input[0];
 }
 
+#define MON_RESPONSE_HEADER_SIZE 12
+
+static void write_response_header(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *output)
+{
+    output[0] = ASC_STX;
+    output[1] = MON_BINARY_API_VERSION;
+    write_uint32(length, &output[2]);
+    output[6] = (uint8_t)response_type;
+    output[7] = (uint8_t)errorcode;
+    write_uint32(request_id, &output[8]);
+}
+
 static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *body)
 {
-    unsigned char response[12];
+    unsigned char response[MON_RESPONSE_HEADER_SIZE];
 
-    response[0] = ASC_STX;
-    response[1] = MON_BINARY_API_VERSION;
-    write_uint32(length, &response[2]);
-    response[6] = (uint8_t)response_type;
-    response[7] = (uint8_t)errorcode;
-    write_uint32(request_id, &response[8]);
+    write_response_header(length, response_type, errorcode, request_id, response);
 
-    monitor_binary_transmit(response, sizeof response);
+    /* the I/O thread may answer queries, don't let them get in between */
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&send_lock);
+#endif
+    transmit_unlocked(response, sizeof response);
 
     if (body != NULL) {
-        monitor_binary_transmit(body, length);
+        transmit_unlocked(body, length);
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&send_lock);
+#endif
+}
+
+/*! \internal \brief Get the buffer for the body of a response sent with
+                      monitor_binary_response_send() */
+static unsigned char *monitor_binary_response_body(size_t length)
+{
+    if (response_buffer_size < MON_RESPONSE_HEADER_SIZE + length) {
+        response_buffer_size = MON_RESPONSE_HEADER_SIZE + length;
+        response_buffer = lib_realloc(response_buffer, response_buffer_size);
     }
+    return response_buffer + MON_RESPONSE_HEADER_SIZE;
+}
+
+/*! \internal \brief Send the response built in monitor_binary_response_body() */
+static void monitor_binary_response_send(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id)
+{
+    write_response_header(length, response_type, errorcode, request_id, response_buffer);
+
+    monitor_binary_transmit(response_buffer, MON_RESPONSE_HEADER_SIZE + length);
 }
 
 static void monitor_binary_error(BINARY_ERROR errorcode, uint32_t request_id)
@@ -487,6 +684,9 @@ static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE
 
 /*! \internal \brief called when the monitor is opened */
 void monitor_binary_event_opened(void) {
+    /* the client should have the whole trace up to the stop */
+    monitor_binary_trace_flush();
+
     /* FIXME */
     monitor_binary_response_register_info(MON_EVENT_ID, e_comp_space);
     monitor_binary_response_stopped(MON_EVENT_ID);
@@ -1271,7 +1471,7 @@ static void monitor_binary_process_display_get(binary_command_t *command)
 
     buffer_length = screenshot.debug_width * screenshot.debug_height * depth / 8;
     response_length = 4 + info_length + buffer_length;
-    response = lib_malloc(response_length);
+    response = monitor_binary_response_body(response_length);
     response_cursor = response;
 
     /* Length of fields before display buffer */
@@ -1303,9 +1503,7 @@ static void monitor_binary_process_display_get(binary_command_t *command)
         response_cursor += screenshot.debug_width * depth / 8;
     }
 
-    monitor_binary_response(response_length, e_MON_RESPONSE_DISPLAY_GET, e_MON_ERR_OK, command->request_id, response);
-
-    lib_free(response);
+    monitor_binary_response_send(response_length, e_MON_RESPONSE_DISPLAY_GET, e_MON_ERR_OK, command->request_id);
 }
 
 static void monitor_binary_process_palette_get(binary_command_t *command)
@@ -1614,6 +1812,270 @@ static void monitor_binary_process_cpuhistory(binary_command_t *command)
 }
 #endif /* FEATURE_CPUMEMHISTORY */
 
+/* ------------------------------------------------------------------------- */
+/* Trace streaming
+
+   While a trace is active, monitor_cpuhistory_store() and
+   monitor_memmap_store() append records to a ring buffer, which is sent to
+   the client in MON_RESPONSE_TRACE_DATA events once per frame, and when the
+   monitor is entered. Producer and consumer both run on the emulation thread,
+   so the ring needs no locking: the producer only moves trace_head and the
+   consumer only moves trace_tail. Drive CPUs running on worker threads (see
+   DriveThreads) do not write to the ring, their instructions are buffered
+   per unit and added by monitor_cpuhistory_end_deferred() on the emulation
+   thread after the workers are joined, unit by unit. Records of different
+   CPUs are therefore grouped per drive run, not sorted by cycle. */
+
+#define MON_TRACE_INSTRUCTIONS      0x01    /* record executed instructions */
+#define MON_TRACE_MEMORY            0x02    /* record memory accesses */
+#define MON_TRACE_BLOCK             0x04    /* wait for the client instead of dropping */
+
+#define MON_TRACE_RECORD_INSTRUCTION        0x00
+#define MON_TRACE_RECORD_MEMORY             0x01
+
+#define MON_TRACE_RECORD_INSTRUCTION_SIZE   20
+#define MON_TRACE_RECORD_MEMORY_SIZE        6
+
+#define MON_TRACE_DEFAULT_RECORDS   0x10000
+#define MON_TRACE_MAX_RECORDS       0x400000
+
+typedef struct trace_record_s {
+    CLOCK cycle;
+    uint16_t addr;
+    uint16_t access;    /* MEMMAP_* flags of a memory record */
+    uint8_t type;
+    uint8_t memspace;
+    uint8_t op;
+    uint8_t p1;
+    uint8_t p2;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t reg_sp;
+    uint8_t reg_st;
+} trace_record_t;
+
+/* MON_TRACE_* flags of the active trace, 0 if none */
+unsigned int monitor_binary_trace_flags = 0;
+
+static trace_record_t *trace_ring = NULL;
+static unsigned int trace_ring_mask = 0;
+static unsigned int trace_head = 0;
+static unsigned int trace_tail = 0;
+static unsigned int trace_last_instruction = 0;
+static uint32_t trace_dropped = 0;
+static unsigned int trace_memspaces = 0;    /* bit n set: trace MEMSPACE n */
+static uint16_t trace_start_addr = 0;
+static uint16_t trace_end_addr = 0;
+
+/*! \internal \brief Send the buffered trace records to the client */
+void monitor_binary_trace_flush(void)
+{
+    unsigned char *body, *cursor;
+    unsigned int count = trace_head - trace_tail;
+
+    if (count == 0 && trace_dropped == 0) {
+        return;
+    }
+
+    body = monitor_binary_response_body(8 + (size_t)count * MON_TRACE_RECORD_INSTRUCTION_SIZE);
+
+    cursor = write_uint32(trace_dropped, body);
+    cursor = write_uint32(count, cursor);
+
+    while (trace_tail != trace_head) {
+        trace_record_t *record = &trace_ring[trace_tail & trace_ring_mask];
+
+        *cursor++ = record->type;
+        *cursor++ = record->memspace;
+        cursor = write_uint16(record->addr, cursor);
+        if (record->type == MON_TRACE_RECORD_MEMORY) {
+            cursor = write_uint16(record->access, cursor);
+        } else {
+            *cursor++ = record->op;
+            *cursor++ = record->p1;
+            *cursor++ = record->p2;
+            *cursor++ = record->reg_a;
+            *cursor++ = record->reg_x;
+            *cursor++ = record->reg_y;
+            *cursor++ = record->reg_sp;
+            *cursor++ = record->reg_st;
+            cursor = write_uint64(record->cycle, cursor);
+        }
+        trace_tail++;
+    }
+    trace_dropped = 0;
+
+    monitor_binary_response_send((uint32_t)(cursor - body), e_MON_RESPONSE_TRACE_DATA,
+                                 e_MON_ERR_OK, MON_EVENT_ID);
+}
+
+/* Get a free record, or NULL if the ring is full and records get dropped */
+static trace_record_t *trace_record_new(void)
+{
+    if (trace_head - trace_tail > trace_ring_mask) {
+        if (!(monitor_binary_trace_flags & MON_TRACE_BLOCK)) {
+            trace_dropped++;
+            return NULL;
+        }
+        /* send blocks until the client has read enough, which holds up the
+           emulation */
+        monitor_binary_trace_flush();
+    }
+    return &trace_ring[trace_head & trace_ring_mask];
+}
+
+/*! \internal \brief Add an instruction to the trace, see monitor_cpuhistory_store() */
+void monitor_binary_trace_instruction(CLOCK cycle, unsigned int addr, unsigned int op,
+                                      unsigned int p1, unsigned int p2,
+                                      uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                                      uint8_t reg_sp, unsigned int reg_st,
+                                      MEMSPACE origin)
+{
+    trace_record_t *record;
+
+    if (!(monitor_binary_trace_flags & MON_TRACE_INSTRUCTIONS)
+        || !(trace_memspaces & (1u << origin))
+        || addr < trace_start_addr || addr > trace_end_addr) {
+        return;
+    }
+
+    record = trace_record_new();
+    if (record == NULL) {
+        return;
+    }
+    record->type = MON_TRACE_RECORD_INSTRUCTION;
+    record->memspace = memspace_to_uint8_t(origin);
+    record->addr = (uint16_t)addr;
+    record->op = (uint8_t)op;
+    record->p1 = (uint8_t)p1;
+    record->p2 = (uint8_t)p2;
+    record->reg_a = reg_a;
+    record->reg_x = reg_x;
+    record->reg_y = reg_y;
+    record->reg_sp = reg_sp;
+    record->reg_st = (uint8_t)reg_st;
+    record->cycle = cycle;
+    trace_last_instruction = trace_head++;
+}
+
+/*! \internal \brief Fix the JSR operand of the last traced instruction,
+                      see monitor_cpuhistory_fix_p2() */
+void monitor_binary_trace_fix_p2(unsigned int p2)
+{
+    /* only if it was not sent yet */
+    if (trace_last_instruction - trace_tail < trace_head - trace_tail) {
+        trace_ring[trace_last_instruction & trace_ring_mask].p2 = (uint8_t)p2;
+    }
+}
+
+/*! \internal \brief Add a main CPU memory access to the trace, see
+                      monitor_memmap_store() */
+void monitor_binary_trace_memory(unsigned int addr, unsigned int type)
+{
+    trace_record_t *record;
+
+    if (!(monitor_binary_trace_flags & MON_TRACE_MEMORY)
+        || !(trace_memspaces & (1u << e_comp_space))
+        || addr < trace_start_addr || addr > trace_end_addr) {
+        return;
+    }
+
+    record = trace_record_new();
+    if (record == NULL) {
+        return;
+    }
+    record->type = MON_TRACE_RECORD_MEMORY;
+    record->memspace = memspace_to_uint8_t(e_comp_space);
+    record->addr = (uint16_t)addr;
+    record->access = (uint16_t)type;
+    trace_head++;
+}
+
+static void monitor_binary_trace_stop(void)
+{
+    monitor_binary_trace_flags = 0;
+    lib_free(trace_ring);
+    trace_ring = NULL;
+    trace_ring_mask = 0;
+    trace_head = trace_tail = 0;
+    trace_dropped = 0;
+}
+
+#ifdef FEATURE_CPUMEMHISTORY
+static void monitor_binary_process_trace_set(binary_command_t *command)
+{
+    unsigned char *body = command->body;
+    uint8_t flags;
+    uint8_t requested_memspaces;
+    uint16_t start_addr;
+    uint16_t end_addr;
+    uint32_t requested_records;
+    unsigned int memspaces = 0;
+    unsigned int records;
+    int i;
+
+    if (command->length < 10) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    flags = body[0];
+    requested_memspaces = body[1];
+    start_addr = little_endian_to_uint16(&body[2]);
+    end_addr = little_endian_to_uint16(&body[4]);
+    requested_records = little_endian_to_uint32(&body[6]);
+
+    /* send what was recorded with the old settings */
+    monitor_binary_trace_flush();
+    monitor_binary_trace_stop();
+
+    if (!(flags & (MON_TRACE_INSTRUCTIONS | MON_TRACE_MEMORY))) {
+        monitor_binary_response(0, e_MON_RESPONSE_TRACE_SET, e_MON_ERR_OK, command->request_id, NULL);
+        return;
+    }
+
+    for (i = 0; i < 8; i++) {
+        if (requested_memspaces & (1 << i)) {
+            MEMSPACE memspace = get_requested_memspace((uint8_t)i);
+
+            if (memspace == e_invalid_space) {
+                monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+                log_message(LOG_DEFAULT, "monitor binary trace: Unknown memspace %d", i);
+                return;
+            }
+            memspaces |= 1u << memspace;
+        }
+    }
+
+    if (requested_records == 0) {
+        requested_records = MON_TRACE_DEFAULT_RECORDS;
+    }
+    if (memspaces == 0 || start_addr > end_addr || requested_records > MON_TRACE_MAX_RECORDS) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        return;
+    }
+
+    /* the ring is indexed with a mask */
+    for (records = 1; records < requested_records; records <<= 1) {
+    }
+
+    trace_ring = lib_malloc(records * sizeof(trace_record_t));
+    trace_ring_mask = records - 1;
+    trace_memspaces = memspaces;
+    trace_start_addr = start_addr;
+    trace_end_addr = end_addr;
+    monitor_binary_trace_flags = flags;
+
+    monitor_binary_response(0, e_MON_RESPONSE_TRACE_SET, e_MON_ERR_OK, command->request_id, NULL);
+}
+#else
+static void monitor_binary_process_trace_set(binary_command_t *command)
+{
+    monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+}
+#endif /* FEATURE_CPUMEMHISTORY */
+
 static void monitor_binary_process_mem_get(binary_command_t *command)
 {
     unsigned char *response;
@@ -1666,7 +2128,7 @@ static void monitor_binary_process_mem_get(binary_command_t *command)
 
     response_size += length;
 
-    response = lib_malloc(response_size);
+    response = monitor_binary_response_body(response_size);
     response_cursor = response;
 
     response_cursor = write_uint16(length, response_cursor);
@@ -1675,11 +2137,91 @@ static void monitor_binary_process_mem_get(binary_command_t *command)
     mon_get_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, response_cursor);
     sidefx = old_sidefx;
 
-    response_cursor += length;
+    monitor_binary_response_send(response_size, e_MON_RESPONSE_MEM_GET, e_MON_ERR_OK, command->request_id);
+}
 
-    monitor_binary_response(response_size, e_MON_RESPONSE_MEM_GET, e_MON_ERR_OK, command->request_id, response);
+static void monitor_binary_process_mem_get_multi(binary_command_t *command)
+{
+    unsigned char *response;
+    unsigned char *response_cursor;
+    unsigned char *range;
 
-    lib_free(response);
+    const int header_size = 3;
+    const int range_size = MON_MEMGET_MULTI_RANGE_SIZE;
+    uint32_t response_size;
+    int old_sidefx = sidefx;
+    uint16_t i;
+
+    unsigned char *body = command->body;
+
+    uint8_t new_sidefx;
+    uint16_t count;
+
+    if (command->length < header_size) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    new_sidefx = body[0];
+    count = little_endian_to_uint16(&body[1]);
+
+    if (command->length < header_size + count * range_size) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    /* check all ranges before reading any, so the response is all or nothing */
+    for (i = 0, range = &body[header_size]; i < count; i++, range += range_size) {
+        uint16_t startaddress = little_endian_to_uint16(&range[0]);
+        uint16_t endaddress = little_endian_to_uint16(&range[2]);
+        MEMSPACE memspace = get_requested_memspace(range[4]);
+        uint16_t requested_banknum = little_endian_to_uint16(&range[5]);
+
+        if (startaddress > endaddress) {
+            monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary memget multi: wrong start and/or end address %04x - %04x",
+                        startaddress, endaddress);
+            return;
+        }
+
+        if (memspace == e_invalid_space) {
+            monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary memget multi: Unknown memspace %u", range[4]);
+            return;
+        }
+
+        if (mon_banknum_validate(memspace, requested_banknum) == 0) {
+            monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary memget multi: Unknown bank %u", requested_banknum);
+            return;
+        }
+    }
+
+    response_size = mon_memget_multi_response_size(&body[header_size], count);
+    if (response_size == 0) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary memget multi: request too big (%u ranges), at most %d ranges and %d bytes",
+                    count, MON_MEMGET_MULTI_MAX_RANGES, MON_MEMGET_MULTI_MAX_SIZE);
+        return;
+    }
+
+    response = monitor_binary_response_body(response_size);
+    response_cursor = write_uint16(count, response);
+
+    sidefx = !!new_sidefx;
+    for (i = 0, range = &body[header_size]; i < count; i++, range += range_size) {
+        uint16_t startaddress = little_endian_to_uint16(&range[0]);
+        uint16_t endaddress = little_endian_to_uint16(&range[2]);
+        uint32_t length = (endaddress + 1) - startaddress;
+
+        response_cursor = write_uint32(length, response_cursor);
+        mon_get_mem_block_ex(get_requested_memspace(range[4]), little_endian_to_uint16(&range[5]),
+                             startaddress, endaddress - startaddress, response_cursor);
+        response_cursor += length;
+    }
+    sidefx = old_sidefx;
+
+    monitor_binary_response_send(response_size, e_MON_RESPONSE_MEM_GET_MULTI, e_MON_ERR_OK, command->request_id);
 }
 
 static void monitor_binary_process_mem_set(binary_command_t *command)
@@ -1775,6 +2317,8 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_mem_get(&command);
     } else if (command_type == e_MON_CMD_MEM_SET) {
         monitor_binary_process_mem_set(&command);
+    } else if (command_type == e_MON_CMD_MEM_GET_MULTI) {
+        monitor_binary_process_mem_get_multi(&command);
 
     } else if (command_type == e_MON_CMD_CHECKPOINT_GET) {
         monitor_binary_process_checkpoint_get(&command);
@@ -1831,6 +2375,8 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_vice_info(&command);
     } else if (command_type == e_MON_CMD_CPUHISTORY_GET) {
         monitor_binary_process_cpuhistory(&command);
+    } else if (command_type == e_MON_CMD_TRACE_SET) {
+        monitor_binary_process_trace_set(&command);
 
     } else if (command_type == e_MON_CMD_EXIT) {
         monitor_binary_process_exit(&command);
@@ -1852,124 +2398,395 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
     pbuffer[0] = 0;
 }
 
-static int monitor_binary_activate(void)
+/*! \internal \brief Read one command from the connection
+
+ \param[in,out] buffer       command buffer, grown as needed
+ \param[in,out] buffer_size  size of the command buffer
+
+ \return 1 if a command was read, 0 if the connection failed, -1 if the data
+         was not the start of a command and got skipped
+*/
+static int monitor_binary_read_command(unsigned char **buffer, size_t *buffer_size)
 {
-    vice_network_socket_address_t * server_addr = NULL;
-    int error = 1;
+    uint32_t body_length;
+    uint8_t api_version;
+    unsigned int remaining_header_size = 5;
+    unsigned int command_size;
 
-    do {
-        if (!monitor_binary_server_address) {
-            break;
+    if (!*buffer) {
+        *buffer = lib_malloc(300);
+        *buffer_size = 300;
+    }
+
+    if (receive_all(*buffer, 1) < 1) {
+        return 0;
+    }
+
+    if ((*buffer)[0] != ASC_STX) {
+        return -1;
+    }
+
+    if (receive_all(&(*buffer)[1], sizeof(api_version) + sizeof(body_length))
+        < (ssize_t)(sizeof(api_version) + sizeof(body_length))) {
+        return 0;
+    }
+
+    api_version = (*buffer)[1];
+    body_length = little_endian_to_uint32(&(*buffer)[2]);
+
+    if (api_version >= 0x01 && api_version <= 0x02) {
+        remaining_header_size = 5;
+    } else {
+        return -1;
+    }
+
+    command_size = sizeof(api_version) + sizeof(body_length) + remaining_header_size + body_length + 1;
+    if (*buffer_size < command_size + 1) {
+        *buffer = lib_realloc(*buffer, command_size + 1);
+        *buffer_size = command_size + 1;
+    }
+
+    if (receive_all(&(*buffer)[6], remaining_header_size + body_length)
+        < (ssize_t)(remaining_header_size + body_length)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+#ifdef HAVE_PTHREAD_H
+/* Take the next queued command and the id of its connection, waiting up to
+   `wait_ms' if there is none. The caller frees the buffer. */
+static unsigned char *monitor_binary_dequeue_command(int wait_ms, unsigned int *connection)
+{
+    binary_command_queue_entry_t *entry;
+    unsigned char *buffer = NULL;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&io_lock);
+    if (command_queue_head == NULL && wait_ms > 0 && connected_socket != NULL) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += wait_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&io_cond, &io_lock, &deadline);
+    }
+    entry = command_queue_head;
+    if (entry != NULL) {
+        command_queue_head = entry->next;
+        if (command_queue_head == NULL) {
+            command_queue_tail = NULL;
+            commands_queued = 0;
         }
+        buffer = entry->buffer;
+        *connection = entry->connection;
+        lib_free(entry);
+    }
+    pthread_mutex_unlock(&io_lock);
 
-        server_addr = vice_network_address_generate(monitor_binary_server_address, 0);
-        if (!server_addr) {
+    return buffer;
+}
+
+static void monitor_binary_command_done(void)
+{
+    pthread_mutex_lock(&io_lock);
+    commands_in_flight--;
+    pthread_mutex_unlock(&io_lock);
+}
+
+/* the commands that are answered by the I/O thread, without stopping */
+static bool monitor_binary_is_query(unsigned char *buffer)
+{
+    BINARY_COMMAND command_type = buffer[10];
+
+    return command_type == e_MON_CMD_PING || command_type == e_MON_CMD_VICE_INFO;
+}
+
+static void monitor_binary_process_query(unsigned char *buffer)
+{
+    binary_command_t command;
+
+    command.api_version = buffer[1];
+    command.length = little_endian_to_uint32(&buffer[2]);
+    command.request_id = little_endian_to_uint32(&buffer[6]);
+    command.type = buffer[10];
+    command.body = &buffer[11];
+
+    if (command.type == e_MON_CMD_PING) {
+        monitor_binary_process_ping(&command);
+    } else {
+        monitor_binary_process_vice_info(&command);
+    }
+}
+
+static void monitor_binary_io_connection_lost(void)
+{
+    binary_command_queue_entry_t *entry;
+
+    monitor_binary_close_connection();
+
+    pthread_mutex_lock(&io_lock);
+    while (command_queue_head != NULL) {
+        entry = command_queue_head;
+        command_queue_head = entry->next;
+        lib_free(entry->buffer);
+        lib_free(entry);
+        commands_in_flight--;
+    }
+    command_queue_tail = NULL;
+    commands_queued = 0;
+    io_connection_open = false;
+    pthread_cond_signal(&io_cond);
+    pthread_mutex_unlock(&io_lock);
+
+    if (command_wakeup != NULL) {
+        vice_network_wakeup_signal(command_wakeup);
+    }
+}
+
+static void *monitor_binary_io_thread(void *unused)
+{
+    vice_network_socket_t *sockets[3];
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+    binary_command_queue_entry_t *entry;
+    bool quit = false;
+    int ret;
+
+    while (!quit) {
+        sockets[0] = connected_socket != NULL ? connected_socket : listen_socket;
+        sockets[1] = io_wakeup;
+        sockets[2] = NULL;
+        if (sockets[0] == NULL) {
+            /* server disabled and connection closed */
             break;
         }
 
-        listen_socket = vice_network_server(server_addr);
-        if (!listen_socket) {
-            log_error(LOG_DEFAULT,
-                "monitor_binary_activate(): could not initialize listening socket");
-            break;
+        /* times out, so the quit flag is also seen without io_wakeup */
+        if (vice_network_select_multiple(sockets) > 0
+            && vice_network_select_poll_one(sockets[0]) > 0) {
+            if (connected_socket == NULL) {
+                vice_network_socket_t *socket = vice_network_accept(listen_socket);
+
+                pthread_mutex_lock(&send_lock);
+                connected_socket = socket;
+                pthread_mutex_unlock(&send_lock);
+
+                pthread_mutex_lock(&io_lock);
+                io_connection++;
+                if (io_connection == 0) {
+                    io_connection = 1;
+                }
+                io_connection_open = socket != NULL;
+                pthread_mutex_unlock(&io_lock);
+            } else {
+                ret = monitor_binary_read_command(&buffer, &buffer_size);
+                if (ret == 0) {
+                    monitor_binary_io_connection_lost();
+                } else if (ret > 0) {
+                    pthread_mutex_lock(&io_lock);
+                    if (commands_in_flight == 0 && monitor_binary_is_query(buffer)) {
+                        /* nothing it has to wait for */
+                        pthread_mutex_unlock(&io_lock);
+                        monitor_binary_process_query(buffer);
+                    } else {
+                        entry = lib_malloc(sizeof(binary_command_queue_entry_t));
+                        entry->buffer = buffer;
+                        entry->connection = io_connection;
+                        entry->next = NULL;
+                        if (command_queue_tail != NULL) {
+                            command_queue_tail->next = entry;
+                        } else {
+                            command_queue_head = entry;
+                        }
+                        command_queue_tail = entry;
+                        commands_in_flight++;
+                        commands_queued = 1;
+                        pthread_cond_signal(&io_cond);
+                        pthread_mutex_unlock(&io_lock);
+
+                        if (command_wakeup != NULL) {
+                            vice_network_wakeup_signal(command_wakeup);
+                        }
+
+                        buffer = NULL;
+                        buffer_size = 0;
+                    }
+                }
+            }
         }
 
-        error = 0;
-    } while (0);
+        pthread_mutex_lock(&io_lock);
+        quit = io_thread_quit;
+        pthread_mutex_unlock(&io_lock);
+    }
 
-    if (server_addr) {
-        vice_network_address_close(server_addr);
+    lib_free(buffer);
+    return NULL;
+}
+
+static void monitor_binary_io_thread_start(void)
+{
+    if (io_thread_running || (listen_socket == NULL && connected_socket == NULL)) {
+        return;
     }
 
-    return error;
+    /* without them the waits just time out */
+    if (io_wakeup == NULL) {
+        io_wakeup = vice_network_wakeup_open();
+    }
+    if (command_wakeup == NULL) {
+        command_wakeup = vice_network_wakeup_open();
+    }
+
+    pthread_mutex_lock(&io_lock);
+    io_connection_open = connected_socket != NULL;
+    pthread_mutex_unlock(&io_lock);
+
+    io_thread_quit = false;
+    if (pthread_create(&io_thread, NULL, monitor_binary_io_thread, NULL) != 0) {
+        log_error(LOG_DEFAULT, "monitor_binary_io_thread_start(): could not start the I/O thread, polling instead");
+        return;
+    }
+    io_thread_running = true;
 }
 
+static void monitor_binary_io_thread_stop(void)
+{
+    if (!io_thread_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&io_lock);
+    io_thread_quit = true;
+    pthread_mutex_unlock(&io_lock);
+    if (io_wakeup != NULL) {
+        vice_network_wakeup_signal(io_wakeup);
+    }
+
+    pthread_join(io_thread, NULL);
+    io_thread_running = false;
+
+    if (io_wakeup != NULL) {
+        vice_network_wakeup_clear(io_wakeup);
+    }
+}
+
+/* process the queued commands */
+static int monitor_binary_get_queued_command_lines(void)
+{
+    unsigned char *buffer;
+    unsigned int connection = 0;
+    /* the caller waits on command_wakeup, and on the text monitor
+       connection if there is one */
+    int wait_ms = (monitor_is_remote() || command_wakeup != NULL) ? 0 : 250;
+
+    /* clear first, a command queued from here on signals again */
+    if (command_wakeup != NULL) {
+        vice_network_wakeup_clear(command_wakeup);
+    }
+
+    monitor_binary_check_connection_lost();
+
+    while ((buffer = monitor_binary_dequeue_command(wait_ms, &connection)) != NULL) {
+        monitor_binary_set_state_connection(connection);
+        monitor_binary_process_command(buffer);
+        lib_free(buffer);
+        monitor_binary_command_done();
+
+        if (exit_mon) {
+            return 0;
+        }
+        wait_ms = 0;
+    }
+
+    return monitor_is_binary();
+}
+#endif
+
 int monitor_binary_get_command_line(void)
 {
     static size_t buffer_size = 0;
     static unsigned char *buffer;
 
+#ifdef HAVE_PTHREAD_H
+    if (io_thread_running) {
+        return monitor_binary_get_queued_command_lines();
+    }
+#endif
+
     while (monitor_binary_data_available()) {
-        uint32_t body_length;
-        uint8_t api_version;
-        unsigned int remaining_header_size = 5;
-        unsigned int command_size;
-        ssize_t n;
-
-        if (!buffer) {
-            buffer = lib_malloc(300);
-            buffer_size = 300;
-        }
+        int ret = monitor_binary_read_command(&buffer, &buffer_size);
 
-        n = monitor_binary_receive(buffer, 1);
-        if (n == 0) {
-            monitor_binary_quit();
-            return 0;
-        } else if (n < 0) {
+        if (ret == 0) {
             monitor_binary_quit();
             return 0;
-        }
-
-        if (buffer[0] != ASC_STX) {
+        } else if (ret < 0) {
             continue;
         }
 
-        n = 0;
-
-        while (n < sizeof(api_version) + sizeof(body_length)) {
-            ssize_t o = monitor_binary_receive(&buffer[1 + n], (sizeof(api_version) + sizeof(body_length)) - n);
-            if (o <= 0) {
-                monitor_binary_quit();
-                return 0;
-            }
+        monitor_binary_process_command(buffer);
 
-            n += o;
+        if (exit_mon) {
+            return 0;
         }
+    }
 
-        api_version = buffer[1];
-        body_length = little_endian_to_uint32(&buffer[2]);
+    return 1;
+}
 
-        if (api_version >= 0x01 && api_version <= 0x02) {
-            remaining_header_size = 5;
-        } else {
-            continue;
-        }
+static int monitor_binary_activate(void)
+{
+    vice_network_socket_address_t * server_addr = NULL;
+    int error = 1;
 
-        command_size = sizeof(api_version) + sizeof(body_length) + remaining_header_size + body_length + 1;
-        if (!buffer || buffer_size < command_size + 1) {
-            buffer = lib_realloc(buffer, command_size + 1);
-            buffer_size = command_size + 1;
+    do {
+        if (!monitor_binary_server_address) {
+            break;
         }
 
-        n = 0;
-
-        while (n < remaining_header_size + body_length) {
-            ssize_t o = monitor_binary_receive(&buffer[6 + n], remaining_header_size + body_length - n);
-            if (o <= 0) {
-                monitor_binary_quit();
-                return 0;
-            }
+        server_addr = vice_network_address_generate(monitor_binary_server_address, 0);
+        if (!server_addr) {
+            break;
+        }
 
-            n += o;
+        listen_socket = vice_network_server(server_addr);
+        if (!listen_socket) {
+            log_error(LOG_DEFAULT,
+                "monitor_binary_activate(): could not initialize listening socket");
+            break;
         }
 
-        monitor_binary_process_command(buffer);
+        error = 0;
+    } while (0);
 
-        if (exit_mon) {
-            return 0;
-        }
+    if (server_addr) {
+        vice_network_address_close(server_addr);
     }
 
-    return 1;
+#ifdef HAVE_PTHREAD_H
+    monitor_binary_io_thread_start();
+#endif
+
+    return error;
 }
 
 static int monitor_binary_deactivate(void)
 {
+#ifdef HAVE_PTHREAD_H
+    monitor_binary_io_thread_stop();
+#endif
+
     if (listen_socket) {
         vice_network_socket_close(listen_socket);
         listen_socket = NULL;
     }
 
+#ifdef HAVE_PTHREAD_H
+    /* keep serving an open connection */
+    monitor_binary_io_thread_start();
+#endif
+
     return 0;
 }
 
@@ -2074,6 +2891,13 @@ int monitor_binary_resources_init(void)
 void monitor_binary_resources_shutdown(void)
 {
     monitor_binary_deactivate();
+#ifdef HAVE_PTHREAD_H
+    monitor_binary_io_thread_stop();
+    vice_network_socket_close(io_wakeup);
+    io_wakeup = NULL;
+    vice_network_socket_close(command_wakeup);
+    command_wakeup = NULL;
+#endif
     monitor_binary_quit();
 
     lib_free(monitor_binary_server_address);
@@ -2109,15 +2933,38 @@ int monitor_binary_cmdline_options_init(void)
 
 int monitor_is_binary(void)
 {
-    return connected_socket != NULL;
+    int connected;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&send_lock);
+#endif
+    connected = connected_socket != NULL;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&send_lock);
+#endif
+
+    return connected;
 }
 
+/*! \brief Get the socket to wait on for commands
+
+ \return the connected socket, or if the I/O thread receives the commands,
+         a socket that is readable while commands are queued. NULL if there
+         is none, monitor_binary_get_command_line() then waits itself.
+*/
 vice_network_socket_t *monitor_binary_get_connected_socket(void) {
+#ifdef HAVE_PTHREAD_H
+    if (io_thread_running) {
+        return command_wakeup;
+    }
+#endif
     return connected_socket;
 }
 
 #else
 
+unsigned int monitor_binary_trace_flags = 0;
+
 int monitor_binary_resources_init(void)
 {
     return 0;
@@ -2136,6 +2983,26 @@ void monitor_check_binary(void)
 {
 }
 
+void monitor_binary_trace_flush(void)
+{
+}
+
+void monitor_binary_trace_instruction(CLOCK cycle, unsigned int addr, unsigned int op,
+                                      unsigned int p1, unsigned int p2,
+                                      uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                                      uint8_t reg_sp, unsigned int reg_st,
+                                      MEMSPACE origin)
+{
+}
+
+void monitor_binary_trace_fix_p2(unsigned int p2)
+{
+}
+
+void monitor_binary_trace_memory(unsigned int addr, unsigned int type)
+{
+}
+
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
     return 0;
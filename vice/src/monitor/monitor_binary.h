@@ -44,6 +44,17 @@ void monitor_binary_event_closed(void);
 
 void monitor_check_binary(void);
 
+extern unsigned int monitor_binary_trace_flags;
+
+void monitor_binary_trace_flush(void);
+void monitor_binary_trace_instruction(CLOCK cycle, unsigned int addr, unsigned int op,
+                                      unsigned int p1, unsigned int p2,
+                                      uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                                      uint8_t reg_sp, unsigned int reg_st,
+                                      MEMSPACE origin);
+void monitor_binary_trace_fix_p2(unsigned int p2);
+void monitor_binary_trace_memory(unsigned int addr, unsigned int type);
+
 ssize_t monitor_binary_receive(unsigned char *buffer, size_t buffer_length);
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length);
 int monitor_binary_get_command_line(void);
@@ -41,6 +41,10 @@
 #include <strings.h>
 #endif
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "archdep.h"
 #include "cmdline.h"
 #include "interrupt.h"
@@ -51,6 +55,7 @@
 #include "mos6510.h"
 #include "network.h"
 #include "resources.h"
+#include "snapshot.h"
 #include "types.h"
 #include "uiapi.h"
 #include "util.h"
@@ -89,7 +94,34 @@ static int network_control;
 static int frame_buffer_full;
 static int current_frame, frame_to_play;
 static event_list_state_t *frame_event_list = NULL;
-static char *snapshotfilename;
+
+/* snapshot received by the client, restored by the connect trap */
+static snapshot_memory_t *client_snapshot = NULL;
+
+/* Data received from the remote host but not yet played back. Each frame is
+   sent as a 4 byte length followed by the event buffer; the remote host runs
+   up to `frame_delta' frames ahead, so more than one frame can be waiting. */
+static uint8_t *recv_queue = NULL;
+static size_t recv_queue_size = 0;
+static size_t recv_queue_len = 0;
+
+/* Snapshot transfer format: the 8 byte header holds the format and the size
+   of the uncompressed snapshot, followed by chunks of (compressed) data, each
+   with a 4 byte length, terminated by an empty chunk. */
+#define SNAPSHOT_FORMAT_RAW  0
+#define SNAPSHOT_FORMAT_ZLIB 1
+
+#define SNAPSHOT_CHUNK_SIZE  0x10000
+
+/* Upper limit for the announced snapshot size, so a broken or hostile peer
+   cannot make us allocate arbitrary amounts of memory.  Well above the
+   largest setup: a C64 with a 64 MiB RAMLink, a 16 MiB REU behind it and
+   the RAM expansions of the drives stays below 100 MiB. */
+#define SNAPSHOT_MAX_SIZE    (128 * 1024 * 1024)
+
+/* Frames of input delay added to the measured one-way latency to absorb
+   jitter on the link. */
+#define NETWORK_JITTER_FRAMES 2
 
 static int set_server_name(const char *val, void *param)
 {
@@ -370,8 +402,9 @@ static ssize_t network_recv_buffer(vice_network_socket_t * s, uint8_t *buf, ssiz
     while (received_total < len) {
         t = vice_network_receive(s, buf, len - received_total, 0);
 
-        if (t < 0) {
-            return t;
+        if (t <= 0) {
+            /* 0 means the remote host closed the connection */
+            return -1;
         }
 
         received_total += t;
@@ -405,6 +438,254 @@ static ssize_t network_send_buffer(vice_network_socket_t * s, const uint8_t *buf
     return 0;
 }
 
+/* Streams the snapshot in `mem' to the remote host. The snapshot is
+   compressed chunk by chunk, so sending overlaps with compressing. */
+static int network_send_snapshot(vice_network_socket_t *s, snapshot_memory_t *mem)
+{
+    const uint8_t *data;
+    size_t len;
+    uint8_t header[8];
+    uint8_t *chunk;
+    size_t out;
+    int ret = 0;
+#ifdef HAVE_ZLIB
+    z_stream zs;
+    int zret;
+#else
+    size_t pos;
+#endif
+
+    data = snapshot_memory_get_data(mem, &len);
+
+#ifdef HAVE_ZLIB
+    util_int_to_le_buf4(header, SNAPSHOT_FORMAT_ZLIB);
+#else
+    util_int_to_le_buf4(header, SNAPSHOT_FORMAT_RAW);
+#endif
+    util_int_to_le_buf4(header + 4, (int)len);
+    if (network_send_buffer(s, header, sizeof(header)) < 0) {
+        return -1;
+    }
+
+    chunk = lib_malloc(4 + SNAPSHOT_CHUNK_SIZE);
+
+#ifdef HAVE_ZLIB
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK) {
+        lib_free(chunk);
+        return -1;
+    }
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)len;
+    do {
+        zs.next_out = chunk + 4;
+        zs.avail_out = SNAPSHOT_CHUNK_SIZE;
+        zret = deflate(&zs, Z_FINISH);
+        if (zret == Z_STREAM_ERROR) {
+            ret = -1;
+            break;
+        }
+        out = SNAPSHOT_CHUNK_SIZE - zs.avail_out;
+        if (out > 0) {
+            util_int_to_le_buf4(chunk, (int)out);
+            if (network_send_buffer(s, chunk, (ssize_t)(4 + out)) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    } while (zret != Z_STREAM_END);
+    deflateEnd(&zs);
+    DBG(("network_send_snapshot: %"PRI_SIZE_T" bytes, %lu compressed",
+         len, (unsigned long)zs.total_out));
+#else
+    for (pos = 0; pos < len; pos += out) {
+        out = len - pos;
+        if (out > SNAPSHOT_CHUNK_SIZE) {
+            out = SNAPSHOT_CHUNK_SIZE;
+        }
+        util_int_to_le_buf4(chunk, (int)out);
+        memcpy(chunk + 4, data + pos, out);
+        if (network_send_buffer(s, chunk, (ssize_t)(4 + out)) < 0) {
+            ret = -1;
+            break;
+        }
+    }
+#endif
+
+    /* empty chunk ends the snapshot */
+    if (ret == 0) {
+        util_int_to_le_buf4(chunk, 0);
+        ret = (int)network_send_buffer(s, chunk, 4);
+    }
+
+    lib_free(chunk);
+    return ret;
+}
+
+/* Receives a snapshot sent with network_send_snapshot() into `mem'. */
+static int network_recv_snapshot(vice_network_socket_t *s, snapshot_memory_t *mem)
+{
+    uint8_t header[8];
+    uint8_t len4[4];
+    uint8_t *data;
+    uint8_t *chunk;
+    unsigned int format;
+    size_t len, chunk_len;
+    size_t pos = 0;
+    int ret = 0;
+#ifdef HAVE_ZLIB
+    z_stream zs;
+    int zret;
+#endif
+
+    if (network_recv_buffer(s, header, sizeof(header)) < 0) {
+        return -1;
+    }
+    format = (unsigned int)util_le_buf4_to_int(header);
+    len = (size_t)util_le_buf4_to_int(header + 4);
+
+#ifdef HAVE_ZLIB
+    if (format != SNAPSHOT_FORMAT_RAW && format != SNAPSHOT_FORMAT_ZLIB) {
+#else
+    if (format != SNAPSHOT_FORMAT_RAW) {
+#endif
+        log_error(LOG_DEFAULT, "network_recv_snapshot: unsupported format %u.", format);
+        return -1;
+    }
+    if (len == 0 || len > SNAPSHOT_MAX_SIZE) {
+        log_error(LOG_DEFAULT, "network_recv_snapshot: bad snapshot size %"PRI_SIZE_T".", len);
+        return -1;
+    }
+
+    data = lib_malloc(len);
+    chunk = lib_malloc(SNAPSHOT_CHUNK_SIZE);
+
+#ifdef HAVE_ZLIB
+    memset(&zs, 0, sizeof(zs));
+    if (format == SNAPSHOT_FORMAT_ZLIB) {
+        if (inflateInit(&zs) != Z_OK) {
+            lib_free(chunk);
+            lib_free(data);
+            return -1;
+        }
+        zs.next_out = data;
+        zs.avail_out = (uInt)len;
+    }
+#endif
+
+    while (1) {
+        if (network_recv_buffer(s, len4, 4) < 0) {
+            ret = -1;
+            break;
+        }
+        chunk_len = (size_t)util_le_buf4_to_int(len4);
+        if (chunk_len == 0) {
+            break;
+        }
+        if (chunk_len > SNAPSHOT_CHUNK_SIZE
+            || network_recv_buffer(s, chunk, (ssize_t)chunk_len) < 0) {
+            ret = -1;
+            break;
+        }
+#ifdef HAVE_ZLIB
+        if (format == SNAPSHOT_FORMAT_ZLIB) {
+            zs.next_in = chunk;
+            zs.avail_in = (uInt)chunk_len;
+            zret = inflate(&zs, Z_NO_FLUSH);
+            if ((zret != Z_OK && zret != Z_STREAM_END && zret != Z_BUF_ERROR)
+                || zs.avail_in != 0) {
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+#endif
+        if (pos + chunk_len > len) {
+            ret = -1;
+            break;
+        }
+        memcpy(data + pos, chunk, chunk_len);
+        pos += chunk_len;
+    }
+
+#ifdef HAVE_ZLIB
+    if (format == SNAPSHOT_FORMAT_ZLIB) {
+        pos = zs.total_out;
+        inflateEnd(&zs);
+    }
+#endif
+
+    if (ret == 0 && pos != len) {
+        log_error(LOG_DEFAULT, "network_recv_snapshot: got %"PRI_SIZE_T" of %"PRI_SIZE_T" bytes.",
+                  pos, len);
+        ret = -1;
+    }
+    if (ret == 0) {
+        snapshot_memory_set_data(mem, data, len);
+    }
+
+    lib_free(chunk);
+    lib_free(data);
+    return ret;
+}
+
+/* Appends whatever the remote host has sent so far to the receive queue.
+   With `block' set, waits until at least some data arrived. */
+static int network_recv_queue_fill(int block)
+{
+    ssize_t t;
+
+    while (block || vice_network_select_poll_one(network_socket) > 0) {
+        if (recv_queue_size - recv_queue_len < 0x1000) {
+            recv_queue_size = recv_queue_len + 0x4000;
+            recv_queue = lib_realloc(recv_queue, recv_queue_size);
+        }
+        t = vice_network_receive(network_socket, recv_queue + recv_queue_len,
+                                 recv_queue_size - recv_queue_len, 0);
+        if (t <= 0) {
+            return -1;
+        }
+        recv_queue_len += (size_t)t;
+        block = 0;
+    }
+    return 0;
+}
+
+/* Takes the next frame from the receive queue, only waiting for the remote
+   host when that frame has not arrived yet. */
+static int network_recv_queue_get_frame(uint8_t **buf, unsigned int *len)
+{
+    unsigned int frame_len;
+
+    while (1) {
+        if (recv_queue_len >= 4) {
+            frame_len = (unsigned int)util_le_buf4_to_int(recv_queue);
+            if (frame_len == 0) {
+                recv_queue_len -= 4;
+                memmove(recv_queue, recv_queue + 4, recv_queue_len);
+                if (suspended == 0) {
+                    /* remote host suspended emulation */
+                    ui_display_statustext("Remote host suspending...", false);
+                    suspended = 1;
+                    vsync_suspend_speed_eval();
+                }
+                continue;
+            }
+            if (recv_queue_len >= 4 + (size_t)frame_len) {
+                *buf = lib_malloc(frame_len);
+                *len = frame_len;
+                memcpy(*buf, recv_queue + 4, frame_len);
+                recv_queue_len -= 4 + (size_t)frame_len;
+                memmove(recv_queue, recv_queue + 4 + frame_len, recv_queue_len);
+                return 0;
+            }
+        }
+        if (network_recv_queue_fill(1) < 0) {
+            return -1;
+        }
+    }
+}
+
 #define NUM_OF_TESTPACKETS 50
 
 typedef struct {
@@ -418,6 +699,7 @@ static int network_test_delay(void)
     uint8_t new_frame_delta = 5; /* default to use on error */
     unsigned char *buf;
     testpacket pkt;
+    float latency;
 
     tick_t packet_delay[NUM_OF_TESTPACKETS];
     char st[256];
@@ -454,11 +736,16 @@ static int network_test_delay(void)
         }
         DBG(("tick_per_second = %u", tick_per_second()));
 
-        /* calculate delay with 90% of packets beeing fast enough */
-        /* FIXME: This needs some further investigation */
-        new_frame_delta = 5 + (uint8_t)(vsync_get_refresh_frequency()
-                                     * packet_delay[(int)(0.1 * NUM_OF_TESTPACKETS)]
-                                     / (float)tick_per_second());
+        /* Frame n is played back n + frame_delta - 1 frames later, so the
+           remote events of a frame have that long to arrive. Use the one-way
+           delay that 90% of the packets beat, plus some frames of jitter. */
+        latency = vsync_get_refresh_frequency()
+                  * packet_delay[(int)(0.1 * NUM_OF_TESTPACKETS)]
+                  / (float)tick_per_second() / 2.0f;
+        if (latency > 200.0f) {
+            latency = 200.0f;
+        }
+        new_frame_delta = 1 + NETWORK_JITTER_FRAMES + (uint8_t)(latency + 0.999f);
         if (network_send_buffer(network_socket, &new_frame_delta, sizeof(new_frame_delta)) < 0) {
             goto exiterror;
         }
@@ -489,9 +776,9 @@ exiterror:
 /* triggers on the server, when the client connects */
 static void network_server_connect_trap(uint16_t addr, void *data)
 {
-    FILE *f;
+    snapshot_memory_t *mem;
     uint8_t *buf;
-    off_t buf_size;
+    size_t buf_size;
     uint8_t send_size4[4];
     ssize_t i;
     event_list_state_t settings_list;
@@ -502,32 +789,14 @@ static void network_server_connect_trap(uint16_t addr, void *data)
     sound_suspend();
 
     /* Create snapshot and send it */
-    snapshotfilename = archdep_tmpnam();
-    if (machine_write_snapshot(snapshotfilename, 1, 1, 0) == 0) {
-        f = fopen(snapshotfilename, MODE_READ);
-        if (f == NULL) {
-            ui_error("Cannot load snapshot file for transfer");
-            lib_free(snapshotfilename);
-            return;
-        }
-        buf_size = archdep_file_size(f);
-        buf = lib_malloc((size_t)buf_size);
-        if (fread(buf, 1, (size_t)buf_size, f) == 0) {
-            log_debug(LOG_DEFAULT, "network_server_connect_trap read failed.");
-        }
-        fclose(f);
-
+    mem = snapshot_memory_new();
+    if (machine_write_snapshot_memory(mem, 1, 1, 0) == 0) {
         ui_display_statustext("Sending snapshot to client...", false);
-        util_int_to_le_buf4(send_size4, (int)buf_size);
-        if ((i = network_send_buffer(network_socket, send_size4, 4)) < 0) {
-        } else {
-            i = network_send_buffer(network_socket, buf, (int)buf_size);
-        }
-        lib_free(buf);
+        i = network_send_snapshot(network_socket, mem);
+        snapshot_memory_destroy(mem);
         if (i < 0) {
             ui_error("Cannot send snapshot to client");
             ui_display_statustext("", false);
-            lib_free(snapshotfilename);
             return;
         }
 
@@ -540,7 +809,7 @@ static void network_server_connect_trap(uint16_t addr, void *data)
         buf_size = (size_t)network_create_event_buffer(&buf, &(settings_list));
         util_int_to_le_buf4(send_size4, (int)buf_size);
 
-        if ((i = network_send_buffer(network_socket, send_size4, 4) < 0)) {
+        if ((i = network_send_buffer(network_socket, send_size4, 4)) < 0) {
         } else {
             i = network_send_buffer(network_socket, buf, (int)buf_size);
         }
@@ -550,9 +819,9 @@ static void network_server_connect_trap(uint16_t addr, void *data)
 
         current_send_frame = 0;
         last_received_frame = 0;
+        recv_queue_len = 0;
 
         if (i < 0) {
-            lib_free(snapshotfilename);
             return;
         }
 
@@ -560,9 +829,9 @@ static void network_server_connect_trap(uint16_t addr, void *data)
             log_error(LOG_DEFAULT, "network_test_delay failed");
         }
     } else {
-        ui_error("Cannot create snapshot file %s", snapshotfilename);
+        snapshot_memory_destroy(mem);
+        ui_error("Cannot create snapshot");
     }
-    lib_free(snapshotfilename);
 }
 
 /* triggers on the client, when it connects to the server */
@@ -592,6 +861,7 @@ static void network_client_connect_trap(uint16_t addr, void *data)
     buf = lib_malloc(buf_size);
 
     if (network_recv_buffer(network_socket, buf, (int)buf_size) < 0) {
+        lib_free(buf);
         return;
     }
 
@@ -603,22 +873,25 @@ static void network_client_connect_trap(uint16_t addr, void *data)
     event_clear_list(settings_list);
     lib_free(settings_list);
 
-    /* read the snapshot */
-    if (machine_read_snapshot(snapshotfilename, 0) != 0) {
-        ui_error("Cannot open snapshot file %s", snapshotfilename);
-        lib_free(snapshotfilename);
+    /* restore the snapshot */
+    if (machine_read_snapshot_memory(client_snapshot, 0) != 0) {
+        ui_error("Cannot restore snapshot received from server");
+        snapshot_memory_destroy(client_snapshot);
+        client_snapshot = NULL;
         return;
     }
+    snapshot_memory_destroy(client_snapshot);
+    client_snapshot = NULL;
 
     current_send_frame = 0;
     last_received_frame = 0;
+    recv_queue_len = 0;
 
     network_mode = NETWORK_CLIENT;
 
     if (network_test_delay() < 0) {
         log_error(LOG_DEFAULT, "network_test_delay failed");
     }
-    lib_free(snapshotfilename);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -759,10 +1032,6 @@ int network_start_server(void)
 int network_connect_client(void)
 {
     vice_network_socket_address_t * server_addr;
-    FILE *f;
-    uint8_t *buf;
-    uint8_t recv_buf4[4];
-    size_t buf_size;
 
     DBG(("network_connect_client (network_mode is: %u)", network_mode));
 
@@ -772,14 +1041,6 @@ int network_connect_client(void)
 
     vsync_suspend_speed_eval();
 
-    snapshotfilename = NULL;
-
-    f = archdep_mkstemp_fd(&snapshotfilename, MODE_WRITE);
-    if (f == NULL) {
-        ui_error("Cannot create snapshot file. Select different history directory!");
-        return -1;
-    }
-
     server_addr = vice_network_address_generate(server_name, server_port);
     if (server_addr == NULL) {
         ui_error("Cannot resolve %s", server_name);
@@ -792,32 +1053,21 @@ int network_connect_client(void)
 
     if (!network_socket) {
         ui_error("Cannot connect to %s (no server running on port %d).", server_name, server_port);
-        lib_free(snapshotfilename);
         return -1;
     }
 
     ui_display_statustext("Receiving snapshot from server...", false);
-    if (network_recv_buffer(network_socket, recv_buf4, 4) < 0) {
-        lib_free(snapshotfilename);
-        vice_network_socket_close(network_socket);
-        return -1;
+    if (client_snapshot == NULL) {
+        client_snapshot = snapshot_memory_new();
     }
-
-    buf_size = (size_t)util_le_buf4_to_int(recv_buf4);
-    buf = lib_malloc(buf_size);
-
-    if (network_recv_buffer(network_socket, buf, (int)buf_size) < 0) {
-        lib_free(snapshotfilename);
+    if (network_recv_snapshot(network_socket, client_snapshot) < 0) {
+        ui_error("Cannot receive snapshot from server");
+        snapshot_memory_destroy(client_snapshot);
+        client_snapshot = NULL;
         vice_network_socket_close(network_socket);
         return -1;
     }
 
-    if (fwrite(buf, 1, buf_size, f) == 0) {
-        log_debug(LOG_DEFAULT, "network_connect_client write failed.");
-    }
-    fclose(f);
-    lib_free(buf);
-
     interrupt_maincpu_trigger_trap(network_client_connect_trap, (void *)0);
     vsync_suspend_speed_eval();
 
@@ -828,6 +1078,7 @@ void network_disconnect(void)
 {
     DBG(("network_disconnect (network_mode was:%u)", network_mode));
     vice_network_socket_close(network_socket);
+    recv_queue_len = 0;
     if (network_mode == NETWORK_SERVER_CONNECTED) {
         network_mode = NETWORK_SERVER;
     } else {
@@ -857,8 +1108,8 @@ long t1, t2, t3, t4;
 static void network_hook_connected_send(void)
 {
     uint8_t *local_event_buf = NULL;
+    uint8_t *send_buf;
     unsigned int send_len;
-    uint8_t send_len4[4];
 
     DBGT(("network_hook_connected_send"));
 
@@ -870,11 +1121,12 @@ static void network_hook_connected_send(void)
     t1 = tick_now();
 #endif
 
-    util_int_to_le_buf4(send_len4, (int)send_len);
-    if (network_send_buffer(network_socket, send_len4, 4) < 0) {
-        ui_display_statustext("Remote host disconnected.", true);
-        network_disconnect();
-    } else if (network_send_buffer(network_socket, local_event_buf, send_len) < 0) {
+    /* length and events go out in one packet; the frame is not played back
+       before frame_delta - 1 more frames, so nothing waits for the remote */
+    send_buf = lib_malloc(4 + send_len);
+    util_int_to_le_buf4(send_buf, (int)send_len);
+    memcpy(send_buf + 4, local_event_buf, send_len);
+    if (network_send_buffer(network_socket, send_buf, (ssize_t)(4 + send_len)) < 0) {
         ui_display_statustext("Remote host disconnected.", true);
         network_disconnect();
     }
@@ -882,6 +1134,7 @@ static void network_hook_connected_send(void)
     t2 = tick_now_after(t1);
 #endif
 
+    lib_free(send_buf);
     lib_free(local_event_buf);
 }
 
@@ -889,7 +1142,6 @@ static void network_hook_connected_receive(void)
 {
     uint8_t *remote_event_buf = NULL;
     unsigned int recv_len;
-    uint8_t recv_len4[4];
     event_list_state_t *remote_event_list;
     event_list_state_t *client_event_list, *server_event_list;
 
@@ -901,35 +1153,24 @@ static void network_hook_connected_receive(void)
         frame_buffer_full = 1;
     }
 
-    if (frame_buffer_full) {
-        do {
-            if (network_recv_buffer(network_socket, recv_len4, 4) < 0) {
-                ui_display_statustext("Remote host disconnected.", true);
-                network_disconnect();
-                return;
-            }
+    /* collect the frames that already arrived without waiting */
+    if (network_recv_queue_fill(0) < 0) {
+        ui_display_statustext("Remote host disconnected.", true);
+        network_disconnect();
+        return;
+    }
 
-            recv_len = util_le_buf4_to_int(recv_len4);
-            if (recv_len == 0 && suspended == 0) {
-                /* remote host suspended emulation */
-                ui_display_statustext("Remote host suspending...", false);
-                suspended = 1;
-                vsync_suspend_speed_eval();
-            }
-        } while (recv_len == 0);
+    if (frame_buffer_full) {
+        if (network_recv_queue_get_frame(&remote_event_buf, &recv_len) < 0) {
+            ui_display_statustext("Remote host disconnected.", true);
+            network_disconnect();
+            return;
+        }
 
         if (suspended == 1) {
             ui_display_statustext("", false);
         }
 
-        remote_event_buf = lib_malloc(recv_len);
-
-        if (network_recv_buffer(network_socket, remote_event_buf,
-                                recv_len) < 0) {
-            lib_free(remote_event_buf);
-            return;
-        }
-
 #ifdef NETWORK_TRAFFIC_DEBUG
         t3 = tick_now_after(t2);
 #endif
@@ -993,7 +1234,9 @@ void network_hook(void)
 
     if (network_connected()) {
         network_hook_connected_send();
-        network_hook_connected_receive();
+        if (network_connected()) {
+            network_hook_connected_receive();
+        }
         DBGT(("network_hook timing: %5ld %5ld %5ld; total: %5ld",
                   t2 - t1, t3 - t2, t4 - t3, t4 - t1));
     }
@@ -1006,6 +1249,13 @@ void network_shutdown(void)
     }
 
     network_free_frame_event_list();
+    lib_free(recv_queue);
+    recv_queue = NULL;
+    recv_queue_size = 0;
+    if (client_snapshot != NULL) {
+        snapshot_memory_destroy(client_snapshot);
+        client_snapshot = NULL;
+    }
     lib_free(server_name);
     lib_free(server_bind_address);
 }
@@ -30,6 +30,7 @@
 #include "interrupt.h"
 #include "monitor.h"
 #include "petmem.h"
+#include "sampleprof.h"
 #include "snapshot.h"
 #include "machine.h"
 
@@ -233,6 +234,32 @@ static unsigned int cc_changed = 0;
 
 static uint16_t *index_regs[4] = { &X, &Y, &U, &S };
 
+/* created when the 6809 runs for the first time */
+static sampleprof_cpu_t *h6809_sampleprof = NULL;
+
+/* Call tracking for the sampling profiler, used after the jump to the
+   called code and before the return address is pulled. */
+#define CHECK_SAMPLEPROF_CALL()                                         \
+    do {                                                                \
+        if (h6809_sampleprof != NULL && h6809_sampleprof->active) {     \
+            sampleprof_call(h6809_sampleprof, PC, S);                   \
+        }                                                               \
+    } while (0)
+
+#define CHECK_SAMPLEPROF_INTERRUPT()                                    \
+    do {                                                                \
+        if (h6809_sampleprof != NULL && h6809_sampleprof->active) {     \
+            sampleprof_interrupt(h6809_sampleprof, PC, S);              \
+        }                                                               \
+    } while (0)
+
+#define CHECK_SAMPLEPROF_RETURN()                                       \
+    do {                                                                \
+        if (h6809_sampleprof != NULL && h6809_sampleprof->active) {     \
+            sampleprof_return(h6809_sampleprof, S);                     \
+        }                                                               \
+    } while (0)
+
 void nmi(void);
 void irq(void);
 void firq(void);
@@ -1547,12 +1574,14 @@ static void jsr(void)
     S -= 2;
     write_stack16(S, PC);
     PC = ea;
+    CHECK_SAMPLEPROF_CALL();
 
     CLK_ADD(3, 2);
 }
 
 static void rti(void)
 {
+    CHECK_SAMPLEPROF_RETURN();
     CLK += 3;
     set_cc(read_stack(S));
     S++;
@@ -1580,6 +1609,7 @@ static void rti(void)
 
 static void rts(void)
 {
+    CHECK_SAMPLEPROF_RETURN();
     CLK_ADD(2, 1);
 
     PC = read_stack16(S);
@@ -1610,6 +1640,7 @@ void nmi(void)
     EFI |= I_FLAG;
 
     PC = read16(0xfffc);
+    CHECK_SAMPLEPROF_INTERRUPT();
 }
 
 void irq(void)
@@ -1637,6 +1668,7 @@ void irq(void)
 
     PC = read16(0xfff8);
     irqs_pending = 0;
+    CHECK_SAMPLEPROF_INTERRUPT();
 }
 
 void firq(void)
@@ -1667,6 +1699,7 @@ void firq(void)
 
     PC = read16(0xfff6);
     firqs_pending = 0;
+    CHECK_SAMPLEPROF_INTERRUPT();
 }
 
 static void swi(void)
@@ -1694,6 +1727,7 @@ static void swi(void)
     EFI |= (I_FLAG | F_FLAG);
 
     PC = read16(0xfffa);
+    CHECK_SAMPLEPROF_INTERRUPT();
 }
 
 static void swi2(void)
@@ -1720,6 +1754,7 @@ static void swi2(void)
     write_stack(S, get_cc());
 
     PC = read16(0xfff4);
+    CHECK_SAMPLEPROF_INTERRUPT();
 }
 
 static void swi3(void)
@@ -1746,6 +1781,7 @@ static void swi3(void)
     write_stack(S, get_cc());
 
     PC = read16(0xfff2);
+    CHECK_SAMPLEPROF_INTERRUPT();
 }
 
 #ifdef H6309
@@ -1931,6 +1967,7 @@ static void long_bsr(void)
     S -= 2;
     write_stack16(S, PC);
     PC = ea;
+    CHECK_SAMPLEPROF_CALL();
 
     CLK_ADD(4, 1);
 }
@@ -1944,6 +1981,7 @@ static void bsr(void)
     write_stack16(S, PC);
     CLK_ADD(3, 2);
     PC = ea;
+    CHECK_SAMPLEPROF_CALL();
 }
 
 /* Undocumented 6809 specific code */
@@ -2739,7 +2777,7 @@ static void st32(uint32_t arg, int CLK6809, int CLK6309)
 #endif
 
 /* Execute 6809 code for a certain number of cycles. */
-void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarm_context)
+static void h6809_loop(struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarm_context)
 {
     uint16_t opcode;
     uint8_t fetch;
@@ -5943,6 +5981,19 @@ void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_con
     return;
 }
 
+/* The sampling profiler of the 6502 pauses while the 6809 runs. */
+void h6809_mainloop(struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarm_context)
+{
+    if (h6809_sampleprof == NULL) {
+        h6809_sampleprof = sampleprof_cpu_new("6809", ALARM_CONTEXT,
+                                              CPU_INT_STATUS, &CLK, NULL, NULL);
+    }
+
+    sampleprof_cpu_switch(maincpu_sampleprof, h6809_sampleprof);
+    h6809_loop(maincpu_intstatus, maincpu_alarm_context);
+    sampleprof_cpu_switch(h6809_sampleprof, maincpu_sampleprof);
+}
+
 void cpu6809_reset (void)
 {
     X = Y = S = U = DP = 0;
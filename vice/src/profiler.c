@@ -376,3 +376,17 @@ void profile_shutdown(void)
 {
     profile_reset();
 }
+
+/* the call stack is tracked even when not profiling, the sampling profiler
+   takes it from here */
+unsigned int profile_get_callstack(uint16_t *pc_dst, bool *interrupt,
+                                   unsigned int max_depth)
+{
+    unsigned int i;
+
+    for (i = 0; i < callstack_size && i < max_depth; i++) {
+        pc_dst[i] = callstack_pc_dst[i];
+        interrupt[i] = callstack_pc_src[i] >= 0xfffa;
+    }
+    return i;
+}
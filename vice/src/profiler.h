@@ -57,4 +57,8 @@ void profile_rtx(uint8_t sp);
 
 void profile_shutdown(void);
 
+/* copies the current call stack of the main CPU, returns its depth */
+unsigned int profile_get_callstack(uint16_t *pc_dst, bool *interrupt,
+                                   unsigned int max_depth);
+
 #endif /* VICE_PROFILER_H */
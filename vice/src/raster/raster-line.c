@@ -41,6 +41,7 @@
 #include "raster-sprite-status.h"
 #include "raster-sprite.h"
 #include "raster.h"
+#include "video.h"
 #include "viewport.h"
 
 
@@ -629,6 +630,29 @@ static void handle_visible_line_with_changes(raster_t *raster)
                      0, raster->geometry->screen_size.width - 1);
 }
 
+/* With "VideoOutput" set to none a line only needs to be drawn when sprites
+   are displayed on it, as the sprite-background collisions depend on the
+   graphics mask. */
+inline static int raster_line_needs_drawing(raster_t *raster)
+{
+    return video_output != VIDEO_OUTPUT_NONE
+           || (raster->sprite_status != NULL
+               && (raster->sprite_status->dma_msk
+                   || raster->sprite_status->new_dma_msk));
+}
+
+/* Apply the changes of a line that is not drawn.  */
+static void handle_skipped_line(raster_t *raster)
+{
+    if (raster->changes->have_on_this_line) {
+        raster_changes_apply_all(raster->changes->background);
+        raster_changes_apply_all(raster->changes->foreground);
+        raster_changes_apply_all(raster->changes->border);
+        raster_changes_apply_all(raster->changes->sprites);
+        raster->changes->have_on_this_line = 0;
+    }
+}
+
 inline static void handle_visible_line(raster_t *raster)
 {
     if (raster->changes->have_on_this_line) {
@@ -666,9 +690,13 @@ void raster_line_emulate(raster_t *raster)
         || (raster->current_line <= raster->geometry->last_displayed_line - raster->geometry->screen_size.height
             && raster->geometry->screen_size.height <= raster->geometry->last_displayed_line)
         ) {
-        /* handle lines with no border or with changes that may affect
-           the border as visible lines */
-        if (raster->can_disable_border && (raster->border_disable || raster->changes->have_on_this_line)) {
+        if (!raster_line_needs_drawing(raster)) {
+            /* nothing to render, redraw the line once output is enabled */
+            handle_skipped_line(raster);
+            raster->dont_cache = 1;
+        } else if (raster->can_disable_border && (raster->border_disable || raster->changes->have_on_this_line)) {
+            /* handle lines with no border or with changes that may affect
+               the border as visible lines */
             handle_visible_line(raster);
         } else {
             if ((raster->blank_this_line || raster->blank_enabled)
@@ -697,14 +725,7 @@ void raster_line_emulate(raster_t *raster)
 #endif
     } else {
         update_sprite_collisions(raster);
-
-        if (raster->changes->have_on_this_line) {
-            raster_changes_apply_all(raster->changes->background);
-            raster_changes_apply_all(raster->changes->foreground);
-            raster_changes_apply_all(raster->changes->border);
-            raster_changes_apply_all(raster->changes->sprites);
-            raster->changes->have_on_this_line = 0;
-        }
+        handle_skipped_line(raster);
     }
 
     raster->current_line++;
@@ -32,6 +32,24 @@
 #include <fstream>
 using namespace std;
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define RESID_CONVOLVE_SSE2
+#include <emmintrin.h>
+#if defined(__clang__) || (__GNUC__ >= 5)
+#define RESID_CONVOLVE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESID_CONVOLVE_NEON
+#include <arm_neon.h>
+#elif defined(VICE_NEON_SHIM)
+// plain C intrinsics, to check the NEON code on other hosts
+#define RESID_CONVOLVE_NEON
+#include "neon-shim.h"
+#endif
+
 #ifndef round
 #define round(x) (x>=0.0?floor(x+0.5):ceil(x-0.5))
 #endif
@@ -39,6 +57,236 @@ using namespace std;
 namespace reSID
 {
 
+// ----------------------------------------------------------------------------
+// FIR convolution used by the resampling methods.
+//
+// The SIMD versions add the same 32 bit products as the scalar loop, only in
+// a different order, so the result is bit-exact as long as the scalar sum
+// does not overflow. The best version for the host CPU is picked once at
+// startup.
+// ----------------------------------------------------------------------------
+static int convolve_scalar(const short* a, const short* b, int n)
+{
+  int v = 0;
+  for (int i = 0; i < n; i++) {
+    v += a[i]*b[i];
+  }
+  return v;
+}
+
+#ifdef RESID_CONVOLVE_SSE2
+static int convolve_sse2(const short* a, const short* b, int n)
+{
+  __m128i acc = _mm_setzero_si128();
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(acc) + convolve_scalar(a + i, b + i, n - i);
+}
+#endif
+
+#ifdef RESID_CONVOLVE_AVX2
+__attribute__((target("avx2")))
+static int convolve_avx2(const short* a, const short* b, int n)
+{
+  __m256i acc = _mm256_setzero_si256();
+  int i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  __m128i acc4 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                               _mm256_extracti128_si256(acc, 1));
+  acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(acc4) + convolve_scalar(a + i, b + i, n - i);
+}
+#endif
+
+#ifdef RESID_CONVOLVE_NEON
+static int convolve_neon(const short* a, const short* b, int n)
+{
+  int32x4_t acc = vdupq_n_s32(0);
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t va = vld1q_s16(a + i);
+    int16x8_t vb = vld1q_s16(b + i);
+    acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+    acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+  }
+  int32x2_t acc2 = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+
+  return vget_lane_s32(vpadd_s32(acc2, acc2), 0) + convolve_scalar(a + i, b + i, n - i);
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// Two convolutions in one pass, for the interpolation between two FIR tables
+// in clock_resample(). The FIR tables are different, the samples are either
+// the same or shifted by one, so each sample vector is loaded once per
+// table pair and both sums build up side by side.
+// ----------------------------------------------------------------------------
+static void convolve2_scalar(const short* s1, const short* s2,
+                             const short* f1, const short* f2, int n,
+                             int* v1, int* v2)
+{
+  *v1 = convolve_scalar(s1, f1, n);
+  *v2 = convolve_scalar(s2, f2, n);
+}
+
+#ifdef RESID_CONVOLVE_SSE2
+static void convolve2_sse2(const short* s1, const short* s2,
+                           const short* f1, const short* f2, int n,
+                           int* v1, int* v2)
+{
+  __m128i acc1 = _mm_setzero_si128();
+  __m128i acc2 = _mm_setzero_si128();
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m128i vs1 = _mm_loadu_si128((const __m128i*)(s1 + i));
+    __m128i vs2 = _mm_loadu_si128((const __m128i*)(s2 + i));
+    acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(vs1, _mm_loadu_si128((const __m128i*)(f1 + i))));
+    acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(vs2, _mm_loadu_si128((const __m128i*)(f2 + i))));
+  }
+  // reduce both accumulators at once: {a0+a1, b0+b1, a2+a3, b2+b3}
+  __m128i lo = _mm_unpacklo_epi32(acc1, acc2);
+  __m128i hi = _mm_unpackhi_epi32(acc1, acc2);
+  __m128i sum = _mm_add_epi32(lo, hi);
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+
+  *v1 = _mm_cvtsi128_si32(sum) + convolve_scalar(s1 + i, f1 + i, n - i);
+  *v2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 1, 1, 1)))
+        + convolve_scalar(s2 + i, f2 + i, n - i);
+}
+#endif
+
+#ifdef RESID_CONVOLVE_AVX2
+__attribute__((target("avx2")))
+static void convolve2_avx2(const short* s1, const short* s2,
+                           const short* f1, const short* f2, int n,
+                           int* v1, int* v2)
+{
+  __m256i acc1 = _mm256_setzero_si256();
+  __m256i acc2 = _mm256_setzero_si256();
+  int i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m256i vs1 = _mm256_loadu_si256((const __m256i*)(s1 + i));
+    __m256i vs2 = _mm256_loadu_si256((const __m256i*)(s2 + i));
+    acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(vs1, _mm256_loadu_si256((const __m256i*)(f1 + i))));
+    acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(vs2, _mm256_loadu_si256((const __m256i*)(f2 + i))));
+  }
+  __m128i a1 = _mm_add_epi32(_mm256_castsi256_si128(acc1),
+                             _mm256_extracti128_si256(acc1, 1));
+  __m128i a2 = _mm_add_epi32(_mm256_castsi256_si128(acc2),
+                             _mm256_extracti128_si256(acc2, 1));
+  __m128i sum = _mm_add_epi32(_mm_unpacklo_epi32(a1, a2),
+                              _mm_unpackhi_epi32(a1, a2));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+
+  *v1 = _mm_cvtsi128_si32(sum) + convolve_scalar(s1 + i, f1 + i, n - i);
+  *v2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 1, 1, 1)))
+        + convolve_scalar(s2 + i, f2 + i, n - i);
+}
+#endif
+
+#ifdef RESID_CONVOLVE_NEON
+static void convolve2_neon(const short* s1, const short* s2,
+                           const short* f1, const short* f2, int n,
+                           int* v1, int* v2)
+{
+  int32x4_t acc1 = vdupq_n_s32(0);
+  int32x4_t acc2 = vdupq_n_s32(0);
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t vs1 = vld1q_s16(s1 + i);
+    int16x8_t vs2 = vld1q_s16(s2 + i);
+    int16x8_t vf1 = vld1q_s16(f1 + i);
+    int16x8_t vf2 = vld1q_s16(f2 + i);
+    acc1 = vmlal_s16(acc1, vget_low_s16(vs1), vget_low_s16(vf1));
+    acc1 = vmlal_s16(acc1, vget_high_s16(vs1), vget_high_s16(vf1));
+    acc2 = vmlal_s16(acc2, vget_low_s16(vs2), vget_low_s16(vf2));
+    acc2 = vmlal_s16(acc2, vget_high_s16(vs2), vget_high_s16(vf2));
+  }
+  // {a0+a1, a2+a3} and {b0+b1, b2+b3}, then {a, b}
+  int32x2_t sum = vpadd_s32(vadd_s32(vget_low_s32(acc1), vget_high_s32(acc1)),
+                            vadd_s32(vget_low_s32(acc2), vget_high_s32(acc2)));
+
+  *v1 = vget_lane_s32(sum, 0) + convolve_scalar(s1 + i, f1 + i, n - i);
+  *v2 = vget_lane_s32(sum, 1) + convolve_scalar(s2 + i, f2 + i, n - i);
+}
+#endif
+
+typedef int (*convolve_func_t)(const short* a, const short* b, int n);
+typedef void (*convolve2_func_t)(const short* s1, const short* s2,
+                                 const short* f1, const short* f2, int n,
+                                 int* v1, int* v2);
+
+static convolve_func_t convolve = convolve_scalar;
+static convolve2_func_t convolve2 = convolve2_scalar;
+
+// Select the convolution code. CONVOLVE_AUTO picks the best version for the
+// host CPU, the others are there to compare the versions in tests and
+// benchmarks. Returns false if the version is not available.
+bool set_convolve_method(convolve_method method)
+{
+  switch (method) {
+  case CONVOLVE_AUTO:
+#ifdef RESID_CONVOLVE_AVX2
+    if (set_convolve_method(CONVOLVE_AVX2)) {
+      return true;
+    }
+#endif
+    if (set_convolve_method(CONVOLVE_SSE2) || set_convolve_method(CONVOLVE_NEON)) {
+      return true;
+    }
+    return set_convolve_method(CONVOLVE_SCALAR);
+  case CONVOLVE_SCALAR:
+    convolve = convolve_scalar;
+    convolve2 = convolve2_scalar;
+    return true;
+#ifdef RESID_CONVOLVE_SSE2
+  case CONVOLVE_SSE2:
+    convolve = convolve_sse2;
+    convolve2 = convolve2_sse2;
+    return true;
+#endif
+#ifdef RESID_CONVOLVE_AVX2
+  case CONVOLVE_AVX2:
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2")) {
+      return false;
+    }
+    convolve = convolve_avx2;
+    convolve2 = convolve2_avx2;
+    return true;
+#endif
+#ifdef RESID_CONVOLVE_NEON
+  case CONVOLVE_NEON:
+    convolve = convolve_neon;
+    convolve2 = convolve2_neon;
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+static const bool convolve_selected = set_convolve_method(CONVOLVE_AUTO);
+
 inline short clip(int input)
 {
     // Saturated arithmetics to guard against 16 bit sample overflow.
@@ -1004,25 +1252,18 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
     short* fir_start = fir + fir_offset*fir_N;
     short* sample_start = sample + sample_index - fir_N - 1 + RINGSIZE;
 
-    // Convolution with filter impulse response.
-    int v1 = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v1 += sample_start[j]*fir_start[j];
-    }
-
-    // Use next FIR table, wrap around to first FIR table using
-    // next sample.
+    // Use next FIR table for the second convolution, wrap around to first
+    // FIR table using next sample.
+    short* fir_next = fir_start + fir_N;
+    short* sample_next = sample_start;
     if (unlikely(++fir_offset == fir_RES)) {
-      fir_offset = 0;
-      ++sample_start;
+      fir_next = fir;
+      ++sample_next;
     }
-    fir_start = fir + fir_offset*fir_N;
 
-    // Convolution with filter impulse response.
-    int v2 = 0;
-    for (int k = 0; k < fir_N; k++) {
-      v2 += sample_start[k]*fir_start[k];
-    }
+    // Convolution with both filter impulse responses.
+    int v1, v2;
+    convolve2(sample_start, sample_next, fir_start, fir_next, fir_N, &v1, &v2);
 
     // Linear interpolation.
     // fir_offset_rmd is equal for all samples, it can thus be factorized out:
@@ -1071,10 +1312,7 @@ int SID::clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int int
     short* sample_start = sample + sample_index - fir_N + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v += sample_start[j]*fir_start[j];
-    }
+    int v = convolve(sample_start, fir_start, fir_N);
 
     v >>= FIR_SHIFT;
 
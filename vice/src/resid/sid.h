@@ -35,6 +35,17 @@
 namespace reSID
 {
 
+// FIR convolution code used by the resampling methods, see sid.cc.
+enum convolve_method {
+  CONVOLVE_AUTO,
+  CONVOLVE_SCALAR,
+  CONVOLVE_SSE2,
+  CONVOLVE_AVX2,
+  CONVOLVE_NEON
+};
+
+bool set_convolve_method(convolve_method method);
+
 class SID
 {
 public:
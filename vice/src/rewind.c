@@ -0,0 +1,662 @@
+/*
+ * rewind.c - Rewind the emulation using in-memory snapshots.
+ *
+ * While "RewindBufferSize" is non-zero, a keyframe snapshot of the machine
+ * is taken into memory every "RewindInterval" frames, and the input events
+ * (keyboard, joystick, datasette) are recorded into an event list like the
+ * event history does. Rewinding restores the newest keyframe at or before
+ * the target frame and then replays the recorded input in warp mode until
+ * the target frame is reached, from where the emulation goes on normally
+ * and the history after that point is dropped.
+ *
+ * Only the newest keyframe is kept as a full snapshot, every older keyframe
+ * is stored as a delta against the next newer one (see snapshot_memory_diff()).
+ * Dropping the oldest keyframe when the buffer is full is then just freeing
+ * its delta, and restoring an older keyframe applies the deltas from the
+ * newest one backwards. The deltas only save memory: every keyframe still
+ * writes and compares the full snapshot, so its cost grows with the size of
+ * the RAM expansions.
+ *
+ * The snapshot buffers are reused: a dropped keyframe leaves its buffer in
+ * its slot of the keyframe ring for the next keyframe that takes the slot,
+ * and the buffer of the previous full snapshot is kept as a spare for the
+ * next one. Once the history is full, taking a keyframe does not allocate.
+ *
+ * The live keyboard and joystick input is ignored while the recorded input
+ * is replayed after a seek.
+ *
+ * The history does not reach back across a machine reset. The keyframes are
+ * taken without the disk images, so writes to an attached disk image are not
+ * rewound. Seeking is refused during netplay and while the event history is
+ * recorded or played back.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "cmdline.h"
+#include "datasette.h"
+#include "interrupt.h"
+#include "joystick.h"
+#include "keyboard.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "network.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "types.h"
+#include "vice-event.h"
+#include "vsync.h"
+
+/* #define DEBUG_REWIND */
+
+#ifdef DEBUG_REWIND
+#define DBG(x)  log_debug x
+#else
+#define DBG(x)
+#endif
+
+/* One keyframe of the history */
+typedef struct rewind_keyframe_s {
+    unsigned long frame;        /* frame number the snapshot was taken in */
+    event_list_t *events;       /* first input event after the snapshot */
+    snapshot_memory_t *mem;     /* full snapshot for the newest keyframe,
+                                   delta to the next newer keyframe otherwise,
+                                   kept in the slot when the keyframe is
+                                   dropped */
+    size_t size;                /* size of `mem', 0 for a dropped keyframe */
+} rewind_keyframe_t;
+
+static log_t rewind_log = LOG_DEFAULT;
+
+/* Size of the history in MiB, 0 disables rewinding */
+static int rewind_buffer_size = 0;
+
+/* Number of frames between keyframes */
+static int rewind_interval = 50;
+
+/* Keyframe ring, `keyframe_first' is the oldest one */
+static rewind_keyframe_t *keyframes = NULL;
+static unsigned int keyframe_max = 0;
+static unsigned int keyframe_first = 0;
+static unsigned int keyframe_num = 0;
+static size_t keyframe_bytes = 0;
+
+/* Buffer for the next full snapshot */
+static snapshot_memory_t *spare_mem = NULL;
+
+/* Input events recorded since the oldest keyframe */
+static event_list_state_t rewind_events = { NULL, NULL };
+
+/* Frames since the history was started */
+static unsigned long frame_counter = 0;
+static unsigned long next_keyframe = 0;
+static int keyframe_pending = 0;
+
+/* Replay of the recorded input up to the target of a seek */
+static alarm_t *replay_alarm = NULL;
+static int replay_active = 0;
+static unsigned long replay_target = 0;
+static event_list_t *replay_event = NULL;
+static int replay_saved_warp = 0;
+
+/* Set while a keyframe is being restored */
+static int restoring = 0;
+
+
+/* ------------------------------------------------------------------------- */
+
+static rewind_keyframe_t *keyframe_get(unsigned int num)
+{
+    return &keyframes[(keyframe_first + num) % keyframe_max];
+}
+
+static rewind_keyframe_t *keyframe_newest(void)
+{
+    return keyframe_num > 0 ? keyframe_get(keyframe_num - 1) : NULL;
+}
+
+/* Append a keyframe to the ring, growing it if needed.  */
+static rewind_keyframe_t *keyframe_append(void)
+{
+    rewind_keyframe_t *new_keyframes;
+    unsigned int i;
+
+    if (keyframe_num == keyframe_max) {
+        /* unroll the ring into the new array */
+        new_keyframes = lib_calloc(keyframe_max + 16, sizeof(rewind_keyframe_t));
+        for (i = 0; i < keyframe_num; i++) {
+            new_keyframes[i] = *keyframe_get(i);
+        }
+        lib_free(keyframes);
+        keyframes = new_keyframes;
+        keyframe_max += 16;
+        keyframe_first = 0;
+    }
+    keyframe_num++;
+    return keyframe_newest();
+}
+
+static void event_node_free(event_list_t *node)
+{
+    lib_free(node->data);
+    lib_free(node);
+}
+
+/* Free the recorded input events before `end'.  */
+static void events_free_until(event_list_t *end)
+{
+    event_list_t *next;
+
+    while (rewind_events.base != end) {
+        next = rewind_events.base->next;
+        event_node_free(rewind_events.base);
+        rewind_events.base = next;
+    }
+}
+
+/* Drop the recorded input events from `node' on, `node' becomes the end of
+   the list.  */
+static void events_truncate(event_list_t *node)
+{
+    event_list_t *next;
+    event_list_t *current;
+
+    current = node->next;
+    while (current != NULL) {
+        next = current->next;
+        event_node_free(current);
+        current = next;
+    }
+    lib_free(node->data);
+    node->type = EVENT_LIST_END;
+    node->data = NULL;
+    node->size = 0;
+    node->next = NULL;
+    rewind_events.current = node;
+}
+
+/* Drop the oldest keyframe and the events recorded before the next one.  */
+static void keyframe_drop_oldest(void)
+{
+    rewind_keyframe_t *keyframe = keyframe_get(0);
+
+    keyframe_bytes -= keyframe->size;
+    keyframe->size = 0;
+    keyframe_first = (keyframe_first + 1) % keyframe_max;
+    keyframe_num--;
+
+    if (keyframe_num > 0) {
+        events_free_until(keyframe_get(0)->events);
+    }
+}
+
+/* Drop the keyframes newer than keyframe `num'.  */
+static void keyframe_drop_newer(unsigned int num)
+{
+    rewind_keyframe_t *keyframe;
+
+    while (keyframe_num > num + 1) {
+        keyframe = keyframe_newest();
+        keyframe_bytes -= keyframe->size;
+        keyframe->size = 0;
+        keyframe_num--;
+    }
+}
+
+static void rewind_replay_stop(void)
+{
+    if (replay_active) {
+        alarm_unset(replay_alarm);
+        vsync_set_warp_mode(replay_saved_warp);
+        replay_active = 0;
+    }
+    /* what was recorded after this point is no longer the history */
+    if (replay_event != NULL) {
+        events_truncate(replay_event);
+        replay_event = NULL;
+    }
+}
+
+/* Free the whole history.  */
+static void rewind_clear(void)
+{
+    rewind_replay_stop();
+    while (keyframe_num > 0) {
+        keyframe_drop_oldest();
+    }
+    if (rewind_events.base != NULL) {
+        events_truncate(rewind_events.base);
+    }
+    keyframe_bytes = 0;
+    frame_counter = 0;
+    next_keyframe = 0;
+}
+
+/* Free the history and the snapshot buffers kept for reuse.  */
+static void rewind_free_buffers(void)
+{
+    unsigned int i;
+
+    rewind_clear();
+    for (i = 0; i < keyframe_max; i++) {
+        if (keyframes[i].mem != NULL) {
+            snapshot_memory_destroy(keyframes[i].mem);
+            keyframes[i].mem = NULL;
+        }
+    }
+    if (spare_mem != NULL) {
+        snapshot_memory_destroy(spare_mem);
+        spare_mem = NULL;
+    }
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Take a keyframe, the newest one so far turns into a delta to it.  */
+static void rewind_keyframe_trap(uint16_t addr, void *data)
+{
+    rewind_keyframe_t *newest;
+    rewind_keyframe_t *keyframe;
+    snapshot_memory_t *mem;
+    snapshot_memory_t *delta;
+    size_t limit;
+
+    keyframe_pending = 0;
+    if (rewind_buffer_size <= 0 || restoring) {
+        return;
+    }
+
+    if (spare_mem == NULL) {
+        spare_mem = snapshot_memory_new();
+    }
+    mem = spare_mem;
+    if (machine_write_snapshot_memory(mem, 0, 0, 0) < 0) {
+        log_error(rewind_log, "Cannot take a keyframe, rewinding disabled.");
+        resources_set_int("RewindBufferSize", 0);
+        return;
+    }
+
+    /* the ring may move, get the previous newest keyframe afterwards */
+    keyframe = keyframe_append();
+    newest = keyframe_num > 1 ? keyframe_get(keyframe_num - 2) : NULL;
+
+    /* the buffer left in the slot takes the delta, the full snapshot of the
+       previous newest keyframe becomes the spare */
+    if (newest != NULL) {
+        delta = keyframe->mem != NULL ? keyframe->mem : snapshot_memory_new();
+        snapshot_memory_diff(delta, mem, newest->mem);
+        spare_mem = newest->mem;
+        newest->mem = delta;
+        keyframe_bytes -= newest->size;
+        snapshot_memory_get_data(delta, &newest->size);
+        keyframe_bytes += newest->size;
+    } else {
+        spare_mem = keyframe->mem;
+    }
+
+    keyframe->frame = frame_counter;
+    keyframe->events = replay_active ? replay_event : rewind_events.current;
+    keyframe->mem = mem;
+    snapshot_memory_get_data(mem, &keyframe->size);
+    keyframe_bytes += keyframe->size;
+
+    /* keep the history within the buffer size, but always keep the newest
+       keyframe */
+    limit = (size_t)rewind_buffer_size * 1024 * 1024;
+    while (keyframe_bytes > limit && keyframe_num > 1) {
+        keyframe_drop_oldest();
+    }
+
+    DBG((rewind_log, "keyframe at frame %lu, %u keyframes, %lu bytes",
+         frame_counter, keyframe_num, (unsigned long)keyframe_bytes));
+}
+
+static void rewind_replay_alarm_set(void)
+{
+    if (replay_event != NULL && replay_event->type != EVENT_LIST_END) {
+        alarm_set(replay_alarm, replay_event->clk);
+    } else {
+        alarm_unset(replay_alarm);
+    }
+}
+
+/* Replay the next recorded input event.  */
+static void rewind_replay_alarm_handler(CLOCK offset, void *data)
+{
+    alarm_unset(replay_alarm);
+
+    switch (replay_event->type) {
+        case EVENT_KEYBOARD_MATRIX:
+            keyboard_event_playback(offset, replay_event->data);
+            break;
+        case EVENT_KEYBOARD_RESTORE:
+            keyboard_restore_event_playback(offset, replay_event->data);
+            break;
+        case EVENT_JOYSTICK_VALUE:
+            joystick_event_playback(offset, replay_event->data);
+            break;
+        case EVENT_DATASETTE:
+            datasette_event_playback_port1(offset, replay_event->data);
+            break;
+        default:
+            break;
+    }
+
+    replay_event = replay_event->next;
+    rewind_replay_alarm_set();
+}
+
+/* A seek would make the emulation diverge from the netplay peer or from
+   the recorded event history.  */
+static int rewind_seek_blocked(void)
+{
+    return network_connected() || event_record_active() || event_playback_active();
+}
+
+/* Restore the newest keyframe at or before the target frame and replay the
+   input from there.  */
+static void rewind_seek_trap(uint16_t addr, void *data)
+{
+    unsigned int frames = vice_ptr_to_uint(data);
+    unsigned long target;
+    unsigned int num;
+    unsigned int i;
+    rewind_keyframe_t *keyframe;
+    rewind_keyframe_t *newest;
+    snapshot_memory_t *mem;
+    const uint8_t *buf;
+    size_t len;
+
+    if (keyframe_num == 0 || rewind_seek_blocked()) {
+        return;
+    }
+
+    target = frame_counter > frames ? frame_counter - frames : 0;
+
+    /* find the keyframe to restore */
+    num = 0;
+    for (i = keyframe_num; i > 0; i--) {
+        if (keyframe_get(i - 1)->frame <= target) {
+            num = i - 1;
+            break;
+        }
+    }
+    keyframe = keyframe_get(num);
+    if (target < keyframe->frame) {
+        target = keyframe->frame;
+    }
+
+    /* apply the deltas from the newest keyframe back to it */
+    if (spare_mem == NULL) {
+        spare_mem = snapshot_memory_new();
+    }
+    mem = spare_mem;
+    newest = keyframe_newest();
+    buf = snapshot_memory_get_data(newest->mem, &len);
+    snapshot_memory_set_data(mem, buf, len);
+    for (i = keyframe_num - 1; i > num; i--) {
+        if (snapshot_memory_patch(mem, keyframe_get(i - 1)->mem) < 0) {
+            log_error(rewind_log, "Corrupt keyframe, history cleared.");
+            rewind_clear();
+            return;
+        }
+    }
+
+    DBG((rewind_log, "frame %lu -> %lu, keyframe %u at frame %lu",
+         frame_counter, target, num, keyframe->frame));
+
+    restoring = 1;
+    if (machine_read_snapshot_memory(mem, 0) < 0) {
+        restoring = 0;
+        log_error(rewind_log, "Cannot restore keyframe, history cleared.");
+        rewind_clear();
+        return;
+    }
+    restoring = 0;
+
+    /* the restored keyframe is the newest one now, the full snapshot of the
+       previous newest one becomes the spare and the delta buffer stays in
+       its slot */
+    spare_mem = newest->mem;
+    newest->mem = keyframe->mem;
+    keyframe_drop_newer(num);
+    keyframe_bytes -= keyframe->size;
+    keyframe->mem = mem;
+    keyframe->size = len;
+    keyframe_bytes += len;
+
+    frame_counter = keyframe->frame;
+    next_keyframe = frame_counter + (unsigned long)rewind_interval;
+
+    replay_event = keyframe->events;
+    replay_target = target;
+    if (frame_counter < replay_target) {
+        if (!replay_active) {
+            replay_saved_warp = vsync_get_warp_mode();
+            vsync_set_warp_mode(1);
+            replay_active = 1;
+        }
+        rewind_replay_alarm_set();
+    } else {
+        rewind_replay_stop();
+    }
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Count the frame, take keyframes and end the replay of a seek
+ *
+ * Called from vsync_do_vsync() at the end of each frame.
+ */
+void rewind_vsync_hook(void)
+{
+    if (rewind_buffer_size <= 0) {
+        return;
+    }
+
+    frame_counter++;
+
+    if (replay_active && frame_counter >= replay_target) {
+        DBG((rewind_log, "reached frame %lu", frame_counter));
+        rewind_replay_stop();
+    }
+
+    if (frame_counter >= next_keyframe && !keyframe_pending) {
+        next_keyframe = frame_counter + (unsigned long)rewind_interval;
+        keyframe_pending = 1;
+        interrupt_maincpu_trigger_trap(rewind_keyframe_trap, NULL);
+    }
+}
+
+/** \brief  Check if recorded input is being replayed after a seek
+ *
+ * The live keyboard and joystick input is ignored meanwhile.
+ *
+ * \return  non-zero while replaying
+ */
+int rewind_replay_active(void)
+{
+    return replay_active;
+}
+
+/** \brief  Drop the history, called on machine reset
+ */
+void rewind_reset(void)
+{
+    if (!restoring) {
+        rewind_clear();
+    }
+}
+
+/** \brief  Record an input event into the rewind history
+ *
+ * Called by event_record() for every input event, whether an event history
+ * is being recorded or not.
+ */
+void rewind_event_record(unsigned int type, void *data, unsigned int size)
+{
+    if (rewind_buffer_size <= 0 || replay_active || restoring
+        || rewind_events.current == NULL) {
+        return;
+    }
+
+    switch (type) {
+        case EVENT_KEYBOARD_MATRIX:
+        case EVENT_KEYBOARD_RESTORE:
+        case EVENT_JOYSTICK_VALUE:
+        case EVENT_DATASETTE:
+            event_record_in_list(&rewind_events, type, data, size);
+            break;
+        default:
+            break;
+    }
+}
+
+/** \brief  Rewind the emulation
+ *
+ * Goes back \a frames frames, or to the oldest keyframe if the history is
+ * shorter. The seek itself happens in a CPU trap.
+ *
+ * \return  0 on success, -1 if there is no history or a netplay session,
+ *          event recording or event playback is active
+ */
+int rewind_seek_frames(unsigned int frames)
+{
+    if (rewind_buffer_size <= 0 || keyframe_num == 0 || rewind_seek_blocked()) {
+        return -1;
+    }
+
+    interrupt_maincpu_trigger_trap(rewind_seek_trap, vice_uint_to_ptr(frames));
+    return 0;
+}
+
+/** \brief  Rewind the emulation by \a seconds seconds
+ *
+ * \return  0 on success, -1 if there is no history or a netplay session,
+ *          event recording or event playback is active
+ */
+int rewind_seek_seconds(unsigned int seconds)
+{
+    double frames = vsync_get_refresh_frequency() * seconds;
+
+    return rewind_seek_frames((unsigned int)(frames + 0.5));
+}
+
+/** \brief  Get the number of frames the history reaches back
+ */
+unsigned int rewind_get_history_frames(void)
+{
+    if (keyframe_num == 0) {
+        return 0;
+    }
+    return (unsigned int)(frame_counter - keyframe_get(0)->frame);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+static int set_rewind_buffer_size(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+
+    rewind_buffer_size = val;
+    if (val == 0) {
+        rewind_free_buffers();
+    }
+    return 0;
+}
+
+static int set_rewind_interval(int val, void *param)
+{
+    if (val < 1) {
+        return -1;
+    }
+
+    rewind_interval = val;
+    if (next_keyframe > frame_counter + (unsigned long)val) {
+        next_keyframe = frame_counter + (unsigned long)val;
+    }
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "RewindBufferSize", 0, RES_EVENT_NO, NULL,
+      &rewind_buffer_size, set_rewind_buffer_size, NULL },
+    { "RewindInterval", 50, RES_EVENT_NO, NULL,
+      &rewind_interval, set_rewind_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int rewind_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-rewindsize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindBufferSize", NULL,
+      "<MiB>", "Set the size of the rewind history in MiB (0: disable rewinding)" },
+    { "-rewindinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindInterval", NULL,
+      "<frames>", "Set the number of frames between rewind keyframes" },
+    CMDLINE_LIST_END
+};
+
+int rewind_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void rewind_init(void)
+{
+    rewind_log = log_open("Rewind");
+
+    replay_alarm = alarm_new(maincpu_alarm_context, "Rewind",
+                             rewind_replay_alarm_handler, NULL);
+    event_register_event_list(&rewind_events);
+}
+
+void rewind_shutdown(void)
+{
+    rewind_free_buffers();
+    if (rewind_events.base != NULL) {
+        lib_free(rewind_events.base);
+        rewind_events.base = NULL;
+        rewind_events.current = NULL;
+    }
+    lib_free(keyframes);
+    keyframes = NULL;
+    keyframe_max = 0;
+}
@@ -0,0 +1,625 @@
+/*
+ * sampleprof.c - Sampling CPU profiler.
+ *
+ * Unlike the instrumenting profiler in profiler.c, which accounts every
+ * instruction of the main CPU, this one only looks at the CPUs every
+ * "SampleProfilerInterval" cycles. An alarm in the alarm context of each CPU
+ * queues a trap, and the CPU core records its call stack in the trap before
+ * the next instruction. So the cores have no extra test per instruction, the
+ * trap goes through the pending interrupt check they do anyway. Between
+ * samples the cost is a call per JSR/RTS on CPUs that don't have their call
+ * stack tracked anyway, so it can stay enabled during long runs.
+ *
+ * A call stack consists of the targets of the calls, starting at the
+ * innermost interrupt like in profiler.c. When profiling stops, the number
+ * of samples per call stack is written as folded stacks (one
+ * "cpu;frame;frame count" line per stack, as read by flamegraph.pl and
+ * speedscope), and the most recent samples with their time as a Chrome
+ * trace (JSON trace event format, for chrome://tracing and Perfetto).
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "resources.h"
+#include "sampleprof.h"
+#include "types.h"
+#include "util.h"
+
+/* smallest sample interval, the traps would cost more than the code */
+#define SAMPLEPROF_MIN_INTERVAL     100
+
+/* number of samples kept per CPU for the trace */
+#define SAMPLEPROF_MAX_TRACE_SAMPLES (1U << 20)
+
+/* A call stack, as a node in a tree of the call stacks seen so far */
+typedef struct sampleprof_node_s {
+    uint16_t pc;                /* target of the call */
+    bool interrupt;             /* the call was an interrupt */
+    unsigned int parent;        /* index of the caller, 0 is the root */
+    unsigned int child;         /* first callee, 0 if none */
+    unsigned int next;          /* next callee of the parent, 0 if none */
+    unsigned long samples;      /* samples taken in this function */
+} sampleprof_node_t;
+
+typedef struct sampleprof_trace_sample_s {
+    CLOCK clk;
+    unsigned int node;
+} sampleprof_trace_sample_t;
+
+typedef struct sampleprof_private_s {
+    char *name;
+    alarm_t *alarm;
+    interrupt_cpu_status_t *int_status;
+    CLOCK *clk_ptr;
+    const int *clock_mhz;
+    sampleprof_callstack_func_t get_callstack;
+
+    CLOCK pending_clk;          /* clock the last sample was due */
+    CLOCK start_clk;            /* clock when profiling started */
+
+    sampleprof_node_t *nodes;
+    unsigned int num_nodes;
+    unsigned int nodes_size;
+
+    /* ring buffer of the most recent samples */
+    sampleprof_trace_sample_t *trace;
+    unsigned int trace_size;
+    unsigned long trace_count;
+
+    struct sampleprof_cpu_s *next;
+} sampleprof_private_t;
+
+sampleprof_cpu_t *maincpu_sampleprof = NULL;
+
+static log_t sampleprof_log = LOG_DEFAULT;
+
+static sampleprof_cpu_t *cpus = NULL;
+static bool profiling = false;
+
+static int sampleprof_interval = 0;
+static char *sampleprof_folded_file = NULL;
+static char *sampleprof_trace_file = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+static void sampleprof_sample(sampleprof_cpu_t *cpu);
+
+/* Runs in the CPU core that executes next on the interrupt status, which
+   is not this CPU when another one shares it and runs instead. */
+static void sampleprof_trap(uint16_t addr, void *data)
+{
+    sampleprof_cpu_t *cpu = data;
+
+    if (cpu->active && cpu->running) {
+        sampleprof_sample(cpu);
+    }
+}
+
+static void sampleprof_alarm_handler(CLOCK offset, void *data)
+{
+    sampleprof_cpu_t *cpu = data;
+    sampleprof_private_t *priv = cpu->priv;
+
+    priv->pending_clk = *(priv->clk_ptr) - offset;
+    interrupt_trigger_trap(priv->int_status, sampleprof_trap, cpu);
+
+    alarm_set(priv->alarm, priv->pending_clk + (CLOCK)sampleprof_interval);
+}
+
+static void sampleprof_cpu_clear(sampleprof_cpu_t *cpu)
+{
+    sampleprof_private_t *priv = cpu->priv;
+
+    lib_free(priv->nodes);
+    priv->nodes = NULL;
+    priv->num_nodes = 0;
+    priv->nodes_size = 0;
+
+    lib_free(priv->trace);
+    priv->trace = NULL;
+    priv->trace_size = 0;
+    priv->trace_count = 0;
+}
+
+static void sampleprof_cpu_start(sampleprof_cpu_t *cpu)
+{
+    sampleprof_private_t *priv = cpu->priv;
+
+    sampleprof_cpu_clear(cpu);
+
+    /* the root of the call stacks */
+    priv->nodes_size = 256;
+    priv->nodes = lib_calloc(priv->nodes_size, sizeof(sampleprof_node_t));
+    priv->num_nodes = 1;
+
+    priv->start_clk = *(priv->clk_ptr);
+    cpu->depth = 0;
+    cpu->active = 1;
+
+    alarm_set(priv->alarm, priv->start_clk + (CLOCK)sampleprof_interval);
+}
+
+static void sampleprof_cpu_stop(sampleprof_cpu_t *cpu)
+{
+    alarm_unset(cpu->priv->alarm);
+    cpu->active = 0;
+}
+
+sampleprof_cpu_t *sampleprof_cpu_new(const char *name,
+                                     alarm_context_t *alarm_context,
+                                     interrupt_cpu_status_t *int_status,
+                                     CLOCK *clk_ptr,
+                                     const int *clock_mhz,
+                                     sampleprof_callstack_func_t get_callstack)
+{
+    sampleprof_cpu_t *cpu = lib_calloc(1, sizeof(sampleprof_cpu_t));
+    sampleprof_private_t *priv = lib_calloc(1, sizeof(sampleprof_private_t));
+
+    cpu->priv = priv;
+    cpu->running = 1;
+    priv->name = lib_strdup(name);
+    priv->alarm = alarm_new(alarm_context, "SampleProfiler",
+                            sampleprof_alarm_handler, cpu);
+    priv->int_status = int_status;
+    priv->clk_ptr = clk_ptr;
+    priv->clock_mhz = clock_mhz;
+    priv->get_callstack = get_callstack;
+
+    priv->next = cpus;
+    cpus = cpu;
+
+    if (profiling) {
+        sampleprof_cpu_start(cpu);
+    }
+
+    return cpu;
+}
+
+void sampleprof_cpu_destroy(sampleprof_cpu_t *cpu)
+{
+    sampleprof_cpu_t **p;
+
+    if (cpu == NULL) {
+        return;
+    }
+
+    for (p = &cpus; *p != NULL; p = &(*p)->priv->next) {
+        if (*p == cpu) {
+            *p = cpu->priv->next;
+            break;
+        }
+    }
+
+    sampleprof_cpu_clear(cpu);
+    alarm_destroy(cpu->priv->alarm);
+    lib_free(cpu->priv->name);
+    lib_free(cpu->priv);
+    lib_free(cpu);
+}
+
+void sampleprof_cpu_switch(sampleprof_cpu_t *from, sampleprof_cpu_t *to)
+{
+    if (from != NULL) {
+        from->running = 0;
+    }
+    if (to != NULL) {
+        to->running = 1;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static unsigned int get_child_node(sampleprof_private_t *priv,
+                                   unsigned int parent,
+                                   uint16_t pc, bool interrupt)
+{
+    sampleprof_node_t *node;
+    unsigned int n;
+
+    for (n = priv->nodes[parent].child; n != 0; n = priv->nodes[n].next) {
+        if (priv->nodes[n].pc == pc && priv->nodes[n].interrupt == interrupt) {
+            return n;
+        }
+    }
+
+    if (priv->num_nodes == priv->nodes_size) {
+        priv->nodes_size *= 2;
+        priv->nodes = lib_realloc(priv->nodes,
+                                  priv->nodes_size * sizeof(sampleprof_node_t));
+    }
+
+    n = priv->num_nodes++;
+    node = &priv->nodes[n];
+    node->pc = pc;
+    node->interrupt = interrupt;
+    node->parent = parent;
+    node->child = 0;
+    node->samples = 0;
+    node->next = priv->nodes[parent].child;
+    priv->nodes[parent].child = n;
+
+    return n;
+}
+
+static void add_trace_sample(sampleprof_private_t *priv, unsigned int node)
+{
+    unsigned int i;
+
+    if (priv->trace_count == priv->trace_size
+        && priv->trace_size < SAMPLEPROF_MAX_TRACE_SAMPLES) {
+        priv->trace_size = priv->trace_size ? priv->trace_size * 2 : 4096;
+        priv->trace = lib_realloc(priv->trace,
+                                  priv->trace_size * sizeof(sampleprof_trace_sample_t));
+    }
+
+    i = (unsigned int)(priv->trace_count % priv->trace_size);
+    priv->trace[i].clk = priv->pending_clk - priv->start_clk;
+    priv->trace[i].node = node;
+    priv->trace_count++;
+}
+
+static void sampleprof_sample(sampleprof_cpu_t *cpu)
+{
+    sampleprof_private_t *priv = cpu->priv;
+    uint16_t stack_pc[SAMPLEPROF_MAX_DEPTH];
+    bool stack_interrupt[SAMPLEPROF_MAX_DEPTH];
+    const uint16_t *pcs;
+    const bool *interrupts;
+    unsigned int depth, head, i, node;
+
+    if (priv->get_callstack != NULL) {
+        depth = priv->get_callstack(stack_pc, stack_interrupt, SAMPLEPROF_MAX_DEPTH);
+        pcs = stack_pc;
+        interrupts = stack_interrupt;
+    } else {
+        depth = cpu->depth;
+        pcs = cpu->stack_pc;
+        interrupts = cpu->stack_interrupt;
+    }
+
+    /* start at the innermost interrupt */
+    for (head = depth; head > 0; head--) {
+        if (interrupts[head - 1]) {
+            head--;
+            break;
+        }
+    }
+
+    node = 0;
+    for (i = head; i < depth; i++) {
+        node = get_child_node(priv, node, pcs[i], interrupts[i]);
+    }
+    priv->nodes[node].samples++;
+
+    if (sampleprof_trace_file != NULL && *sampleprof_trace_file != '\0') {
+        add_trace_sample(priv, node);
+    }
+}
+
+static void sampleprof_push(sampleprof_cpu_t *cpu, uint16_t pc_dst, uint16_t sp,
+                            bool interrupt)
+{
+    if (cpu->depth >= SAMPLEPROF_MAX_DEPTH) {
+        /* stack overflow; do nothing */
+        return;
+    }
+    cpu->stack_pc[cpu->depth] = pc_dst;
+    cpu->stack_sp[cpu->depth] = sp;
+    cpu->stack_interrupt[cpu->depth] = interrupt;
+    cpu->depth++;
+}
+
+void sampleprof_call(sampleprof_cpu_t *cpu, uint16_t pc_dst, uint16_t sp)
+{
+    sampleprof_push(cpu, pc_dst, sp, false);
+}
+
+void sampleprof_interrupt(sampleprof_cpu_t *cpu, uint16_t pc_dst, uint16_t sp)
+{
+    sampleprof_push(cpu, pc_dst, sp, true);
+}
+
+/* Like profile_rtx(), a return with the stack pointer above the one stored
+   with the call is a jump through a pushed address, not a return. */
+void sampleprof_return(sampleprof_cpu_t *cpu, uint16_t sp)
+{
+    while (cpu->depth != 0 && sp >= cpu->stack_sp[cpu->depth - 1]) {
+        cpu->depth--;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void write_frame_name(FILE *f, const sampleprof_node_t *node)
+{
+    fprintf(f, node->interrupt ? "int $%04x" : "$%04x", node->pc);
+}
+
+static void write_folded_stack(FILE *f, sampleprof_private_t *priv,
+                               unsigned int n)
+{
+    if (n == 0) {
+        fputs(priv->name, f);
+        return;
+    }
+    write_folded_stack(f, priv, priv->nodes[n].parent);
+    fputc(';', f);
+    write_frame_name(f, &priv->nodes[n]);
+}
+
+static int write_folded(const char *filename)
+{
+    FILE *f;
+    sampleprof_cpu_t *cpu;
+    unsigned int n;
+
+    f = fopen(filename, "w");
+    if (f == NULL) {
+        log_error(sampleprof_log, "Cannot write `%s'.", filename);
+        return -1;
+    }
+
+    for (cpu = cpus; cpu != NULL; cpu = cpu->priv->next) {
+        sampleprof_private_t *priv = cpu->priv;
+
+        for (n = 0; n < priv->num_nodes; n++) {
+            if (priv->nodes[n].samples != 0) {
+                write_folded_stack(f, priv, n);
+                fprintf(f, " %lu\n", priv->nodes[n].samples);
+            }
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static double cycles_per_usec(sampleprof_private_t *priv)
+{
+    if (priv->clock_mhz != NULL) {
+        return (double)*(priv->clock_mhz);
+    }
+    return (double)machine_get_cycles_per_second() / 1000000.0;
+}
+
+static int write_trace(const char *filename)
+{
+    FILE *f;
+    sampleprof_cpu_t *cpu;
+    unsigned int tid, n;
+    unsigned long i, first;
+    const char *sep = "";
+
+    f = fopen(filename, "w");
+    if (f == NULL) {
+        log_error(sampleprof_log, "Cannot write `%s'.", filename);
+        return -1;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n"
+               "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}",
+               machine_get_name());
+    for (cpu = cpus, tid = 1; cpu != NULL; cpu = cpu->priv->next, tid++) {
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                tid, cpu->priv->name);
+    }
+
+    fputs("\n],\n\"stackFrames\":{\n", f);
+    for (cpu = cpus, tid = 1; cpu != NULL; cpu = cpu->priv->next, tid++) {
+        sampleprof_private_t *priv = cpu->priv;
+
+        for (n = 0; n < priv->num_nodes; n++) {
+            fprintf(f, "%s\"%u-%u\":{\"category\":\"%s\",\"name\":\"",
+                    sep, tid, n, priv->name);
+            if (n == 0) {
+                fputs(priv->name, f);
+                fputs("\"}", f);
+            } else {
+                write_frame_name(f, &priv->nodes[n]);
+                fprintf(f, "\",\"parent\":\"%u-%u\"}", tid, priv->nodes[n].parent);
+            }
+            sep = ",\n";
+        }
+    }
+
+    fputs("\n},\n\"samples\":[\n", f);
+    sep = "";
+    for (cpu = cpus, tid = 1; cpu != NULL; cpu = cpu->priv->next, tid++) {
+        sampleprof_private_t *priv = cpu->priv;
+        double rate = cycles_per_usec(priv);
+
+        if (priv->trace_count == 0) {
+            continue;
+        }
+        first = priv->trace_count > priv->trace_size
+                ? priv->trace_count - priv->trace_size : 0;
+        for (i = first; i < priv->trace_count; i++) {
+            sampleprof_trace_sample_t *s = &priv->trace[i % priv->trace_size];
+
+            fprintf(f, "%s{\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":\"cycles\",\"sf\":\"%u-%u\",\"weight\":1}",
+                    sep, tid, (double)s->clk / rate, tid, s->node);
+            sep = ",\n";
+        }
+    }
+    fputs("\n]}\n", f);
+
+    fclose(f);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void sampleprof_start(unsigned int interval)
+{
+    sampleprof_cpu_t *cpu;
+
+    if (profiling) {
+        sampleprof_stop();
+    }
+
+    if (sampleprof_log == LOG_DEFAULT) {
+        sampleprof_log = log_open("SampleProfiler");
+    }
+
+    if (interval < SAMPLEPROF_MIN_INTERVAL) {
+        interval = SAMPLEPROF_MIN_INTERVAL;
+    }
+    sampleprof_interval = (int)interval;
+    profiling = true;
+
+    for (cpu = cpus; cpu != NULL; cpu = cpu->priv->next) {
+        sampleprof_cpu_start(cpu);
+    }
+}
+
+void sampleprof_stop(void)
+{
+    sampleprof_cpu_t *cpu;
+
+    if (!profiling) {
+        return;
+    }
+    profiling = false;
+
+    for (cpu = cpus; cpu != NULL; cpu = cpu->priv->next) {
+        sampleprof_cpu_stop(cpu);
+    }
+
+    if (sampleprof_folded_file != NULL && *sampleprof_folded_file != '\0') {
+        if (write_folded(sampleprof_folded_file) == 0) {
+            log_message(sampleprof_log, "Folded stacks written to `%s'.",
+                        sampleprof_folded_file);
+        }
+    }
+    if (sampleprof_trace_file != NULL && *sampleprof_trace_file != '\0') {
+        if (write_trace(sampleprof_trace_file) == 0) {
+            log_message(sampleprof_log, "Trace written to `%s'.",
+                        sampleprof_trace_file);
+        }
+    }
+
+    for (cpu = cpus; cpu != NULL; cpu = cpu->priv->next) {
+        sampleprof_cpu_clear(cpu);
+    }
+}
+
+/* The profilers of the drive CPUs are destroyed with them, this destroys the
+   remaining ones before the main alarm context goes away. */
+void sampleprof_shutdown(void)
+{
+    sampleprof_stop();
+
+    while (cpus != NULL) {
+        sampleprof_cpu_destroy(cpus);
+    }
+    maincpu_sampleprof = NULL;
+
+    lib_free(sampleprof_folded_file);
+    sampleprof_folded_file = NULL;
+    lib_free(sampleprof_trace_file);
+    sampleprof_trace_file = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_sampleprof_interval(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+    if (val > 0 && val < SAMPLEPROF_MIN_INTERVAL) {
+        val = SAMPLEPROF_MIN_INTERVAL;
+    }
+
+    if (val == 0) {
+        sampleprof_stop();
+    } else if (!profiling) {
+        sampleprof_start((unsigned int)val);
+    }
+    /* when already profiling, the new interval is used from the next
+       sample on */
+    sampleprof_interval = val;
+    return 0;
+}
+
+static int set_sampleprof_folded_file(const char *val, void *param)
+{
+    util_string_set(&sampleprof_folded_file, val);
+    return 0;
+}
+
+static int set_sampleprof_trace_file(const char *val, void *param)
+{
+    util_string_set(&sampleprof_trace_file, val);
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "SampleProfilerFoldedFile", "", RES_EVENT_NO, NULL,
+      &sampleprof_folded_file, set_sampleprof_folded_file, NULL },
+    { "SampleProfilerTraceFile", "", RES_EVENT_NO, NULL,
+      &sampleprof_trace_file, set_sampleprof_trace_file, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "SampleProfilerInterval", 0, RES_EVENT_NO, NULL,
+      &sampleprof_interval, set_sampleprof_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int sampleprof_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-sampleprof", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SampleProfilerInterval", NULL,
+      "<cycles>", "Sample the call stacks of all CPUs every <cycles> cycles (0: disable)" },
+    { "-sampleproffolded", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SampleProfilerFoldedFile", NULL,
+      "<Name>", "Write the sampled call stacks as folded stacks (flame graph input) to <Name>" },
+    { "-sampleproftrace", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SampleProfilerTraceFile", NULL,
+      "<Name>", "Write the sampled call stacks as Chrome trace JSON to <Name>" },
+    CMDLINE_LIST_END
+};
+
+int sampleprof_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,90 @@
+/*
+ * sampleprof.h - Sampling CPU profiler.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SAMPLEPROF_H
+#define VICE_SAMPLEPROF_H
+
+#include "types.h"
+
+struct alarm_context_s;
+struct interrupt_cpu_status_s;
+
+#define SAMPLEPROF_MAX_DEPTH 129
+
+/* Fills `pc_dst' and `interrupt' with the current call stack, outermost call
+   first, and returns its depth. */
+typedef unsigned int (*sampleprof_callstack_func_t)(uint16_t *pc_dst,
+                                                    bool *interrupt,
+                                                    unsigned int max_depth);
+
+typedef struct sampleprof_cpu_s {
+    /* non-zero while profiling, calls and returns are only tracked then */
+    int active;
+
+    /* zero while another CPU sharing the interrupt status runs instead of
+       this one (C128 Z80, SuperPET 6809), see sampleprof_cpu_switch() */
+    int running;
+
+    /* call stack, when not taken from `get_callstack' */
+    unsigned int depth;
+    uint16_t stack_pc[SAMPLEPROF_MAX_DEPTH];
+    uint16_t stack_sp[SAMPLEPROF_MAX_DEPTH];
+    bool stack_interrupt[SAMPLEPROF_MAX_DEPTH];
+
+    /* private */
+    struct sampleprof_private_s *priv;
+} sampleprof_cpu_t;
+
+/* The profiler for the CPU(s) using the main alarm context */
+extern sampleprof_cpu_t *maincpu_sampleprof;
+
+int sampleprof_resources_init(void);
+int sampleprof_cmdline_options_init(void);
+void sampleprof_shutdown(void);
+
+/* The samples are taken by a trap in `int_status', which the CPU runs
+   before its next instruction.  `clock_mhz' is the clock of the CPU in MHz,
+   NULL for the machine clock.  If `get_callstack' is NULL, calls must be
+   reported with sampleprof_call() and friends. */
+sampleprof_cpu_t *sampleprof_cpu_new(const char *name,
+                                     struct alarm_context_s *alarm_context,
+                                     struct interrupt_cpu_status_s *int_status,
+                                     CLOCK *clk_ptr,
+                                     const int *clock_mhz,
+                                     sampleprof_callstack_func_t get_callstack);
+void sampleprof_cpu_destroy(sampleprof_cpu_t *cpu);
+
+/* `to' takes over from `from' until switched back, either may be NULL */
+void sampleprof_cpu_switch(sampleprof_cpu_t *from, sampleprof_cpu_t *to);
+
+/* `sp' is the stack pointer after the return address was pushed */
+void sampleprof_call(sampleprof_cpu_t *cpu, uint16_t pc_dst, uint16_t sp);
+void sampleprof_interrupt(sampleprof_cpu_t *cpu, uint16_t pc_dst, uint16_t sp);
+/* `sp' is the stack pointer before the return address is pulled */
+void sampleprof_return(sampleprof_cpu_t *cpu, uint16_t sp);
+
+/* starts profiling every `interval' cycles, writes the results when stopped */
+void sampleprof_start(unsigned int interval);
+void sampleprof_stop(void);
+
+#endif
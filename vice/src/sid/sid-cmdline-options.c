@@ -210,6 +210,10 @@ static const cmdline_option_t resid_cmdline_options[] =
       NULL, NULL, "SidResidEnableRawOutput", (void *)1, NULL, "Enable writing raw reSID output to resid.raw, 16bit little endian data (WARNING: 1MiB per second)." },
     { "+residrawoutput", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "SidResidEnableRawOutput", (void *)0, NULL, "Disable writing raw reSID output to resid.raw." },
+    { "-residthreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidResidThreads", (void *)1, NULL, "Clock multiple reSID chips on worker threads." },
+    { "+residthreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidResidThreads", (void *)0, NULL, "Clock all reSID chips on the emulation thread." },
     CMDLINE_LIST_END
 };
 #endif
@@ -61,7 +61,8 @@ static int sid_resid_filter_bias;
 static int sid_resid_8580_passband;
 static int sid_resid_8580_gain;
 static int sid_resid_8580_filter_bias;
-static int sid_resid_enable_raw_output;
+int sid_resid_enable_raw_output;
+int sid_resid_threads = 0;
 #endif
 int sid_stereo = 0;
 int checking_sid_stereo;
@@ -152,6 +153,13 @@ static int set_sid_resid_enable_raw_output(int val, void *param)
 
     return 0;
 }
+
+static int set_sid_resid_threads(int val, void *param)
+{
+    sid_resid_threads = val ? 1 : 0;
+
+    return 0;
+}
 #endif
 
 static int set_sid_stereo(int val, void *param)
@@ -382,6 +390,8 @@ void sid_set_enable(int value)
 static const resource_int_t resid_resources_int[] = {
     { "SidResidEnableRawOutput", 0, RES_EVENT_NO, NULL,
       &sid_resid_enable_raw_output, set_sid_resid_enable_raw_output, NULL },
+    { "SidResidThreads", 0, RES_EVENT_NO, NULL,
+      &sid_resid_threads, set_sid_resid_threads, NULL },
     { "SidResidSampling", SID_RESID_SAMPLING_RESAMPLING, RES_EVENT_NO, NULL,
       &sid_resid_sampling, set_sid_resid_sampling, NULL },
     { "SidResidPassband", RESID_6581_PASSBAND_DEFAULT, RES_EVENT_NO, NULL,
@@ -56,4 +56,9 @@ extern unsigned int sid7_address_end;
 extern unsigned int sid8_address_start;
 extern unsigned int sid8_address_end;
 
+#ifdef HAVE_RESID
+extern int sid_resid_enable_raw_output;
+extern int sid_resid_threads;
+#endif
+
 #endif
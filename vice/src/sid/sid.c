@@ -641,6 +641,81 @@ int sid_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int
     return sid_engine.calculate_samples(psid[scc], pbuf, nr, delta_t);
 }
 #else
+/* Minimum number of cycles a multi-SID render call has to cover before the
+   chips are clocked on worker threads */
+#define SID_RENDER_THREADS_MIN_CYCLES   2000
+
+/* One chip rendered by sid_render_run() */
+typedef struct sid_render_chip_s {
+    sound_t *psid;
+    int16_t *pbuf;
+    int interleave;
+    CLOCK delta_t;
+    int nr;
+} sid_render_chip_t;
+
+/* The chips needed for one call of sid_sound_machine_calculate_samples() */
+typedef struct sid_render_s {
+    sid_render_chip_t chip[SOUND_SIDS_MAX];
+    int num;
+} sid_render_t;
+
+static void sid_render_add(sid_render_t *render, sound_t *psid, int16_t *pbuf, int interleave)
+{
+    sid_render_chip_t *chip = &render->chip[render->num++];
+
+    chip->psid = psid;
+    chip->pbuf = pbuf;
+    chip->interleave = interleave;
+}
+
+/* Check if several reSID chips are clocked on worker threads. Every reSID
+   chip only touches its own state and output buffer, which keeps the result
+   identical to clocking them one after another. The raw debug output is
+   shared by all chips. */
+static int sid_render_threads_enabled(void)
+{
+#ifdef HAVE_RESID
+    return sid_resid_threads && !sid_resid_enable_raw_output
+           && sidengine == SID_ENGINE_RESID && sid_stereo > 0;
+#else
+    return 0;
+#endif
+}
+
+/* Clock all chips over the same cycles. The last chip added determines the
+   returned number of samples and the remaining cycles, as it did before. */
+static int sid_render_run(sid_render_t *render, int nr, CLOCK *delta_t)
+{
+    sid_render_chip_t *last = &render->chip[render->num - 1];
+    int i;
+
+    for (i = 0; i < render->num; i++) {
+        render->chip[i].delta_t = *delta_t;
+    }
+
+    if (render->num > 1 && *delta_t >= SID_RENDER_THREADS_MIN_CYCLES
+        && sid_render_threads_enabled()) {
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(render->num) schedule(static, 1)
+#endif
+        for (i = 0; i < render->num; i++) {
+            sid_render_chip_t *chip = &render->chip[i];
+
+            chip->nr = sid_engine.calculate_samples(chip->psid, chip->pbuf, nr, chip->interleave, &chip->delta_t);
+        }
+    } else {
+        for (i = 0; i < render->num; i++) {
+            sid_render_chip_t *chip = &render->chip[i];
+
+            chip->nr = sid_engine.calculate_samples(chip->psid, chip->pbuf, nr, chip->interleave, &chip->delta_t);
+        }
+    }
+
+    *delta_t = last->delta_t;
+    return last->nr;
+}
+
 int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
     int i;
@@ -652,15 +727,18 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     int16_t *tmp_buf6;
     int16_t *tmp_buf7;
     int tmp_nr = 0;
-    CLOCK tmp_delta_t = *delta_t;
+    sid_render_t render;
+
+    render.num = 0;
 
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_1_DEVICE) {
         return sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
     }
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_2_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
         }
@@ -669,10 +747,10 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_3_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[2], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -683,12 +761,11 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[2], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[3], tmp_buf3, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -701,14 +778,12 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
         tmp_buf4 = getbuf4(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[2], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[3], tmp_buf3, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[4], tmp_buf4, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -723,16 +798,13 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf3 = getbuf3(2 * nr);
         tmp_buf4 = getbuf4(2 * nr);
         tmp_buf5 = getbuf5(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[2], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[3], tmp_buf3, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[4], tmp_buf4, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[5], tmp_buf5, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -749,18 +821,14 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf4 = getbuf4(2 * nr);
         tmp_buf5 = getbuf5(2 * nr);
         tmp_buf6 = getbuf6(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf6, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[2], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[3], tmp_buf3, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[4], tmp_buf4, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[5], tmp_buf5, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[6], tmp_buf6, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -779,20 +847,15 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf5 = getbuf5(2 * nr);
         tmp_buf6 = getbuf6(2 * nr);
         tmp_buf7 = getbuf7(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf6, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[7], tmp_buf7, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        sid_render_add(&render, psid[0], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[2], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[3], tmp_buf3, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[4], tmp_buf4, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[5], tmp_buf5, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[6], tmp_buf6, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[7], tmp_buf7, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[1], pbuf, SOUND_OUTPUT_MONO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -812,16 +875,17 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         return tmp_nr;
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_2_DEVICES) {
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         return tmp_nr;
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_3_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[2], tmp_buf1, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i]);
             pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[i]);
@@ -829,12 +893,11 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_4_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[2], tmp_buf1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[3], tmp_buf1 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
@@ -843,14 +906,12 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_5_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[2], tmp_buf1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[3], tmp_buf1 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[4], tmp_buf2, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i]);
@@ -861,16 +922,13 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_6_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[2], tmp_buf1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[3], tmp_buf1 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[4], tmp_buf2, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[5], tmp_buf2 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
@@ -882,18 +940,14 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[2], tmp_buf1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[3], tmp_buf1 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[4], tmp_buf2, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[5], tmp_buf2 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[6], tmp_buf3, SOUND_OUTPUT_MONO);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
@@ -907,20 +961,15 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf3, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[7], tmp_buf3 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        sid_render_add(&render, psid[2], tmp_buf1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[3], tmp_buf1 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[4], tmp_buf2, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[5], tmp_buf2 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[6], tmp_buf3, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[7], tmp_buf3 + 1, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[0], pbuf, SOUND_OUTPUT_STEREO);
+        sid_render_add(&render, psid[1], pbuf + 1, SOUND_OUTPUT_STEREO);
+        tmp_nr = sid_render_run(&render, nr, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
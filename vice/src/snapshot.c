@@ -61,15 +61,42 @@ static char *current_machine_name = NULL;
 static char *current_filename = NULL;
 static size_t current_fpos = 0;
 
+/* Memory buffer used by the next snapshot_create()/snapshot_open() instead
+   of a file, see snapshot_memory_select().  */
+static snapshot_memory_t *selected_memory = NULL;
+
 static const char snapshot_magic_string[] = "VICE Snapshot File\032";
 static const char snapshot_version_magic_string[] = "VICE Version\032";
 
 #define SNAPSHOT_MAGIC_LEN              19
 #define SNAPSHOT_VERSION_MAGIC_LEN      13
 
+/* Name used in error messages for snapshots in memory.  */
+#define SNAPSHOT_MEMORY_NAME            "(memory)"
+
+/* Initial size of the buffer of a memory snapshot, it grows as needed.  */
+#define SNAPSHOT_MEMORY_INITIAL_SIZE    0x10000
+
+/* Granularity of snapshot_memory_diff().  */
+#define SNAPSHOT_DELTA_PAGE_SIZE        256
+
+/* Number of array elements converted at once by the array functions.  */
+#define SNAPSHOT_ARRAY_CHUNK            256
+
+struct snapshot_memory_s {
+    /* Snapshot data.  */
+    uint8_t *data;
+
+    /* Number of bytes used in `data'.  */
+    size_t len;
+
+    /* Number of bytes allocated for `data'.  */
+    size_t size;
+};
+
 struct snapshot_module_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* Snapshot the module belongs to.  */
+    snapshot_t *snapshot;
 
     /* Flag: are we writing it?  */
     int write_mode;
@@ -85,9 +112,15 @@ struct snapshot_module_s {
 };
 
 struct snapshot_s {
-    /* File descriptor.  */
+    /* File descriptor, NULL for a memory snapshot.  */
     FILE *file;
 
+    /* Memory buffer, NULL for a snapshot file.  */
+    snapshot_memory_t *memory;
+
+    /* Current position in the memory buffer.  */
+    size_t pos;
+
     /* Offset of the first module.  */
     long first_module_offset;
 
@@ -97,10 +130,106 @@ struct snapshot_s {
 
 /* ------------------------------------------------------------------------- */
 
-static int snapshot_write_byte(FILE *f, uint8_t data)
+static long snapshot_tell(snapshot_t *s)
+{
+    if (s->memory != NULL) {
+        return (long)s->pos;
+    }
+    return ftell(s->file);
+}
+
+static int snapshot_seek(snapshot_t *s, long offset)
+{
+    if (s->memory != NULL) {
+        if (offset < 0 || (size_t)offset > s->memory->len) {
+            return -1;
+        }
+        s->pos = (size_t)offset;
+        return 0;
+    }
+    return fseek(s->file, offset, SEEK_SET);
+}
+
+/* Make room for `size' bytes in the memory buffer.  */
+static void snapshot_memory_reserve(snapshot_memory_t *mem, size_t size)
+{
+    if (size > mem->size) {
+        size_t new_size = mem->size ? mem->size : SNAPSHOT_MEMORY_INITIAL_SIZE;
+
+        while (size > new_size) {
+            new_size *= 2;
+        }
+        mem->data = lib_realloc(mem->data, new_size);
+        mem->size = new_size;
+    }
+}
+
+/* Write `num' bytes to the snapshot. Does not set snapshot_error.  */
+static int snapshot_write_block(snapshot_t *s, const void *data, size_t num)
+{
+    snapshot_memory_t *mem = s->memory;
+
+    if (mem == NULL) {
+        current_fpos = ftell(s->file);
+        return (num > 0 && fwrite(data, num, 1, s->file) < 1) ? -1 : 0;
+    }
+
+    current_fpos = s->pos;
+    snapshot_memory_reserve(mem, s->pos + num);
+    memcpy(mem->data + s->pos, data, num);
+    s->pos += num;
+    if (s->pos > mem->len) {
+        mem->len = s->pos;
+    }
+    return 0;
+}
+
+/* Read `num' bytes from the snapshot. Does not set snapshot_error.  */
+static int snapshot_read_block(snapshot_t *s, void *data, size_t num)
+{
+    snapshot_memory_t *mem = s->memory;
+
+    if (mem == NULL) {
+        current_fpos = ftell(s->file);
+        return (num > 0 && fread(data, num, 1, s->file) < 1) ? -1 : 0;
+    }
+
+    current_fpos = s->pos;
+    if (num > mem->len - s->pos) {
+        return -1;
+    }
+    memcpy(data, mem->data + s->pos, num);
+    s->pos += num;
+    return 0;
+}
+
+static void snapshot_put_word(uint8_t *p, uint16_t data)
+{
+    p[0] = (uint8_t)(data & 0xff);
+    p[1] = (uint8_t)(data >> 8);
+}
+
+static void snapshot_put_dword(uint8_t *p, uint32_t data)
+{
+    snapshot_put_word(p, (uint16_t)(data & 0xffff));
+    snapshot_put_word(p + 2, (uint16_t)(data >> 16));
+}
+
+static uint16_t snapshot_get_word(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t snapshot_get_dword(const uint8_t *p)
+{
+    return snapshot_get_word(p) | ((uint32_t)snapshot_get_word(p + 2) << 16);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int snapshot_write_byte(snapshot_t *s, uint8_t data)
 {
-    current_fpos = ftell(f);
-    if (fputc(data, f) == EOF) {
+    if (snapshot_write_block(s, &data, 1) < 0) {
         snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
@@ -108,66 +237,67 @@ static int snapshot_write_byte(FILE *f, uint8_t data)
     return 0;
 }
 
-static int snapshot_write_word(FILE *f, uint16_t data)
+static int snapshot_write_word(snapshot_t *s, uint16_t data)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_byte(f, (uint8_t)(data & 0xff)) < 0
-        || snapshot_write_byte(f, (uint8_t)(data >> 8)) < 0) {
+    uint8_t buf[2];
+
+    snapshot_put_word(buf, data);
+    if (snapshot_write_block(s, buf, sizeof(buf)) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
 
     return 0;
 }
 
-static int snapshot_write_dword(FILE *f, uint32_t data)
+static int snapshot_write_dword(snapshot_t *s, uint32_t data)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)(data & 0xffff)) < 0
-        || snapshot_write_word(f, (uint16_t)(data >> 16)) < 0) {
+    uint8_t buf[4];
+
+    snapshot_put_dword(buf, data);
+    if (snapshot_write_block(s, buf, sizeof(buf)) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
 
     return 0;
 }
 
-static int snapshot_write_qword(FILE *f, uint64_t data)
+static int snapshot_write_qword(snapshot_t *s, uint64_t data)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_dword(f, (uint32_t)(data & 0xffffffff)) < 0
-        || snapshot_write_dword(f, (uint32_t)(data >> 32)) < 0) {
+    uint8_t buf[8];
+
+    snapshot_put_dword(buf, (uint32_t)(data & 0xffffffff));
+    snapshot_put_dword(buf + 4, (uint32_t)(data >> 32));
+    if (snapshot_write_block(s, buf, sizeof(buf)) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
 
     return 0;
 }
 
-static int snapshot_write_double(FILE *f, double data)
+static int snapshot_write_double(snapshot_t *s, double data)
 {
-    uint8_t *byte_data = (uint8_t *)&data;
-    int i;
-
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        if (snapshot_write_byte(f, byte_data[i]) < 0) {
-            return -1;
-        }
+    if (snapshot_write_block(s, &data, sizeof(double)) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        return -1;
     }
     return 0;
 }
 
-static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char,
+static int snapshot_write_padded_string(snapshot_t *s, const char *str, uint8_t pad_char,
                                         int len)
 {
     int i, found_zero;
     uint8_t c;
 
-    current_fpos = ftell(f);
     for (i = found_zero = 0; i < len; i++) {
-        if (!found_zero && s[i] == 0) {
+        if (!found_zero && str[i] == 0) {
             found_zero = 1;
         }
-        c = found_zero ? (uint8_t)pad_char : (uint8_t) s[i];
-        if (snapshot_write_byte(f, c) < 0) {
+        c = found_zero ? (uint8_t)pad_char : (uint8_t) str[i];
+        if (snapshot_write_byte(s, c) < 0) {
             return -1;
         }
     }
@@ -175,10 +305,9 @@ static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char
     return 0;
 }
 
-static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int num)
+static int snapshot_write_byte_array(snapshot_t *s, const uint8_t *data, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1) {
+    if (snapshot_write_block(s, data, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -186,132 +315,130 @@ static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int num)
+static int snapshot_write_word_array(snapshot_t *s, const uint16_t *data, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[SNAPSHOT_ARRAY_CHUNK * 2];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_write_word(f, data[i]) < 0) {
+    while (num > 0) {
+        n = num < SNAPSHOT_ARRAY_CHUNK ? num : SNAPSHOT_ARRAY_CHUNK;
+        for (i = 0; i < n; i++) {
+            snapshot_put_word(buf + i * 2, data[i]);
+        }
+        if (snapshot_write_block(s, buf, n * 2) < 0) {
+            snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
             return -1;
         }
+        data += n;
+        num -= n;
     }
 
     return 0;
 }
 
-static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned int num)
+static int snapshot_write_dword_array(snapshot_t *s, const uint32_t *data, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[SNAPSHOT_ARRAY_CHUNK * 4];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_write_dword(f, data[i]) < 0) {
+    while (num > 0) {
+        n = num < SNAPSHOT_ARRAY_CHUNK ? num : SNAPSHOT_ARRAY_CHUNK;
+        for (i = 0; i < n; i++) {
+            snapshot_put_dword(buf + i * 4, data[i]);
+        }
+        if (snapshot_write_block(s, buf, n * 4) < 0) {
+            snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
             return -1;
         }
+        data += n;
+        num -= n;
     }
 
     return 0;
 }
 
 
-static int snapshot_write_string(FILE *f, const char *s)
+static int snapshot_write_string(snapshot_t *s, const char *str)
 {
-    size_t len, i;
+    size_t len;
 
-    len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
+    len = str ? (strlen(str) + 1) : 0;      /* length includes nullbyte */
 
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)len) < 0) {
+    if (snapshot_write_word(s, (uint16_t)len) < 0) {
         return -1;
     }
 
-    for (i = 0; i < len; i++) {
-        if (snapshot_write_byte(f, s[i]) < 0) {
-            return -1;
-        }
+    if (snapshot_write_block(s, str, len) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        return -1;
     }
 
     return (int)(len + sizeof(uint16_t));
 }
 
-static int snapshot_read_byte(FILE *f, uint8_t *b_return)
+static int snapshot_read_byte(snapshot_t *s, uint8_t *b_return)
 {
-    int c;
-
-    current_fpos = ftell(f);
-    c = fgetc(f);
-    if (c == EOF) {
+    if (snapshot_read_block(s, b_return, 1) < 0) {
         snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
-    *b_return = (uint8_t)c;
     return 0;
 }
 
-static int snapshot_read_word(FILE *f, uint16_t *w_return)
+static int snapshot_read_word(snapshot_t *s, uint16_t *w_return)
 {
-    uint8_t lo, hi;
+    uint8_t buf[2];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_byte(f, &lo) < 0 || snapshot_read_byte(f, &hi) < 0) {
+    if (snapshot_read_block(s, buf, sizeof(buf)) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
 
-    *w_return = lo | (hi << 8);
+    *w_return = snapshot_get_word(buf);
     return 0;
 }
 
-static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
+static int snapshot_read_dword(snapshot_t *s, uint32_t *dw_return)
 {
-    uint16_t lo, hi;
+    uint8_t buf[4];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &lo) < 0 || snapshot_read_word(f, &hi) < 0) {
+    if (snapshot_read_block(s, buf, sizeof(buf)) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
 
-    *dw_return = lo | (hi << 16);
+    *dw_return = snapshot_get_dword(buf);
     return 0;
 }
 
-static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
+static int snapshot_read_qword(snapshot_t *s, uint64_t *qw_return)
 {
-    uint32_t lo, hi;
+    uint8_t buf[8];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_dword(f, &lo) < 0 || snapshot_read_dword(f, &hi) < 0) {
+    if (snapshot_read_block(s, buf, sizeof(buf)) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
 
-    *qw_return = lo | ((uint64_t)hi << 32);
+    *qw_return = snapshot_get_dword(buf) | ((uint64_t)snapshot_get_dword(buf + 4) << 32);
     return 0;
 }
 
-static int snapshot_read_double(FILE *f, double *d_return)
+static int snapshot_read_double(snapshot_t *s, double *d_return)
 {
-    int i;
-    int c;
     double val;
-    uint8_t *byte_val = (uint8_t *)&val;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
-        if (c == EOF) {
-            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
-            return -1;
-        }
-        byte_val[i] = (uint8_t)c;
+    if (snapshot_read_block(s, &val, sizeof(double)) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
+        return -1;
     }
     *d_return = val;
     return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num)
+static int snapshot_read_byte_array(snapshot_t *s, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1) {
+    if (snapshot_read_block(s, b_return, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_READ_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -319,46 +446,59 @@ static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num
     return 0;
 }
 
-static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int num)
+static int snapshot_read_word_array(snapshot_t *s, uint16_t *w_return, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[SNAPSHOT_ARRAY_CHUNK * 2];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_read_word(f, w_return + i) < 0) {
+    while (num > 0) {
+        n = num < SNAPSHOT_ARRAY_CHUNK ? num : SNAPSHOT_ARRAY_CHUNK;
+        if (snapshot_read_block(s, buf, n * 2) < 0) {
+            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
             return -1;
         }
+        for (i = 0; i < n; i++) {
+            w_return[i] = snapshot_get_word(buf + i * 2);
+        }
+        w_return += n;
+        num -= n;
     }
 
     return 0;
 }
 
-static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int num)
+static int snapshot_read_dword_array(snapshot_t *s, uint32_t *dw_return, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[SNAPSHOT_ARRAY_CHUNK * 4];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_read_dword(f, dw_return + i) < 0) {
+    while (num > 0) {
+        n = num < SNAPSHOT_ARRAY_CHUNK ? num : SNAPSHOT_ARRAY_CHUNK;
+        if (snapshot_read_block(s, buf, n * 4) < 0) {
+            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
             return -1;
         }
+        for (i = 0; i < n; i++) {
+            dw_return[i] = snapshot_get_dword(buf + i * 4);
+        }
+        dw_return += n;
+        num -= n;
     }
 
     return 0;
 }
 
-static int snapshot_read_string(FILE *f, char **s)
+static int snapshot_read_string(snapshot_t *s, char **str)
 {
-    int i, len;
+    int len;
     uint16_t w;
     char *p = NULL;
 
     /* first free the previous string */
-    lib_free(*s);
-    *s = NULL;      /* don't leave a bogus pointer */
+    lib_free(*str);
+    *str = NULL;      /* don't leave a bogus pointer */
 
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &w) < 0) {
+    if (snapshot_read_word(s, &w) < 0) {
         return -1;
     }
 
@@ -366,13 +506,12 @@ static int snapshot_read_string(FILE *f, char **s)
 
     if (len) {
         p = lib_malloc(len);
-        *s = p;
+        *str = p;
 
-        for (i = 0; i < len; i++) {
-            if (snapshot_read_byte(f, (uint8_t *)(p + i)) < 0) {
-                p[0] = 0;
-                return -1;
-            }
+        if (snapshot_read_block(s, p, (size_t)len) < 0) {
+            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
+            p[0] = 0;
+            return -1;
         }
         p[len - 1] = 0;   /* just to be save */
     }
@@ -383,7 +522,7 @@ static int snapshot_read_string(FILE *f, char **s)
 
 int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 {
-    if (snapshot_write_byte(m->file, b) < 0) {
+    if (snapshot_write_byte(m->snapshot, b) < 0) {
         return -1;
     }
 
@@ -393,7 +532,7 @@ int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 
 int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 {
-    if (snapshot_write_word(m->file, w) < 0) {
+    if (snapshot_write_word(m->snapshot, w) < 0) {
         return -1;
     }
 
@@ -403,7 +542,7 @@ int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 
 int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0) {
+    if (snapshot_write_dword(m->snapshot, dw) < 0) {
         return -1;
     }
 
@@ -413,7 +552,7 @@ int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 
 int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 {
-    if (snapshot_write_qword(m->file, qw) < 0) {
+    if (snapshot_write_qword(m->snapshot, qw) < 0) {
         return -1;
     }
 
@@ -423,7 +562,7 @@ int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
+    if (snapshot_write_double(m->snapshot, db) < 0) {
         return -1;
     }
 
@@ -433,7 +572,7 @@ int snapshot_module_write_double(snapshot_module_t *m, double db)
 
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (uint8_t)pad_char, len) < 0) {
+    if (snapshot_write_padded_string(m->snapshot, s, (uint8_t)pad_char, len) < 0) {
         return -1;
     }
 
@@ -443,7 +582,7 @@ int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uin
 
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0) {
+    if (snapshot_write_byte_array(m->snapshot, b, num) < 0) {
         return -1;
     }
 
@@ -453,7 +592,7 @@ int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, uns
 
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0) {
+    if (snapshot_write_word_array(m->snapshot, w, num) < 0) {
         return -1;
     }
 
@@ -463,7 +602,7 @@ int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, un
 
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw, unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0) {
+    if (snapshot_write_dword_array(m->snapshot, dw, num) < 0) {
         return -1;
     }
 
@@ -474,7 +613,7 @@ int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw,
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
     int len;
-    len = snapshot_write_string(m->file, s);
+    len = snapshot_write_string(m->snapshot, s);
     if (len < 0) {
         snapshot_error = SNAPSHOT_ILLEGAL_STRING_LENGTH_ERROR;
         return -1;
@@ -486,102 +625,98 @@ int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 
 /* ------------------------------------------------------------------------- */
 
-int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
+/* Check that `num' more bytes can be read from the module.  */
+static int snapshot_module_check_bounds(snapshot_module_t *m, size_t num)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint8_t) > m->offset + m->size) {
+    long pos = snapshot_tell(m->snapshot);
+
+    current_fpos = (size_t)pos;
+    if ((long)(pos + num) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
+    return 0;
+}
+
+int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
+{
+    if (snapshot_module_check_bounds(m, sizeof(uint8_t)) < 0) {
+        return -1;
+    }
 
-    return snapshot_read_byte(m->file, b_return);
+    return snapshot_read_byte(m->snapshot, b_return);
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, sizeof(uint16_t)) < 0) {
         return -1;
     }
 
-    return snapshot_read_word(m->file, w_return);
+    return snapshot_read_word(m->snapshot, w_return);
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint32_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, sizeof(uint32_t)) < 0) {
         return -1;
     }
 
-    return snapshot_read_dword(m->file, dw_return);
+    return snapshot_read_dword(m->snapshot, dw_return);
 }
 
 int snapshot_module_read_qword(snapshot_module_t *m, uint64_t *qw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint64_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, sizeof(uint64_t)) < 0) {
         return -1;
     }
 
-    return snapshot_read_qword(m->file, qw_return);
+    return snapshot_read_qword(m->snapshot, qw_return);
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, sizeof(double)) < 0) {
         return -1;
     }
 
-    return snapshot_read_double(m->file, db_return);
+    return snapshot_read_double(m->snapshot, db_return);
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size)) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, num) < 0) {
         return -1;
     }
 
-    return snapshot_read_byte_array(m->file, b_return, num);
+    return snapshot_read_byte_array(m->snapshot, b_return, num);
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, uint16_t *w_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, num * sizeof(uint16_t)) < 0) {
         return -1;
     }
 
-    return snapshot_read_word_array(m->file, w_return, num);
+    return snapshot_read_word_array(m->snapshot, w_return, num);
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, uint32_t *dw_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, num * sizeof(uint32_t)) < 0) {
         return -1;
     }
 
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    return snapshot_read_dword_array(m->snapshot, dw_return, num);
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    if (snapshot_module_check_bounds(m, sizeof(uint16_t)) < 0) {
         return -1;
     }
 
-    return snapshot_read_string(m->file, charp_return);
+    return snapshot_read_string(m->snapshot, charp_return);
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -681,8 +816,8 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     current_module = (char *)name;
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
+    m->snapshot = s;
+    m->offset = snapshot_tell(s);
     if (m->offset == -1) {
         snapshot_error = SNAPSHOT_ILLEGAL_OFFSET_ERROR;
         lib_free(m);
@@ -690,15 +825,15 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     }
     m->write_mode = 1;
 
-    if (snapshot_write_padded_string(s->file, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0) {
+    if (snapshot_write_padded_string(s, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
+        || snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0
+        || snapshot_write_dword(s, 0) < 0) {
         return NULL;
     }
 
-    m->size = (uint32_t)(ftell(s->file) - m->offset);
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size = (uint32_t)(snapshot_tell(s) - m->offset);
+    m->size_offset = snapshot_tell(s) - sizeof(uint32_t);
 
     return m;
 }
@@ -711,14 +846,14 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
 
     current_module = (char *)name;
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0) {
+    if (snapshot_seek(s, s->first_module_offset) < 0) {
         snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
         DBG(("snapshot_module_open error: name: '%s' NOT found", name));
         return NULL;
     }
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
+    m->snapshot = s;
     m->write_mode = 0;
 
     m->offset = s->first_module_offset;
@@ -728,11 +863,11 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
     /* Search for the module name.  This is quite inefficient, but I don't
        think we care.  */
     while (1) {
-        if (snapshot_read_byte_array(s->file, (uint8_t *)n,
+        if (snapshot_read_byte_array(s, (uint8_t *)n,
                                      SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size)) {
+            || snapshot_read_byte(s, major_version_return) < 0
+            || snapshot_read_byte(s, minor_version_return) < 0
+            || snapshot_read_dword(s, &m->size)) {
             snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
             goto fail;
         }
@@ -744,13 +879,13 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
         }
 
         m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0) {
+        if (snapshot_seek(s, m->offset) < 0) {
             snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
             goto fail;
         }
     }
 
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size_offset = snapshot_tell(s) - sizeof(uint32_t);
 #if 0
     /* HACK: if any of the errors *this* function can produce is still pending
              in snapshot_error, clear it out - else we might fail for no reason
@@ -766,7 +901,7 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
     return m;
 
 fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
+    snapshot_seek(s, s->first_module_offset);
     lib_free(m);
     DBG(("snapshot_module_open error: name: '%s' NOT found", name));
     return NULL;
@@ -777,15 +912,15 @@ int snapshot_module_close(snapshot_module_t *m)
     DBG(("snapshot_module_close name: '%s'", current_module));
     /* Backpatch module size if writing.  */
     if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0)) {
+        && (snapshot_seek(m->snapshot, m->size_offset) < 0
+            || snapshot_write_dword(m->snapshot, m->size) < 0)) {
         snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
         DBG(("snapshot_module_close error"));
         return -1;
     }
 
     /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0) {
+    if (snapshot_seek(m->snapshot, m->offset + m->size) < 0) {
         snapshot_error = SNAPSHOT_MODULE_SKIP_ERROR;
         DBG(("snapshot_module_close error"));
         return -1;
@@ -800,66 +935,77 @@ int snapshot_module_close(snapshot_module_t *m)
 
 snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
 {
-    FILE *f;
     snapshot_t *s;
     unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
-    current_filename = (char *)filename;
+    s = lib_malloc(sizeof(snapshot_t));
+    s->file = NULL;
+    s->memory = selected_memory;
+    s->pos = 0;
+    s->write_mode = 1;
 
-    f = fopen(filename, MODE_WRITE);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
-        return NULL;
+    if (s->memory != NULL) {
+        current_filename = SNAPSHOT_MEMORY_NAME;
+        s->memory->len = 0;
+    } else {
+        current_filename = (char *)filename;
+
+        s->file = fopen(filename, MODE_WRITE);
+        if (s->file == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+            lib_free(s);
+            return NULL;
+        }
     }
 
     /* Magic string.  */
-    if (snapshot_write_padded_string(f, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
         goto fail;
     }
 
     /* Version number.  */
-    if (snapshot_write_byte(f, major_version) < 0
-        || snapshot_write_byte(f, minor_version) < 0) {
+    if (snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
         goto fail;
     }
 
     /* Machine.  */
-    if (snapshot_write_padded_string(f, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MACHINE_NAME_ERROR;
         goto fail;
     }
 
     /* VICE version and revision */
-    if (snapshot_write_padded_string(f, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
         goto fail;
     }
 
-    if (snapshot_write_byte(f, viceversion[0]) < 0
-        || snapshot_write_byte(f, viceversion[1]) < 0
-        || snapshot_write_byte(f, viceversion[2]) < 0
-        || snapshot_write_byte(f, viceversion[3]) < 0
+    if (snapshot_write_byte(s, viceversion[0]) < 0
+        || snapshot_write_byte(s, viceversion[1]) < 0
+        || snapshot_write_byte(s, viceversion[2]) < 0
+        || snapshot_write_byte(s, viceversion[3]) < 0
 #ifdef USE_SVN_REVISION
-        || snapshot_write_dword(f, VICE_SVN_REV_NUMBER) < 0) {
+        || snapshot_write_dword(s, VICE_SVN_REV_NUMBER) < 0) {
 #else
-        || snapshot_write_dword(f, 0) < 0) {
+        || snapshot_write_dword(s, 0) < 0) {
 #endif
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
         goto fail;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 1;
+    s->first_module_offset = snapshot_tell(s);
 
     return s;
 
 fail:
-    fclose(f);
-    archdep_remove(filename);
+    if (s->file != NULL) {
+        fclose(s->file);
+        archdep_remove(filename);
+    }
+    lib_free(s);
     return NULL;
 }
 
@@ -869,38 +1015,49 @@ static uint32_t snapshot_vicerevision;
 
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
 {
-    FILE *f;
     char magic[SNAPSHOT_MAGIC_LEN];
     snapshot_t *s = NULL;
     int machine_name_len;
-    size_t offs;
+    long offs;
 
     current_machine_name = (char *)snapshot_machine_name;
-    current_filename = (char *)filename;
     current_module = NULL;
 
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
-        return NULL;
+    s = lib_malloc(sizeof(snapshot_t));
+    s->file = NULL;
+    s->memory = selected_memory;
+    s->pos = 0;
+    s->write_mode = 0;
+
+    if (s->memory != NULL) {
+        current_filename = SNAPSHOT_MEMORY_NAME;
+    } else {
+        current_filename = (char *)filename;
+
+        s->file = zfile_fopen(filename, MODE_READ);
+        if (s->file == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+            lib_free(s);
+            return NULL;
+        }
     }
 
     /* Magic string.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
         snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
         goto fail;
     }
 
     /* Version number.  */
-    if (snapshot_read_byte(f, major_version_return) < 0
-        || snapshot_read_byte(f, minor_version_return) < 0) {
+    if (snapshot_read_byte(s, major_version_return) < 0
+        || snapshot_read_byte(s, minor_version_return) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
         goto fail;
     }
 
     /* Machine.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    if (snapshot_read_byte_array(s, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_MACHINE_NAME_ERROR;
         goto fail;
     }
@@ -917,55 +1074,57 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     /* VICE version and revision */
     memset(snapshot_viceversion, 0, 4);
     snapshot_vicerevision = 0;
-    offs = ftell(f);
+    offs = snapshot_tell(s);
 
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
         /* old snapshots do not contain VICE version */
-        fseek(f, offs, SEEK_SET);
+        snapshot_seek(s, offs);
         log_warning(LOG_DEFAULT, "attempting to load pre 2.4.30 snapshot");
     } else {
         /* actually read the version */
-        if (snapshot_read_byte(f, &snapshot_viceversion[0]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[1]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[2]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[3]) < 0
-            || snapshot_read_dword(f, &snapshot_vicerevision) < 0) {
+        if (snapshot_read_byte(s, &snapshot_viceversion[0]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[1]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[2]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[3]) < 0
+            || snapshot_read_dword(s, &snapshot_vicerevision) < 0) {
             snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
             goto fail;
         }
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 0;
+    s->first_module_offset = snapshot_tell(s);
 
-    vsync_suspend_speed_eval();
+    /* restoring from memory is cheap and may happen often (rewind), don't
+       disturb the speed evaluation for it */
+    if (s->memory == NULL) {
+        vsync_suspend_speed_eval();
+    }
     return s;
 
 fail:
-    fclose(f);
+    if (s->file != NULL) {
+        fclose(s->file);
+    }
+    lib_free(s);
     return NULL;
 }
 
 int snapshot_close(snapshot_t *s)
 {
-    int retval;
+    int retval = 0;
 
-    if (!s->write_mode) {
+    if (s->memory != NULL) {
+        /* nothing to do, the data stays in the memory buffer */
+    } else if (!s->write_mode) {
         if (zfile_fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_READ_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
     } else {
         if (fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
     }
 
@@ -973,6 +1132,191 @@ int snapshot_close(snapshot_t *s)
     return retval;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Create an empty buffer for snapshots in memory
+ *
+ * \return  memory buffer, free with snapshot_memory_destroy()
+ */
+snapshot_memory_t *snapshot_memory_new(void)
+{
+    return lib_calloc(1, sizeof(snapshot_memory_t));
+}
+
+/** \brief  Free a memory snapshot buffer
+ *
+ * \param[in]   mem     memory buffer
+ */
+void snapshot_memory_destroy(snapshot_memory_t *mem)
+{
+    if (mem == NULL) {
+        return;
+    }
+    if (selected_memory == mem) {
+        selected_memory = NULL;
+    }
+    lib_free(mem->data);
+    lib_free(mem);
+}
+
+/** \brief  Use a memory buffer instead of a file for snapshots
+ *
+ * While a buffer is selected, snapshot_create() overwrites the contents of
+ * \a mem and snapshot_open() reads from it, the file name passed to them is
+ * ignored. The buffer keeps its allocation between snapshots, so taking a
+ * snapshot of the same machine again needs no memory allocation nor any
+ * system call.
+ *
+ * \param[in]   mem     memory buffer, or NULL to use files again
+ */
+void snapshot_memory_select(snapshot_memory_t *mem)
+{
+    selected_memory = mem;
+}
+
+/** \brief  Get the contents of a memory snapshot buffer
+ *
+ * \param[in]   mem     memory buffer
+ * \param[out]  len     size of the snapshot in bytes
+ *
+ * \return  snapshot data, owned by \a mem, or NULL if the buffer is empty
+ */
+const uint8_t *snapshot_memory_get_data(snapshot_memory_t *mem, size_t *len)
+{
+    *len = mem->len;
+    return mem->data;
+}
+
+/** \brief  Set the contents of a memory snapshot buffer
+ *
+ * \param[in]   mem     memory buffer
+ * \param[in]   data    snapshot data, as written by snapshot_create()
+ * \param[in]   len     size of \a data in bytes
+ */
+void snapshot_memory_set_data(snapshot_memory_t *mem, const uint8_t *data, size_t len)
+{
+    snapshot_memory_reserve(mem, len);
+    if (len > 0) {
+        memcpy(mem->data, data, len);
+    }
+    mem->len = len;
+}
+
+/* Append `num' bytes to the memory buffer.  */
+static void snapshot_memory_append(snapshot_memory_t *mem, const void *data, size_t num)
+{
+    snapshot_memory_reserve(mem, mem->len + num);
+    memcpy(mem->data + mem->len, data, num);
+    mem->len += num;
+}
+
+static void snapshot_memory_append_dword(snapshot_memory_t *mem, uint32_t data)
+{
+    uint8_t buf[4];
+
+    snapshot_put_dword(buf, data);
+    snapshot_memory_append(mem, buf, sizeof(buf));
+}
+
+/** \brief  Store the difference between two memory snapshots
+ *
+ * Compares \a to with \a from in pages of SNAPSHOT_DELTA_PAGE_SIZE bytes
+ * and stores only the pages that differ in \a delta. Snapshots of the same
+ * machine with the same configuration have the same layout, so the size of
+ * the delta roughly scales with the amount of RAM written since \a from.
+ *
+ * This saves memory, not time: there is no dirty page tracking in the
+ * memory modules, so both snapshots must have been written in full and are
+ * compared in full. Taking a delta costs a full snapshot plus a compare of
+ * the whole stream, both proportional to the size of the RAM and the RAM
+ * expansions.
+ *
+ * Delta format: size of \a to, number of pages, then for each page its
+ * index followed by the page data (the last page may be shorter).
+ *
+ * \param[out]  delta   delta, previous contents are replaced
+ * \param[in]   from    reference snapshot
+ * \param[in]   to      new snapshot
+ */
+void snapshot_memory_diff(snapshot_memory_t *delta, snapshot_memory_t *from, snapshot_memory_t *to)
+{
+    size_t offset;
+    size_t num;
+    uint32_t pages = 0;
+
+    delta->len = 0;
+    snapshot_memory_append_dword(delta, (uint32_t)to->len);
+    snapshot_memory_append_dword(delta, 0);     /* patched below */
+
+    for (offset = 0; offset < to->len; offset += SNAPSHOT_DELTA_PAGE_SIZE) {
+        num = to->len - offset;
+        if (num > SNAPSHOT_DELTA_PAGE_SIZE) {
+            num = SNAPSHOT_DELTA_PAGE_SIZE;
+        }
+        if (offset + num <= from->len
+            && memcmp(from->data + offset, to->data + offset, num) == 0) {
+            continue;
+        }
+        snapshot_memory_append_dword(delta, (uint32_t)(offset / SNAPSHOT_DELTA_PAGE_SIZE));
+        snapshot_memory_append(delta, to->data + offset, num);
+        pages++;
+    }
+
+    snapshot_put_dword(delta->data + 4, pages);
+}
+
+/** \brief  Apply a delta made by snapshot_memory_diff()
+ *
+ * \a mem must hold the snapshot the delta was made from, it then holds the
+ * new snapshot. Deltas can be stacked by applying them in the order they
+ * were made.
+ *
+ * \param[in,out]   mem     snapshot to update
+ * \param[in]       delta   delta to apply
+ *
+ * \return  0 on success, -1 if the delta is corrupt
+ */
+int snapshot_memory_patch(snapshot_memory_t *mem, snapshot_memory_t *delta)
+{
+    const uint8_t *p = delta->data;
+    const uint8_t *end = delta->data + delta->len;
+    size_t len;
+    size_t offset;
+    size_t num;
+    uint32_t pages;
+
+    if (delta->len < 8) {
+        return -1;
+    }
+    len = snapshot_get_dword(p);
+    pages = snapshot_get_dword(p + 4);
+    p += 8;
+
+    snapshot_memory_reserve(mem, len);
+    mem->len = len;
+
+    while (pages-- > 0) {
+        if (end - p < 4) {
+            return -1;
+        }
+        offset = (size_t)snapshot_get_dword(p) * SNAPSHOT_DELTA_PAGE_SIZE;
+        p += 4;
+        if (offset >= len) {
+            return -1;
+        }
+        num = len - offset;
+        if (num > SNAPSHOT_DELTA_PAGE_SIZE) {
+            num = SNAPSHOT_DELTA_PAGE_SIZE;
+        }
+        if ((size_t)(end - p) < num) {
+            return -1;
+        }
+        memcpy(mem->data + offset, p, num);
+        p += num;
+    }
+    return 0;
+}
+
 static void display_error_with_vice_version(char *text, char *filename)
 {
     char *vmessage = lib_malloc(0x100);
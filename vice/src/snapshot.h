@@ -28,6 +28,8 @@
 #ifndef SNAPSHOT_H
 #define SNAPSHOT_H
 
+#include <stddef.h>
+
 #include "types.h"
 
 #define SNAPSHOT_MACHINE_NAME_LEN       16
@@ -67,6 +69,7 @@
 
 typedef struct snapshot_module_s snapshot_module_t;
 typedef struct snapshot_s snapshot_t;
+typedef struct snapshot_memory_s snapshot_memory_t;
 
 void snapshot_display_error(void);
 
@@ -136,6 +139,14 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name);
 int snapshot_close(snapshot_t *s);
 
+snapshot_memory_t *snapshot_memory_new(void);
+void snapshot_memory_destroy(snapshot_memory_t *mem);
+void snapshot_memory_select(snapshot_memory_t *mem);
+const uint8_t *snapshot_memory_get_data(snapshot_memory_t *mem, size_t *len);
+void snapshot_memory_set_data(snapshot_memory_t *mem, const uint8_t *data, size_t len);
+void snapshot_memory_diff(snapshot_memory_t *delta, snapshot_memory_t *from, snapshot_memory_t *to);
+int snapshot_memory_patch(snapshot_memory_t *mem, snapshot_memory_t *delta);
+
 void snapshot_set_error(int error);
 int snapshot_get_error(void);
 
@@ -1114,6 +1114,81 @@ int vice_network_select_multiple(vice_network_socket_t ** readsockfd)
     return select(max_sockfd + 1, &fdsockset, NULL, NULL, &time);
 }
 
+/*! \brief Open a socket to wake up a select from another thread
+
+  The socket is a UDP socket on the loopback interface that is connected to
+  itself. It becomes readable after vice_network_wakeup_signal(), so adding
+  it to the sockets of vice_network_select_multiple() lets another thread end
+  the wait. Unlike a pipe, this also works with select() on Windows.
+
+  \return
+     the socket, or NULL on error. Close it with vice_network_socket_close().
+*/
+vice_network_socket_t *vice_network_wakeup_open(void)
+{
+    struct sockaddr_in address;
+    socklen_t len = sizeof address;
+    int sockfd;
+
+    if (socket_init() < 0) {
+        return NULL;
+    }
+
+    sockfd = (int)socket(PF_INET, SOCK_DGRAM, 0);
+    if (sockfd == INVALID_SOCKET) {
+        return NULL;
+    }
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    if (bind(sockfd, (struct sockaddr *)&address, sizeof address) < 0
+        || getsockname(sockfd, (struct sockaddr *)&address, &len) < 0
+        || connect(sockfd, (struct sockaddr *)&address, len) < 0) {
+        log_error(LOG_DEFAULT,
+            "vice_network_wakeup_open(): cannot set up the loopback socket: %s",
+            strerror(errno));
+        closesocket(sockfd);
+        return NULL;
+    }
+
+    return vice_network_alloc_new_socket(sockfd);
+}
+
+/*! \brief Wake up a select on a socket from vice_network_wakeup_open()
+
+  \param sockfd
+     The wakeup socket
+*/
+void vice_network_wakeup_signal(vice_network_socket_t *sockfd)
+{
+    const char wakeup = 0;
+
+    send(sockfd->sockfd, &wakeup, 1, 0);
+}
+
+/*! \brief Drop the pending wakeups of a socket from vice_network_wakeup_open()
+
+  \param sockfd
+     The wakeup socket
+
+  \remark
+     Clear the wakeups before handling what they announce, then nothing
+     signalled meanwhile gets lost.
+*/
+void vice_network_wakeup_clear(vice_network_socket_t *sockfd)
+{
+    char buffer[16];
+
+    while (vice_network_select_poll_one(sockfd) > 0) {
+        if (recv(sockfd->sockfd, buffer, sizeof buffer, 0) <= 0) {
+            break;
+        }
+    }
+}
+
 /*! \brief Get the error of the last socket operation
 
   This function determines the error code for the last
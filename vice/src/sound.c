@@ -71,6 +71,7 @@
 log_t sound_log = LOG_DEFAULT;
 
 static void sounddev_close(const sound_device_t **dev);
+static int sound_run_sound(void);
 
 /* ------------------------------------------------------------------------- */
 
@@ -206,6 +207,9 @@ typedef struct {
     /* time of last call to sound_run_sound() */
     CLOCK lastclk;
 
+    /* time of last call to sound_flush() that did not skip rendering */
+    CLOCK flushclk;
+
     /* sample buffer */
     int16_t *buffer;
 
@@ -573,6 +577,9 @@ static int cycle_based = 0;
 /* If a current playback device is used to control emulator timing */
 static int sound_is_timing_source = FALSE;
 
+/* Offline rendering: keep emulating and writing samples in warp mode */
+static int sound_offline_render = FALSE;
+
 static int set_output_option(int val, void *param)
 {
     switch (val) {
@@ -1071,6 +1078,7 @@ static int sid_init(void)
     snddata.fclk = SOUNDCLK_CONSTANT(maincpu_clk);
     snddata.wclk = maincpu_clk;
     snddata.lastclk = maincpu_clk;
+    snddata.flushclk = maincpu_clk;
 
     for (c = 0; c < snddata.sound_chip_channels; c++) {
         if (!sound_machine_init(snddata.psid[c], speed, cycles_per_sec) || !playback_enabled) {
@@ -1333,9 +1341,32 @@ static void sounddev_close(const sound_device_t **dev)
     }
 }
 
+/* When rendering offline, sound_flush() leaves up to half of the buffer
+   unrendered, and only ever writes whole fragments.  Write out the rest,
+   or the file ends early.  */
+static void sound_offline_render_finish(void)
+{
+    if (!sound_offline_render || !sdev_open || snddata.playdev == NULL) {
+        return;
+    }
+
+    if (sound_run_sound() != 0 || snddata.bufptr == 0) {
+        return;
+    }
+
+    if (snddata.playdev->write(snddata.buffer, snddata.bufptr * snddata.sound_output_channels)
+        || (snddata.recdev != NULL
+            && snddata.recdev->write(snddata.buffer, snddata.bufptr * snddata.sound_output_channels))) {
+        log_error(sound_log, "Cannot write the end of the rendered sound.");
+    }
+    snddata.bufptr = 0;
+}
+
 /* close sid */
 void sound_close(void)
 {
+    sound_offline_render_finish();
+
     sounddev_close(&snddata.playdev);
     sounddev_close(&snddata.recdev);
     sid_close();
@@ -1387,7 +1418,8 @@ static int sound_run_sound(void)
     }
 
     /* if "disable sound emulation on warp" is enabled, exit */
-    if ((sound_emulation_enabled_on_warp == 0) && warp_mode_enabled) {
+    if ((sound_emulation_enabled_on_warp == 0) && warp_mode_enabled
+        && !sound_offline_render) {
         snddata.lastclk = maincpu_clk;
         return 0;
     }
@@ -1462,6 +1494,7 @@ void sound_reset(void)
     snddata.fclk = SOUNDCLK_CONSTANT(maincpu_clk);
     snddata.wclk = maincpu_clk;
     snddata.lastclk = maincpu_clk;
+    snddata.flushclk = maincpu_clk;
     snddata.bufptr = 0;         /* ugly hack! */
     for (c = 0; c < snddata.sound_chip_channels; c++) {
         if (snddata.psid[c]) {
@@ -1471,6 +1504,18 @@ void sound_reset(void)
 }
 
 /* flush all generated samples from buffer to sounddevice. */
+/* Number of cycles to accumulate before rendering in sound_flush() */
+static CLOCK sound_render_batch_cycles(void)
+{
+    if (sound_offline_render && sample_rate > 0) {
+        /* nobody is listening, so render up to half of the sample buffer at
+           once. the other half leaves room for an incomplete fragment. */
+        return (CLOCK)((double)(snddata.bufsize - snddata.fragsize) / 2.0
+                       * cycles_per_sec / sample_rate);
+    }
+    return 0;
+}
+
 bool sound_flush(void)
 {
     int c, i, nr, space;
@@ -1514,6 +1559,15 @@ bool sound_flush(void)
         sound_playdev_reopen = FALSE;
     }
 
+    /* when rendering offline, render in larger batches; register writes
+       still render up to the exact cycle. count from the last flush, as the
+       samples rendered by register writes also have to fit into the buffer. */
+    if (cycle_based && sdev_open
+        && maincpu_clk - snddata.flushclk < sound_render_batch_cycles()) {
+        goto done;
+    }
+    snddata.flushclk = maincpu_clk;
+
     if (sound_run_sound()) {
         goto done;
     }
@@ -1525,7 +1579,7 @@ bool sound_flush(void)
         sid_state_changed = FALSE;
     }
 
-    if (warp_mode_enabled && snddata.recdev == NULL) {
+    if (warp_mode_enabled && snddata.recdev == NULL && !sound_offline_render) {
         snddata.bufptr = 0;
         goto done;
     }
@@ -1570,7 +1624,7 @@ bool sound_flush(void)
      * The 'push against the audio device' sync method depends on this.
      */
 
-    while (!warp_mode_enabled) {
+    while (!warp_mode_enabled || sound_offline_render) {
 
         if (snddata.playdev->bufferspace) {
             space = snddata.playdev->bufferspace();
@@ -1821,12 +1875,22 @@ void sound_set_warp_mode(int value)
     warp_mode_enabled = value;
 
     if (value) {
-        sound_suspend();
+        if (!sound_offline_render) {
+            sound_suspend();
+        }
     } else {
         sound_resume();
     }
 }
 
+/* Render the sound for a file device faster than realtime: in warp mode the
+   sound chips keep running and every sample is written to the playback
+   device, which must not be a realtime device. */
+void sound_set_offline_render(int value)
+{
+    sound_offline_render = value ? TRUE : FALSE;
+}
+
 void sound_snapshot_prepare(void)
 {
     /* Update lastclk.  */
@@ -1836,6 +1900,7 @@ void sound_snapshot_prepare(void)
 void sound_snapshot_finish(void)
 {
     snddata.lastclk = maincpu_clk;
+    snddata.flushclk = maincpu_clk;
 }
 
 void sound_dac_init(sound_dac_t *dac, int speed)
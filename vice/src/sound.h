@@ -256,6 +256,7 @@ int sound_open(void);
 void sound_close(void);
 void sound_set_relative_speed(int value);
 void sound_set_warp_mode(int value);
+void sound_set_offline_render(int value);
 void sound_set_machine_parameter(long clock_rate, long ticks_per_frame);
 void sound_snapshot_prepare(void);
 void sound_snapshot_finish(void);
@@ -0,0 +1,408 @@
+/*
+ * alarmbench.c - Replay alarm traces against the pending alarm list.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Usage: alarmbench [trace [repeats]]
+
+   Replays a trace written by an emulator built with ALARM_TRACE defined (see
+   alarm.h), or, without a trace, a synthetic one modelled on a C64 with REU
+   and two drives.
+
+   At every dispatch of the trace the alarm contexts must report the same
+   next pending clock as the emulator did.  The program prints the replay
+   speed and exits with status 1 on the first mismatch.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "lib.h"
+#include "types.h"
+
+#include "teststubs.h"
+
+#define MAX_CONTEXTS    16
+#define MAX_ALARMS      (MAX_CONTEXTS * ALARM_CONTEXT_MAX_PENDING_ALARMS)
+
+enum {
+    EV_SET,
+    EV_UNSET,
+    EV_DISPATCH,
+    EV_WARP
+};
+
+typedef struct event_s {
+    uint8_t type;
+    uint8_t context;
+    int16_t warp_direction;
+    uint32_t alarm;
+    CLOCK clk;
+} event_t;
+
+typedef struct trace_s {
+    event_t *events;
+    size_t num, max;
+
+    /* address in the trace of each context and alarm */
+    uint64_t context_id[MAX_CONTEXTS];
+    unsigned int num_contexts;
+    uint64_t alarm_id[MAX_ALARMS];
+    uint8_t alarm_context[MAX_ALARMS];
+    unsigned int num_alarms;
+} trace_t;
+
+static trace_t trace;
+
+static alarm_context_t *contexts[MAX_CONTEXTS];
+static alarm_t *alarms[MAX_ALARMS];
+
+static void add_event(int type, unsigned int context, unsigned int alarm,
+                      CLOCK clk, int warp_direction)
+{
+    event_t *ev;
+
+    if (trace.num == trace.max) {
+        trace.max = trace.max ? trace.max * 2 : 65536;
+        trace.events = lib_realloc(trace.events, trace.max * sizeof(event_t));
+    }
+    ev = &trace.events[trace.num++];
+    ev->type = (uint8_t)type;
+    ev->context = (uint8_t)context;
+    ev->alarm = alarm;
+    ev->clk = clk;
+    ev->warp_direction = (int16_t)warp_direction;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Trace file reading.  */
+
+static unsigned int lookup_context(uint64_t id)
+{
+    unsigned int i;
+
+    for (i = 0; i < trace.num_contexts; i++) {
+        if (trace.context_id[i] == id) {
+            return i;
+        }
+    }
+    if (trace.num_contexts == MAX_CONTEXTS) {
+        fprintf(stderr, "too many alarm contexts in trace\n");
+        exit(2);
+    }
+    trace.context_id[trace.num_contexts] = id;
+    return trace.num_contexts++;
+}
+
+/* Alarms are only looked up while reading, a linear search from the most
+   recently added alarm is fast enough.  */
+static unsigned int lookup_alarm(unsigned int context, uint64_t id)
+{
+    unsigned int i;
+
+    for (i = trace.num_alarms; i-- > 0;) {
+        if (trace.alarm_id[i] == id) {
+            return i;
+        }
+    }
+    if (trace.num_alarms == MAX_ALARMS) {
+        fprintf(stderr, "too many alarms in trace\n");
+        exit(2);
+    }
+    trace.alarm_id[trace.num_alarms] = id;
+    trace.alarm_context[trace.num_alarms] = (uint8_t)context;
+    return trace.num_alarms++;
+}
+
+static void read_trace(const char *name)
+{
+    FILE *f;
+    char line[256];
+    unsigned long lineno = 0;
+
+    f = fopen(name, "r");
+    if (f == NULL) {
+        perror(name);
+        exit(2);
+    }
+
+    while (fgets(line, sizeof line, f) != NULL) {
+        char *p = line + 1;
+        unsigned int context;
+        unsigned long long a, b;
+        int dir;
+
+        lineno++;
+        context = lookup_context(strtoull(p, &p, 16));
+
+        switch (line[0]) {
+            case 'S':
+                a = strtoull(p, &p, 16);
+                b = strtoull(p, &p, 10);
+                add_event(EV_SET, context, lookup_alarm(context, a), (CLOCK)b, 0);
+                break;
+            case 'U':
+                a = strtoull(p, &p, 16);
+                add_event(EV_UNSET, context, lookup_alarm(context, a), 0, 0);
+                break;
+            case 'D':
+                b = strtoull(p, &p, 10);
+                add_event(EV_DISPATCH, context, 0, (CLOCK)b, 0);
+                break;
+            case 'W':
+                b = strtoull(p, &p, 10);
+                dir = (int)strtol(p, &p, 10);
+                add_event(EV_WARP, context, 0, (CLOCK)b, dir);
+                break;
+            default:
+                fprintf(stderr, "%s:%lu: bad trace line\n", name, lineno);
+                exit(2);
+        }
+    }
+    fclose(f);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Synthetic trace.  Every alarm has a period and fires, re-arms and gets
+   reprogrammed like the chip it stands for.  */
+
+typedef struct synth_alarm_s {
+    unsigned int context;
+    CLOCK period;       /* typical distance to the next dispatch */
+    CLOCK jitter;       /* random part of the distance */
+    unsigned int reprogram;     /* chance in 1/65536 per dispatch in the context */
+    unsigned int unset;         /* chance in 1/65536 to stop after a dispatch */
+} synth_alarm_t;
+
+static const synth_alarm_t synth_alarms[] = {
+    /* main CPU: VIC-II raster, 2 CIAs with 2 timers and TOD, REU, SID, tape,
+       cartridge, RS232, keyboard and joystick */
+    { 0, 63, 0, 0, 0 },
+    { 0, 63 * 312, 0, 0, 0 },
+    { 0, 985, 200, 4000, 600 },
+    { 0, 19656, 0, 2000, 0 },
+    { 0, 98524, 0, 100, 0 },
+    { 0, 300, 500, 6000, 3000 },
+    { 0, 4000, 1000, 3000, 1500 },
+    { 0, 98524, 0, 100, 0 },
+    { 0, 16, 16, 2000, 8000 },
+    { 0, 8000, 0, 50, 0 },
+    { 0, 500, 2000, 1000, 2000 },
+    { 0, 3000, 3000, 500, 1000 },
+    { 0, 19656, 0, 20, 0 },
+    { 0, 1000, 100, 100, 100 },
+    { 0, 250, 50, 200, 400 },
+    /* drive 8: 2 VIAs with 2 timers each, rotation, motor and ATN */
+    { 1, 65536, 0, 4000, 0 },
+    { 1, 255, 0, 1000, 0 },
+    { 1, 65536, 0, 4000, 0 },
+    { 1, 26, 6, 200, 0 },
+    { 1, 20000, 0, 50, 0 },
+    { 1, 100, 100, 2000, 4000 },
+    /* drive 9 */
+    { 2, 65536, 0, 4000, 0 },
+    { 2, 255, 0, 1000, 0 },
+    { 2, 65536, 0, 4000, 0 },
+    { 2, 26, 6, 200, 0 },
+    { 2, 20000, 0, 50, 0 },
+    { 2, 100, 100, 2000, 4000 },
+};
+
+#define SYNTH_NUM_ALARMS    (sizeof(synth_alarms) / sizeof(synth_alarms[0]))
+#define SYNTH_NUM_CONTEXTS  3
+
+static CLOCK synth_next_clk(unsigned int i, CLOCK now)
+{
+    CLOCK delay = synth_alarms[i].period;
+
+    if (synth_alarms[i].jitter) {
+        delay += test_rand() % synth_alarms[i].jitter;
+    }
+    return now + delay;
+}
+
+static void synth_trace(size_t num_dispatches)
+{
+    CLOCK next[SYNTH_NUM_ALARMS];
+    unsigned int i, c;
+    size_t n;
+
+    test_rand_seed(0x1541);
+
+    trace.num_contexts = SYNTH_NUM_CONTEXTS;
+    for (i = 0; i < SYNTH_NUM_CONTEXTS; i++) {
+        trace.context_id[i] = i;
+    }
+    trace.num_alarms = SYNTH_NUM_ALARMS;
+    for (i = 0; i < SYNTH_NUM_ALARMS; i++) {
+        trace.alarm_id[i] = i;
+        trace.alarm_context[i] = (uint8_t)synth_alarms[i].context;
+        next[i] = synth_next_clk(i, 0);
+        add_event(EV_SET, synth_alarms[i].context, i, next[i], 0);
+    }
+
+    for (n = 0; n < num_dispatches; n++) {
+        unsigned int first = 0;
+        CLOCK now;
+
+        /* the earliest alarm of all contexts is dispatched next */
+        for (i = 1; i < SYNTH_NUM_ALARMS; i++) {
+            if (next[i] < next[first]) {
+                first = i;
+            }
+        }
+        now = next[first];
+        c = synth_alarms[first].context;
+
+        add_event(EV_DISPATCH, c, 0, now, 0);
+
+        /* the callback re-arms or stops its alarm */
+        if ((test_rand() & 0xffff) < synth_alarms[first].unset) {
+            next[first] = CLOCK_MAX;
+            add_event(EV_UNSET, c, first, 0, 0);
+        } else {
+            next[first] = synth_next_clk(first, now);
+            add_event(EV_SET, c, first, next[first], 0);
+        }
+
+        /* register writes reprogram other alarms of the context */
+        for (i = 0; i < SYNTH_NUM_ALARMS; i++) {
+            if (synth_alarms[i].context == c && i != first
+                && (test_rand() & 0xffff) < synth_alarms[i].reprogram) {
+                next[i] = synth_next_clk(i, now + 1);
+                add_event(EV_SET, c, i, next[i], 0);
+            }
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void dummy_callback(CLOCK offset, void *data)
+{
+}
+
+static void replay_setup(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < trace.num_contexts; i++) {
+        contexts[i] = alarm_context_new("bench");
+    }
+    for (i = 0; i < trace.num_alarms; i++) {
+        alarms[i] = alarm_new(contexts[trace.alarm_context[i]], "bench",
+                              dummy_callback, NULL);
+    }
+}
+
+static void replay_reset(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < trace.num_alarms; i++) {
+        alarm_unset(alarms[i]);
+    }
+}
+
+/* Replay all events, returns the index of the first dispatch where the
+   alarm contexts disagree with the trace, or -1.  */
+static long replay(void)
+{
+    size_t i;
+
+    for (i = 0; i < trace.num; i++) {
+        const event_t *ev = &trace.events[i];
+        alarm_context_t *context = contexts[ev->context];
+
+        switch (ev->type) {
+            case EV_SET:
+                alarm_set(alarms[ev->alarm], ev->clk);
+                break;
+            case EV_UNSET:
+                alarm_unset(alarms[ev->alarm]);
+                break;
+            case EV_DISPATCH:
+                if (alarm_context_next_pending_clk(context) != ev->clk) {
+                    return (long)i;
+                }
+                alarm_context_dispatch(context, ev->clk);
+                break;
+            case EV_WARP:
+                alarm_context_time_warp(context, ev->clk, ev->warp_direction);
+                break;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    int repeats;
+    size_t dispatches = 0;
+    double start, elapsed;
+    long bad;
+    size_t i;
+    int r;
+
+    test_init("alarmbench", "[trace [repeats]]");
+    if (argc > 1) {
+        read_trace(argv[1]);
+    } else {
+        synth_trace(500000);
+    }
+    repeats = test_arg_int(argc, argv, 2, 20);
+
+    for (i = 0; i < trace.num; i++) {
+        if (trace.events[i].type == EV_DISPATCH) {
+            dispatches++;
+        }
+    }
+
+    replay_setup();
+
+    start = test_time();
+    for (r = 0; r < repeats; r++) {
+        replay_reset();
+        bad = replay();
+        if (bad >= 0) {
+            return test_fail("event %ld: dispatch at %"PRIu64", context has %"PRIu64,
+                             bad, trace.events[bad].clk,
+                             alarm_context_next_pending_clk(contexts[trace.events[bad].context]));
+        }
+    }
+    elapsed = test_time() - start;
+
+    test_print("%u contexts, %u alarms, %lu events, %lu dispatches",
+               trace.num_contexts, trace.num_alarms,
+               (unsigned long)trace.num, (unsigned long)dispatches);
+    test_print("%.2f ns per event, %.1f M dispatches/s",
+               elapsed * 1e9 / ((double)trace.num * repeats),
+               (double)dispatches * repeats / elapsed / 1e6);
+    return test_failed();
+}
@@ -0,0 +1,340 @@
+/*
+ * fsimagebench.c - Check and time the disk image backends.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Usage: fsimagebench [sectors]
+
+   Reads and writes pseudo random sectors of a 16 MiB image, the size of a
+   DHD, through diskimage/fsimage-cache.c with the stdio, memory mapped and
+   in-memory backends.  Every read must return what the same accesses on a
+   copy in plain memory give, and the image file must hold the same data
+   after the image is closed.  With a sync interval, changes must reach the
+   file from the frame hook once the interval has passed, without another
+   write.
+
+   Then prints how many sectors per second each backend reads and writes,
+   timed over `sectors' accesses (default 200000) with one write in ten,
+   and a D64 sized image opened, read completely and closed.  The image is
+   a temporary file.  The program exits with status 1 on the first
+   difference.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diskimage.h"
+#include "lib.h"
+#include "types.h"
+
+#include "teststubs.h"
+
+/* the test needs the cache state and the sync interval, which are static,
+   so fsimage-cache.c is built into it */
+#include "../diskimage/fsimage-cache.c"
+
+#define SECTOR_SIZE     256
+#define IMAGE_SECTORS   65536
+#define IMAGE_SIZE      (IMAGE_SECTORS * SECTOR_SIZE)
+
+#define D64_SIZE        174848
+
+/* ------------------------------------------------------------------------- */
+
+/* The rest of the emulator, as far as fsimage-cache.c uses it and
+   teststubs.c does not have it.  */
+
+/* as in util.c */
+int util_fpread(FILE *fd, void *buf, size_t num, long offset)
+{
+    if (fseek(fd, offset, SEEK_SET) < 0 || fread(buf, num, 1, fd) < 1) {
+        return -1;
+    }
+    return 0;
+}
+
+int util_fpwrite(FILE *fd, const void *buf, size_t num, long offset)
+{
+    if (fseek(fd, offset, SEEK_SET) < 0 || fwrite(buf, num, 1, fd) < 1) {
+        return -1;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const struct {
+    int backend;
+    const char *name;
+} backends[] = {
+    { FSIMAGE_BACKEND_STDIO, "stdio" },
+    { FSIMAGE_BACKEND_MMAP, "mmap" },
+    { FSIMAGE_BACKEND_MEMORY, "memory" }
+};
+
+#define NUM_BACKENDS (int)(sizeof(backends) / sizeof(backends[0]))
+
+static uint8_t *reference;
+static uint8_t *file_data;
+
+static disk_image_t image;
+static fsimage_t fsimage;
+
+/* A fresh temporary image of `size' bytes with the contents of `reference',
+   opened with `backend' like fsimage_open() does.  */
+static int image_open(int backend, size_t size)
+{
+    memset(&image, 0, sizeof(image));
+    memset(&fsimage, 0, sizeof(fsimage));
+    image.media.fsimage = &fsimage;
+    image.type = size == D64_SIZE ? DISK_IMAGE_TYPE_D64 : DISK_IMAGE_TYPE_DHD;
+    fsimage.name = "fsimagebench";
+
+    fsimage.fd = tmpfile();
+    if (fsimage.fd == NULL) {
+        test_fail("cannot create a temporary file");
+        return -1;
+    }
+    if (fwrite(reference, size, 1, fsimage.fd) < 1 || fflush(fsimage.fd) != 0) {
+        fclose(fsimage.fd);
+        test_fail("cannot write the temporary file");
+        return -1;
+    }
+
+    fsimage_cache_set_backend(backend);
+    fsimage_cache_open(&image);
+    if (backend != FSIMAGE_BACKEND_STDIO && fsimage.cache == NULL) {
+        fclose(fsimage.fd);
+        test_fail("%s: the cache did not open", backends[backend].name);
+        return -1;
+    }
+    return 0;
+}
+
+static int image_close(void)
+{
+    int result = fsimage_cache_close(&image);
+
+    fclose(fsimage.fd);
+    return result;
+}
+
+/* The file as it is now, through stdio like another reader sees it.  */
+static int file_matches(size_t size)
+{
+    fflush(fsimage.fd);
+    if (util_fpread(fsimage.fd, file_data, size, 0) < 0) {
+        return 0;
+    }
+    return memcmp(file_data, reference, size) == 0;
+}
+
+static void random_sector(uint8_t *buf)
+{
+    int i;
+
+    for (i = 0; i < SECTOR_SIZE; i++) {
+        buf[i] = (uint8_t)test_rand();
+    }
+}
+
+/* Random reads and writes, also unaligned and across sectors, compared
+   with the same accesses on `reference'.  */
+static int check_backend(int b)
+{
+    uint8_t buf[SECTOR_SIZE * 2];
+    int i;
+
+    if (image_open(backends[b].backend, IMAGE_SIZE) < 0) {
+        return 1;
+    }
+
+    for (i = 0; i < 20000; i++) {
+        uint32_t r = test_rand();
+        size_t num = r & 1 ? SECTOR_SIZE : 1 + (r >> 1) % (SECTOR_SIZE * 2);
+        long offset = (long)(test_rand() % (IMAGE_SIZE - num + 1));
+
+        if ((r >> 16) % 4 == 0) {
+            random_sector(buf);
+            random_sector(buf + SECTOR_SIZE);
+            if (fsimage_write(&fsimage, buf, num, offset) < 0) {
+                image_close();
+                return test_fail("%s: write of %u bytes at %ld failed",
+                                 backends[b].name, (unsigned int)num, offset);
+            }
+            fsimage_flush(&fsimage);
+            memcpy(reference + offset, buf, num);
+        } else {
+            if (fsimage_read(&fsimage, buf, num, offset) < 0
+                || memcmp(buf, reference + offset, num) != 0) {
+                image_close();
+                return test_fail("%s: read of %u bytes at %ld differs",
+                                 backends[b].name, (unsigned int)num, offset);
+            }
+        }
+    }
+
+    /* everything must be in the file after close */
+    if (fsimage_cache_close(&image) < 0) {
+        fclose(fsimage.fd);
+        return test_fail("%s: close failed", backends[b].name);
+    }
+    if (!file_matches(IMAGE_SIZE)) {
+        fclose(fsimage.fd);
+        return test_fail("%s: the file differs after close", backends[b].name);
+    }
+    fclose(fsimage.fd);
+    return 0;
+}
+
+/* A write, then only frames: the change must be in the file once the sync
+   interval has passed, not before (in memory mode, mmap shares the pages
+   with the file).  */
+static int check_sync(int b)
+{
+    uint8_t buf[SECTOR_SIZE];
+    long offset = 1234 * SECTOR_SIZE;
+    int saved_interval = sync_interval;
+    int failed = 0;
+
+    if (image_open(backends[b].backend, IMAGE_SIZE) < 0) {
+        return 1;
+    }
+    sync_interval = 1;
+
+    random_sector(buf);
+    fsimage_write(&fsimage, buf, SECTOR_SIZE, offset);
+    fsimage_flush(&fsimage);
+    memcpy(reference + offset, buf, SECTOR_SIZE);
+
+    fsimage_cache_vsync_hook();
+    if (backends[b].backend == FSIMAGE_BACKEND_MEMORY && file_matches(IMAGE_SIZE)) {
+        failed = test_fail("%s: written back before the interval", backends[b].name);
+    }
+
+    /* as if a second went by */
+    fsimage.cache->dirty_since -= tick_per_second() + 1;
+    fsimage_cache_vsync_hook();
+    if (!failed && (fsimage.cache->dirty || !file_matches(IMAGE_SIZE))) {
+        failed = test_fail("%s: not written back from the frame hook", backends[b].name);
+    }
+
+    sync_interval = saved_interval;
+    image_close();
+    return failed;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void time_backend(int b, int sectors)
+{
+    uint8_t buf[SECTOR_SIZE];
+    double start, t_access, t_d64;
+    long *offsets;
+    int i, images;
+
+    offsets = lib_malloc((size_t)sectors * sizeof(long));
+    for (i = 0; i < sectors; i++) {
+        offsets[i] = (long)(test_rand() % IMAGE_SECTORS) * SECTOR_SIZE;
+    }
+    random_sector(buf);
+
+    if (image_open(backends[b].backend, IMAGE_SIZE) < 0) {
+        lib_free(offsets);
+        return;
+    }
+    start = test_time();
+    for (i = 0; i < sectors; i++) {
+        if (i % 10 == 0) {
+            fsimage_write(&fsimage, buf, SECTOR_SIZE, offsets[i]);
+            fsimage_flush(&fsimage);
+        } else {
+            fsimage_read(&fsimage, buf, SECTOR_SIZE, offsets[i]);
+        }
+    }
+    fsimage_cache_close(&image);
+    t_access = test_time() - start;
+    fclose(fsimage.fd);
+
+    /* open, read and close many small images, like c1541 batch mode */
+    images = sectors / 683 + 1;
+    t_d64 = 0.0;
+    for (i = 0; i < images; i++) {
+        long offset;
+
+        if (image_open(backends[b].backend, D64_SIZE) < 0) {
+            break;
+        }
+        fsimage_cache_close(&image);
+        start = test_time();
+        fsimage_cache_open(&image);
+        for (offset = 0; offset < D64_SIZE; offset += SECTOR_SIZE) {
+            fsimage_read(&fsimage, buf, SECTOR_SIZE, offset);
+        }
+        fsimage_cache_close(&image);
+        t_d64 += test_time() - start;
+        fclose(fsimage.fd);
+    }
+
+    test_print("%-7s %9.0f sectors/s, %7.0f D64 images/s",
+               backends[b].name, sectors / t_access, images / t_d64);
+    lib_free(offsets);
+}
+
+int main(int argc, char **argv)
+{
+    int sectors;
+    int b, i, failed = 0;
+
+    test_init("fsimagebench", "[sectors]");
+    sectors = test_arg_int(argc, argv, 1, 200000);
+
+    reference = lib_malloc(IMAGE_SIZE);
+    file_data = lib_malloc(IMAGE_SIZE);
+    test_rand_seed(0x1541);
+    for (i = 0; i < IMAGE_SIZE; i++) {
+        reference[i] = (uint8_t)test_rand();
+    }
+
+    for (b = 0; b < NUM_BACKENDS && !failed; b++) {
+        failed = check_backend(b)
+                 || (backends[b].backend != FSIMAGE_BACKEND_STDIO && check_sync(b));
+        if (!failed) {
+            test_print("%s backend matches memory", backends[b].name);
+        }
+    }
+
+    if (!failed) {
+        for (b = 0; b < NUM_BACKENDS; b++) {
+            time_backend(b, sectors);
+        }
+    }
+
+    fsimage_cache_set_backend(FSIMAGE_BACKEND_STDIO);
+    lib_free(reference);
+    lib_free(file_data);
+    return test_failed();
+}
@@ -0,0 +1,98 @@
+/*
+ * memgetmulti.c - Check the size limits of binary monitor multi-range reads.
+ *
+ * Runs mon_memget_multi_response_size() on requests at and over the limits,
+ * including 65535 ranges of 64 KiB, whose size does not fit in 32 bits.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mon_memget_multi.h"
+
+#include "teststubs.h"
+
+static uint8_t ranges[65535 * MON_MEMGET_MULTI_RANGE_SIZE];
+
+/* Fill the first `count' ranges with start..end in bank 0 of the computer */
+static void set_ranges(unsigned int count, unsigned int start, unsigned int end)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        uint8_t *range = &ranges[i * MON_MEMGET_MULTI_RANGE_SIZE];
+
+        range[0] = (uint8_t)start;
+        range[1] = (uint8_t)(start >> 8);
+        range[2] = (uint8_t)end;
+        range[3] = (uint8_t)(end >> 8);
+        range[4] = 0;
+        range[5] = 0;
+        range[6] = 0;
+    }
+}
+
+static void check(const char *what, unsigned int count, unsigned int start, unsigned int end,
+                  uint32_t expected)
+{
+    uint32_t size;
+
+    set_ranges(count, start, end);
+    size = mon_memget_multi_response_size(ranges, count);
+    if (size != expected) {
+        test_fail("%s: %u ranges $%04x-$%04x, size %u, expected %u",
+                  what, count, start, end, size, expected);
+    }
+}
+
+int main(void)
+{
+    test_init("memgetmulti", "");
+
+    check("no ranges", 0, 0, 0, 2);
+    check("one byte", 1, 0x1000, 0x1000, 2 + 4 + 1);
+    check("all memory", 1, 0x0000, 0xffff, 2 + 4 + 0x10000);
+    check("start after end", 1, 0x2000, 0x1fff, 0);
+
+    /* range count limit */
+    check("most ranges", MON_MEMGET_MULTI_MAX_RANGES, 0xd000, 0xd000,
+          2 + MON_MEMGET_MULTI_MAX_RANGES * (4 + 1));
+    check("too many ranges", MON_MEMGET_MULTI_MAX_RANGES + 1, 0xd000, 0xd000, 0);
+
+    /* size limit, 255 full ranges fit, 256 do not */
+    check("largest response", 255, 0x0000, 0xffff, 2 + 255 * (4 + 0x10000));
+    check("too large response", 256, 0x0000, 0xffff, 0);
+
+    /* 2 + 65535 * (4 + 0x10000) wraps to 196606 in 32 bits */
+    check("size over 32 bits", 65535, 0x0000, 0xffff, 0);
+
+    if (!test_failed()) {
+        test_print("limits ok");
+    }
+    return test_failed();
+}
@@ -0,0 +1,238 @@
+/*
+ * neon-shim.h - Portable stand-in for the NEON intrinsics used by VICE.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Plain C versions of the NEON intrinsics used by the reSID convolution and
+   the CRT render kernels, following the ARM C Language Extensions.  Code
+   built with VICE_NEON_SHIM uses this header instead of <arm_neon.h>, so the
+   equivalence checks in this directory also cover the NEON code on hosts
+   without NEON.  Add the intrinsics new NEON code uses here.  */
+
+#ifndef VICE_NEON_SHIM_H
+#define VICE_NEON_SHIM_H
+
+#include <stdint.h>
+
+typedef struct { int16_t v[4]; } int16x4_t;
+typedef struct { int16_t v[8]; } int16x8_t;
+typedef struct { int32_t v[2]; } int32x2_t;
+typedef struct { int32_t v[4]; } int32x4_t;
+
+/* the lanes wrap around like the hardware does */
+#define NEON_SHIM_WRAP32(x) ((int32_t)(uint32_t)(x))
+
+static inline int32x4_t vdupq_n_s32(int32_t x)
+{
+    int32x4_t r;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.v[i] = x;
+    }
+    return r;
+}
+
+static inline int16x8_t vld1q_s16(const int16_t *p)
+{
+    int16x8_t r;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        r.v[i] = p[i];
+    }
+    return r;
+}
+
+static inline int32x4_t vld1q_s32(const int32_t *p)
+{
+    int32x4_t r;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.v[i] = p[i];
+    }
+    return r;
+}
+
+static inline void vst1q_s32(int32_t *p, int32x4_t a)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        p[i] = a.v[i];
+    }
+}
+
+static inline void vst1_s16(int16_t *p, int16x4_t a)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        p[i] = a.v[i];
+    }
+}
+
+static inline int16x4_t vget_low_s16(int16x8_t a)
+{
+    int16x4_t r;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.v[i] = a.v[i];
+    }
+    return r;
+}
+
+static inline int16x4_t vget_high_s16(int16x8_t a)
+{
+    int16x4_t r;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.v[i] = a.v[i + 4];
+    }
+    return r;
+}
+
+static inline int32x2_t vget_low_s32(int32x4_t a)
+{
+    int32x2_t r;
+
+    r.v[0] = a.v[0];
+    r.v[1] = a.v[1];
+    return r;
+}
+
+static inline int32x2_t vget_high_s32(int32x4_t a)
+{
+    int32x2_t r;
+
+    r.v[0] = a.v[2];
+    r.v[1] = a.v[3];
+    return r;
+}
+
+#define vget_lane_s32(a, lane) ((a).v[(lane)])
+
+static inline int32x4_t vmlal_s16(int32x4_t acc, int16x4_t a, int16x4_t b)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        acc.v[i] = NEON_SHIM_WRAP32((uint32_t)acc.v[i] + (uint32_t)((int32_t)a.v[i] * b.v[i]));
+    }
+    return acc;
+}
+
+static inline int32x2_t vadd_s32(int32x2_t a, int32x2_t b)
+{
+    a.v[0] = NEON_SHIM_WRAP32((uint32_t)a.v[0] + (uint32_t)b.v[0]);
+    a.v[1] = NEON_SHIM_WRAP32((uint32_t)a.v[1] + (uint32_t)b.v[1]);
+    return a;
+}
+
+static inline int32x2_t vpadd_s32(int32x2_t a, int32x2_t b)
+{
+    int32x2_t r;
+
+    r.v[0] = NEON_SHIM_WRAP32((uint32_t)a.v[0] + (uint32_t)a.v[1]);
+    r.v[1] = NEON_SHIM_WRAP32((uint32_t)b.v[0] + (uint32_t)b.v[1]);
+    return r;
+}
+
+static inline int32x4_t vaddq_s32(int32x4_t a, int32x4_t b)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        a.v[i] = NEON_SHIM_WRAP32((uint32_t)a.v[i] + (uint32_t)b.v[i]);
+    }
+    return a;
+}
+
+static inline int32x4_t vsubq_s32(int32x4_t a, int32x4_t b)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        a.v[i] = NEON_SHIM_WRAP32((uint32_t)a.v[i] - (uint32_t)b.v[i]);
+    }
+    return a;
+}
+
+static inline int32x4_t vmulq_n_s32(int32x4_t a, int32_t b)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        a.v[i] = NEON_SHIM_WRAP32((uint32_t)a.v[i] * (uint32_t)b);
+    }
+    return a;
+}
+
+static inline int32x4_t vmlaq_n_s32(int32x4_t acc, int32x4_t a, int32_t b)
+{
+    return vaddq_s32(acc, vmulq_n_s32(a, b));
+}
+
+static inline int32x4_t vmlsq_n_s32(int32x4_t acc, int32x4_t a, int32_t b)
+{
+    return vsubq_s32(acc, vmulq_n_s32(a, b));
+}
+
+/* arithmetic shift, like the hardware */
+static inline int32x4_t vshrq_n_s32(int32x4_t a, int n)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        a.v[i] = a.v[i] < 0 ? ~(~a.v[i] >> n) : a.v[i] >> n;
+    }
+    return a;
+}
+
+static inline int32x4_t vmovl_s16(int16x4_t a)
+{
+    int32x4_t r;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.v[i] = a.v[i];
+    }
+    return r;
+}
+
+static inline int16x4_t vmovn_s32(int32x4_t a)
+{
+    int16x4_t r;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.v[i] = (int16_t)(uint16_t)(uint32_t)a.v[i];
+    }
+    return r;
+}
+
+#endif
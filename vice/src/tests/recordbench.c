@@ -0,0 +1,528 @@
+/*
+ * recordbench.c - Check and time the frame queue of the video recorders.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Usage: recordbench [frames]
+
+   Pushes `frames' PAL sized video frames (default 2000), each followed by
+   one frame worth of audio, through gfxoutputdrv/recordqueue.c to an
+   encoder that converts the frames to RGB like the recorders do.
+
+   With the emulation waiting for the encoder every frame and every audio
+   buffer must reach the encoder once, in order, with the pixels and the
+   palette they were pushed with.  With RecordDropFrames and an encoder
+   slower than the pushes, all audio must still arrive in order and the
+   repeat counts of the frames that got through must add up to the frames
+   pushed, also when the last frames were dropped.  Screenshots larger and
+   smaller than the video must be cut and centered.
+
+   Then prints the time the emulation thread spends in the recorder per
+   frame and the frames per second of the whole run, with some work for
+   the emulation between the frames, the encoder called directly and
+   through queues of several sizes.  The queues only gain with a core for
+   the encoder.  The program exits with status 1 on the first
+   difference.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib.h"
+#include "palette.h"
+#include "screenshot.h"
+#include "types.h"
+
+#include "teststubs.h"
+
+/* the test needs the queue internals and the settings, which are static,
+   so recordqueue.c is built into it */
+#include "../gfxoutputdrv/recordqueue.c"
+
+#define VIDEO_WIDTH     384
+#define VIDEO_HEIGHT    272
+
+/* 44100 Hz stereo at 50 frames per second */
+#define AUDIO_SAMPLES   (882 * 2)
+
+/* ------------------------------------------------------------------------- */
+
+/* What the encoder got, in order.  */
+
+typedef struct encoded_s {
+    recordqueue_item_type_t type;
+    uint32_t id;
+    int repeat;
+    uint32_t hash;
+} encoded_t;
+
+static encoded_t *encoded;
+static int num_encoded;
+static int max_encoded;
+
+/* extra work per video frame in the encoder, to make it fall behind */
+static int encode_spin;
+
+#ifdef HAVE_PTHREAD_H
+/* held by the emulation side to stop the encoder at the next frame */
+static pthread_mutex_t encoder_hold = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static uint32_t rgb[VIDEO_WIDTH * VIDEO_HEIGHT];
+
+static uint32_t hash_bytes(uint32_t hash, const uint8_t *p, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        hash = (hash ^ p[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/* The frame number is in the first four pixels of the video.  */
+static uint32_t frame_id(const uint8_t *pixels)
+{
+    return (uint32_t)pixels[0] | ((uint32_t)pixels[1] << 8)
+           | ((uint32_t)pixels[2] << 16) | ((uint32_t)pixels[3] << 24);
+}
+
+/* Converts to RGB, like the ZMBV and ffmpeg encoders, and remembers the
+   item.  Called on the encoder thread.  */
+static int test_encode(recordqueue_item_t *item, void *param)
+{
+    encoded_t *e;
+    uint32_t hash = 2166136261U;
+    int i, r;
+
+    if (num_encoded == max_encoded) {
+        max_encoded = max_encoded ? max_encoded * 2 : 8192;
+        encoded = lib_realloc(encoded, (size_t)max_encoded * sizeof(encoded_t));
+    }
+    e = &encoded[num_encoded++];
+    e->type = item->type;
+    e->repeat = 0;
+
+    if (item->type == RECORDQUEUE_ITEM_AUDIO) {
+        e->id = (uint32_t)(uint16_t)item->samples[0] | ((uint32_t)(uint16_t)item->samples[1] << 16);
+        e->hash = hash_bytes(hash, (const uint8_t *)item->samples, item->num_samples * sizeof(int16_t));
+        return 0;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&encoder_hold);
+    pthread_mutex_unlock(&encoder_hold);
+#endif
+
+    e->id = frame_id(item->pixels);
+    e->repeat = item->repeat;
+    hash = hash_bytes(hash, item->palette, sizeof(item->palette));
+    e->hash = hash_bytes(hash, item->pixels, (size_t)item->width * (size_t)item->height);
+
+    for (r = 0; r < item->repeat; r++) {
+        for (i = 0; i < item->width * item->height; i++) {
+            const uint8_t *c = &item->palette[item->pixels[i] * 3];
+
+            rgb[i] = ((uint32_t)c[0] << 16) | ((uint32_t)c[1] << 8) | c[2];
+        }
+        for (i = 0; i < encode_spin; i++) {
+            rgb[i % (VIDEO_WIDTH * VIDEO_HEIGHT)] += (uint32_t)i;
+        }
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The emulation side: a screenshot of `width' x `height' with distinct
+   content per frame, and the audio of a frame.  */
+
+/* work of the emulation between two frames, while timing */
+static int emulate_spin;
+static uint32_t emulate_state[4096];
+
+static palette_t palette;
+static palette_entry_t palette_entries[16];
+static screenshot_t screenshot;
+static uint8_t *draw_buffer;
+static int16_t samples[AUDIO_SAMPLES];
+
+#define BORDER  8
+
+static void make_screenshot(unsigned int width, unsigned int height)
+{
+    lib_free(draw_buffer);
+    memset(&screenshot, 0, sizeof(screenshot));
+    /* some room around the visible part, like the canvas has */
+    screenshot.draw_buffer_line_size = width + 2 * BORDER;
+    draw_buffer = lib_malloc((size_t)screenshot.draw_buffer_line_size * (height + 2 * BORDER));
+    screenshot.draw_buffer = draw_buffer;
+    screenshot.x_offset = BORDER;
+    screenshot.y_offset = BORDER;
+    screenshot.width = width;
+    screenshot.height = height;
+    screenshot.palette = &palette;
+}
+
+static void make_frame(uint32_t id)
+{
+    unsigned int x, y;
+    uint8_t *line;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        palette_entries[i].red = (uint8_t)(id * 3 + (uint32_t)i);
+        palette_entries[i].green = (uint8_t)(id * 5 + (uint32_t)i * 7);
+        palette_entries[i].blue = (uint8_t)(id * 11 + (uint32_t)i * 13);
+    }
+    for (y = 0; y < screenshot.height + 2 * BORDER; y++) {
+        line = draw_buffer + y * screenshot.draw_buffer_line_size;
+        for (x = 0; x < screenshot.draw_buffer_line_size; x++) {
+            line[x] = (uint8_t)((x + y * 3 + id * 7) & 0x0f);
+        }
+    }
+    line = draw_buffer + screenshot.y_offset * screenshot.draw_buffer_line_size + screenshot.x_offset;
+    line[0] = (uint8_t)id;
+    line[1] = (uint8_t)(id >> 8);
+    line[2] = (uint8_t)(id >> 16);
+    line[3] = (uint8_t)(id >> 24);
+}
+
+static void make_audio(uint32_t id)
+{
+    int i;
+
+    samples[0] = (int16_t)(uint16_t)id;
+    samples[1] = (int16_t)(uint16_t)(id >> 16);
+    for (i = 2; i < AUDIO_SAMPLES; i++) {
+        samples[i] = (int16_t)(id * 31 + (uint32_t)i);
+    }
+}
+
+/* Hashes of frame `id' as the encoder should see it, with the screenshot
+   centered in the video and cut to it, the border black.  */
+static uint32_t reference_hash(uint32_t id, uint32_t *audio_hash)
+{
+    static uint8_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+    uint8_t pal[RECORDQUEUE_PALETTE_COLORS * 3];
+    uint32_t hash = 2166136261U;
+    int dx = (VIDEO_WIDTH - (int)screenshot.width) / 2;
+    int dy = (VIDEO_HEIGHT - (int)screenshot.height) / 2;
+    int x, y, i;
+
+    make_frame(id);
+    memset(pal, 0, sizeof(pal));
+    for (i = 0; i < 16; i++) {
+        pal[i * 3 + 0] = palette_entries[i].red;
+        pal[i * 3 + 1] = palette_entries[i].green;
+        pal[i * 3 + 2] = palette_entries[i].blue;
+    }
+    for (y = 0; y < VIDEO_HEIGHT; y++) {
+        for (x = 0; x < VIDEO_WIDTH; x++) {
+            int sx = x - dx, sy = y - dy;
+
+            if (sx < 0 || sy < 0 || sx >= (int)screenshot.width || sy >= (int)screenshot.height) {
+                pixels[y * VIDEO_WIDTH + x] = 0;
+            } else {
+                pixels[y * VIDEO_WIDTH + x] =
+                    draw_buffer[(sy + BORDER) * screenshot.draw_buffer_line_size + sx + BORDER];
+            }
+        }
+    }
+    hash = hash_bytes(hash, pal, sizeof(pal));
+
+    make_audio(id);
+    *audio_hash = hash_bytes(2166136261U, (const uint8_t *)samples, sizeof(samples));
+
+    return hash_bytes(hash, pixels, sizeof(pixels));
+}
+
+static void emulate(void)
+{
+    int i;
+
+    for (i = 0; i < emulate_spin; i++) {
+        emulate_state[i & 4095] = emulate_state[(i * 7) & 4095] * 69069 + (uint32_t)i;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct run_s {
+    double push_seconds;    /* spent in the push functions */
+    double total_seconds;   /* until everything is encoded */
+    unsigned long dropped;
+    int queue_size;
+} run_t;
+
+/* Pushes `frames' frames with audio, then `tail' more frames without audio
+   as the end of a recording may have.  The encoder is stopped for the tail,
+   so with dropping enabled the frames after the first few are dropped.  */
+static int run_queue(int frames, int tail, int size, int drop, run_t *run)
+{
+    recordqueue_t *queue;
+    double start, push_start;
+    int i;
+
+    num_encoded = 0;
+    record_queue_size = size;
+    record_drop_frames = drop;
+
+    start = test_time();
+    run->push_seconds = 0.0;
+    queue = recordqueue_new("recordbench", VIDEO_WIDTH, VIDEO_HEIGHT, test_encode, NULL);
+    run->queue_size = queue->size;
+
+    for (i = 0; i < frames + tail; i++) {
+        emulate();
+#ifdef HAVE_PTHREAD_H
+        if (i == frames && tail > 0) {
+            pthread_mutex_lock(&encoder_hold);
+        }
+#endif
+        make_frame((uint32_t)i);
+        if (i < frames) {
+            make_audio((uint32_t)i);
+        }
+        push_start = test_time();
+        if (recordqueue_push_video(queue, &screenshot, 1) < 0
+            || (i < frames && recordqueue_push_audio(queue, samples, AUDIO_SAMPLES) < 0)) {
+            test_fail("push failed");
+#ifdef HAVE_PTHREAD_H
+            if (i >= frames && tail > 0) {
+                pthread_mutex_unlock(&encoder_hold);
+            }
+#endif
+            recordqueue_close(queue);
+            return -1;
+        }
+        run->push_seconds += test_time() - push_start;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    if (tail > 0) {
+        pthread_mutex_unlock(&encoder_hold);
+    }
+#endif
+    run->dropped = queue->frames_dropped;
+    if (recordqueue_close(queue) < 0) {
+        test_fail("close failed");
+        return -1;
+    }
+    run->total_seconds = test_time() - start;
+    return 0;
+}
+
+/* Every frame and every audio buffer once, in order, as pushed.  */
+static int check_all(const char *what, int frames)
+{
+    uint32_t video_hash, audio_hash;
+    int i;
+
+    if (num_encoded != frames * 2) {
+        return test_fail("%s: %d items encoded, %d pushed", what, num_encoded, frames * 2);
+    }
+    for (i = 0; i < frames; i++) {
+        const encoded_t *v = &encoded[i * 2], *a = &encoded[i * 2 + 1];
+
+        video_hash = reference_hash((uint32_t)i, &audio_hash);
+        /* the frame number may be cut off, the hash tells the frames apart */
+        if (v->type != RECORDQUEUE_ITEM_VIDEO || v->repeat != 1 || v->hash != video_hash) {
+            return test_fail("%s: item %d is not video frame %d as pushed", what, i * 2, i);
+        }
+        if (a->type != RECORDQUEUE_ITEM_AUDIO || a->id != (uint32_t)i || a->hash != audio_hash) {
+            return test_fail("%s: item %d is not audio buffer %d as pushed", what, i * 2 + 1, i);
+        }
+    }
+    return 0;
+}
+
+/* All audio in order; the repeats of each frame that got through make up
+   for the frames dropped before it, and the last repeats for the frames
+   dropped at the end.  */
+static int check_dropped(int frames, int tail, const run_t *run)
+{
+    uint32_t video_hash, audio_hash;
+    int i, audio = 0, total = 0;
+
+    for (i = 0; i < num_encoded; i++) {
+        const encoded_t *e = &encoded[i];
+
+        if (e->type == RECORDQUEUE_ITEM_AUDIO) {
+            reference_hash((uint32_t)audio, &audio_hash);
+            if (e->id != (uint32_t)audio || e->hash != audio_hash) {
+                return test_fail("drop: item %d is not audio buffer %d as pushed", i, audio);
+            }
+            audio++;
+            continue;
+        }
+        video_hash = reference_hash(e->id, &audio_hash);
+        if (e->hash != video_hash) {
+            return test_fail("drop: item %d is not video frame %u as pushed", i, e->id);
+        }
+        total += e->repeat;
+        /* only the repeats at close may go past the frame */
+        if (total != (int)e->id + 1 && i != num_encoded - 1) {
+            return test_fail("drop: %d frames in the stream after frame %u", total, e->id);
+        }
+    }
+    if (audio != frames) {
+        return test_fail("drop: %d audio buffers encoded, %d pushed", audio, frames);
+    }
+    if (total != frames + tail) {
+        return test_fail("drop: %d frames in the stream, %d pushed", total, frames + tail);
+    }
+    if (run->dropped == 0) {
+        return test_fail("drop: the encoder did not fall behind");
+    }
+    return 0;
+}
+
+static int check_queue(void)
+{
+    run_t run;
+    const int frames = 300, tail = 40;
+
+    /* the emulation waits, nothing may get lost */
+    make_screenshot(VIDEO_WIDTH, VIDEO_HEIGHT);
+    encode_spin = 0;
+    if (run_queue(frames, 0, 4, 0, &run) < 0 || check_all("wait", frames)) {
+        return 1;
+    }
+
+    /* cut, centered */
+    make_screenshot(VIDEO_WIDTH + 20, VIDEO_HEIGHT + 13);
+    if (run_queue(50, 0, 4, 0, &run) < 0 || check_all("larger screen", 50)) {
+        return 1;
+    }
+
+    /* border around it */
+    make_screenshot(VIDEO_WIDTH - 64, VIDEO_HEIGHT - 31);
+    if (run_queue(50, 0, 4, 0, &run) < 0 || check_all("smaller screen", 50)) {
+        return 1;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    /* an encoder a lot slower than the pushes, and stopped for the last
+       frames, so the video ends with dropped frames */
+    make_screenshot(VIDEO_WIDTH, VIDEO_HEIGHT);
+    encode_spin = VIDEO_WIDTH * VIDEO_HEIGHT * 4;
+    if (run_queue(frames, tail, 4, 1, &run) < 0 || check_dropped(frames, tail, &run)) {
+        return 1;
+    }
+    encode_spin = 0;
+
+    test_print("queue delivers all frames and audio, %lu of %d frames dropped and repeated",
+               run.dropped, frames + tail);
+#else
+    test_print("queue delivers all frames and audio, no thread to drop frames");
+#endif
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The encoder called right where the frame is pushed, as the recorders
+   did without the queue.  */
+static void time_direct(int frames)
+{
+    recordqueue_item_t item;
+    recordqueue_t queue;
+    double start, push_start, push_seconds = 0.0, seconds;
+    int i;
+
+    memset(&item, 0, sizeof(item));
+    memset(&queue, 0, sizeof(queue));
+    queue.width = VIDEO_WIDTH;
+    queue.height = VIDEO_HEIGHT;
+    item.pixels = lib_malloc(VIDEO_WIDTH * VIDEO_HEIGHT);
+    item.samples = samples;
+    item.num_samples = AUDIO_SAMPLES;
+
+    num_encoded = 0;
+    make_screenshot(VIDEO_WIDTH, VIDEO_HEIGHT);
+    make_audio(0);
+
+    start = test_time();
+    for (i = 0; i < frames; i++) {
+        emulate();
+        make_frame((uint32_t)i);
+        push_start = test_time();
+        item.type = RECORDQUEUE_ITEM_VIDEO;
+        item.repeat = 1;
+        recordqueue_fill_video(&queue, &item, &screenshot);
+        test_encode(&item, NULL);
+        item.type = RECORDQUEUE_ITEM_AUDIO;
+        test_encode(&item, NULL);
+        push_seconds += test_time() - push_start;
+        if (num_encoded > 4096) {
+            num_encoded = 0;
+        }
+    }
+    seconds = test_time() - start;
+
+    test_print("direct          emulation %7.1f us/frame, %7.1f frames/s",
+               push_seconds * 1e6 / frames, frames / seconds);
+    lib_free(item.pixels);
+}
+
+static void time_queue(int frames, int size, int drop)
+{
+    run_t run;
+
+    make_screenshot(VIDEO_WIDTH, VIDEO_HEIGHT);
+    if (run_queue(frames, 0, size, drop, &run) < 0) {
+        return;
+    }
+    test_print("queue %3d%-5s  emulation %7.1f us/frame, %7.1f frames/s, %lu dropped",
+               run.queue_size, drop ? " drop" : "",
+               run.push_seconds * 1e6 / frames, frames / run.total_seconds, run.dropped);
+}
+
+int main(int argc, char **argv)
+{
+    int frames;
+
+    test_init("recordbench", "[frames]");
+    frames = test_arg_int(argc, argv, 1, 2000);
+
+    palette.num_entries = 16;
+    palette.entries = palette_entries;
+
+    if (!check_queue()) {
+        /* an emulation about as busy as the encoder, in warp mode */
+        emulate_spin = VIDEO_WIDTH * VIDEO_HEIGHT;
+        time_direct(frames);
+        time_queue(frames, 2, 0);
+        time_queue(frames, 8, 0);
+        time_queue(frames, 32, 0);
+        time_queue(frames, 8, 1);
+    }
+
+    lib_free(draw_buffer);
+    lib_free(encoded);
+    return test_failed();
+}
@@ -0,0 +1,280 @@
+/*
+ * renderbench.c - Check and time the row kernels of the renderers.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Usage: renderbench [rows]
+          renderbench-neon [rows]
+
+   Feeds pseudo random rows, with the Y, U and V values spread over the
+   whole range the PAL and NTSC renderers produce, through every version of
+   the row kernels in video/render-simd.c.  The output rows, the scanlines
+   and the previous row kept for the next scanline must be the same as with
+   the scalar kernels, pixel for pixel, also for row lengths that are not a
+   multiple of the vector width.  Then prints how many pixels per second
+   each version converts, timed over `rows' full rows (default 20000).
+
+   renderbench-neon builds the kernels with the plain C stand-ins of
+   neon-shim.h, so the NEON version is checked on hosts without NEON (its
+   timing there means nothing).  The program exits with status 1 on the
+   first difference.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib.h"
+#include "render-simd.h"
+#include "types.h"
+#include "video.h"
+
+#include "teststubs.h"
+
+#define ROW_WIDTH   VIDEO_MAX_OUTPUT_WIDTH
+
+static const struct {
+    int kernels;
+    const char *name;
+} kernel_list[] = {
+    { RENDER_KERNELS_SCALAR, "scalar" },
+    { RENDER_KERNELS_AVX2, "avx2" },
+    { RENDER_KERNELS_NEON, "neon" }
+};
+
+#define NUM_KERNELS (int)(sizeof(kernel_list) / sizeof(kernel_list[0]))
+
+/* row lengths to check, the odd ones leave a tail for the scalar code */
+static const unsigned int widths[] = { 1, 3, 4, 7, 8, 9, 15, 17, 384, 403, 720, ROW_WIDTH };
+
+#define NUM_WIDTHS (int)(sizeof(widths) / sizeof(widths[0]))
+
+static uint32_t line_ref[ROW_WIDTH], scan_ref[ROW_WIDTH];
+static uint32_t line_out[ROW_WIDTH], scan_out[ROW_WIDTH];
+static int16_t prev_ref[ROW_WIDTH * 3], prev_out[ROW_WIDTH * 3];
+static uint8_t palette_src[ROW_WIDTH];
+static uint32_t palette_tab[256];
+
+/* random value in [min, max] */
+static int32_t rand_range(int32_t min, int32_t max)
+{
+    return min + (int32_t)(test_rand() % (uint32_t)(max - min + 1));
+}
+
+/* Fill a row with Y, U and V values as the renderers make them: with the
+   PAL matrix Y is 8.16 fixed point and U, V signed, NTSC uses 8.15.  The
+   extremes are put in now and then, the resulting RGB values then reach
+   the ends of the gamma tables.  */
+static void make_row(video_render_color_tables_t *color_tab, int matrix)
+{
+    int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    int32_t *urow = RENDER_YUVROW_U(color_tab);
+    int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    int shift = matrix == RENDER_YUV_NTSC ? 15 : 16;
+    int32_t ymax = (256 << shift) - 1;
+    int32_t uvmax = (matrix == RENDER_YUV_NTSC ? 64 : 128) << shift;
+    unsigned int x;
+
+    for (x = 0; x < ROW_WIDTH; x++) {
+        if (test_rand() % 16 == 0) {
+            yrow[x] = test_rand() & 1 ? ymax : 0;
+            urow[x] = test_rand() & 1 ? uvmax - 1 : -uvmax;
+            vrow[x] = test_rand() & 1 ? uvmax - 1 : -uvmax;
+        } else {
+            yrow[x] = rand_range(0, ymax);
+            urow[x] = rand_range(-uvmax, uvmax - 1);
+            vrow[x] = rand_range(-uvmax, uvmax - 1);
+        }
+    }
+}
+
+/* Distinct values in all tables, so a wrong index shows up.  */
+static void make_tables(video_render_color_tables_t *color_tab)
+{
+    int i;
+
+    for (i = 0; i < 256 * 3; i++) {
+        color_tab->gamma_red[i] = test_rand();
+        color_tab->gamma_grn[i] = test_rand();
+        color_tab->gamma_blu[i] = test_rand();
+    }
+    for (i = 0; i < 256 * 3 * 2; i++) {
+        color_tab->gamma_red_fac[i] = test_rand();
+        color_tab->gamma_grn_fac[i] = test_rand();
+        color_tab->gamma_blu_fac[i] = test_rand();
+    }
+    color_tab->alpha = 0xff000000;
+
+    for (i = 0; i < 256; i++) {
+        palette_tab[i] = test_rand();
+    }
+}
+
+static int compare(const char *what, const char *name, int matrix, unsigned int width,
+                   const uint32_t *out, const uint32_t *ref)
+{
+    unsigned int x;
+
+    for (x = 0; x < width; x++) {
+        if (out[x] != ref[x]) {
+            return test_fail("%s, %s, %s, width %u: pixel %u is %08x, scalar gives %08x",
+                             name, matrix == RENDER_YUV_NTSC ? "ntsc" : "pal", what, width, x,
+                             out[x], ref[x]);
+        }
+    }
+    return 0;
+}
+
+/* Run a few rows through the kernels and compare with the scalar ones.  */
+static int check_kernels(video_render_color_tables_t *color_tab, int k)
+{
+    const char *name = kernel_list[k].name;
+    int matrix, w, row, failed = 0;
+
+    for (matrix = RENDER_YUV_PAL; matrix <= RENDER_YUV_NTSC; matrix++) {
+        for (w = 0; w < NUM_WIDTHS; w++) {
+            unsigned int width = widths[w];
+
+            memset(color_tab->prevrgbline, 0, sizeof(color_tab->prevrgbline));
+            memset(prev_ref, 0, sizeof(prev_ref));
+
+            for (row = 0; row < 8; row++) {
+                unsigned int x;
+
+                make_row(color_tab, matrix);
+
+                /* scalar reference, with its own copy of the previous row */
+                memcpy(prev_out, color_tab->prevrgbline, sizeof(prev_out));
+                memcpy(color_tab->prevrgbline, prev_ref, sizeof(prev_ref));
+                render_simd_set(RENDER_KERNELS_SCALAR);
+                render_yuv_line(color_tab, matrix, line_ref, width);
+                render_yuv_line_scanline(color_tab, matrix, line_ref, scan_ref, width);
+                memcpy(prev_ref, color_tab->prevrgbline, sizeof(prev_ref));
+                memcpy(color_tab->prevrgbline, prev_out, sizeof(prev_out));
+
+                render_simd_set(kernel_list[k].kernels);
+                render_yuv_line(color_tab, matrix, line_out, width);
+                failed |= compare("line", name, matrix, width, line_out, line_ref);
+                render_yuv_line_scanline(color_tab, matrix, line_out, scan_out, width);
+                failed |= compare("line with scanline", name, matrix, width, line_out, line_ref);
+                failed |= compare("scanline", name, matrix, width, scan_out, scan_ref);
+
+                for (x = 0; x < ROW_WIDTH * 3; x++) {
+                    if (color_tab->prevrgbline[x] != prev_ref[x]) {
+                        failed = test_fail("%s, %s, width %u: previous row value %u is %d, scalar gives %d",
+                                           name, matrix == RENDER_YUV_NTSC ? "ntsc" : "pal", width, x,
+                                           color_tab->prevrgbline[x], prev_ref[x]);
+                        break;
+                    }
+                }
+                if (failed) {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    for (w = 0; w < NUM_WIDTHS; w++) {
+        unsigned int x, width = widths[w];
+
+        for (x = 0; x < ROW_WIDTH; x++) {
+            palette_src[x] = (uint8_t)test_rand();
+        }
+        render_simd_set(RENDER_KERNELS_SCALAR);
+        render_palette_line(line_ref, palette_src, palette_tab, width);
+        render_simd_set(kernel_list[k].kernels);
+        render_palette_line(line_out, palette_src, palette_tab, width);
+        if (compare("palette", name, RENDER_YUV_PAL, width, line_out, line_ref)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void time_kernels(video_render_color_tables_t *color_tab, int k, int rows)
+{
+    double start, t_line, t_scan, t_pal;
+    int row;
+
+    render_simd_set(kernel_list[k].kernels);
+
+    make_row(color_tab, RENDER_YUV_PAL);
+    start = test_time();
+    for (row = 0; row < rows; row++) {
+        render_yuv_line(color_tab, RENDER_YUV_PAL, line_out, ROW_WIDTH);
+    }
+    t_line = test_time() - start;
+
+    start = test_time();
+    for (row = 0; row < rows; row++) {
+        render_yuv_line_scanline(color_tab, RENDER_YUV_PAL, line_out, scan_out, ROW_WIDTH);
+    }
+    t_scan = test_time() - start;
+
+    start = test_time();
+    for (row = 0; row < rows; row++) {
+        render_palette_line(line_out, palette_src, palette_tab, ROW_WIDTH);
+    }
+    t_pal = test_time() - start;
+
+    test_print("%-7s yuv %7.1f, yuv+scanline %7.1f, palette %7.1f M pixels/s",
+               kernel_list[k].name,
+               (double)rows * ROW_WIDTH / t_line / 1e6,
+               (double)rows * ROW_WIDTH / t_scan / 1e6,
+               (double)rows * ROW_WIDTH / t_pal / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    video_render_color_tables_t *color_tab;
+    int rows;
+    int k;
+
+    test_init("renderbench", "[rows]");
+    rows = test_arg_int(argc, argv, 1, 20000);
+
+    color_tab = lib_calloc(1, sizeof(video_render_color_tables_t));
+    test_rand_seed(0x6569);
+    make_tables(color_tab);
+
+    for (k = 1; k < NUM_KERNELS; k++) {
+        if (render_simd_set(kernel_list[k].kernels) < 0) {
+            continue;
+        }
+        if (!check_kernels(color_tab, k)) {
+            test_print("%s kernels match scalar", kernel_list[k].name);
+        }
+    }
+
+    for (k = 0; k < NUM_KERNELS; k++) {
+        if (render_simd_set(kernel_list[k].kernels) == 0) {
+            time_kernels(color_tab, k, rows);
+        }
+    }
+
+    lib_free(color_tab);
+    return test_failed();
+}
@@ -0,0 +1,250 @@
+/*
+ * residbench.cc - Check and time the reSID sampling methods.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Usage: residbench [seconds]
+          residbench-neon [seconds]
+
+   Plays the same pseudo random register writes through both chip models
+   with every convolution version of sid.cc and checks that the resampling
+   methods give the same samples as with the scalar version, bit for bit.
+   Then prints how many samples per second each sampling method produces,
+   for the resampling methods once per convolution version.  `seconds' is
+   the length of the emulated tune, 10 by default.
+
+   residbench-neon is linked with a copy of reSID built with the plain C
+   stand-ins of neon-shim.h, so the NEON version is checked on hosts
+   without NEON (its timing there means nothing).  The program exits with
+   status 1 on the first difference.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sid.h"
+
+#include "teststubs.h"
+
+using namespace reSID;
+
+#define CLOCK_FREQ      985248.0
+#define SAMPLE_FREQ     44100.0
+
+/* one PAL frame worth of cycles between the register write bursts */
+#define FRAME_CYCLES    19656
+
+static const struct {
+    convolve_method method;
+    const char *name;
+} convolve_methods[] = {
+    { CONVOLVE_SCALAR, "scalar" },
+    { CONVOLVE_SSE2, "sse2" },
+    { CONVOLVE_AVX2, "avx2" },
+    { CONVOLVE_NEON, "neon" }
+};
+
+#define NUM_CONVOLVE_METHODS (int)(sizeof(convolve_methods) / sizeof(convolve_methods[0]))
+
+static const struct {
+    sampling_method method;
+    const char *name;
+} sampling_methods[] = {
+    { SAMPLE_FAST, "fast" },
+    { SAMPLE_INTERPOLATE, "interpolate" },
+    { SAMPLE_RESAMPLE, "resample" },
+    { SAMPLE_RESAMPLE_FASTMEM, "resample fastmem" }
+};
+
+#define NUM_SAMPLING_METHODS (int)(sizeof(sampling_methods) / sizeof(sampling_methods[0]))
+
+/* Something like a tune: each frame changes a few voice and filter
+   registers, with the filter and all waveforms (including the combined
+   ones and noise) in use, so the FIR input covers the full range.  */
+static void write_frame(SID *sid)
+{
+    int i;
+    int writes = 1 + (int)(test_rand() % 8);
+
+    for (i = 0; i < writes; i++) {
+        uint32_t r = test_rand();
+        int voice = (int)((r >> 8) % 3) * 7;
+
+        switch (r % 6) {
+            case 0:
+                sid->write((reg8)(voice + 0), (reg8)(r >> 16));
+                sid->write((reg8)(voice + 1), (reg8)(r >> 24));
+                break;
+            case 1:
+                sid->write((reg8)(voice + 2), (reg8)(r >> 16));
+                sid->write((reg8)(voice + 3), (reg8)((r >> 24) & 0x0f));
+                break;
+            case 2:
+                /* waveform and gate, test and sync/ring now and then */
+                sid->write((reg8)(voice + 4), (reg8)((r >> 16) & 0xf7));
+                break;
+            case 3:
+                sid->write((reg8)(voice + 5), (reg8)(r >> 16));
+                sid->write((reg8)(voice + 6), (reg8)(r >> 24));
+                break;
+            case 4:
+                sid->write(0x15, (reg8)((r >> 16) & 0x07));
+                sid->write(0x16, (reg8)(r >> 24));
+                sid->write(0x17, (reg8)(r >> 12));
+                break;
+            default:
+                sid->write(0x18, (reg8)((r >> 16) | 0x0f));
+                break;
+        }
+    }
+}
+
+/* Play `frames' frames of the tune into `buf', which must hold the samples
+   of the whole run.  Returns the number of samples.  */
+static int play(chip_model model, sampling_method method, int frames,
+                short *buf, int bufsize)
+{
+    SID *sid;
+    int n = 0;
+    int frame;
+
+    /* the new 8580 filter dithers its inputs with rand() */
+    srand(1);
+    sid = new SID();
+    /* set up like sid/resid.cc with the default resources, the filter
+       is not complete until the bias has been set */
+    sid->set_chip_model(model);
+    sid->enable_filter(true);
+    sid->adjust_filter_bias(model == MOS8580 ? 0.0 : 0.5);
+    if (!sid->set_sampling_parameters(CLOCK_FREQ, method, SAMPLE_FREQ,
+                                      SAMPLE_FREQ * 90 / 200.0, 0.97)) {
+        fprintf(stderr, "residbench: cannot set the sampling parameters\n");
+        exit(1);
+    }
+    sid->reset();
+
+    test_rand_seed(0x6581);
+    for (frame = 0; frame < frames; frame++) {
+        cycle_count delta_t = FRAME_CYCLES;
+
+        write_frame(sid);
+        while (delta_t > 0) {
+            n += sid->clock(delta_t, buf + n, bufsize - n);
+            if (n >= bufsize) {
+                fprintf(stderr, "residbench: sample buffer overflow\n");
+                exit(1);
+            }
+        }
+    }
+
+    delete sid;
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds;
+    int frames, bufsize;
+    short *ref, *buf;
+    int model, sm, cm;
+
+    test_init("residbench", "[seconds]");
+    seconds = test_arg_double(argc, argv, 1, 10.0);
+
+    frames = (int)(seconds * CLOCK_FREQ / FRAME_CYCLES) + 1;
+    bufsize = (int)(frames * (FRAME_CYCLES * SAMPLE_FREQ / CLOCK_FREQ + 2.0));
+    ref = new short[bufsize];
+    buf = new short[bufsize];
+
+    /* the resampling methods must not depend on the convolution version */
+    for (model = 0; model < 2; model++) {
+        chip_model chip = model ? MOS8580 : MOS6581;
+
+        for (sm = 0; sm < NUM_SAMPLING_METHODS; sm++) {
+            sampling_method method = sampling_methods[sm].method;
+            int ref_n;
+
+            if (method != SAMPLE_RESAMPLE && method != SAMPLE_RESAMPLE_FASTMEM) {
+                continue;
+            }
+
+            set_convolve_method(CONVOLVE_SCALAR);
+            ref_n = play(chip, method, frames, ref, bufsize);
+
+            for (cm = 1; cm < NUM_CONVOLVE_METHODS; cm++) {
+                int n, i;
+
+                if (!set_convolve_method(convolve_methods[cm].method)) {
+                    continue;
+                }
+                n = play(chip, method, frames, buf, bufsize);
+                for (i = 0; i < n && i < ref_n; i++) {
+                    if (buf[i] != ref[i]) {
+                        break;
+                    }
+                }
+                if (n != ref_n || i < n) {
+                    test_fail("%s, %s, %s: sample %d is %d, scalar gives %d",
+                              model ? "8580" : "6581", sampling_methods[sm].name,
+                              convolve_methods[cm].name, i,
+                              i < n ? buf[i] : 0, i < ref_n ? ref[i] : 0);
+                } else {
+                    test_print("%s, %s, %s: %d samples match scalar",
+                               model ? "8580" : "6581", sampling_methods[sm].name,
+                               convolve_methods[cm].name, n);
+                }
+            }
+        }
+    }
+
+    /* speed, 6581 only: the filter is the same work for both models */
+    for (sm = 0; sm < NUM_SAMPLING_METHODS; sm++) {
+        sampling_method method = sampling_methods[sm].method;
+        int resampling = method == SAMPLE_RESAMPLE || method == SAMPLE_RESAMPLE_FASTMEM;
+
+        for (cm = 0; cm < NUM_CONVOLVE_METHODS; cm++) {
+            double start, elapsed;
+            int n;
+
+            if (!resampling && cm > 0) {
+                break;
+            }
+            if (!set_convolve_method(convolve_methods[cm].method)) {
+                continue;
+            }
+            start = test_time();
+            n = play(MOS6581, method, frames, buf, bufsize);
+            elapsed = test_time() - start;
+            test_print("%-16s %-7s %6.2f M samples/s, %6.1fx real time",
+                       sampling_methods[sm].name,
+                       resampling ? convolve_methods[cm].name : "",
+                       n / elapsed / 1e6, seconds / elapsed);
+        }
+    }
+
+    set_convolve_method(CONVOLVE_AUTO);
+    delete[] ref;
+    delete[] buf;
+    return test_failed();
+}
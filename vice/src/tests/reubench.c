@@ -0,0 +1,718 @@
+/*
+ * reubench.c - Check and time the REU block transfers.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Usage: reubench [cases]
+
+   Runs pseudo random REU transfers of all four types with all four address
+   step modes twice from the same start, once through the per-byte loops of
+   c64/cart/reu.c and once with the block transfers x64 registers.  The
+   host is a model of the C64 memory as DMA sees it: RAM, with ROM at
+   $a000-$bfff and $e000-$ffff (writes go to the RAM below) and I/O at
+   $d000-$dfff.  The VIC-II is modelled by alarms, from every cycle to
+   every 63 cycles, which steal cycles now and then and look at the memory
+   around the transfer position, like the fetches do.
+
+   Both runs must end with the same host and REU memory, REU registers,
+   floating bus value and clock, must serve the same alarms at the same
+   clocks with the same memory contents, and must make the same I/O
+   accesses.  `cases' is the number of transfers per REU size (default
+   1000).  Then prints how many bytes per second each transfer type moves
+   both ways, with alarms about as often as on a C64.  The program exits
+   with status 1 on the first difference.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib.h"
+#include "types.h"
+
+#include "teststubs.h"
+
+/* the test needs the transfer loops and the REU state, which are static,
+   so reu.c is built into it */
+#include "../c64/cart/reu.c"
+
+/* ------------------------------------------------------------------------- */
+
+/* Host memory model.  */
+
+enum {
+    PAGE_RAM,
+    PAGE_ROM,
+    PAGE_IO
+};
+
+static uint8_t host_ram[0x10000];
+static uint8_t host_rom[0x10000];
+
+static int page_kind(uint16_t addr)
+{
+    unsigned int page = addr >> 8;
+
+    if (page >= 0xd0 && page <= 0xdf) {
+        return PAGE_IO;
+    }
+    if ((page >= 0xa0 && page <= 0xbf) || page >= 0xe0) {
+        return PAGE_ROM;
+    }
+    return PAGE_RAM;
+}
+
+/* The same pages as mem_reu_dma_ram() in c64mem.c lets through.  */
+static uint8_t *test_dma_ram(uint16_t addr, int write)
+{
+    unsigned int page = addr >> 8;
+
+    if (page == 0x00 || page == 0xff) {
+        return NULL;
+    }
+    switch (page_kind(addr)) {
+        case PAGE_IO:
+            return NULL;
+        case PAGE_ROM:
+            return write ? host_ram : NULL;
+        default:
+            return host_ram;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* What the two runs did, in order.  */
+
+enum {
+    EV_ALARM,
+    EV_IO_READ,
+    EV_IO_WRITE
+};
+
+typedef struct event_s {
+    int type;
+    CLOCK clk;
+    uint32_t addr;
+    uint32_t value;
+} event_t;
+
+static event_t *events[2];
+static int num_events[2];
+static int max_events[2];
+static int run;
+
+/* no log while timing, the hashing would take longer than the transfer */
+static int timing;
+
+static void add_event(int type, uint32_t addr, uint32_t value)
+{
+    event_t *ev;
+
+    if (num_events[run] == max_events[run]) {
+        max_events[run] = max_events[run] ? max_events[run] * 2 : 4096;
+        events[run] = lib_realloc(events[run], max_events[run] * sizeof(event_t));
+    }
+    ev = &events[run][num_events[run]++];
+    ev->type = type;
+    ev->clk = maincpu_clk;
+    ev->addr = addr;
+    ev->value = value;
+}
+
+uint8_t mem_dma_read(uint16_t addr)
+{
+    uint8_t value;
+
+    switch (page_kind(addr)) {
+        case PAGE_IO:
+            value = (uint8_t)(addr ^ maincpu_clk ^ (maincpu_clk >> 8));
+            if (!timing) {
+                add_event(EV_IO_READ, addr, value);
+            }
+            return value;
+        case PAGE_ROM:
+            return host_rom[addr];
+        default:
+            return host_ram[addr];
+    }
+}
+
+void mem_dma_store(uint16_t addr, uint8_t value)
+{
+    if (page_kind(addr) == PAGE_IO) {
+        if (!timing) {
+            add_event(EV_IO_WRITE, addr, value);
+        }
+    } else {
+        host_ram[addr] = value;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* VIC-II model: alarms `gap_min' to `gap_max' cycles apart, one in eight
+   steals up to 40 cycles like a bad line.  */
+
+static CLOCK next_alarm_clk;
+static uint32_t alarm_seed;
+static int gap_min, gap_max;
+
+/* where the transfer started, for the position the alarms look at */
+static uint16_t xfer_host;
+static unsigned int xfer_reu;
+static int xfer_host_step, xfer_reu_step, xfer_cycles;
+static CLOCK xfer_clk;
+
+static uint32_t alarm_rand(void)
+{
+    alarm_seed ^= alarm_seed << 13;
+    alarm_seed ^= alarm_seed >> 17;
+    alarm_seed ^= alarm_seed << 5;
+    return alarm_seed;
+}
+
+/* Hash of the memory around the byte the transfer should be at by now.  */
+static uint32_t alarm_probe(void)
+{
+    int pos = (int)((maincpu_clk - xfer_clk) / (CLOCK)xfer_cycles);
+    uint32_t hash = 2166136261U;
+    int i;
+
+    for (i = pos - 32; i < pos + 32; i++) {
+        hash = (hash ^ host_ram[(xfer_host + i * xfer_host_step) & 0xffff]) * 16777619U;
+        hash = (hash ^ reu_ram[(xfer_reu + (unsigned int)(i * xfer_reu_step)) % reu_size]) * 16777619U;
+    }
+    return hash;
+}
+
+void machine_handle_pending_alarms(CLOCK num_write_cycles)
+{
+    uint32_t r;
+
+    while (maincpu_clk >= next_alarm_clk) {
+        r = alarm_rand();
+        if (!timing) {
+            add_event(EV_ALARM, 0, alarm_probe());
+        }
+        if (r % 8 == 0) {
+            maincpu_clk += 1 + (r >> 8) % 40;
+        }
+        /* from the end of the stolen cycles, so the loop ends */
+        next_alarm_clk = maincpu_clk
+                         + (CLOCK)(gap_min + (int)((r >> 16) % (uint32_t)(gap_max - gap_min + 1)));
+    }
+}
+
+static CLOCK test_next_alarm(void)
+{
+    return next_alarm_clk;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The rest of the emulator, as far as reu.c uses it and teststubs.c does
+   not have it.  */
+
+CLOCK maincpu_clk = 0;
+interrupt_cpu_status_t *maincpu_int_status = NULL;
+
+void interrupt_fixup_int_clk(interrupt_cpu_status_t *cs, CLOCK cpu_clk, CLOCK *int_clk)
+{
+}
+
+void interrupt_log_wrong_nirq(void)
+{
+}
+
+void interrupt_restore_irq(interrupt_cpu_status_t *cs, int int_num, int value)
+{
+}
+
+unsigned int interrupt_cpu_status_int_new(interrupt_cpu_status_t *cs, const char *name)
+{
+    return 0;
+}
+
+void ram_init_with_pattern(uint8_t *memram, unsigned int ramsize, RAMINITPARAM *ramparam)
+{
+    unsigned int i;
+
+    for (i = 0; i < ramsize; i++) {
+        memram[i] = (uint8_t)test_rand();
+    }
+}
+
+int export_add(const export_resource_t *export_res)
+{
+    return 0;
+}
+
+int export_remove(const export_resource_t *export_res)
+{
+    return 0;
+}
+
+io_source_list_t *io_source_register(io_source_t *device)
+{
+    return NULL;
+}
+
+void io_source_unregister(io_source_list_t *device)
+{
+}
+
+int resources_register_string(const resource_string_t *r)
+{
+    return 0;
+}
+
+int util_check_null_string(const char *string)
+{
+    return string == NULL || *string == '\0';
+}
+
+int util_check_filename_access(const char *filename)
+{
+    return -1;
+}
+
+int util_file_exists(const char *name)
+{
+    return 0;
+}
+
+int util_file_load(const char *name, uint8_t *dest, size_t size, unsigned int load_flag)
+{
+    return -1;
+}
+
+int util_file_save(const char *name, uint8_t *src, int size)
+{
+    return -1;
+}
+
+int util_string_set(char **str, const char *new_value)
+{
+    return 0;
+}
+
+snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8_t major_version, uint8_t minor_version)
+{
+    return NULL;
+}
+
+snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t *major_version_return, uint8_t *minor_version_return)
+{
+    return NULL;
+}
+
+int snapshot_module_close(snapshot_module_t *m)
+{
+    return -1;
+}
+
+int snapshot_module_write_dword(snapshot_module_t *m, uint32_t data)
+{
+    return -1;
+}
+
+int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *data, unsigned int num)
+{
+    return -1;
+}
+
+int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
+{
+    return -1;
+}
+
+void snapshot_set_error(int error)
+{
+}
+
+int snapshot_version_is_bigger(uint8_t major_version, uint8_t minor_version, uint8_t major_version_required, uint8_t minor_version_required)
+{
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Everything a transfer may change.  */
+typedef struct state_s {
+    uint8_t host[0x10000];
+    uint8_t *reu;
+    struct rec_s rec;
+    int floating_bus_value;
+    CLOCK clk;
+    CLOCK next_alarm_clk;
+    uint32_t alarm_seed;
+} state_t;
+
+static state_t start, result[2];
+
+static void state_save(state_t *s)
+{
+    memcpy(s->host, host_ram, sizeof(host_ram));
+    s->reu = lib_realloc(s->reu, reu_size);
+    memcpy(s->reu, reu_ram, reu_size);
+    memcpy(&s->rec, &rec, sizeof(rec));
+    s->floating_bus_value = floating_bus_value;
+    s->clk = maincpu_clk;
+    s->next_alarm_clk = next_alarm_clk;
+    s->alarm_seed = alarm_seed;
+}
+
+static void state_restore(const state_t *s)
+{
+    memcpy(host_ram, s->host, sizeof(host_ram));
+    memcpy(reu_ram, s->reu, reu_size);
+    memcpy(&rec, &s->rec, sizeof(rec));
+    floating_bus_value = s->floating_bus_value;
+    maincpu_clk = s->clk;
+    next_alarm_clk = s->next_alarm_clk;
+    alarm_seed = s->alarm_seed;
+}
+
+static const char *type_names[] = { "to REU", "from REU", "swap", "verify" };
+static const char *step_names[] = { "", ", REU fixed", ", host fixed", ", both fixed" };
+
+/* Describes the first difference between the per-byte and the block run,
+   NULL if there is none.  */
+static const char *state_compare(unsigned int *where)
+{
+    const state_t *a = &result[0], *b = &result[1];
+    unsigned int i;
+    int e;
+
+    for (i = 0; i < 0x10000; i++) {
+        if (a->host[i] != b->host[i]) {
+            *where = i;
+            return "host memory";
+        }
+    }
+    for (i = 0; i < reu_size; i++) {
+        if (a->reu[i] != b->reu[i]) {
+            *where = i;
+            return "REU memory";
+        }
+    }
+    *where = 0;
+    if (a->rec.status != b->rec.status
+        || a->rec.command != b->rec.command
+        || a->rec.base_computer != b->rec.base_computer
+        || a->rec.base_reu != b->rec.base_reu
+        || a->rec.bank_reu != b->rec.bank_reu
+        || a->rec.transfer_length != b->rec.transfer_length
+        || a->rec.int_mask_reg != b->rec.int_mask_reg
+        || a->rec.address_control_reg != b->rec.address_control_reg) {
+        return "registers";
+    }
+    if (a->floating_bus_value != b->floating_bus_value) {
+        return "floating bus value";
+    }
+    if (a->clk != b->clk) {
+        return "clock";
+    }
+    if (a->next_alarm_clk != b->next_alarm_clk || a->alarm_seed != b->alarm_seed) {
+        return "number of alarms";
+    }
+    for (e = 0; e < num_events[0] && e < num_events[1]; e++) {
+        if (events[0][e].type != events[1][e].type
+            || events[0][e].clk != events[1][e].clk
+            || events[0][e].addr != events[1][e].addr
+            || events[0][e].value != events[1][e].value) {
+            *where = (unsigned int)e;
+            return events[0][e].type == EV_ALARM ? "alarm" : "I/O access";
+        }
+    }
+    if (num_events[0] != num_events[1]) {
+        *where = (unsigned int)e;
+        return "number of alarms and I/O accesses";
+    }
+    return NULL;
+}
+
+/* Run the transfer set up in `start' with the per-byte loops or the block
+   transfers, into `result'.  */
+static void run_transfer(int block, uint8_t command)
+{
+    run = block;
+    num_events[run] = 0;
+    state_restore(&start);
+    xfer_clk = maincpu_clk;
+    if (block) {
+        reu_dma_fast_register(test_next_alarm, test_dma_ram);
+    } else {
+        reu_dma_fast_register(NULL, NULL);
+    }
+    reu_io2_store(REU_REG_RW_COMMAND, command);
+    state_save(&result[block]);
+}
+
+static int pick(const int *list, int num)
+{
+    return list[test_rand() % (uint32_t)num];
+}
+
+#define NUM(list) (int)(sizeof(list) / sizeof(list[0]))
+
+/* host start addresses next to the page kinds, page $00 and $ff, and the
+   wrap around at $ffff */
+static const int host_addrs[] = {
+    0x0000, 0x00f8, 0x0400, 0x07ff, 0x1000, 0x9ff0, 0xbff8, 0xcff0, 0xdff8,
+    0xfef0, 0xfff8, -1
+};
+
+static const int lengths[] = {
+    1, 2, 3, 7, 63, 64, 255, 256, 257, 1000, -1, -1, 0
+};
+
+/* from an alarm every cycle to about a raster line */
+static const int gaps[][2] = {
+    { 1, 1 }, { 1, 3 }, { 2, 8 }, { 5, 20 }, { 20, 63 }, { 1000000, 1000000 }
+};
+
+static int check_size(int size_kb, int cases)
+{
+    unsigned int reu_limit, i;
+    int c;
+
+    set_reu_size(size_kb, NULL);
+    reu_limit = rec_options.not_backedup_addresses < rec_options.wrap_around
+                ? rec_options.not_backedup_addresses : rec_options.wrap_around;
+
+    for (c = 0; c < cases; c++) {
+        int type = c % 4;
+        int steps = (c / 4) % 4;
+        int host_step = steps & 2 ? 0 : 1;
+        int reu_step = steps & 1 ? 0 : 1;
+        int host_addr = pick(host_addrs, NUM(host_addrs));
+        int len = pick(lengths, NUM(lengths));
+        int gap = (int)(test_rand() % (uint32_t)NUM(gaps));
+        unsigned int reu_addr, bank;
+        uint8_t command;
+        const char *diff;
+        unsigned int where;
+
+        if (host_addr < 0) {
+            host_addr = (int)(test_rand() & 0xffff);
+        }
+        if (len < 0) {
+            len = 1 + (int)(test_rand() % 4096);
+        } else if (len == 0 && test_rand() % 4 != 0) {
+            len = 1 + (int)(test_rand() % 300);
+        }
+
+        /* at the start, at the end of the DRAM or at the wrap around,
+           anywhere, or in a bank with the upper bits set */
+        switch (test_rand() % 5) {
+            case 0:
+                reu_addr = 0;
+                break;
+            case 1:
+                reu_addr = reu_limit - 1 - test_rand() % 16;
+                break;
+            case 2:
+                reu_addr = rec_options.wrap_around - 1 - test_rand() % 16;
+                break;
+            case 3:
+                reu_addr = test_rand() % rec_options.dram_wrap_around;
+                break;
+            default:
+                reu_addr = test_rand() & 0xffffff;
+                break;
+        }
+        bank = (reu_addr >> 16) & 0xff;
+
+        /* dense alarms only for short transfers, the log gets long */
+        if ((len == 0 || len > 4096) && gaps[gap][1] < 20) {
+            gap = 4;
+        }
+        gap_min = gaps[gap][0];
+        gap_max = gaps[gap][1];
+
+        reu_reset();
+        for (i = 0; i < 0x10000; i++) {
+            host_ram[i] = (uint8_t)test_rand();
+        }
+        ram_init_with_pattern(reu_ram, reu_size, NULL);
+
+        /* for verify, most of the bytes compare equal */
+        if (type == 3) {
+            int n = len ? len : 0x10000;
+            int mismatch = (int)(test_rand() % 6);
+            uint16_t h = (uint16_t)host_addr;
+            unsigned int r = reu_addr;
+
+            for (i = 0; i < (unsigned int)n; i++) {
+                uint8_t value = page_kind(h) == PAGE_ROM ? host_rom[h] : host_ram[h];
+
+                if ((mismatch == 1 && i == 0)
+                    || (mismatch == 2 && i == (unsigned int)n / 2)
+                    || (mismatch == 3 && i + 2 == (unsigned int)n)
+                    || (mismatch == 4 && i + 1 == (unsigned int)n)) {
+                    value ^= 0x5a;
+                }
+                store_to_reu(r, value);
+                h = (uint16_t)(h + host_step);
+                r = increment_reu_with_wrap_around(r, (unsigned int)reu_step);
+            }
+        }
+
+        maincpu_clk = 1000000 + test_rand() % 1000000;
+        next_alarm_clk = maincpu_clk + test_rand() % (uint32_t)(gap_max + 1);
+        alarm_seed = test_rand() | 1;
+
+        reu_io2_store(REU_REG_RW_BASEADDR_LOW, (uint8_t)host_addr);
+        reu_io2_store(REU_REG_RW_BASEADDR_HIGH, (uint8_t)(host_addr >> 8));
+        reu_io2_store(REU_REG_RW_RAMADDR_LOW, (uint8_t)reu_addr);
+        reu_io2_store(REU_REG_RW_RAMADDR_HIGH, (uint8_t)(reu_addr >> 8));
+        reu_io2_store(REU_REG_RW_BANK, (uint8_t)bank);
+        reu_io2_store(REU_REG_RW_BLOCKLEN_LOW, (uint8_t)len);
+        reu_io2_store(REU_REG_RW_BLOCKLEN_HIGH, (uint8_t)(len >> 8));
+        reu_io2_store(REU_REG_RW_INTERRUPT, (uint8_t)test_rand());
+        reu_io2_store(REU_REG_RW_ADDR_CONTROL,
+                      (uint8_t)((host_step ? 0 : REU_REG_RW_ADDR_CONTROL_FIX_C64)
+                                | (reu_step ? 0 : REU_REG_RW_ADDR_CONTROL_FIX_REC)));
+        command = (uint8_t)(REU_REG_RW_COMMAND_EXECUTE
+                            | REU_REG_RW_COMMAND_FF00_TRIGGER_DISABLED
+                            | (test_rand() & 1 ? REU_REG_RW_COMMAND_AUTOLOAD : 0)
+                            | type);
+
+        /* as the registers hold them */
+        xfer_host = rec.base_computer;
+        xfer_reu = rec.base_reu | ((unsigned int)rec.bank_reu << 16);
+        xfer_host_step = host_step;
+        xfer_reu_step = reu_step;
+        xfer_cycles = type == 2 ? 2 : 1;
+        state_save(&start);
+
+        run_transfer(0, command);
+        run_transfer(1, command);
+
+        diff = state_compare(&where);
+        if (diff != NULL) {
+            return test_fail("%uk, case %d, %s%s, host $%04x, REU $%06x, length %d, alarms %d-%d: %s differs at %u",
+                             (unsigned int)size_kb, c, type_names[type], step_names[steps],
+                             (unsigned int)host_addr, xfer_reu, len ? len : 0x10000,
+                             gap_min, gap_max, diff, where);
+        }
+    }
+
+    test_print("%uk, %d transfers match the per-byte loops",
+               (unsigned int)size_kb, cases);
+    return 0;
+}
+
+/* 32k from $0800 on, all RAM, with alarms about as often as the VIC-II
+   fetch and draw alarms come on a C64.  */
+static void time_transfers(void)
+{
+    int type, block, i;
+    double start_time, seconds[2];
+    const int len = 0x8000;
+    const int repeats = 200;
+
+    set_reu_size(512, NULL);
+    timing = 1;
+    gap_min = 20;
+    gap_max = 43;
+
+    for (type = 0; type < 4; type++) {
+        for (block = 0; block < 2; block++) {
+            reu_reset();
+            memset(host_ram, 0x55, sizeof(host_ram));
+            memset(reu_ram, 0x55, reu_size);
+            maincpu_clk = 1000000;
+            next_alarm_clk = maincpu_clk + 20;
+            alarm_seed = 0x6569;
+            reu_dma_fast_register(block ? test_next_alarm : NULL, block ? test_dma_ram : NULL);
+
+            start_time = test_time();
+            for (i = 0; i < repeats; i++) {
+                reu_io2_store(REU_REG_RW_BASEADDR_LOW, 0x00);
+                reu_io2_store(REU_REG_RW_BASEADDR_HIGH, 0x08);
+                reu_io2_store(REU_REG_RW_RAMADDR_LOW, 0);
+                reu_io2_store(REU_REG_RW_RAMADDR_HIGH, 0);
+                reu_io2_store(REU_REG_RW_BANK, 0);
+                reu_io2_store(REU_REG_RW_BLOCKLEN_LOW, (uint8_t)len);
+                reu_io2_store(REU_REG_RW_BLOCKLEN_HIGH, (uint8_t)(len >> 8));
+                reu_io2_store(REU_REG_RW_COMMAND,
+                              (uint8_t)(REU_REG_RW_COMMAND_EXECUTE
+                                        | REU_REG_RW_COMMAND_FF00_TRIGGER_DISABLED
+                                        | type));
+            }
+            seconds[block] = test_time() - start_time;
+        }
+        test_print("%-8s per byte %7.1f MB/s, block %7.1f MB/s, %5.1fx",
+                   type_names[type],
+                   (double)len * repeats / seconds[0] / 1e6,
+                   (double)len * repeats / seconds[1] / 1e6,
+                   seconds[0] / seconds[1]);
+    }
+    timing = 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[] = { 128, 256, 512, 1024 };
+    int cases;
+    int s, failed = 0;
+    unsigned int i;
+
+    test_init("reubench", "[cases]");
+    cases = test_arg_int(argc, argv, 1, 1000);
+
+    test_rand_seed(0x1764);
+    for (i = 0; i < 0x10000; i++) {
+        host_rom[i] = (uint8_t)test_rand();
+    }
+
+    /* x64, no BA handling */
+    set_reu_size(128, NULL);
+    set_reu_enabled(1, NULL);
+
+    for (s = 0; s < NUM(sizes) && !failed; s++) {
+        failed = check_size(sizes[s], cases);
+    }
+
+    if (!failed) {
+        time_transfers();
+    }
+
+    set_reu_enabled(0, NULL);
+    lib_free(start.reu);
+    lib_free(result[0].reu);
+    lib_free(result[1].reu);
+    lib_free(events[0]);
+    lib_free(events[1]);
+    return test_failed();
+}
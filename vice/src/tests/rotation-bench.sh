@@ -0,0 +1,151 @@
+#!/bin/sh
+#
+# rotation-bench.sh - Check and time DriveFastRotation with a G64 load.
+#
+# Usage: rotation-bench.sh [directory [cycles [pages]]]
+#
+# Writes a program of `pages' pages (default 120) of pseudo random data
+# plus a checker to a new G64 image with the c1541 found in `directory'
+# (default: the current directory, `src' of a build configured with
+# --enable-headlessui).  Then each headless C64 emulator found there loads
+# and runs it with true drive emulation in batch mode, once with the disk
+# rotation simulated bit by bit and once with `-drivefastrotation'.  The
+# checker sums the loaded data and exits through the debug cartridge, with
+# code 0 when the data is right.  A job that does not get there within
+# `cycles' main CPU cycles (default 300000000) fails.
+#
+# Prints the time of both loads and the speed-up for each machine, or
+# `failed' when one of them loaded wrong data or did not finish.  Exits
+# with status 1 if any job failed.
+#
+# This file is part of VICE, the Versatile Commodore Emulator.
+# See README for copyright notice.
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+#  02111-1307  USA.
+#
+
+# machines with the debug cartridge at $d7ff and BASIC at $0801
+EMULATORS="x64 x64sc"
+
+dir=${1:-.}
+cycles=${2:-300000000}
+pages=${3:-120}
+
+# the data must end below the BASIC ROM
+if [ "$pages" -lt 1 ] || [ "$pages" -gt 150 ]; then
+    echo "pages must be 1..150" >&2
+    exit 1
+fi
+
+if [ ! -x "$dir/c1541" ]; then
+    echo "no c1541 found in $dir" >&2
+    exit 1
+fi
+
+tmp=${TMPDIR:-/tmp}/rotation-bench.$$
+mkdir "$tmp" || exit 1
+trap 'rm -rf "$tmp"' 0
+
+# The program: "10 SYS2061", then a Fletcher sum over the data from $0900
+# on, compared with the sums of the data as written.  The result goes to
+# the debug cartridge.
+awk -v pages="$pages" '
+    function byte(b) {
+        out = out sprintf("\\%03o", b)
+        if (length(out) >= 256) {
+            print out
+            out = ""
+        }
+    }
+    BEGIN {
+        seed = 6502
+        for (i = 0; i < pages * 256; i++) {
+            seed = (seed * 1103515245 + 12345) % 2147483648
+            data[i] = int(seed / 65536) % 256
+            s1 = (s1 + data[i]) % 256
+            s2 = (s2 + s1) % 256
+        }
+        n = split("1 8 11 8 10 0 158 50 48 54 49 0 0 0 " \
+                  "169 0 133 251 169 9 133 252 162 " pages " 160 0 " \
+                  "169 0 133 253 133 254 " \
+                  "177 251 24 101 253 133 253 24 101 254 133 254 " \
+                  "200 208 241 230 252 202 208 236 " \
+                  "165 253 201 " s1 " 208 14 165 254 201 " s2 " 208 8 " \
+                  "169 0 141 255 215 76 76 8 " \
+                  "169 1 141 255 215 76 76 8", code, " ")
+        for (i = 1; i <= n; i++) {
+            byte(code[i])
+        }
+        # up to $0900, then the data
+        for (i = n - 1; i < 256; i++) {
+            byte(0)
+        }
+        for (i = 0; i < pages * 256; i++) {
+            byte(data[i])
+        }
+        print out
+    }' | while read -r line; do
+    printf "$line"
+done > "$tmp/rotation.prg"
+
+if ! "$dir/c1541" -format "rotation,rb" g64 "$tmp/rotation.g64" \
+        -write "$tmp/rotation.prg" rotation >/dev/null 2>&1; then
+    echo "cannot create the G64 image with $dir/c1541" >&2
+    exit 1
+fi
+
+jobs=$tmp/jobs
+cat > "$jobs" <<EOF
++drivefastrotation -drive8truedrive -debugcart -limitcycles $cycles -autostart $tmp/rotation.g64
+-drivefastrotation -drive8truedrive -debugcart -limitcycles $cycles -autostart $tmp/rotation.g64
+EOF
+
+found=no
+status=0
+for emu in $EMULATORS; do
+    if [ ! -x "$dir/$emu" ]; then
+        continue
+    fi
+    found=yes
+    "$dir/$emu" -warp +sound -batch "$jobs" -batchworkers 1 2>/dev/null \
+    | awk -v emu="$emu" '
+        $1 == "batch:" && $2 == "job" {
+            if ($4 != "exit" || $5 != "0") {
+                failed = 1
+            }
+            ms = $6 + 0
+            if (index($0, "+drivefastrotation")) {
+                exact = ms
+            } else {
+                fast = ms
+            }
+        }
+        END {
+            if (failed || exact == 0 || fast == 0) {
+                printf "%-8s failed\n", emu
+                exit 1
+            }
+            printf "%-8s exact %7d ms, fast rotation %7d ms, speed-up %.2fx\n",
+                   emu, exact, fast, exact / fast
+        }' || status=1
+done
+
+if [ "$found" = no ]; then
+    echo "no headless emulators found in $dir" >&2
+    exit 1
+fi
+
+exit $status
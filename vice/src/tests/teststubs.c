@@ -0,0 +1,379 @@
+/*
+ * teststubs.c - Common harness and stand-ins for the test programs.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The test programs link the code under test directly, without the rest of
+   the emulator.  These replace lib.c and log.c, which pull in resources,
+   the monitor and the archdep layer, and the few other functions more than
+   one unit under test needs.
+
+   The harness below takes care of what every program does: the optional
+   number on the command line, the messages prefixed with the program name,
+   and the exit status, 1 once a check has failed.  */
+
+#include "vice.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WINDOWS_COMPILE
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* keep lib.h from redirecting the lib_xxx functions to the pinpoint ones */
+#define COMPILING_LIB_DOT_C
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "resources.h"
+
+#include "teststubs.h"
+
+
+void *lib_malloc(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+
+    if (p == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+void *lib_calloc(size_t nmemb, size_t size)
+{
+    void *p = calloc(nmemb ? nmemb : 1, size ? size : 1);
+
+    if (p == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+void *lib_realloc(void *p, size_t size)
+{
+    p = realloc(p, size ? size : 1);
+    if (p == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+void lib_free(void *ptr)
+{
+    free(ptr);
+}
+
+char *lib_strdup(const char *str)
+{
+    char *p = lib_malloc(strlen(str) + 1);
+
+    strcpy(p, str);
+    return p;
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void *lib_malloc_pinpoint(size_t size, const char *name, unsigned int line)
+{
+    return lib_malloc(size);
+}
+
+void *lib_calloc_pinpoint(size_t nmemb, size_t size, const char *name, unsigned int line)
+{
+    return lib_calloc(nmemb, size);
+}
+
+void *lib_realloc_pinpoint(void *p, size_t size, const char *name, unsigned int line)
+{
+    return lib_realloc(p, size);
+}
+
+void lib_free_pinpoint(void *p, const char *name, unsigned int line)
+{
+    lib_free(p);
+}
+
+char *lib_strdup_pinpoint(const char *str, const char *name, unsigned int line)
+{
+    return lib_strdup(str);
+}
+#endif
+
+char *lib_mvsprintf(const char *fmt, va_list args)
+{
+    va_list args2;
+    char *p;
+    int len;
+
+    va_copy(args2, args);
+    len = vsnprintf(NULL, 0, fmt, args2);
+    va_end(args2);
+
+    p = lib_malloc((size_t)len + 1);
+    vsnprintf(p, (size_t)len + 1, fmt, args);
+    return p;
+}
+
+char *lib_msprintf(const char *fmt, ...)
+{
+    va_list args;
+    char *p;
+
+    va_start(args, fmt);
+    p = lib_mvsprintf(fmt, args);
+    va_end(args);
+    return p;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Only errors are shown, the other messages would disturb the timings.  */
+static int test_log(const char *prefix, const char *format, va_list ap)
+{
+    fputs(prefix, stderr);
+    vfprintf(stderr, format, ap);
+    fputc('\n', stderr);
+    return 0;
+}
+
+log_t log_open(const char *id)
+{
+    return LOG_DEFAULT;
+}
+
+int log_close(log_t log)
+{
+    return 0;
+}
+
+int log_message(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_verbose(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_debug(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_warning(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_error(log_t log, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    test_log("error: ", format, ap);
+    va_end(ap);
+    return 0;
+}
+
+int log_fatal(log_t log, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    test_log("fatal: ", format, ap);
+    va_end(ap);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The units under test register their settings, which keep the defaults.  */
+
+int resources_register_int(const resource_int_t *r)
+{
+    return 0;
+}
+
+int cmdline_register_options(const cmdline_option_t *c)
+{
+    return 0;
+}
+
+tick_t tick_per_second(void)
+{
+    return TICK_PER_SECOND;
+}
+
+tick_t tick_now(void)
+{
+    return (tick_t)(uint64_t)(test_time() * TICK_PER_SECOND);
+}
+
+tick_t tick_now_delta(tick_t previous_tick)
+{
+    return tick_now() - previous_tick;
+}
+
+off_t archdep_file_size(FILE *stream)
+{
+    long pos, size;
+
+    pos = ftell(stream);
+    if (pos < 0 || fseek(stream, 0, SEEK_END) < 0) {
+        return -1;
+    }
+    size = ftell(stream);
+    fseek(stream, pos, SEEK_SET);
+    return (off_t)size;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *test_name = "test";
+static const char *test_usage = "";
+static int test_failures = 0;
+
+/* Set the program name for the messages and the usage of its arguments.  */
+void test_init(const char *name, const char *usage)
+{
+    test_name = name;
+    test_usage = usage;
+}
+
+static void test_usage_exit(char **argv)
+{
+    fprintf(stderr, "usage: %s %s\n", argv[0], test_usage);
+    exit(2);
+}
+
+/* Positive number argument \a index, or \a def if not given.  */
+int test_arg_int(int argc, char **argv, int index, int def)
+{
+    int val;
+
+    if (argc <= index) {
+        return def;
+    }
+    val = atoi(argv[index]);
+    if (val <= 0) {
+        test_usage_exit(argv);
+    }
+    return val;
+}
+
+double test_arg_double(int argc, char **argv, int index, double def)
+{
+    double val;
+
+    if (argc <= index) {
+        return def;
+    }
+    val = atof(argv[index]);
+    if (val <= 0.0) {
+        test_usage_exit(argv);
+    }
+    return val;
+}
+
+static void test_vprint(const char *format, va_list ap)
+{
+    printf("%s: ", test_name);
+    vprintf(format, ap);
+    putchar('\n');
+}
+
+/* Print a line of results.  */
+void test_print(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    test_vprint(format, ap);
+    va_end(ap);
+}
+
+/* Print what differs and fail the test, returns 1.  */
+int test_fail(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    test_vprint(format, ap);
+    va_end(ap);
+    test_failures++;
+    return 1;
+}
+
+/* Exit status of the program, 1 if a check failed.  */
+int test_failed(void)
+{
+    return test_failures > 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Monotonic time in seconds.  */
+double test_time(void)
+{
+#ifdef WINDOWS_COMPILE
+    LARGE_INTEGER freq, now;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/* Small deterministic generator, the runs must be repeatable.  */
+static uint32_t test_rand_state = 1;
+
+void test_rand_seed(uint32_t seed)
+{
+    test_rand_state = seed ? seed : 1;
+}
+
+uint32_t test_rand(void)
+{
+    /* xorshift32 */
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 17;
+    test_rand_state ^= test_rand_state << 5;
+    return test_rand_state;
+}
@@ -0,0 +1,59 @@
+/*
+ * teststubs.h - Common harness and stand-ins for the test programs.
+ *
+ * Written by
+ *  VICE Project
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_TESTSTUBS_H
+#define VICE_TESTSTUBS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __GNUC__
+#define TEST_ATTR_PRINTF    __attribute__((__format__(__printf__, 1, 2)))
+#else
+#define TEST_ATTR_PRINTF
+#endif
+
+void test_init(const char *name, const char *usage);
+int test_arg_int(int argc, char **argv, int index, int def);
+double test_arg_double(int argc, char **argv, int index, double def);
+
+void test_print(const char *format, ...) TEST_ATTR_PRINTF;
+int test_fail(const char *format, ...) TEST_ATTR_PRINTF;
+int test_failed(void);
+
+double test_time(void);
+
+void test_rand_seed(uint32_t seed);
+uint32_t test_rand(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# videooutput-bench.sh - Time VideoOutput=none against normal output.
+#
+# Usage: videooutput-bench.sh [directory [cycles [option...]]]
+#
+# Runs each headless emulator found in `directory' (default: the current
+# directory, `src' of a build configured with --enable-headlessui) in batch
+# mode with two jobs: one with the normal video output and one with
+# `-videooutput none'.  Both run `cycles' main CPU cycles (default
+# 20000000) in warp mode without sound, from the same initialised process,
+# so only the video output differs.  The options given after the cycles
+# are added to both jobs, for example `-autostart demo.prg' to measure a
+# busy screen instead of the idle BASIC prompt.
+#
+# Prints the time of both runs and the speed-up for each machine.
+#
+# This file is part of VICE, the Versatile Commodore Emulator.
+# See README for copyright notice.
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+#  02111-1307  USA.
+#
+
+EMULATORS="x64 x64sc x64dtv xscpu64 x128 xvic xpet xplus4 xcbm2 xcbm5x0"
+
+dir=${1:-.}
+cycles=${2:-20000000}
+if [ $# -gt 2 ]; then
+    shift 2
+    extra="$*"
+else
+    extra=""
+fi
+
+jobs=${TMPDIR:-/tmp}/videooutput-bench.$$
+trap 'rm -f "$jobs"' 0
+
+# the jobs stop with exit code 1 when the cycle limit is reached
+cat > "$jobs" <<EOF
+-videooutput normal -limitcycles $cycles $extra
+-videooutput none -limitcycles $cycles $extra
+EOF
+
+found=no
+for emu in $EMULATORS; do
+    if [ ! -x "$dir/$emu" ]; then
+        continue
+    fi
+    found=yes
+    "$dir/$emu" -warp +sound -batch "$jobs" -batchworkers 1 2>/dev/null \
+    | awk -v emu="$emu" '
+        $1 == "batch:" && $2 == "job" {
+            if ($5 != "1") {
+                failed = 1
+            }
+            ms = $6 + 0
+            if (index($0, "-videooutput none")) {
+                none = ms
+            } else {
+                normal = ms
+            }
+        }
+        END {
+            if (failed || normal == 0 || none == 0) {
+                printf "%-8s failed\n", emu
+                exit 1
+            }
+            printf "%-8s normal %7d ms, none %7d ms, speed-up %.2fx\n",
+                   emu, normal, none, normal / none
+        }'
+done
+
+if [ "$found" = no ]; then
+    echo "no headless emulators found in $dir" >&2
+    exit 1
+fi
@@ -1380,6 +1380,27 @@ int vdrive_bam_write_bam(vdrive_t *vdrive)
 
 /* ------------------------------------------------------------------------- */
 
+/* number of set bits in a byte, for counting the free blocks on NP
+   images; const so the c1541 batch workers can share it */
+static const uint8_t bitcount[256] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+    4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
+};
+
 /*
  * Return the number of free blocks on disk.
  */
@@ -1391,20 +1412,6 @@ unsigned int vdrive_bam_free_block_count(vdrive_t *vdrive)
     unsigned int s;
     unsigned int a;
     uint8_t *bamp;
-    static uint8_t bitcount[256];
-    static int bc = 0;
-
-    /* create a LUT that helps calculate the blocks from on a NP faster */
-    if (vdrive->image_format == VDRIVE_IMAGE_FORMAT_NP && !bc) {
-        for (t = 0; t < 256; t++) {
-            blocks = t;
-            for (s = 0; s < 8; s++) {
-                bitcount[t] += (blocks & 1);
-                blocks >>= 1;
-            }
-        }
-        bc++;
-    }
 
     /* load in the whole bam */
     t = vdrive_bam_read_bam(vdrive);
@@ -69,6 +69,273 @@ void vdrive_dir_init(void)
     vdrive_dir_log = log_open("VDriveDIR");
 }
 
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Directory index.
+ *
+ * Every directory access walks the chain of directory sectors, costing one
+ * image access per sector (a GCR decode on G64). With thousands of entries
+ * on D81/DNP/DHD images that adds up, so the sectors of the directories in
+ * use are kept in memory per drive. A directory is indexed the first time it
+ * is looked at, for CMD partitions that happens when they are used.
+ *
+ * vdrive_write_sector() updates the cached copies; a write changing the link
+ * of a cached sector drops the index as the chain has changed. Other writes
+ * to the image (true drive emulation) bump its generation, which drops the
+ * index the next time it is used.
+ */
+
+#define DIR_INDEX_MAX       8   /* directories kept per drive */
+
+typedef struct vdrive_dir_index_sector_s {
+    unsigned int track;
+    unsigned int sector;
+    uint8_t data[256];
+} vdrive_dir_index_sector_t;
+
+struct vdrive_dir_index_s {
+    struct disk_image_s *image;     /* image and partition of the directory */
+    unsigned int offset;
+    unsigned int track;             /* first sector of the chain */
+    unsigned int sector;
+    unsigned int generation;        /* image generation the copies match */
+    int error;                      /* chain ends with an unreadable sector */
+    unsigned int error_track;
+    unsigned int error_sector;
+    unsigned int num_sectors;
+    unsigned int size;
+    unsigned int last;              /* last sector looked up */
+    vdrive_dir_index_sector_t *sectors;
+    uint8_t map[256 * 256 / 8];     /* sectors in the chain, by track/sector */
+    struct vdrive_dir_index_s *next;
+};
+
+#define DIR_INDEX_MAP_BIT(t, s)  ((((t) & 0xff) << 8) | ((s) & 0xff))
+
+static int vdrive_dir_index_has(const vdrive_dir_index_t *index,
+                                unsigned int track, unsigned int sector)
+{
+    unsigned int bit = DIR_INDEX_MAP_BIT(track, sector);
+
+    if (track > 255 || sector > 255) {
+        return 0;
+    }
+    return (index->map[bit >> 3] >> (bit & 7)) & 1;
+}
+
+/* Returns the position of a sector known to be in the chain */
+static unsigned int vdrive_dir_index_find(vdrive_dir_index_t *index,
+                                          unsigned int track,
+                                          unsigned int sector)
+{
+    unsigned int i;
+
+    /* directories are read in order, try the next one first */
+    for (i = index->last + 1; i < index->num_sectors; i++) {
+        if (index->sectors[i].track == track && index->sectors[i].sector == sector) {
+            index->last = i;
+            return i;
+        }
+    }
+    for (i = 0; i <= index->last && i < index->num_sectors; i++) {
+        if (index->sectors[i].track == track && index->sectors[i].sector == sector) {
+            index->last = i;
+            return i;
+        }
+    }
+    return 0;
+}
+
+static void vdrive_dir_index_free(vdrive_dir_index_t *index)
+{
+    lib_free(index->sectors);
+    lib_free(index);
+}
+
+static vdrive_dir_index_t *vdrive_dir_index_build(vdrive_t *vdrive,
+                                                  unsigned int track,
+                                                  unsigned int sector)
+{
+    vdrive_dir_index_t *index = lib_calloc(1, sizeof(vdrive_dir_index_t));
+
+    index->image = vdrive->image;
+    index->offset = vdrive->current_offset;
+    index->track = track;
+    index->sector = sector;
+
+    /* stop at the end of the chain or when it loops */
+    while (track != 0 && !vdrive_dir_index_has(index, track, sector)) {
+        vdrive_dir_index_sector_t *p;
+        unsigned int bit;
+
+        if (index->num_sectors == index->size) {
+            index->size = index->size ? index->size * 2 : 16;
+            index->sectors = lib_realloc(index->sectors,
+                                         index->size * sizeof(vdrive_dir_index_sector_t));
+        }
+        p = &index->sectors[index->num_sectors];
+
+        if (vdrive_read_sector(vdrive, p->data, track, sector) != 0) {
+            index->error = 1;
+            index->error_track = track;
+            index->error_sector = sector;
+            break;
+        }
+        p->track = track;
+        p->sector = sector;
+        index->num_sectors++;
+
+        bit = DIR_INDEX_MAP_BIT(track, sector);
+        index->map[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+
+        track = p->data[0];
+        sector = p->data[1];
+    }
+
+    index->generation = vdrive->image->generation;
+    return index;
+}
+
+/* Returns the index of the directory starting at track/sector of the
+   current partition, building it if needed */
+vdrive_dir_index_t *vdrive_dir_index_get(vdrive_t *vdrive, unsigned int track,
+                                         unsigned int sector)
+{
+    vdrive_dir_index_t *index, **prev;
+    unsigned int count = 0;
+
+    if (vdrive->image == NULL) {
+        return NULL;
+    }
+
+    prev = &vdrive->dir_index;
+    while ((index = *prev) != NULL) {
+        if (index->image == vdrive->image
+            && index->generation != vdrive->image->generation) {
+            /* stale */
+            *prev = index->next;
+            vdrive_dir_index_free(index);
+            continue;
+        }
+        if (index->image == vdrive->image
+            && index->offset == vdrive->current_offset
+            && index->track == track && index->sector == sector) {
+            /* move to the front */
+            *prev = index->next;
+            index->next = vdrive->dir_index;
+            vdrive->dir_index = index;
+            return index;
+        }
+        prev = &index->next;
+    }
+
+    index = vdrive_dir_index_build(vdrive, track, sector);
+    index->next = vdrive->dir_index;
+    vdrive->dir_index = index;
+
+    /* drop the least recently used ones */
+    for (prev = &vdrive->dir_index; *prev != NULL; prev = &(*prev)->next) {
+        if (++count == DIR_INDEX_MAX) {
+            while ((index = (*prev)->next) != NULL) {
+                (*prev)->next = index->next;
+                vdrive_dir_index_free(index);
+            }
+            break;
+        }
+    }
+
+    return vdrive->dir_index;
+}
+
+unsigned int vdrive_dir_index_num_sectors(const vdrive_dir_index_t *index)
+{
+    return index->num_sectors;
+}
+
+const uint8_t *vdrive_dir_index_sector(const vdrive_dir_index_t *index,
+                                       unsigned int n)
+{
+    return n < index->num_sectors ? index->sectors[n].data : NULL;
+}
+
+/* Reads a directory sector, from the index if it is in there */
+static int vdrive_dir_read_sector(vdrive_t *vdrive, uint8_t *buf,
+                                  unsigned int track, unsigned int sector)
+{
+    vdrive_dir_index_t *index;
+
+    for (index = vdrive->dir_index; index != NULL; index = index->next) {
+        if (index->image == vdrive->image
+            && vdrive->image != NULL
+            && index->generation == vdrive->image->generation
+            && index->offset == vdrive->current_offset
+            && vdrive_dir_index_has(index, track, sector)) {
+            memcpy(buf, index->sectors[vdrive_dir_index_find(index, track, sector)].data, 256);
+            return 0;
+        }
+    }
+
+    return vdrive_read_sector(vdrive, buf, track, sector);
+}
+
+/* Called by vdrive_write_sector() after a successful write, `generation' is
+   the image generation before the write */
+void vdrive_dir_index_written(vdrive_t *vdrive, const uint8_t *buf,
+                              unsigned int track, unsigned int sector,
+                              unsigned int generation)
+{
+    vdrive_dir_index_t *index, **prev;
+
+    prev = &vdrive->dir_index;
+    while ((index = *prev) != NULL) {
+        int drop = 0;
+
+        if (index->image != vdrive->image) {
+            prev = &index->next;
+            continue;
+        }
+
+        if (index->generation != generation) {
+            /* someone else wrote to the image in between */
+            drop = 1;
+        } else if (index->offset == vdrive->current_offset) {
+            if (vdrive_dir_index_has(index, track, sector)) {
+                uint8_t *data = index->sectors[vdrive_dir_index_find(index, track, sector)].data;
+
+                if (data[0] != buf[0] || (data[0] != 0 && data[1] != buf[1])) {
+                    /* chain changed */
+                    drop = 1;
+                } else {
+                    memcpy(data, buf, 256);
+                }
+            } else if (index->error && index->error_track == track
+                       && index->error_sector == sector) {
+                /* the chain may continue now */
+                drop = 1;
+            }
+        }
+
+        if (drop) {
+            *prev = index->next;
+            vdrive_dir_index_free(index);
+        } else {
+            index->generation = vdrive->image->generation;
+            prev = &index->next;
+        }
+    }
+}
+
+void vdrive_dir_index_clear(vdrive_t *vdrive)
+{
+    vdrive_dir_index_t *index;
+
+    while ((index = vdrive->dir_index) != NULL) {
+        vdrive->dir_index = index->next;
+        vdrive_dir_index_free(index);
+    }
+}
+
 /* Returns the interleave for directory sectors of a given image type */
 static int vdrive_dir_get_interleave(unsigned int type)
 {
@@ -241,6 +508,9 @@ void vdrive_dir_find_first_slot(vdrive_t *vdrive, const uint8_t *name,
         dir->buffer[0] = vdrive->Dir_Track;
         dir->buffer[1] = vdrive->Dir_Sector;
     }
+
+    /* the search below is then answered from memory */
+    vdrive_dir_index_get(vdrive, dir->buffer[0], dir->buffer[1]);
 #ifdef DEBUG_DRIVE
     log_debug(LOG_DEFAULT, "DIR: vdrive_dir_find_first_slot (curr t:%u/s:%u dir t:%u/s:%u)",
               dir->track, dir->sector, vdrive->Dir_Track, vdrive->Dir_Sector);
@@ -264,7 +534,6 @@ static unsigned int date_to_int(int year, int month, int day, int hour, int minu
 
 uint8_t *vdrive_dir_find_next_slot(vdrive_dir_context_t *dir)
 {
-    static uint8_t return_slot[32];
     vdrive_t *vdrive = dir->vdrive;
     uint8_t *tmp;
     int j;
@@ -298,7 +567,7 @@ uint8_t *vdrive_dir_find_next_slot(vdrive_dir_context_t *dir)
             dir->track = (unsigned int)dir->buffer[0];
             dir->sector = (unsigned int)dir->buffer[1];
 
-            status = vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
+            status = vdrive_dir_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
             if (status != 0) {
                 return NULL; /* error */
             }
@@ -307,15 +576,15 @@ uint8_t *vdrive_dir_find_next_slot(vdrive_dir_context_t *dir)
         if (vdrive_dir_name_match(&dir->buffer[dir->slot * 32],
                                   dir->find_nslot, dir->find_length,
                                   dir->find_type)) {
-            memcpy(return_slot, &dir->buffer[dir->slot * 32], 32);
+            memcpy(dir->return_slot, &dir->buffer[dir->slot * 32], 32);
             /* check date range; for DIR listings */
-            t = date_to_int(return_slot[SLOT_GEOS_YEAR], return_slot[SLOT_GEOS_MONTH],
-                return_slot[SLOT_GEOS_DATE], return_slot[SLOT_GEOS_HOUR],
-                return_slot[SLOT_GEOS_MINUTE] );
+            t = date_to_int(dir->return_slot[SLOT_GEOS_YEAR], dir->return_slot[SLOT_GEOS_MONTH],
+                dir->return_slot[SLOT_GEOS_DATE], dir->return_slot[SLOT_GEOS_HOUR],
+                dir->return_slot[SLOT_GEOS_MINUTE] );
             /* time_low is initially 0, and time_high is initially largest,
                 so it should always match for most uses. */
             if (t >= dir->time_low && t <= dir->time_high)
-                return return_slot;
+                return dir->return_slot;
         }
     } while (1);
 
@@ -872,6 +1141,8 @@ void vdrive_dir_part_find_first_slot(vdrive_t *vdrive, const uint8_t *name,
 
     dir->buffer[0] = 1;
     dir->buffer[1] = 0;
+
+    vdrive_dir_index_get(vdrive, 1, 0);
 }
 
 static unsigned int vdrive_dir_part_name_match(uint8_t *slot, uint8_t *nslot, int type)
@@ -889,7 +1160,6 @@ static unsigned int vdrive_dir_part_name_match(uint8_t *slot, uint8_t *nslot, in
 
 uint8_t *vdrive_dir_part_find_next_slot(vdrive_dir_context_t *dir)
 {
-    static uint8_t return_slot[32];
     vdrive_t *vdrive = dir->vdrive;
 
 #ifdef DEBUG_DRIVE
@@ -918,7 +1188,7 @@ uint8_t *vdrive_dir_part_find_next_slot(vdrive_dir_context_t *dir)
             dir->track = (unsigned int)dir->buffer[0];
             dir->sector = (unsigned int)dir->buffer[1];
 
-            status = vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
+            status = vdrive_dir_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
             if (status != 0) {
                 return NULL; /* error */
             }
@@ -926,8 +1196,8 @@ uint8_t *vdrive_dir_part_find_next_slot(vdrive_dir_context_t *dir)
         if (vdrive_dir_part_name_match(&dir->buffer[dir->slot * 32],
                                   dir->find_nslot,
                                   dir->find_type)) {
-            memcpy(return_slot, &dir->buffer[dir->slot * 32], 32);
-            return return_slot;
+            memcpy(dir->return_slot, &dir->buffer[dir->slot * 32], 32);
+            return dir->return_slot;
         }
     } while (1);
 
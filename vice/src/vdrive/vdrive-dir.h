@@ -72,8 +72,12 @@ typedef struct vdrive_dir_context_s {
     unsigned int time_low;
     unsigned int time_high;
     struct vdrive_s *vdrive;
+    uint8_t return_slot[32];  /* Slot returned by the find functions. */
 } vdrive_dir_context_t;
 
+/* Cached sectors of a directory chain, see vdrive-dir.c */
+typedef struct vdrive_dir_index_s vdrive_dir_index_t;
+
 void vdrive_dir_init(void);
 int vdrive_dir_first_directory(struct vdrive_s *vdrive, struct cbmdos_cmd_parse_plus_s *cmd_parse, struct bufferinfo_s *p);
 int vdrive_dir_next_directory(struct vdrive_s *vdrive, struct bufferinfo_s *b);
@@ -90,4 +94,10 @@ int vdrive_dir_part_next_directory(struct vdrive_s *vdrive, struct bufferinfo_s
 int vdrive_dir_part_first_directory(struct vdrive_s *vdrive, const uint8_t *name, int length, struct bufferinfo_s *p);
 void vdrive_dir_part_find_first_slot(struct vdrive_s *vdrive, const uint8_t *name, int length, unsigned int type, vdrive_dir_context_t *dir);
 
+vdrive_dir_index_t *vdrive_dir_index_get(struct vdrive_s *vdrive, unsigned int track, unsigned int sector);
+unsigned int vdrive_dir_index_num_sectors(const vdrive_dir_index_t *index);
+const uint8_t *vdrive_dir_index_sector(const vdrive_dir_index_t *index, unsigned int n);
+void vdrive_dir_index_written(struct vdrive_s *vdrive, const uint8_t *buf, unsigned int track, unsigned int sector, unsigned int generation);
+void vdrive_dir_index_clear(struct vdrive_s *vdrive);
+
 #endif
@@ -143,6 +143,7 @@ int vdrive_device_setup(vdrive_t *vdrive, unsigned int unit)
     vdrive->image = NULL;
     vdrive->image_mode = -1;
     vdrive->current_part = -1;
+    vdrive->dir_index = NULL;
 
     for (i = 0; i < NUM_DRIVES; i++ ) {
         vdrive->images[i] = NULL;
@@ -177,6 +178,7 @@ void vdrive_device_shutdown(vdrive_t *vdrive)
             vdrive_free_buffer(p);
             lib_free(p->buffer);
         }
+        vdrive_dir_index_clear(vdrive);
     }
 }
 
@@ -197,6 +199,7 @@ log_debug(LOG_DEFAULT, "VDRIVE: refresh unit %u", unit);
     }
 
     vdrive_bam_setup_bam(vdrive);
+    vdrive_dir_index_clear(vdrive);
 
     vdrive->current_offset = 0;
     vdrive->sys_offset = UINT32_MAX;
@@ -349,6 +352,9 @@ void vdrive_detach_image(disk_image_t *image, unsigned int unit,
 
     disk_image_detach_log(image, vdrive_log, unit, drive);
 
+    /* the image may be freed and its address reused */
+    vdrive_dir_index_clear(vdrive);
+
     /* shutdown everything on that drive */
     if (vdrive->haspt) {
         vdrive_close_all_channels(vdrive);
@@ -422,6 +428,8 @@ int vdrive_attach_image(disk_image_t *image, unsigned int unit,
 
     disk_image_attach_log(image, vdrive_log, unit, drive);
 
+    vdrive_dir_index_clear(vdrive);
+
     /* fix the number of tracks here as extended tracks aren't supported */
     switch (image->type) {
         case DISK_IMAGE_TYPE_D64:
@@ -968,6 +976,7 @@ int vdrive_read_sector(vdrive_t *vdrive, uint8_t *buf, unsigned int track, unsig
 int vdrive_write_sector(vdrive_t *vdrive, const uint8_t *buf, unsigned int track, unsigned int sector)
 {
     disk_addr_t dadr;
+    unsigned int generation;
     int ret;
 
     /* update image mode if disk is attached */
@@ -988,7 +997,12 @@ int vdrive_write_sector(vdrive_t *vdrive, const uint8_t *buf, unsigned int track
 #if 0
     ui_display_drive_track(vdrive->unit - 8, 0, dadr.track * 2);
 #endif
+    generation = vdrive->image->generation;
     ret = disk_image_write_sector(vdrive->image, buf, &dadr);
+    if (ret == 0) {
+        /* keep the directory index up to date */
+        vdrive_dir_index_written(vdrive, buf, track, sector, generation);
+    }
 
 #ifdef DEBUG_DRIVE
     log_debug(LOG_DEFAULT, "VDRIVE: write_sector %u %u = %d", dadr.track, dadr.sector, ret);
@@ -185,6 +185,9 @@ typedef struct vdrive_s {
 
     unsigned int bam_size;
     uint8_t *bam;              /* Disk header blk (if any) followed by BAM blocks */
+
+    /* cached directory chains, see vdrive-dir.c */
+    struct vdrive_dir_index_s *dir_index;
     bufferinfo_t buffers[16];
 
     /* Memory read command buffer.  */
@@ -52,6 +52,10 @@ ssize_t vice_network_receive(vice_network_socket_t * sockfd, void * buffer, size
 int vice_network_select_poll_one(vice_network_socket_t * readsockfd);
 int vice_network_select_multiple(vice_network_socket_t ** readsockfd);
 
+vice_network_socket_t *vice_network_wakeup_open(void);
+void vice_network_wakeup_signal(vice_network_socket_t *sockfd);
+void vice_network_wakeup_clear(vice_network_socket_t *sockfd);
+
 int vice_network_get_errorcode(void);
 
 #endif /* VICE_SOCKET_H */
@@ -88,6 +88,7 @@ void vicii_reset_registers(void);
 void vicii_update_memory_ptrs_external(void);
 void vicii_handle_pending_alarms_external(CLOCK num_write_cycles);
 void vicii_handle_pending_alarms_external_write(void);
+CLOCK vicii_next_pending_alarm_clk(void);
 
 void vicii_screenshot(struct screenshot_s *screenshot);
 void vicii_shutdown(void);
@@ -34,6 +34,7 @@
 #include "interrupt.h"
 #include "log.h"
 #include "mem.h"
+#include "raster-changes.h"
 #include "raster-snapshot.h"
 #include "raster-sprite-status.h"
 #include "raster-sprite.h"
@@ -251,7 +252,15 @@ int vicii_snapshot_read_module(snapshot_t *s)
         goto fail;
     }
 
-    /* FIXME: initialize changes?  */
+    /* Drop the changes still pending from before the snapshot, the state
+       below replaces them. Without this, restoring several snapshots in a
+       row without drawing a line overflows the change lists.  */
+    raster_changes_remove_all(vicii.raster.changes->background);
+    raster_changes_remove_all(vicii.raster.changes->foreground);
+    raster_changes_remove_all(vicii.raster.changes->border);
+    raster_changes_remove_all(vicii.raster.changes->sprites);
+    raster_changes_remove_all(vicii.raster.changes->next_line);
+    vicii.raster.changes->have_on_this_line = 0;
 
     if (0
         /* AllowBadLines */
@@ -266,6 +266,15 @@ void vicii_handle_pending_alarms_external(CLOCK num_write_cycles)
     }
 }
 
+/*
+ * Returns the clock at which vicii_handle_pending_alarms() has something to
+ * do next. Until then, calling it does not change anything.
+ */
+CLOCK vicii_next_pending_alarm_clk(void)
+{
+    return vicii.fetch_clk < vicii.draw_clk ? vicii.fetch_clk : vicii.draw_clk;
+}
+
 /*
  * As mentioned elsewhere, BA won't interrupt the CPU's write cycles, but it can
  * stop it at read cycles.
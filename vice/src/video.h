@@ -169,6 +169,7 @@ struct video_render_color_tables_s {
     int yuv_updated;            /* yuv table updated for packed mode */
     uint32_t yuv_table[512];
     int32_t line_yuv_0[VIDEO_MAX_OUTPUT_WIDTH * 3];
+    int32_t yuvrow[VIDEO_MAX_OUTPUT_WIDTH * 3];     /* see render-simd.h */
     int16_t prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 3];
     uint8_t rgbscratchbuffer[VIDEO_MAX_OUTPUT_WIDTH * 4];
 
@@ -244,6 +245,7 @@ struct video_render_config_s {
     int fullscreen_mode[FULLSCREEN_MAXDEV];
     int fullscreen_custom_width; /* currently used only in the SDL port */
     int fullscreen_custom_height; /* currently used only in the SDL port */
+    struct video_render_job_s *render_job; /* see video/video-render-worker.c */
 };
 typedef struct video_render_config_s video_render_config_t;
 
@@ -278,6 +280,14 @@ void video_canvas_map(struct video_canvas_s *canvas);
 void video_canvas_unmap(struct video_canvas_s *canvas);
 void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas);
 void video_canvas_render(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht);
+
+/* Called when an asynchronous render of the canvas has completed `trg'.
+   Runs on the render worker thread, see video_canvas_render_async(). */
+typedef void (*video_render_done_func_t)(struct video_canvas_s *canvas, void *param);
+
+void video_canvas_render_async(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht,
+                               video_render_done_func_t done, void *param);
+void video_canvas_render_wait(struct video_canvas_s *canvas);
 void video_canvas_refresh_all(struct video_canvas_s *canvas);
 char video_canvas_can_resize(struct video_canvas_s *canvas);
 void video_viewport_get(struct video_canvas_s *canvas, struct viewport_s **viewport, struct geometry_s **geometry);
@@ -285,6 +295,18 @@ void video_viewport_resize(struct video_canvas_s *canvas, char resize_canvas);
 
 struct raster_s;
 
+/* Values for the global "VideoOutput" resource */
+#define VIDEO_OUTPUT_NONE       0   /* emulate the video chips, but render no pixels */
+#define VIDEO_OUTPUT_NORMAL     1   /* render every frame (default) */
+
+/* Current value of "VideoOutput", checked by the video chips on every line
+   or cycle. */
+extern int video_output;
+
+/* Current value of "VideoRenderThread": render the canvases on a worker
+   thread, see video_canvas_render_async(). */
+extern int video_render_thread;
+
 int video_resources_init(void);
 void video_resources_shutdown(void);
 int video_resources_chip_init(const char *chipname, struct video_canvas_s **canvas, video_chip_cap_t *video_chip_cap);
@@ -26,6 +26,7 @@
 
 #include "vice.h"
 
+#include "render-simd.h"
 #include "types.h"
 #include "video.h"
 
@@ -41,18 +42,9 @@ static inline void render_source_line(uint32_t *tmptrg, const uint8_t *tmpsrc, c
     for (x = 0; x < wstart; x++) {
         *tmptrg++ = colortab[*tmpsrc++];
     }
-    for (x = 0; x < wfast; x++) {
-        tmptrg[0] = colortab[tmpsrc[0]];
-        tmptrg[1] = colortab[tmpsrc[1]];
-        tmptrg[2] = colortab[tmpsrc[2]];
-        tmptrg[3] = colortab[tmpsrc[3]];
-        tmptrg[4] = colortab[tmpsrc[4]];
-        tmptrg[5] = colortab[tmpsrc[5]];
-        tmptrg[6] = colortab[tmpsrc[6]];
-        tmptrg[7] = colortab[tmpsrc[7]];
-        tmpsrc += 8;
-        tmptrg += 8;
-    }
+    render_palette_line(tmptrg, tmpsrc, colortab, wfast * 8);
+    tmpsrc += wfast * 8;
+    tmptrg += wfast * 8;
     for (x = 0; x < wend; x++) {
         *tmptrg++ = colortab[*tmpsrc++];
     }
@@ -0,0 +1,451 @@
+/*
+ * render-simd.c - SIMD row kernels for the renderers
+ *
+ * The PAL/NTSC renderers first compute the Y, U and V values of a whole
+ * output row (the delay line and blur sums are table lookups that do not
+ * vectorize well), then hand the row to the kernels here, which do the
+ * YUV to RGB conversion, the gamma/scanline lookups and the stores.
+ *
+ * All versions do the same 32 bit integer arithmetic as the scalar code, so
+ * the output is pixel-exact. The best version for the host CPU is picked by
+ * render_simd_init().
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#include "log.h"
+#include "render-simd.h"
+#include "types.h"
+#include "video.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || (__GNUC__ >= 5))
+#define RENDER_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RENDER_SIMD_NEON
+#include <arm_neon.h>
+#elif defined(VICE_NEON_SHIM)
+/* plain C intrinsics, to check the NEON code on other hosts */
+#define RENDER_SIMD_NEON
+#include "neon-shim.h"
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* scalar reference */
+
+/*
+    YUV to RGB (PAL)
+
+    R = Y + V
+    G = Y - (0.1953 * U + 0.5078 * V)
+    B = Y + U
+
+    YIQ->RGB (NTSC, Sony CXA2025AS US decoder matrix)
+
+    R = Y + (1.630 * I + 0.317 * Q)
+    G = Y - (0.378 * I + 0.466 * Q)
+    B = Y - (1.089 * I - 1.677 * Q)
+*/
+static inline void yuv_to_rgb(int matrix, int32_t y, int32_t u, int32_t v,
+                              int16_t *red, int16_t *grn, int16_t *blu)
+{
+    if (matrix == RENDER_YUV_NTSC) {
+        *red = (y + ((209 * u +  41 * v) >> 7)) >> 15;
+        *grn = (y - (( 48 * u +  69 * v) >> 7)) >> 15;
+        *blu = (y - ((139 * u - 215 * v) >> 7)) >> 15;
+    } else {
+        *red = (y + v) >> 16;
+        *blu = (y + u) >> 16;
+        *grn = (y - ((50 * u + 130 * v) >> 8)) >> 16;
+    }
+}
+
+static void yuv_line_from(const video_render_color_tables_t *color_tab, int matrix,
+                          uint32_t *line, unsigned int x, unsigned int num)
+{
+    const int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    const int32_t *urow = RENDER_YUVROW_U(color_tab);
+    const int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    int16_t red, grn, blu;
+
+    for (; x < num; x++) {
+        yuv_to_rgb(matrix, yrow[x], urow[x], vrow[x], &red, &grn, &blu);
+        line[x] = color_tab->gamma_red[256 + red]
+                  | color_tab->gamma_grn[256 + grn]
+                  | color_tab->gamma_blu[256 + blu]
+                  | color_tab->alpha;
+    }
+}
+
+static void yuv_line_scanline_from(video_render_color_tables_t *color_tab, int matrix,
+                                   uint32_t *line, uint32_t *scanline,
+                                   unsigned int x, unsigned int num)
+{
+    const int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    const int32_t *urow = RENDER_YUVROW_U(color_tab);
+    const int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    int16_t *prevred = &color_tab->prevrgbline[0];
+    int16_t *prevgrn = &color_tab->prevrgbline[VIDEO_MAX_OUTPUT_WIDTH];
+    int16_t *prevblu = &color_tab->prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 2];
+    int16_t red, grn, blu;
+
+    for (; x < num; x++) {
+        yuv_to_rgb(matrix, yrow[x], urow[x], vrow[x], &red, &grn, &blu);
+        scanline[x] = color_tab->gamma_red_fac[512 + red + prevred[x]]
+                      | color_tab->gamma_grn_fac[512 + grn + prevgrn[x]]
+                      | color_tab->gamma_blu_fac[512 + blu + prevblu[x]]
+                      | color_tab->alpha;
+        line[x] = color_tab->gamma_red[256 + red]
+                  | color_tab->gamma_grn[256 + grn]
+                  | color_tab->gamma_blu[256 + blu]
+                  | color_tab->alpha;
+        prevred[x] = red;
+        prevgrn[x] = grn;
+        prevblu[x] = blu;
+    }
+}
+
+static void palette_line_from(uint32_t *trg, const uint8_t *src, const uint32_t *colortab,
+                              unsigned int x, unsigned int num)
+{
+    for (; x < num; x++) {
+        trg[x] = colortab[src[x]];
+    }
+}
+
+static void yuv_line_scalar(const video_render_color_tables_t *color_tab, int matrix,
+                            uint32_t *line, unsigned int num)
+{
+    yuv_line_from(color_tab, matrix, line, 0, num);
+}
+
+static void yuv_line_scanline_scalar(video_render_color_tables_t *color_tab, int matrix,
+                                     uint32_t *line, uint32_t *scanline, unsigned int num)
+{
+    yuv_line_scanline_from(color_tab, matrix, line, scanline, 0, num);
+}
+
+static void palette_line_scalar(uint32_t *trg, const uint8_t *src, const uint32_t *colortab,
+                                unsigned int num)
+{
+    palette_line_from(trg, src, colortab, 0, num);
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2: 8 pixels at a time, table lookups with gathers */
+
+#ifdef RENDER_SIMD_X86
+
+__attribute__((target("avx2")))
+static inline void yuv_to_rgb_avx2(int matrix, __m256i y, __m256i u, __m256i v,
+                                   __m256i *red, __m256i *grn, __m256i *blu)
+{
+    if (matrix == RENDER_YUV_NTSC) {
+        __m256i ru = _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(209)),
+                                      _mm256_mullo_epi32(v, _mm256_set1_epi32(41)));
+        __m256i gu = _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(48)),
+                                      _mm256_mullo_epi32(v, _mm256_set1_epi32(69)));
+        __m256i bu = _mm256_sub_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(139)),
+                                      _mm256_mullo_epi32(v, _mm256_set1_epi32(215)));
+        *red = _mm256_srai_epi32(_mm256_add_epi32(y, _mm256_srai_epi32(ru, 7)), 15);
+        *grn = _mm256_srai_epi32(_mm256_sub_epi32(y, _mm256_srai_epi32(gu, 7)), 15);
+        *blu = _mm256_srai_epi32(_mm256_sub_epi32(y, _mm256_srai_epi32(bu, 7)), 15);
+    } else {
+        __m256i gu = _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(50)),
+                                      _mm256_mullo_epi32(v, _mm256_set1_epi32(130)));
+        *red = _mm256_srai_epi32(_mm256_add_epi32(y, v), 16);
+        *blu = _mm256_srai_epi32(_mm256_add_epi32(y, u), 16);
+        *grn = _mm256_srai_epi32(_mm256_sub_epi32(y, _mm256_srai_epi32(gu, 8)), 16);
+    }
+    /* the scalar code keeps the components in 16 bit variables */
+    *red = _mm256_srai_epi32(_mm256_slli_epi32(*red, 16), 16);
+    *grn = _mm256_srai_epi32(_mm256_slli_epi32(*grn, 16), 16);
+    *blu = _mm256_srai_epi32(_mm256_slli_epi32(*blu, 16), 16);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i gamma_avx2(const video_render_color_tables_t *color_tab,
+                                 __m256i red, __m256i grn, __m256i blu, __m256i alpha)
+{
+    const __m256i off = _mm256_set1_epi32(256);
+    __m256i rgb;
+
+    rgb = _mm256_i32gather_epi32((const int *)color_tab->gamma_red, _mm256_add_epi32(red, off), 4);
+    rgb = _mm256_or_si256(rgb, _mm256_i32gather_epi32((const int *)color_tab->gamma_grn,
+                                                      _mm256_add_epi32(grn, off), 4));
+    rgb = _mm256_or_si256(rgb, _mm256_i32gather_epi32((const int *)color_tab->gamma_blu,
+                                                      _mm256_add_epi32(blu, off), 4));
+    return _mm256_or_si256(rgb, alpha);
+}
+
+/* scanline lookup, also replaces the previous row by the current one */
+__attribute__((target("avx2")))
+static inline __m256i scanline_avx2(const uint32_t *fac, int16_t *prev, __m256i cur)
+{
+    const __m256i pack = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i idx, packed;
+
+    idx = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)prev));
+    idx = _mm256_add_epi32(_mm256_add_epi32(idx, cur), _mm256_set1_epi32(512));
+
+    packed = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(cur, pack), 0x08);
+    _mm_storeu_si128((__m128i *)prev, _mm256_castsi256_si128(packed));
+
+    return _mm256_i32gather_epi32((const int *)fac, idx, 4);
+}
+
+__attribute__((target("avx2")))
+static void yuv_line_avx2(const video_render_color_tables_t *color_tab, int matrix,
+                          uint32_t *line, unsigned int num)
+{
+    const int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    const int32_t *urow = RENDER_YUVROW_U(color_tab);
+    const int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    const __m256i alpha = _mm256_set1_epi32((int)color_tab->alpha);
+    __m256i red, grn, blu;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= num; x += 8) {
+        yuv_to_rgb_avx2(matrix,
+                        _mm256_loadu_si256((const __m256i *)(yrow + x)),
+                        _mm256_loadu_si256((const __m256i *)(urow + x)),
+                        _mm256_loadu_si256((const __m256i *)(vrow + x)),
+                        &red, &grn, &blu);
+        _mm256_storeu_si256((__m256i *)(line + x), gamma_avx2(color_tab, red, grn, blu, alpha));
+    }
+    yuv_line_from(color_tab, matrix, line, x, num);
+}
+
+__attribute__((target("avx2")))
+static void yuv_line_scanline_avx2(video_render_color_tables_t *color_tab, int matrix,
+                                   uint32_t *line, uint32_t *scanline, unsigned int num)
+{
+    const int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    const int32_t *urow = RENDER_YUVROW_U(color_tab);
+    const int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    int16_t *prevred = &color_tab->prevrgbline[0];
+    int16_t *prevgrn = &color_tab->prevrgbline[VIDEO_MAX_OUTPUT_WIDTH];
+    int16_t *prevblu = &color_tab->prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 2];
+    const __m256i alpha = _mm256_set1_epi32((int)color_tab->alpha);
+    __m256i red, grn, blu, rgb;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= num; x += 8) {
+        yuv_to_rgb_avx2(matrix,
+                        _mm256_loadu_si256((const __m256i *)(yrow + x)),
+                        _mm256_loadu_si256((const __m256i *)(urow + x)),
+                        _mm256_loadu_si256((const __m256i *)(vrow + x)),
+                        &red, &grn, &blu);
+        rgb = scanline_avx2(color_tab->gamma_red_fac, prevred + x, red);
+        rgb = _mm256_or_si256(rgb, scanline_avx2(color_tab->gamma_grn_fac, prevgrn + x, grn));
+        rgb = _mm256_or_si256(rgb, scanline_avx2(color_tab->gamma_blu_fac, prevblu + x, blu));
+        _mm256_storeu_si256((__m256i *)(scanline + x), _mm256_or_si256(rgb, alpha));
+        _mm256_storeu_si256((__m256i *)(line + x), gamma_avx2(color_tab, red, grn, blu, alpha));
+    }
+    yuv_line_scanline_from(color_tab, matrix, line, scanline, x, num);
+}
+
+__attribute__((target("avx2")))
+static void palette_line_avx2(uint32_t *trg, const uint8_t *src, const uint32_t *colortab,
+                              unsigned int num)
+{
+    unsigned int x;
+
+    for (x = 0; x + 8 <= num; x += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + x)));
+        _mm256_storeu_si256((__m256i *)(trg + x),
+                            _mm256_i32gather_epi32((const int *)colortab, idx, 4));
+    }
+    palette_line_from(trg, src, colortab, x, num);
+}
+
+#endif /* RENDER_SIMD_X86 */
+
+/* ------------------------------------------------------------------------- */
+/* NEON: 4 pixels at a time, scalar table lookups */
+
+#ifdef RENDER_SIMD_NEON
+
+static inline void yuv_to_rgb_neon(int matrix, int32x4_t y, int32x4_t u, int32x4_t v,
+                                   int32x4_t *red, int32x4_t *grn, int32x4_t *blu)
+{
+    if (matrix == RENDER_YUV_NTSC) {
+        int32x4_t ru = vmlaq_n_s32(vmulq_n_s32(u, 209), v, 41);
+        int32x4_t gu = vmlaq_n_s32(vmulq_n_s32(u, 48), v, 69);
+        int32x4_t bu = vmlsq_n_s32(vmulq_n_s32(u, 139), v, 215);
+        *red = vshrq_n_s32(vaddq_s32(y, vshrq_n_s32(ru, 7)), 15);
+        *grn = vshrq_n_s32(vsubq_s32(y, vshrq_n_s32(gu, 7)), 15);
+        *blu = vshrq_n_s32(vsubq_s32(y, vshrq_n_s32(bu, 7)), 15);
+    } else {
+        int32x4_t gu = vmlaq_n_s32(vmulq_n_s32(u, 50), v, 130);
+        *red = vshrq_n_s32(vaddq_s32(y, v), 16);
+        *blu = vshrq_n_s32(vaddq_s32(y, u), 16);
+        *grn = vshrq_n_s32(vsubq_s32(y, vshrq_n_s32(gu, 8)), 16);
+    }
+    /* the scalar code keeps the components in 16 bit variables */
+    *red = vmovl_s16(vmovn_s32(*red));
+    *grn = vmovl_s16(vmovn_s32(*grn));
+    *blu = vmovl_s16(vmovn_s32(*blu));
+}
+
+static void yuv_line_neon(const video_render_color_tables_t *color_tab, int matrix,
+                          uint32_t *line, unsigned int num)
+{
+    const int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    const int32_t *urow = RENDER_YUVROW_U(color_tab);
+    const int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    int32x4_t red, grn, blu;
+    int32_t r[4], g[4], b[4];
+    unsigned int x, i;
+
+    for (x = 0; x + 4 <= num; x += 4) {
+        yuv_to_rgb_neon(matrix, vld1q_s32(yrow + x), vld1q_s32(urow + x), vld1q_s32(vrow + x),
+                        &red, &grn, &blu);
+        vst1q_s32(r, red);
+        vst1q_s32(g, grn);
+        vst1q_s32(b, blu);
+        for (i = 0; i < 4; i++) {
+            line[x + i] = color_tab->gamma_red[256 + r[i]]
+                          | color_tab->gamma_grn[256 + g[i]]
+                          | color_tab->gamma_blu[256 + b[i]]
+                          | color_tab->alpha;
+        }
+    }
+    yuv_line_from(color_tab, matrix, line, x, num);
+}
+
+static void yuv_line_scanline_neon(video_render_color_tables_t *color_tab, int matrix,
+                                   uint32_t *line, uint32_t *scanline, unsigned int num)
+{
+    const int32_t *yrow = RENDER_YUVROW_Y(color_tab);
+    const int32_t *urow = RENDER_YUVROW_U(color_tab);
+    const int32_t *vrow = RENDER_YUVROW_V(color_tab);
+    int16_t *prevred = &color_tab->prevrgbline[0];
+    int16_t *prevgrn = &color_tab->prevrgbline[VIDEO_MAX_OUTPUT_WIDTH];
+    int16_t *prevblu = &color_tab->prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 2];
+    int32x4_t red, grn, blu;
+    int32_t r[4], g[4], b[4];
+    unsigned int x, i;
+
+    for (x = 0; x + 4 <= num; x += 4) {
+        yuv_to_rgb_neon(matrix, vld1q_s32(yrow + x), vld1q_s32(urow + x), vld1q_s32(vrow + x),
+                        &red, &grn, &blu);
+        vst1q_s32(r, red);
+        vst1q_s32(g, grn);
+        vst1q_s32(b, blu);
+        for (i = 0; i < 4; i++) {
+            scanline[x + i] = color_tab->gamma_red_fac[512 + r[i] + prevred[x + i]]
+                              | color_tab->gamma_grn_fac[512 + g[i] + prevgrn[x + i]]
+                              | color_tab->gamma_blu_fac[512 + b[i] + prevblu[x + i]]
+                              | color_tab->alpha;
+            line[x + i] = color_tab->gamma_red[256 + r[i]]
+                          | color_tab->gamma_grn[256 + g[i]]
+                          | color_tab->gamma_blu[256 + b[i]]
+                          | color_tab->alpha;
+        }
+        vst1_s16(prevred + x, vmovn_s32(red));
+        vst1_s16(prevgrn + x, vmovn_s32(grn));
+        vst1_s16(prevblu + x, vmovn_s32(blu));
+    }
+    yuv_line_scanline_from(color_tab, matrix, line, scanline, x, num);
+}
+
+#endif /* RENDER_SIMD_NEON */
+
+/* ------------------------------------------------------------------------- */
+
+render_yuv_line_func_t render_yuv_line = yuv_line_scalar;
+render_yuv_scanline_func_t render_yuv_line_scanline = yuv_line_scanline_scalar;
+render_palette_line_func_t render_palette_line = palette_line_scalar;
+
+/* Select the row kernels. RENDER_KERNELS_AUTO picks the best version for the
+   host CPU, the others are there to compare the versions in tests and
+   benchmarks. Returns 0 on success, -1 if the version is not compiled in or
+   not supported by the CPU. */
+int render_simd_set(int kernels)
+{
+    switch (kernels) {
+        case RENDER_KERNELS_AUTO:
+            if (render_simd_set(RENDER_KERNELS_AVX2) == 0
+                || render_simd_set(RENDER_KERNELS_NEON) == 0) {
+                return 0;
+            }
+            return render_simd_set(RENDER_KERNELS_SCALAR);
+        case RENDER_KERNELS_SCALAR:
+            render_yuv_line = yuv_line_scalar;
+            render_yuv_line_scanline = yuv_line_scanline_scalar;
+            render_palette_line = palette_line_scalar;
+            return 0;
+#ifdef RENDER_SIMD_X86
+        case RENDER_KERNELS_AVX2:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("avx2")) {
+                return -1;
+            }
+            render_yuv_line = yuv_line_avx2;
+            render_yuv_line_scanline = yuv_line_scanline_avx2;
+            render_palette_line = palette_line_avx2;
+            return 0;
+#endif
+#ifdef RENDER_SIMD_NEON
+        case RENDER_KERNELS_NEON:
+            render_yuv_line = yuv_line_neon;
+            render_yuv_line_scanline = yuv_line_scanline_neon;
+            render_palette_line = palette_line_scalar;
+            return 0;
+#endif
+        default:
+            return -1;
+    }
+}
+
+/* Pick the row kernels for the host CPU. */
+void render_simd_init(void)
+{
+    static int done = 0;
+
+    if (done) {
+        return;
+    }
+    done = 1;
+
+    render_simd_set(RENDER_KERNELS_AUTO);
+    if (render_yuv_line == yuv_line_scalar) {
+        return;
+    }
+#ifdef RENDER_SIMD_X86
+    if (render_yuv_line == yuv_line_avx2) {
+        log_message(LOG_DEFAULT, "Video: using AVX2 render kernels.");
+    }
+#endif
+#ifdef RENDER_SIMD_NEON
+    if (render_yuv_line == yuv_line_neon) {
+        log_message(LOG_DEFAULT, "Video: using NEON render kernels.");
+    }
+#endif
+}
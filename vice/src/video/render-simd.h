@@ -0,0 +1,67 @@
+/*
+ * render-simd.h - SIMD row kernels for the renderers
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_RENDER_SIMD_H
+#define VICE_RENDER_SIMD_H
+
+#include "types.h"
+#include "video.h"
+
+/* YUV to RGB matrix used by the row kernels */
+#define RENDER_YUV_PAL      0   /* see render1x1pal.c and render2x2pal.c */
+#define RENDER_YUV_NTSC     1   /* see render2x2ntsc.c */
+
+/* Y, U and V of the output pixels of a row, in color_tab->yuvrow */
+#define RENDER_YUVROW_Y(color_tab)  (&(color_tab)->yuvrow[0])
+#define RENDER_YUVROW_U(color_tab)  (&(color_tab)->yuvrow[VIDEO_MAX_OUTPUT_WIDTH])
+#define RENDER_YUVROW_V(color_tab)  (&(color_tab)->yuvrow[VIDEO_MAX_OUTPUT_WIDTH * 2])
+
+/* Convert `num' pixels from color_tab->yuvrow to gamma corrected RGB. */
+typedef void (*render_yuv_line_func_t)(const video_render_color_tables_t *color_tab,
+                                       int matrix, uint32_t *line, unsigned int num);
+
+/* Same, and also write the scanline between the previous row and this one.
+   The RGB values of the previous row are kept in color_tab->prevrgbline,
+   as 3 planes of VIDEO_MAX_OUTPUT_WIDTH values (red, green, blue). */
+typedef void (*render_yuv_scanline_func_t)(video_render_color_tables_t *color_tab,
+                                           int matrix, uint32_t *line, uint32_t *scanline,
+                                           unsigned int num);
+
+/* Look up `num' palette indexes in colortab. */
+typedef void (*render_palette_line_func_t)(uint32_t *trg, const uint8_t *src,
+                                           const uint32_t *colortab, unsigned int num);
+
+extern render_yuv_line_func_t render_yuv_line;
+extern render_yuv_scanline_func_t render_yuv_line_scanline;
+extern render_palette_line_func_t render_palette_line;
+
+/* row kernel versions, see render_simd_set() */
+#define RENDER_KERNELS_AUTO     0
+#define RENDER_KERNELS_SCALAR   1
+#define RENDER_KERNELS_AVX2     2
+#define RENDER_KERNELS_NEON     3
+
+extern int render_simd_set(int kernels);
+extern void render_simd_init(void);
+
+#endif
@@ -28,51 +28,21 @@
 
 #include <stdio.h>
 
+#include "render-simd.h"
 #include "render2x2.h"
 #include "render2x2pal.h"
 #include "types.h"
 #include "video-color.h"
 
-/*
-    YUV to RGB
-
-    R = Y + V
-    G = Y - (0.1953 * U + 0.5078 * V)
-    B = Y + U
-*/
-static inline
-void yuv_to_rgb(int32_t y, int32_t u, int32_t v, int16_t *red, int16_t *grn, int16_t *blu)
-{
-    *red = (y + v) >> 16;
-    *blu = (y + u) >> 16;
-    *grn = (y - ((50 * u + 130 * v) >> 8)) >> 16;
-}
-
+/* Queue a pixel of the current row, see render-simd.h */
 static inline
-void store_line_and_scanline_4(
-    video_render_color_tables_t *color_tab,
-    uint8_t *const line, uint8_t *const scanline,
-    int16_t *const prevline, const int shade, /* ignored by RGB modes */
-    const int32_t y, const int32_t u, const int32_t v)
+void store_yuv(video_render_color_tables_t *color_tab, unsigned int *const n,
+               const int32_t y, const int32_t u, const int32_t v)
 {
-    int16_t red, grn, blu;
-    uint32_t *tmp1, *tmp2;
-    yuv_to_rgb(y, u, v, &red, &grn, &blu);
-
-    tmp1 = (uint32_t *) scanline;
-    tmp2 = (uint32_t *) line;
-    *tmp1 = color_tab->gamma_red_fac[512 + red + prevline[0]]
-            | color_tab->gamma_grn_fac[512 + grn + prevline[1]]
-            | color_tab->gamma_blu_fac[512 + blu + prevline[2]]
-            | color_tab->alpha;
-    *tmp2 = color_tab->gamma_red[256 + red]
-            | color_tab->gamma_grn[256 + grn]
-            | color_tab->gamma_blu[256 + blu]
-            | color_tab->alpha;
-
-    prevline[0] = red;
-    prevline[1] = grn;
-    prevline[2] = blu;
+    RENDER_YUVROW_Y(color_tab)[*n] = y;
+    RENDER_YUVROW_U(color_tab)[*n] = u;
+    RENDER_YUVROW_V(color_tab)[*n] = v;
+    (*n)++;
 }
 
 static inline
@@ -98,14 +68,13 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
                             unsigned int pixelstride,
                             const int write_interpolated_pixels, video_render_config_t *config)
 {
-    int16_t *prevrgblineptr;
     const int32_t *ytablel = color_tab->ytablel;
     const int32_t *ytableh = color_tab->ytableh;
     const uint8_t *tmpsrc;
     uint8_t *tmptrg, *tmptrgscanline;
     int32_t *line, *cbtable, *crtable;
-    uint32_t x, y, wfirst, wlast, yys;
-    int32_t l, l2, u, u2, unew, v, v2, vnew, off, off_flip, shade;
+    uint32_t x, y, wfirst, wlast, yys, n;
+    int32_t l, l2, u, u2, unew, v, v2, vnew, off, off_flip;
     int first_line = viewport_first_line * 2;
     int last_line = (viewport_last_line * 2) + 1;
 
@@ -151,7 +120,6 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
 
     /* Calculate odd line shading */
     off = (int) (((float) config->video_resources.pal_oddlines_offset * (1.5f / 2000.0f) - (1.5f / 2.0f - 1.0f)) * (1 << 5));
-    shade = (int) ((float) config->video_resources.pal_scanlineshade / 1000.0f * 256.f);
 
     /* height & 1 == 0. */
     for (y = yys; y < yys + height + 1; y += 2) {
@@ -208,7 +176,7 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
         line += 2;
 
         /* actual line */
-        prevrgblineptr = &color_tab->prevrgbline[0];
+        n = 0;
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -220,10 +188,7 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             line += 2;
 
             if (write_interpolated_pixels) {
-                store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
-                tmptrgscanline += pixelstride;
-                tmptrg += pixelstride;
-                prevrgblineptr += 3;
+                store_yuv(color_tab, &n, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
             }
 
             l = l2;
@@ -231,10 +196,7 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             v = v2;
         }
         for (x = 0; x < width; x++) {
-            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
-            tmptrgscanline += pixelstride;
-            tmptrg += pixelstride;
-            prevrgblineptr += 3;
+            store_yuv(color_tab, &n, l, u, v);
 
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -246,10 +208,7 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             line += 2;
 
             if (write_interpolated_pixels) {
-                store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
-                tmptrgscanline += pixelstride;
-                tmptrg += pixelstride;
-                prevrgblineptr += 3;
+                store_yuv(color_tab, &n, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
             }
 
             l = l2;
@@ -257,8 +216,9 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             v = v2;
         }
         if (wlast) {
-            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
+            store_yuv(color_tab, &n, l, u, v);
         }
+        render_yuv_line_scanline(color_tab, RENDER_YUV_PAL, (uint32_t *)tmptrg, (uint32_t *)tmptrgscanline, n);
 
         src += pitchs;
         trg += pitcht * 2;
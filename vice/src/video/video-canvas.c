@@ -45,6 +45,7 @@
 #include "types.h"
 #include "video-canvas.h"
 #include "video-color.h"
+#include "video-render-worker.h"
 #include "video-render.h"
 #include "video.h"
 #include "viewport.h"
@@ -103,6 +104,8 @@ void video_canvas_shutdown(video_canvas_t *canvas)
             }
         }
 
+        video_render_worker_canvas_shutdown(canvas);
+
         lib_free(canvas->videoconfig);
         lib_free(canvas->draw_buffer);
         lib_free(canvas->viewport);
@@ -111,15 +114,10 @@ void video_canvas_shutdown(video_canvas_t *canvas)
     }
 }
 
-void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
-                         int height, int xs, int ys, int xt, int yt,
-                         int pitcht)
+/* Bring the colour tables up to date before rendering */
+void video_canvas_render_prepare(video_canvas_t *canvas)
 {
     viewport_t *viewport = canvas->viewport;
-#ifdef VIDEO_SCALE_SOURCE
-    xs /= canvas->videoconfig->scalex;
-    ys /= canvas->videoconfig->scaley;
-#endif
 
     /* when the color encoding changed, the palette must be recalculated */
     if (viewport->crt_type != canvas->crt_type) {
@@ -130,6 +128,22 @@ void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
     if (!canvas->videoconfig->color_tables.updated) { /* update colors as necessary */
         video_color_update_palette(canvas);
     }
+}
+
+void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
+                         int height, int xs, int ys, int xt, int yt,
+                         int pitcht)
+{
+    viewport_t *viewport = canvas->viewport;
+#ifdef VIDEO_SCALE_SOURCE
+    xs /= canvas->videoconfig->scalex;
+    ys /= canvas->videoconfig->scaley;
+#endif
+
+    /* trg may still be in use by a render on the worker thread */
+    video_canvas_render_wait(canvas);
+
+    video_canvas_render_prepare(canvas);
     video_render_main(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
                       trg, width, height, xs, ys, xt, yt,
                       canvas->draw_buffer->draw_buffer_width, pitcht,
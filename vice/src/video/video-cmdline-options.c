@@ -27,6 +27,7 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "cmdline.h"
@@ -36,8 +37,39 @@
 #include "util.h"
 #include "video.h"
 
+static int set_video_output(const char *param, void *extra_param)
+{
+    int val;
+
+    if (strcmp(param, "none") == 0) {
+        val = VIDEO_OUTPUT_NONE;
+    } else if (strcmp(param, "normal") == 0) {
+        val = VIDEO_OUTPUT_NORMAL;
+    } else {
+        val = atoi(param);
+    }
+    return resources_set_int("VideoOutput", val);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-videooutput", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_video_output, NULL, "VideoOutput", NULL,
+      "<Mode>", "Set video output mode: (none/0: emulate the video chips without rendering, normal/1: render every frame)" },
+    { "-videorenderthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VideoRenderThread", (void *)1,
+      NULL, "Render frames on a separate thread, overlapping with the emulation of the next frame" },
+    { "+videorenderthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VideoRenderThread", (void *)0,
+      NULL, "Render frames on the emulation thread" },
+    CMDLINE_LIST_END
+};
+
 int video_cmdline_options_init(void)
 {
+    if (cmdline_register_options(cmdline_options) < 0) {
+        return -1;
+    }
     return video_arch_cmdline_options_init();
 }
 
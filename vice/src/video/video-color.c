@@ -897,6 +897,10 @@ int video_color_update_palette(struct video_canvas_s *canvas)
     if (canvas == NULL) {
         return 0;
     }
+
+    /* the render worker may be using the colour tables */
+    video_canvas_render_wait(canvas);
+
     canvas->videoconfig->color_tables.updated = 1;
 
     DBG(("video_color_update_palette cbm palette:%d extern: %d",
@@ -0,0 +1,315 @@
+/*
+ * video-render-worker.c - Render canvases on a worker thread.
+ *
+ * With "VideoRenderThread" enabled, video_canvas_render_async() copies the
+ * finished draw buffer of a canvas and hands the palette/CRT render of the
+ * frame to a worker thread, so the emulation can go on with the next frame
+ * while the previous one is being rendered. The draw buffer copy is owned by
+ * the worker, the raster code keeps drawing into its own buffer.
+ *
+ * Each canvas has at most one frame in flight: submitting the next frame, or
+ * touching the target buffer or the colour tables from the emulation side,
+ * first waits for the previous render of that canvas to complete.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include "videoarch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "video-canvas.h"
+#include "video-render-worker.h"
+#include "video-render.h"
+#include "video-sound.h"
+#include "video.h"
+#include "viewport.h"
+
+#ifdef HAVE_PTHREAD_H
+
+/* One frame of a canvas, queued or being rendered */
+struct video_render_job_s {
+    video_canvas_t *canvas;
+    int busy;                       /* queued or being rendered */
+
+    /* copy of the draw buffer, including the padding lines of the raster */
+    uint8_t *buffer;
+    size_t buffer_size;
+    uint8_t *src;
+    int pitchs;
+    viewport_t viewport;
+
+    uint8_t *trg;
+    int width, height, xs, ys, xt, yt, pitcht;
+    video_render_done_func_t done;
+    void *param;
+
+    struct video_render_job_s *next;
+};
+typedef struct video_render_job_s video_render_job_t;
+
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;  /* new job or quit */
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;    /* job completed */
+static pthread_t worker_thread;
+static int worker_running = 0;
+static int worker_quit = 0;
+
+static video_render_job_t *queue_head = NULL;
+static video_render_job_t *queue_tail = NULL;
+
+/* jobs queued or being rendered, the queue is empty while the last job is
+   still being rendered */
+static int jobs_in_flight = 0;
+
+
+static void *video_render_worker_main(void *unused)
+{
+    video_render_job_t *job;
+
+    pthread_mutex_lock(&worker_lock);
+
+    for (;;) {
+        while (queue_head == NULL && !worker_quit) {
+            pthread_cond_wait(&worker_cond, &worker_lock);
+        }
+        if (queue_head == NULL) {
+            break;
+        }
+        job = queue_head;
+        queue_head = job->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&worker_lock);
+
+        video_render_pixels(job->canvas->videoconfig, job->src, job->trg,
+                            job->width, job->height, job->xs, job->ys,
+                            job->xt, job->yt, job->pitchs, job->pitcht,
+                            &job->viewport);
+        if (job->done != NULL) {
+            job->done(job->canvas, job->param);
+        }
+
+        pthread_mutex_lock(&worker_lock);
+        job->busy = 0;
+        jobs_in_flight--;
+        pthread_cond_broadcast(&done_cond);
+    }
+
+    pthread_mutex_unlock(&worker_lock);
+    return NULL;
+}
+
+static int video_render_worker_start(void)
+{
+    if (worker_running) {
+        return 0;
+    }
+    worker_quit = 0;
+    if (pthread_create(&worker_thread, NULL, video_render_worker_main, NULL) != 0) {
+        log_error(LOG_DEFAULT, "Video: cannot start the render thread, rendering on the emulation thread.");
+        video_render_thread = 0;
+        return -1;
+    }
+    worker_running = 1;
+    return 0;
+}
+
+/* Copy the draw buffer of the canvas into the job, see
+   raster_calculate_padding_size() for the layout. */
+static void video_render_job_copy_source(video_render_job_t *job, video_canvas_t *canvas)
+{
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    size_t pitch = draw_buffer->draw_buffer_width;
+    size_t size = pitch * (draw_buffer->draw_buffer_height + 4);
+
+    if (job->buffer_size < size) {
+        lib_free(job->buffer);
+        job->buffer = lib_malloc(size);
+        job->buffer_size = size;
+    }
+    memcpy(job->buffer, draw_buffer->draw_buffer - pitch * 2, size);
+    job->src = job->buffer + pitch * 2;
+    job->pitchs = (int)pitch;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+
+/** \brief  Render a frame of the canvas, on the worker thread if enabled
+ *
+ * Takes the same arguments as video_canvas_render(). When the render worker
+ * is used, the function returns right after queueing the frame, and \a done
+ * is called on the worker thread once \a trg is complete. Otherwise the frame
+ * is rendered right away and \a done is called before returning.
+ *
+ * \a trg must stay valid until then, see video_canvas_render_wait().
+ *
+ * \param[in]   done    function to call when the frame is rendered, or NULL
+ * \param[in]   param   extra argument for \a done
+ */
+void video_canvas_render_async(video_canvas_t *canvas, uint8_t *trg,
+                               int width, int height, int xs, int ys,
+                               int xt, int yt, int pitcht,
+                               video_render_done_func_t done, void *param)
+{
+#ifdef HAVE_PTHREAD_H
+    video_render_job_t *job;
+
+    if (video_render_thread && width > 0 && video_render_worker_start() == 0) {
+        if (canvas->videoconfig->render_job == NULL) {
+            canvas->videoconfig->render_job = lib_calloc(1, sizeof(video_render_job_t));
+        }
+        job = canvas->videoconfig->render_job;
+
+        /* the previous frame of this canvas must be done first */
+        video_canvas_render_wait(canvas);
+
+        video_canvas_render_prepare(canvas);
+        video_sound_update(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
+                           width, height, xs, ys,
+                           (int)canvas->draw_buffer->draw_buffer_width,
+                           canvas->viewport);
+
+        video_render_job_copy_source(job, canvas);
+        job->canvas = canvas;
+        job->viewport = *canvas->viewport;
+        job->trg = trg;
+        job->width = width;
+        job->height = height;
+        job->xs = xs;
+        job->ys = ys;
+        job->xt = xt;
+        job->yt = yt;
+        job->pitcht = pitcht;
+        job->done = done;
+        job->param = param;
+        job->next = NULL;
+
+        pthread_mutex_lock(&worker_lock);
+        job->busy = 1;
+        jobs_in_flight++;
+        if (queue_tail != NULL) {
+            queue_tail->next = job;
+        } else {
+            queue_head = job;
+        }
+        queue_tail = job;
+        pthread_cond_signal(&worker_cond);
+        pthread_mutex_unlock(&worker_lock);
+        return;
+    }
+#endif
+    video_canvas_render(canvas, trg, width, height, xs, ys, xt, yt, pitcht);
+    if (done != NULL) {
+        done(canvas, param);
+    }
+}
+
+
+/** \brief  Wait until the worker is done with the canvas
+ *
+ * Must be called before the target buffer of a pending render is reused or
+ * freed, or before the colour tables of the canvas are changed.
+ */
+void video_canvas_render_wait(video_canvas_t *canvas)
+{
+#ifdef HAVE_PTHREAD_H
+    video_render_job_t *job;
+
+    if (canvas == NULL || canvas->videoconfig == NULL) {
+        return;
+    }
+    job = canvas->videoconfig->render_job;
+    if (job == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&worker_lock);
+    while (job->busy) {
+        pthread_cond_wait(&done_cond, &worker_lock);
+    }
+    pthread_mutex_unlock(&worker_lock);
+#endif
+}
+
+
+/** \brief  Wait until all queued frames are rendered
+ *
+ * Also waits for the frame the worker is rendering right now, which has
+ * already been taken off the queue.
+ */
+void video_render_worker_wait_all(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&worker_lock);
+    while (jobs_in_flight > 0) {
+        pthread_cond_wait(&done_cond, &worker_lock);
+    }
+    pthread_mutex_unlock(&worker_lock);
+#endif
+}
+
+
+/** \brief  Wait for the canvas and free its render job
+ */
+void video_render_worker_canvas_shutdown(video_canvas_t *canvas)
+{
+#ifdef HAVE_PTHREAD_H
+    video_render_job_t *job = canvas->videoconfig->render_job;
+
+    if (job != NULL) {
+        video_canvas_render_wait(canvas);
+        lib_free(job->buffer);
+        lib_free(job);
+        canvas->videoconfig->render_job = NULL;
+    }
+#endif
+}
+
+
+/** \brief  Stop the render worker thread
+ */
+void video_render_worker_shutdown(void)
+{
+#ifdef HAVE_PTHREAD_H
+    if (!worker_running) {
+        return;
+    }
+    pthread_mutex_lock(&worker_lock);
+    worker_quit = 1;
+    pthread_cond_signal(&worker_cond);
+    pthread_mutex_unlock(&worker_lock);
+
+    pthread_join(worker_thread, NULL);
+    worker_running = 0;
+#endif
+}
@@ -0,0 +1,33 @@
+/*
+ * video-render-worker.h - Render canvases on a worker thread.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_VIDEO_RENDER_WORKER_H
+#define VICE_VIDEO_RENDER_WORKER_H
+
+struct video_canvas_s;
+
+void video_render_worker_wait_all(void);
+void video_render_worker_canvas_shutdown(struct video_canvas_s *canvas);
+void video_render_worker_shutdown(void);
+
+#endif
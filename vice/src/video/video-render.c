@@ -30,6 +30,7 @@
 #include <stdio.h>
 
 #include "log.h"
+#include "render-simd.h"
 #include "types.h"
 #include "video-render.h"
 #include "video-sound.h"
@@ -43,6 +44,8 @@ void video_render_initconfig(video_render_config_t *config)
 {
     int i;
 
+    render_simd_init();
+
     config->rendermode = VIDEO_RENDER_NULL;
     config->doublescan = 0;
 
@@ -75,8 +78,6 @@ void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg
                        int width, int height, int xs, int ys, int xt, int yt,
                        int pitchs, int pitcht, viewport_t *viewport)
 {
-    int rendermode;
-
 #if 0
     log_debug(LOG_DEFAULT, "w:%i h:%i xs:%i ys:%i xt:%i yt:%i ps:%i pt:%i d%i",
               width, height, xs, ys, xt, yt, pitchs, pitcht, depth);
@@ -88,6 +89,18 @@ void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg
 
     video_sound_update(config, src, width, height, xs, ys, pitchs, viewport);
 
+    video_render_pixels(config, src, trg, width, height, xs, ys, xt, yt,
+                        pitchs, pitcht, viewport);
+}
+
+/* The pixel part of video_render_main(), which may also run on the render
+   worker thread. */
+void video_render_pixels(video_render_config_t *config, uint8_t *src, uint8_t *trg,
+                         int width, int height, int xs, int ys, int xt, int yt,
+                         int pitchs, int pitcht, viewport_t *viewport)
+{
+    int rendermode;
+
     rendermode = config->rendermode;
 
     switch (rendermode) {
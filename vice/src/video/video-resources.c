@@ -47,6 +47,7 @@
 #include "machine.h"
 #include "resources.h"
 #include "video-color.h"
+#include "video-render-worker.h"
 #include "video.h"
 #include "viewport.h"
 #include "util.h"
@@ -55,13 +56,74 @@
 /*-----------------------------------------------------------------------*/
 /* global resources.  */
 
+int video_output = VIDEO_OUTPUT_NORMAL;
+
+/** \brief  Setter for the integer resource "VideoOutput"
+ *
+ * With VIDEO_OUTPUT_NONE the video chips still emulate everything that has
+ * a visible effect on the machine (timing, DMA, collisions, light pen), but
+ * skip refreshing the canvas, and the line based chips skip drawing lines
+ * without sprites.  Nothing that goes into a snapshot changes, which is why
+ * the resource is not relevant for event history and netplay.
+ *
+ * \param[in]   val     VIDEO_OUTPUT_NONE or VIDEO_OUTPUT_NORMAL
+ * \param[in]   param   unused
+ *
+ * \return  0 on success, -1 on invalid value
+ */
+static int set_video_output(int val, void *param)
+{
+    switch (val) {
+        case VIDEO_OUTPUT_NONE:
+        case VIDEO_OUTPUT_NORMAL:
+            break;
+        default:
+            return -1;
+    }
+    video_output = val;
+    return 0;
+}
+
+int video_render_thread = 0;
+
+/** \brief  Setter for the boolean resource "VideoRenderThread"
+ *
+ * When disabled, the frames still queued on the render thread are completed
+ * before returning.
+ *
+ * \param[in]   val     render frames on a worker thread
+ * \param[in]   param   unused
+ *
+ * \return  0
+ */
+static int set_video_render_thread(int val, void *param)
+{
+    video_render_thread = val ? 1 : 0;
+    if (!video_render_thread) {
+        video_render_worker_wait_all();
+    }
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "VideoOutput", VIDEO_OUTPUT_NORMAL, RES_EVENT_NO, NULL,
+      &video_output, set_video_output, NULL },
+    { "VideoRenderThread", 0, RES_EVENT_NO, NULL,
+      &video_render_thread, set_video_render_thread, NULL },
+    RESOURCE_INT_LIST_END
+};
+
 int video_resources_init(void)
 {
+    if (resources_register_int(resources_int) < 0) {
+        return -1;
+    }
     return video_arch_resources_init();
 }
 
 void video_resources_shutdown(void)
 {
+    video_render_worker_shutdown();
     video_arch_resources_shutdown();
 }
 
@@ -64,6 +64,7 @@
 #endif
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
 #include "sound.h"
 #include "types.h"
 #include "videoarch.h"
@@ -683,6 +684,8 @@ void vsync_do_vsync(struct video_canvas_s *c)
 
     vsync_hook();
 
+    rewind_vsync_hook();
+
     if (network_connected()) {
         /* TODO - re-eval if any of this network stuff makes sense */
         network_hook_time = tick_now_delta(network_hook_time);
@@ -67,6 +67,9 @@ static uint8_t iff2_2 = 0;
 
 static uint8_t halt = 0;
 
+/* created when the Z80 runs for the first time */
+static sampleprof_cpu_t *z80_sampleprof = NULL;
+
 /* See: https://gist.github.com/drhelius/8497817
    for proper implementation of the BIT flags.
    Called either memptr or WZ (reg_wz) */
@@ -739,6 +742,9 @@ static void export_registers(void)
                     JUMP(jumpdst);                                                        \
                     CLK_ADD(CLK, 6);                                                      \
                 }                                                                         \
+                if (z80_sampleprof->active) {                                             \
+                    sampleprof_interrupt(z80_sampleprof, jumpdst, reg_sp);                \
+                }                                                                         \
                 interrupt_ack_irq(cpu_int_status);                                        \
             }                                                                             \
         }                                                                                 \
@@ -952,6 +958,9 @@ static void export_registers(void)
         --reg_sp;                                           \
         STORE((reg_sp), ((uint8_t)(z80_reg_pc & 0xff)));       \
         JUMP(reg_val);                                      \
+        if (z80_sampleprof->active) {                       \
+            sampleprof_call(z80_sampleprof, (uint16_t)z80_reg_pc, reg_sp); \
+        }                                                   \
         CLK_ADD(CLK, clk_inc3);                             \
     } while (0)
 
@@ -1620,6 +1629,9 @@ static void export_registers(void)
     do {                                  \
         uint16_t tmp;                         \
                                           \
+        if (z80_sampleprof->active) {     \
+            sampleprof_return(z80_sampleprof, reg_sp); \
+        }                                 \
         CLK_ADD(CLK, clk_inc1);           \
         tmp = LOAD(reg_sp);               \
         CLK_ADD(CLK, clk_inc2);           \
@@ -1643,6 +1655,9 @@ static void export_registers(void)
     do {                                \
         uint16_t tmp;                       \
                                         \
+        if (z80_sampleprof->active) {   \
+            sampleprof_return(z80_sampleprof, reg_sp); \
+        }                               \
         CLK_ADD(CLK, 4);                \
         tmp = LOAD(reg_sp);             \
         CLK_ADD(CLK, 4);                \
@@ -4030,6 +4045,12 @@ static void z80_maincpu_loop(interrupt_cpu_status_t *cpu_int_status, alarm_conte
 
     import_registers();
 
+    if (z80_sampleprof == NULL) {
+        z80_sampleprof = sampleprof_cpu_new("z80", cpu_alarm_context,
+                                            cpu_int_status, &CLK, NULL, NULL);
+    }
+    sampleprof_cpu_switch(maincpu_sampleprof, z80_sampleprof);
+
     Z80_SET_DMA_REQUEST(0)
 
     do {
@@ -5028,5 +5049,6 @@ fetchmore:
 
     } while (Z80_LOOP_COND);
 
+    sampleprof_cpu_switch(z80_sampleprof, maincpu_sampleprof);
     export_registers();
 }